@@ -0,0 +1,373 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <random>
+#include <cmath>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <pumex/Pumex.h>
+#include <args.hxx>
+
+// pumexallocatorreplay replays a trace of allocate/free calls against allocation strategies available in DeviceMemoryAllocator
+// ( FIRST_FIT and TLSF ) and measures the time spent in allocation strategies.
+// Trace may be loaded from a text file or generated procedurally ( and saved for later use ). Each line of a trace file is either :
+//   a <id> <size> <alignment>  - allocation of memory identified by id
+//   f <id>                     - release of memory allocated earlier under id
+// Lines starting with # are ignored.
+// Memory is not allocated from Vulkan - MockDeviceMemory manages blocks of memory with fake VkDeviceMemory handles the same way
+// DeviceMemoryAllocator does it, so no Vulkan device is required.
+
+struct TraceEntry
+{
+  enum Type { Allocate, Free };
+  TraceEntry(Type t, uint32_t i, VkDeviceSize s, VkDeviceSize a)
+    : type{ t }, id{ i }, size{ s }, alignment{ a }
+  {
+  }
+  Type         type;
+  uint32_t     id;
+  VkDeviceSize size;
+  VkDeviceSize alignment;
+};
+
+void loadTrace(const std::string& fileName, std::vector<TraceEntry>& trace)
+{
+  std::ifstream file(fileName);
+  CHECK_LOG_THROW(!file, "Cannot open file " << fileName);
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline(file, line))
+  {
+    lineNumber++;
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream str(line);
+    char type;
+    uint32_t id;
+    str >> type >> id;
+    CHECK_LOG_THROW(str.fail(), "Trace error in line " << lineNumber << " : " << line);
+    if (type == 'a')
+    {
+      VkDeviceSize size, alignment;
+      str >> size >> alignment;
+      CHECK_LOG_THROW(str.fail() || size == 0, "Trace error in line " << lineNumber << " : " << line);
+      trace.emplace_back(TraceEntry::Allocate, id, size, alignment);
+    }
+    else if (type == 'f')
+      trace.emplace_back(TraceEntry::Free, id, 0, 0);
+    else
+      CHECK_LOG_THROW(true, "Trace error in line " << lineNumber << " : " << line);
+  }
+}
+
+void saveTrace(const std::string& fileName, const std::vector<TraceEntry>& trace)
+{
+  std::ofstream file(fileName);
+  CHECK_LOG_THROW(!file, "Cannot open file " << fileName);
+  file << "# pumex allocator trace" << std::endl;
+  for (const auto& entry : trace)
+  {
+    if (entry.type == TraceEntry::Allocate)
+      file << "a " << entry.id << " " << entry.size << " " << entry.alignment << std::endl;
+    else
+      file << "f " << entry.id << std::endl;
+  }
+}
+
+// workload resembling a streaming application : many small buffers ( uniform buffers, vertex/index buffers of small objects )
+// mixed with fewer big images. Live allocations are released in random order, so memory becomes fragmented
+void generateTrace(uint32_t operationCount, uint32_t liveCount, std::default_random_engine& randomEngine, std::vector<TraceEntry>& trace)
+{
+  std::uniform_real_distribution<double> randomValue(0.0, 1.0);
+  std::vector<uint32_t> liveIDs;
+  uint32_t nextID = 0;
+  for (uint32_t i = 0; i < operationCount; ++i)
+  {
+    // number of live allocations oscillates around liveCount
+    bool allocate = liveIDs.empty() || randomValue(randomEngine) < (liveIDs.size() < liveCount ? 0.75 : 0.25);
+    if (allocate)
+    {
+      bool image = randomValue(randomEngine) < 0.1;
+      // sizes are log-uniform : 256 B - 256 kB for buffers, 64 kB - 8 MB for images
+      double minLog2 = image ? 16.0 : 8.0;
+      double maxLog2 = image ? 23.0 : 18.0;
+      VkDeviceSize size      = static_cast<VkDeviceSize>(std::pow(2.0, minLog2 + (maxLog2 - minLog2) * randomValue(randomEngine)));
+      VkDeviceSize alignment = image ? 4096 : 256;
+      trace.emplace_back(TraceEntry::Allocate, nextID, size, alignment);
+      liveIDs.push_back(nextID++);
+    }
+    else
+    {
+      std::uniform_int_distribution<size_t> randomIndex(0, liveIDs.size() - 1);
+      size_t index = randomIndex(randomEngine);
+      trace.emplace_back(TraceEntry::Free, liveIDs[index], 0, 0);
+      liveIDs[index] = liveIDs.back();
+      liveIDs.pop_back();
+    }
+  }
+  // release everything that is still alive, so that replay always ends with empty memory
+  for (auto id : liveIDs)
+    trace.emplace_back(TraceEntry::Free, id, 0, 0);
+}
+
+// MockDeviceMemory mimics DeviceMemoryAllocator::allocate() / DeviceMemoryAllocator::deallocate() : it tries to fit data in existing blocks of memory,
+// creates new block when none of them has free space ( data bigger than blockSize gets its own block ) and releases empty blocks except the first one.
+// Blocks of memory are identified by fake VkDeviceMemory handles and no memory is allocated from Vulkan
+class MockDeviceMemory
+{
+public:
+  MockDeviceMemory(pumex::DeviceMemoryAllocator::EnumStrategy s, VkDeviceSize bs)
+    : strategy{ s }, blockSize{ bs }
+  {
+  }
+
+  pumex::DeviceMemoryBlock allocate(VkMemoryRequirements memoryRequirements)
+  {
+    for (auto& sb : storageBlocks)
+    {
+      pumex::DeviceMemoryBlock block = sb.allocationStrategy->allocate(sb.storageMemory, memoryRequirements);
+      if (block.alignedSize > 0)
+      {
+        sb.allocationCount++;
+        return block;
+      }
+    }
+    VkDeviceSize newBlockSize = std::max(blockSize, memoryRequirements.size + std::max<VkDeviceSize>(1, memoryRequirements.alignment) - 1);
+    storageBlocks.push_back(StorageBlock{ (VkDeviceMemory)(nextMemoryHandle++), newBlockSize, 0, pumex::DeviceMemoryAllocator::createAllocationStrategy(strategy, newBlockSize) });
+    vkAllocateMemoryCount++;
+    peakBlockCount = std::max<uint32_t>(peakBlockCount, storageBlocks.size());
+
+    auto& sb = storageBlocks.back();
+    pumex::DeviceMemoryBlock block = sb.allocationStrategy->allocate(sb.storageMemory, memoryRequirements);
+    CHECK_LOG_THROW(block.alignedSize == 0, "memory allocation failed : " << memoryRequirements.size);
+    sb.allocationCount++;
+    return block;
+  }
+
+  void deallocate(const pumex::DeviceMemoryBlock& block)
+  {
+    auto sbit = std::find_if(begin(storageBlocks), end(storageBlocks), [&block](const StorageBlock& sb) { return sb.storageMemory == block.memory; });
+    CHECK_LOG_THROW(sbit == end(storageBlocks), "Cannot deallocate memory - memory block does not belong to this allocator");
+    sbit->allocationStrategy->deallocate(block);
+    sbit->allocationCount--;
+    if (sbit->allocationCount == 0 && sbit != begin(storageBlocks))
+      storageBlocks.erase(sbit);
+  }
+
+  // free space of all blocks : total free bytes and the largest free block
+  void getFreeSpace(VkDeviceSize& freeBytes, VkDeviceSize& largestFreeBlock) const
+  {
+    freeBytes        = 0;
+    largestFreeBlock = 0;
+    std::vector<pumex::FreeBlock> freeBlocks;
+    for (const auto& sb : storageBlocks)
+    {
+      freeBlocks.clear();
+      sb.allocationStrategy->getFreeBlocks(freeBlocks);
+      for (const auto& fb : freeBlocks)
+      {
+        freeBytes        += fb.size;
+        largestFreeBlock = std::max(largestFreeBlock, fb.size);
+      }
+    }
+  }
+
+  inline VkDeviceSize getReservedBytes() const;
+
+  uint32_t vkAllocateMemoryCount = 0;
+  uint32_t peakBlockCount        = 0;
+protected:
+  struct StorageBlock
+  {
+    VkDeviceMemory                             storageMemory;
+    VkDeviceSize                               size;
+    uint32_t                                   allocationCount;
+    std::unique_ptr<pumex::AllocationStrategy> allocationStrategy;
+  };
+
+  pumex::DeviceMemoryAllocator::EnumStrategy strategy;
+  VkDeviceSize                               blockSize;
+  std::vector<StorageBlock>                  storageBlocks;
+  uint64_t                                   nextMemoryHandle = 1;
+};
+
+VkDeviceSize MockDeviceMemory::getReservedBytes() const
+{
+  VkDeviceSize result = 0;
+  for (const auto& sb : storageBlocks)
+    result += sb.size;
+  return result;
+}
+
+struct ReplayResult
+{
+  double       time                  = 0.0;
+  uint32_t     vkAllocateMemoryCount = 0;
+  uint32_t     peakBlockCount        = 0;
+  VkDeviceSize peakUsedBytes         = 0;
+  VkDeviceSize peakReservedBytes     = 0;
+  // fragmentation measured when the number of live allocations was the highest : 1 - largest free block / free bytes
+  double       fragmentation         = 0.0;
+};
+
+ReplayResult replayTrace(const std::vector<TraceEntry>& trace, pumex::DeviceMemoryAllocator::EnumStrategy strategy, VkDeviceSize blockSize)
+{
+  ReplayResult result;
+  MockDeviceMemory memory(strategy, blockSize);
+  std::unordered_map<uint32_t, pumex::DeviceMemoryBlock> liveBlocks;
+  VkDeviceSize usedBytes = 0;
+  size_t peakLiveCount   = 0;
+
+  // only calls to MockDeviceMemory are timed
+  pumex::HPClock::duration replayDuration(0);
+  for (const auto& entry : trace)
+  {
+    if (entry.type == TraceEntry::Allocate)
+    {
+      CHECK_LOG_THROW(liveBlocks.find(entry.id) != end(liveBlocks), "Trace allocates id " << entry.id << " twice");
+      VkMemoryRequirements memoryRequirements{ entry.size, entry.alignment, 0xFFFFFFFF };
+      auto startTime = pumex::HPClock::now();
+      pumex::DeviceMemoryBlock block = memory.allocate(memoryRequirements);
+      replayDuration += pumex::HPClock::now() - startTime;
+      liveBlocks.insert({ entry.id, block });
+      usedBytes += block.alignedSize;
+      result.peakUsedBytes     = std::max(result.peakUsedBytes, usedBytes);
+      result.peakReservedBytes = std::max(result.peakReservedBytes, memory.getReservedBytes());
+      if (liveBlocks.size() > peakLiveCount)
+      {
+        peakLiveCount = liveBlocks.size();
+        VkDeviceSize freeBytes, largestFreeBlock;
+        memory.getFreeSpace(freeBytes, largestFreeBlock);
+        result.fragmentation = (freeBytes > 0) ? 1.0 - (double)largestFreeBlock / (double)freeBytes : 0.0;
+      }
+    }
+    else
+    {
+      auto it = liveBlocks.find(entry.id);
+      CHECK_LOG_THROW(it == end(liveBlocks), "Trace frees id " << entry.id << " that is not allocated");
+      auto startTime = pumex::HPClock::now();
+      memory.deallocate(it->second);
+      replayDuration += pumex::HPClock::now() - startTime;
+      usedBytes -= it->second.alignedSize;
+      liveBlocks.erase(it);
+    }
+  }
+  result.time                  = pumex::inSeconds(replayDuration);
+  result.vkAllocateMemoryCount = memory.vkAllocateMemoryCount;
+  result.peakBlockCount        = memory.peakBlockCount;
+  return result;
+}
+
+int main(int argc, char * argv[])
+{
+  SET_LOG_INFO;
+
+  args::ArgumentParser         parser("pumex example : allocation strategy trace replay");
+  args::HelpFlag               help(parser, "help", "display this help menu", { 'h', "help" });
+  args::ValueFlag<std::string> traceFileName(parser, "trace", "load allocation trace from file", { 't', "trace" });
+  args::ValueFlag<std::string> outputFileName(parser, "output", "save generated allocation trace to file", { 'o', "output" });
+  args::ValueFlag<uint32_t>    operationCountFlag(parser, "operations", "number of operations in generated trace", { 'n' }, 100000);
+  args::ValueFlag<uint32_t>    liveCountFlag(parser, "live", "average number of live allocations in generated trace", { 'l' }, 2000);
+  args::ValueFlag<uint32_t>    blockSizeFlag(parser, "block_size", "size of memory block in MB", { 'b' }, 64);
+  args::ValueFlag<uint32_t>    repeatCountFlag(parser, "repeat", "number of replays for each strategy", { 'r' }, 5);
+  try
+  {
+    parser.ParseCLI(argc, argv);
+  }
+  catch (const args::Help&)
+  {
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 0;
+  }
+  catch (const args::ParseError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+  catch (const args::ValidationError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+
+  uint32_t     operationCount = std::max(1U, args::get(operationCountFlag));
+  uint32_t     liveCount      = std::max(1U, args::get(liveCountFlag));
+  VkDeviceSize blockSize      = std::max(1U, args::get(blockSizeFlag)) * 1024ULL * 1024ULL;
+  uint32_t     repeatCount    = std::max(1U, args::get(repeatCountFlag));
+
+  int result = 0;
+  try
+  {
+    std::vector<TraceEntry> trace;
+    if (traceFileName)
+    {
+      loadTrace(args::get(traceFileName), trace);
+    }
+    else
+    {
+      std::default_random_engine randomEngine;
+      generateTrace(operationCount, liveCount, randomEngine, trace);
+    }
+    if (outputFileName)
+      saveTrace(args::get(outputFileName), trace);
+
+    uint32_t allocationCount = std::count_if(begin(trace), end(trace), [](const TraceEntry& entry) { return entry.type == TraceEntry::Allocate; });
+    LOG_INFO << "Trace : " << trace.size() << " operations, " << allocationCount << " allocations, block size " << blockSize / (1024 * 1024) << " MB" << std::endl;
+
+    std::vector<pumex::DeviceMemoryAllocator::EnumStrategy> strategies{ pumex::DeviceMemoryAllocator::FIRST_FIT, pumex::DeviceMemoryAllocator::TLSF };
+    std::vector<std::string>                                strategyNames{ "FIRST_FIT", "TLSF" };
+    for (uint32_t s = 0; s < strategies.size(); ++s)
+    {
+      // the best time of all replays is reported
+      ReplayResult bestResult;
+      for (uint32_t r = 0; r < repeatCount; ++r)
+      {
+        ReplayResult replayResult = replayTrace(trace, strategies[s], blockSize);
+        if (r == 0 || replayResult.time < bestResult.time)
+          bestResult = replayResult;
+      }
+      LOG_INFO << std::left << std::setw(10) << strategyNames[s] << " : " << std::right << std::fixed << std::setprecision(3) << std::setw(9) << 1000.0 * bestResult.time << " ms, ";
+      LOG_INFO << std::setprecision(1) << std::setw(7) << 1.0e9 * bestResult.time / trace.size() << " ns per operation, ";
+      LOG_INFO << bestResult.vkAllocateMemoryCount << " memory blocks allocated ( peak " << bestResult.peakBlockCount << " ), ";
+      LOG_INFO << "peak used " << bestResult.peakUsedBytes / (1024 * 1024) << " MB, peak reserved " << bestResult.peakReservedBytes / (1024 * 1024) << " MB, ";
+      LOG_INFO << "fragmentation " << std::setprecision(3) << bestResult.fragmentation << std::endl;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    LOG_ERROR << "Exception thrown : " << e.what() << std::endl;
+    result = 1;
+  }
+  catch (...)
+  {
+    LOG_ERROR << "Unknown error" << std::endl;
+    result = 1;
+  }
+  FLUSH_LOG;
+  return result;
+}
@@ -0,0 +1,244 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <random>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <pumex/Pumex.h>
+#include <args.hxx>
+
+// pumexanimationbenchmark measures CPU cost of calculating bone matrices for many animated instances using different methods :
+// - per instance evaluation with binary search of keyframes ( Animation::calculateLocalTransforms() followed by a walk through skeleton )
+// - per instance evaluation with keyframe cursors ( AnimationCursor )
+// - batched evaluation ( AnimationEvaluator ) with binary search and with keyframe cursors
+// - per instance evaluation of compressed animation ( CompressedAnimation )
+// Skeleton and animation are generated procedurally, so no files and no Vulkan device are required.
+
+// each bone has up to three children, so the skeleton resembles a character with limbs
+void createSkeleton(uint32_t boneCount, pumex::Skeleton& skeleton)
+{
+  skeleton.bones.resize(boneCount);
+  for (uint32_t i = 0; i < boneCount; ++i)
+  {
+    auto& bone = skeleton.bones[i];
+    if (i > 0)
+      bone.parentIndex = (i - 1) / 3;
+    bone.localTransformation = glm::translate(glm::mat4(), glm::vec3(0.0f, 0.1f, 0.0f));
+    bone.offsetMatrix        = glm::translate(glm::mat4(), glm::vec3(0.0f, -0.1f * i, 0.0f));
+    skeleton.boneNames.push_back("bone" + std::to_string(i));
+    skeleton.invBoneNames.insert({ skeleton.boneNames.back(), i });
+  }
+  skeleton.refreshChildren();
+}
+
+// every bone is animated, keyframes are sampled with constant frequency like in most exported animations
+void createAnimation(const pumex::Skeleton& skeleton, float duration, float keysPerSecond, std::default_random_engine& randomEngine, pumex::Animation& animation)
+{
+  std::uniform_real_distribution<float> randomValue(-1.0f, 1.0f);
+  uint32_t keyCount = std::max(2U, static_cast<uint32_t>(duration * keysPerSecond) + 1);
+  animation.name = "benchmark";
+  for (uint32_t i = 0; i < skeleton.bones.size(); ++i)
+  {
+    pumex::Animation::Channel channel;
+    for (uint32_t k = 0; k < keyCount; ++k)
+    {
+      float time = duration * k / (keyCount - 1);
+      glm::vec3 axis(randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine) + 2.0f);
+      channel.position.emplace_back(time, glm::vec3(0.0f, 0.1f, 0.0f) + 0.01f * glm::vec3(randomValue(randomEngine), randomValue(randomEngine), randomValue(randomEngine)));
+      channel.rotation.emplace_back(time, glm::angleAxis(randomValue(randomEngine), glm::normalize(axis)));
+      channel.scale.emplace_back(time, glm::vec3(1.0f, 1.0f, 1.0f));
+    }
+    channel.calcBeginEndTimes();
+    animation.channels.push_back(channel);
+    animation.channelBefore.push_back(pumex::Animation::Channel::REPEAT);
+    animation.channelAfter.push_back(pumex::Animation::Channel::REPEAT);
+    animation.channelNames.push_back(skeleton.boneNames[i]);
+    animation.invChannelNames.insert({ skeleton.boneNames[i], i });
+  }
+}
+
+// memory used by keyframes of uncompressed animation
+std::size_t getMemorySize(const pumex::Animation& animation)
+{
+  std::size_t result = animation.channels.size() * sizeof(pumex::Animation::Channel);
+  for (const auto& channel : animation.channels)
+    result += channel.position.size() * sizeof(pumex::TimeLine<glm::vec3>) + channel.rotation.size() * sizeof(pumex::TimeLine<glm::quat>) + channel.scale.size() * sizeof(pumex::TimeLine<glm::vec3>);
+  return result;
+}
+
+// bone matrices calculated from local transforms the way pumex examples do it
+void calculateBoneMatrices(const pumex::Skeleton& skeleton, const std::vector<glm::mat4>& localTransforms, std::vector<glm::mat4>& globalTransforms, glm::mat4* boneMatrices)
+{
+  uint32_t numSkelBones = skeleton.bones.size();
+  // channel i animates bone i
+  globalTransforms[0] = skeleton.invGlobalTransform * localTransforms[0];
+  for (uint32_t boneIndex = 1; boneIndex < numSkelBones; ++boneIndex)
+    globalTransforms[boneIndex] = globalTransforms[skeleton.bones[boneIndex].parentIndex] * localTransforms[boneIndex];
+  for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
+    boneMatrices[boneIndex] = globalTransforms[boneIndex] * skeleton.bones[boneIndex].offsetMatrix;
+}
+
+int main(int argc, char * argv[])
+{
+  SET_LOG_INFO;
+
+  args::ArgumentParser      parser("pumex example : skeletal animation benchmark");
+  args::HelpFlag            help(parser, "help", "display this help menu", { 'h', "help" });
+  args::ValueFlag<uint32_t> instanceCountFlag(parser, "instances", "number of animated instances", { 'i' }, 10000);
+  args::ValueFlag<uint32_t> boneCountFlag(parser, "bones", "number of bones in a skeleton", { 'b' }, 60);
+  args::ValueFlag<uint32_t> frameCountFlag(parser, "frames", "number of evaluated frames", { 'f' }, 100);
+  args::ValueFlag<float>    keysPerSecondFlag(parser, "keys", "keyframes per second", { 'k' }, 30.0f);
+  try
+  {
+    parser.ParseCLI(argc, argv);
+  }
+  catch (const args::Help&)
+  {
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 0;
+  }
+  catch (const args::ParseError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+  catch (const args::ValidationError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+
+  uint32_t instanceCount = std::max(1U, args::get(instanceCountFlag));
+  uint32_t boneCount     = std::max(1U, args::get(boneCountFlag));
+  uint32_t frameCount    = std::max(1U, args::get(frameCountFlag));
+  float    keysPerSecond = std::max(1.0f, args::get(keysPerSecondFlag));
+  // instances are evaluated at 60 frames per second
+  float    frameDelta    = 1.0f / 60.0f;
+
+  int result = 0;
+  try
+  {
+    std::default_random_engine randomEngine;
+    pumex::Skeleton  skeleton;
+    pumex::Animation animation;
+    createSkeleton(boneCount, skeleton);
+    createAnimation(skeleton, 4.0f, keysPerSecond, randomEngine, animation);
+    pumex::AnimationEvaluator          evaluator(skeleton, animation);
+    pumex::AnimationEvaluatorWorkspace evaluatorWorkspace;
+    pumex::CompressedAnimation compressedAnimation(animation);
+    LOG_INFO << "Animation memory : " << getMemorySize(animation) << " bytes, compressed animation memory : " << compressedAnimation.getMemorySize() << " bytes" << std::endl;
+
+    std::uniform_real_distribution<float> randomOffset(0.0f, 4.0f);
+    std::vector<float> animationOffsets(instanceCount);
+    for (auto& offset : animationOffsets)
+      offset = randomOffset(randomEngine);
+
+    std::vector<float>                   times(instanceCount);
+    std::vector<pumex::AnimationCursor>  cursors(instanceCount);
+    std::vector<pumex::AnimationCursor*> cursorPointers(instanceCount);
+    std::vector<glm::mat4>               referenceMatrices(instanceCount * boneCount);
+    std::vector<glm::mat4>               matrices(instanceCount * boneCount);
+    std::vector<glm::mat4*>              matrixPointers(instanceCount);
+    std::vector<glm::mat4>               localTransforms(boneCount), globalTransforms(boneCount);
+    for (uint32_t i = 0; i < instanceCount; ++i)
+    {
+      cursorPointers[i] = &cursors[i];
+      matrixPointers[i] = matrices.data() + i * boneCount;
+    }
+
+    enum Method { BinarySearch, Cursors, Evaluator, EvaluatorCursors, Compressed };
+    std::vector<std::string> methodNames{ "binary search", "cursors", "evaluator", "evaluator + cursors", "compressed" };
+    std::vector<double>      methodTimes;
+    for (uint32_t method = BinarySearch; method <= Compressed; ++method)
+    {
+      for (auto& cursor : cursors)
+        cursor.channels.clear();
+      auto startTime = pumex::HPClock::now();
+      for (uint32_t frame = 0; frame < frameCount; ++frame)
+      {
+        for (uint32_t i = 0; i < instanceCount; ++i)
+          times[i] = frame * frameDelta + animationOffsets[i];
+        switch (method)
+        {
+        case BinarySearch:
+          for (uint32_t i = 0; i < instanceCount; ++i)
+          {
+            animation.calculateLocalTransforms(times[i], localTransforms.data(), boneCount);
+            calculateBoneMatrices(skeleton, localTransforms, globalTransforms, matrixPointers[i]);
+          }
+          break;
+        case Cursors:
+          for (uint32_t i = 0; i < instanceCount; ++i)
+          {
+            animation.calculateLocalTransforms(times[i], localTransforms.data(), boneCount, cursors[i]);
+            calculateBoneMatrices(skeleton, localTransforms, globalTransforms, matrixPointers[i]);
+          }
+          break;
+        case Evaluator:
+          evaluator.evaluate(times.data(), matrixPointers.data(), instanceCount, evaluatorWorkspace);
+          break;
+        case EvaluatorCursors:
+          evaluator.evaluate(times.data(), cursorPointers.data(), matrixPointers.data(), instanceCount, evaluatorWorkspace);
+          break;
+        case Compressed:
+          for (uint32_t i = 0; i < instanceCount; ++i)
+          {
+            compressedAnimation.calculateLocalTransforms(times[i], localTransforms.data(), boneCount);
+            calculateBoneMatrices(skeleton, localTransforms, globalTransforms, matrixPointers[i]);
+          }
+          break;
+        }
+      }
+      methodTimes.push_back(pumex::inSeconds(pumex::HPClock::now() - startTime));
+
+      // results of the last frame are compared with results of binary search
+      if (method == BinarySearch)
+        referenceMatrices = matrices;
+      float maxDifference = 0.0f;
+      for (uint32_t i = 0; i < matrices.size(); ++i)
+        for (uint32_t c = 0; c < 4; ++c)
+          for (uint32_t r = 0; r < 4; ++r)
+            maxDifference = std::max(maxDifference, std::abs(matrices[i][c][r] - referenceMatrices[i][c][r]));
+
+      LOG_INFO << std::left << std::setw(20) << methodNames[method] << " : " << std::right << std::fixed << std::setprecision(3) << std::setw(9) << 1000.0 * methodTimes[method] / frameCount << " ms per frame, ";
+      LOG_INFO << std::setprecision(2) << std::setw(6) << methodTimes[0] / methodTimes[method] << "x, max difference " << std::scientific << maxDifference << std::endl;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    LOG_ERROR << "Exception thrown : " << e.what() << std::endl;
+    result = 1;
+  }
+  catch (...)
+  {
+    LOG_ERROR << "Unknown error" << std::endl;
+    result = 1;
+  }
+  FLUSH_LOG;
+  return result;
+}
@@ -31,6 +31,7 @@
 #include <tbb/tbb.h>
 #include <pumex/Pumex.h>
 #include <pumex/AssetLoaderAssimp.h>
+#include <pumex/TextureLoaderGli.h>
 #include <args.hxx>
 
 
@@ -50,6 +51,7 @@
 
 const uint32_t MAX_BONES = 63;
 const uint32_t MAIN_RENDER_MASK = 1;
+const float    ANIMATION_TRANSITION_DURATION = 0.5f;
 
 // Structure storing information about people and objects.
 // Structure is used by update loop to update its parameters.
@@ -58,16 +60,18 @@ const uint32_t MAIN_RENDER_MASK = 1;
 struct ObjectData
 {
   ObjectData()
-    : animation{ 0 }, animationOffset{ 0.0f }, typeID{ 0 }, materialVariant{ 0 }, time2NextTurn { 0.0f }, ownerID{ std::numeric_limits<uint32_t>::max() }
+    : animation{ 0 }, animationOffset{ 0.0f }, previousAnimation{ 0 }, transitionTime{ 0.0f }, typeID{ 0 }, materialVariant{ 0 }, time2NextTurn { 0.0f }, ownerID{ std::numeric_limits<uint32_t>::max() }
   {
   }
-  pumex::Kinematic kinematic;       // not used by clothes
-  uint32_t         animation;       // not used by clothes
-  float            animationOffset; // not used by clothes
+  pumex::Kinematic kinematic;         // not used by clothes
+  uint32_t         animation;         // not used by clothes
+  float            animationOffset;   // not used by clothes
+  uint32_t         previousAnimation; // not used by clothes
+  float            transitionTime;    // time left to the end of transition from previous animation, not used by clothes
   uint32_t         typeID;
   uint32_t         materialVariant;
-  float            time2NextTurn;   // not used by clothes
-  uint32_t         ownerID;         // not used by people
+  float            time2NextTurn;     // not used by clothes
+  uint32_t         ownerID;           // not used by people
 };
 
 struct UpdateData
@@ -133,21 +137,32 @@ struct MaterialData
 
 struct SkelAnimKey
 {
-  SkelAnimKey(uint32_t s, uint32_t a)
-    : skelID{ s }, animID{ a }
+  SkelAnimKey(uint32_t s, uint32_t a, uint32_t l = 0)
+    : skelID{ s }, animID{ a }, lodID{ l }
   {
   }
   uint32_t skelID;
   uint32_t animID;
+  uint32_t lodID;
 };
 
 inline bool operator<(const SkelAnimKey& lhs, const SkelAnimKey& rhs)
 {
   if (lhs.skelID != rhs.skelID)
+    return lhs.skelID < rhs.skelID;
+  if (lhs.animID != rhs.animID)
     return lhs.animID < rhs.animID;
-  return lhs.skelID < rhs.skelID;
+  return lhs.lodID < rhs.lodID;
 }
 
+// temporary data used by each thread that blends animations
+struct AnimationBlendData
+{
+  pumex::BlendWorkspace workspace;
+  pumex::SkeletonPose   pose;
+  std::vector<float>    parameters;
+};
+
 // global variables storing model file names etc
 std::vector<std::tuple<std::string, float>> animationDefinitions
 {
@@ -225,7 +240,11 @@ struct CrowdApplicationData
   std::vector<uint32_t>                                     accessoryObjectTypeID;
   std::map<uint32_t, uint32_t>                              materialVariantCount;
 
-  std::map<SkelAnimKey, std::vector<uint32_t>>              skelAnimBoneMapping;
+  std::map<SkelAnimKey, std::shared_ptr<pumex::AnimationEvaluator>> animationEvaluators;
+  std::vector<pumex::AnimationCursor>                       animationCursors;
+  pumex::AnimationLodScheduler                              animationLodScheduler;
+  std::map<uint32_t, std::shared_ptr<pumex::BlendTree>>     blendTrees;
+  tbb::enumerable_thread_specific<AnimationBlendData>       animationBlendData;
 
   std::default_random_engine                                randomEngine;
   std::exponential_distribution<float>                      randomTime2NextTurn;
@@ -234,6 +253,9 @@ struct CrowdApplicationData
 
   std::shared_ptr<pumex::AssetBuffer>                       skeletalAssetBuffer;
   std::shared_ptr<pumex::AssetBufferFilterNode>             filterNode;
+  std::shared_ptr<pumex::SkinningPaletteNode>               skinningPaletteNode;
+  std::map<SkelAnimKey, uint32_t>                           skinningClips;
+  std::vector<pumex::SkinningPaletteInstance>               skinningInstances;
 
   std::shared_ptr<pumex::Buffer<pumex::Camera>>             cameraBuffer;
   std::shared_ptr<pumex::Buffer<pumex::Camera>>             textCameraBuffer;
@@ -250,6 +272,8 @@ struct CrowdApplicationData
   CrowdApplicationData(std::shared_ptr<pumex::DeviceMemoryAllocator> buffersAllocator)
 	  : randomTime2NextTurn{ 0.25 }, randomRotation{ -glm::pi<float>(), glm::pi<float>() }
   {
+    // distant people are animated less often and without their smallest bones
+    animationLodScheduler.setPolicies({ pumex::AnimationLodPolicy(1, 0.0f), pumex::AnimationLodPolicy(2, 0.005f), pumex::AnimationLodPolicy(4, 0.01f) });
     cameraBuffer     = std::make_shared<pumex::Buffer<pumex::Camera>>(buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pumex::pbPerSurface, pumex::swOnce, true);
     textCameraBuffer = std::make_shared<pumex::Buffer<pumex::Camera>>(buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pumex::pbPerSurface, pumex::swOnce, true);
     positionData     = std::make_shared<std::vector<PositionData>>();
@@ -263,19 +287,39 @@ struct CrowdApplicationData
     camHandler = bcamHandler;
   }
 
+  // bone matrices of all people will be calculated by compute shader. Animation transitions are not blended then
+  void setSkinningPaletteNode(std::shared_ptr<pumex::SkinningPaletteNode> spNode)
+  {
+    skinningPaletteNode = spNode;
+    for (auto typeID : mainObjectTypeID)
+      for (uint32_t animID = 0; animID < animations.size(); ++animID)
+        skinningClips[SkelAnimKey(typeID, animID)] = skinningPaletteNode->addClip(skeletons[typeID], animations[animID]);
+  }
+
   void setupModels(std::shared_ptr<pumex::Viewer> viewer, std::shared_ptr<pumex::AssetBuffer> assetBuffer, std::shared_ptr<pumex::MaterialSet> materialSet, const std::vector<pumex::VertexSemantic>& vertexSemantic)
   {
     skeletalAssetBuffer = assetBuffer;
 
-    pumex::AssetLoaderAssimp      loader;
+    // models are converted by assimp only once, later they are loaded from asset cache
+    // All files are requested at once and decoded in parallel. Results are registered below in the same order they were requested
+    pumex::AsyncLoader loader(std::make_shared<pumex::AssetLoaderCache>(std::make_shared<pumex::AssetLoaderAssimp>()), std::make_shared<pumex::TextureLoaderGli>());
 
-    // We assume that animations use the same skeleton as skeletal models
+    std::vector<std::shared_future<std::shared_ptr<pumex::Asset>>> animationFutures;
     for (auto& animDef : animationDefinitions)
+      animationFutures.push_back(loader.loadAsset(viewer, std::get<0>(animDef), true));
+
+    std::map<std::string, std::shared_future<std::shared_ptr<pumex::Asset>>> modelFutures;
+    for (auto& modelDef : modelDefinitions)
     {
-      std::shared_ptr<pumex::Asset> asset(loader.load(viewer, std::get<0>(animDef), true));
-      animations.push_back(asset->animations[0]);
+      for (const auto& fileName : { std::get<3>(modelDef), std::get<4>(modelDef), std::get<5>(modelDef) })
+        if (!fileName.empty() && modelFutures.find(fileName) == end(modelFutures))
+          modelFutures.insert({ fileName, loader.loadAsset(viewer, fileName, false, vertexSemantic) });
     }
 
+    // We assume that animations use the same skeleton as skeletal models
+    for (auto& animationFuture : animationFutures)
+      animations.push_back(animationFuture.get()->animations[0]);
+
     skeletons.push_back(pumex::Skeleton()); // empty skeleton for null type
     for (auto& modelDef : modelDefinitions)
     {
@@ -290,7 +334,7 @@ struct CrowdApplicationData
       {
         if (fileNames[j].empty())
           continue;
-        std::shared_ptr<pumex::Asset> asset(loader.load(viewer, fileNames[j],false,vertexSemantic));
+        std::shared_ptr<pumex::Asset> asset(modelFutures[fileNames[j]].get());
         if( j == 0 )
         {
           skeletons.push_back(asset->skeleton);
@@ -427,13 +471,20 @@ struct CrowdApplicationData
     // change rotation, animation and speed if bot requires it
     if (human.time2NextTurn < 0.0f)
     {
+      uint32_t previousAnimation  = human.animation;
       human.kinematic.orientation = glm::angleAxis(randomRotation(randomEngine), glm::vec3(0.0f, 0.0f, 1.0f));
       human.animation             = randomAnimation(randomEngine);
       human.kinematic.velocity    = glm::rotate(human.kinematic.orientation, glm::vec3(0, -1, 0)) * std::get<1>(animationDefinitions[human.animation]);
       human.time2NextTurn         = randomTime2NextTurn(randomEngine);
+      if (human.animation != previousAnimation)
+      {
+        human.previousAnimation = previousAnimation;
+        human.transitionTime    = ANIMATION_TRANSITION_DURATION;
+      }
     }
     else
       human.time2NextTurn -= updateStep;
+    human.transitionTime = std::max(0.0f, human.transitionTime - updateStep);
 
     // calculate new position
     human.kinematic.position += human.kinematic.velocity * updateStep;
@@ -506,64 +557,112 @@ struct CrowdApplicationData
 
     filterNode->setTypeCount(typeCount);
 
-    positionData->resize(0);
+    // bone matrices of people not updated in this frame are reused, so position data is not cleared
+    if (positionData->size() != rData.people.size())
+      animationLodScheduler.reset(rData.people.size());
+    positionData->resize(rData.people.size());
     instanceData->resize(0);
-    std::vector<uint32_t> animIndex;
-    std::vector<float> animOffset;
-    for (auto it = begin(rData.people); it != end(rData.people); ++it)
+
+    // animation LOD depends on distance to the nearest observer - the same distance that chooses geometry LOD
+    std::vector<glm::vec3> observerPositions;
+    for (auto surfaceID : viewer->getSurfaceIDs())
+    {
+      glm::vec4 observerPosition = camHandler->getObserverPosition(viewer->getSurface(surfaceID));
+      observerPositions.push_back(glm::vec3(observerPosition) / observerPosition.w);
+    }
+    uint64_t frameNumber = viewer->getFrameNumber();
+
+    // people using the same skeleton, animation and LOD are evaluated together, people changing animation are blended separately
+    std::map<SkelAnimKey, std::vector<uint32_t>> skelAnimInstances;
+    std::vector<uint32_t>                        blendedInstances;
+    skinningInstances.resize(0);
+    for (uint32_t index = 0; index < rData.people.size(); ++index)
     {
-      uint32_t index = positionData->size();
-      positionData->emplace_back(PositionData(pumex::extrapolate(it->kinematic, deltaTime)));
-      instanceData->emplace_back(InstanceData(index, it->typeID, it->materialVariant, 1));
+      const ObjectData& human = rData.people[index];
+      (*positionData)[index].position = pumex::extrapolate(human.kinematic, deltaTime);
+      instanceData->emplace_back(InstanceData(index, human.typeID, human.materialVariant, 1));
+
+      if (skinningPaletteNode.get() != nullptr)
+      {
+        skinningInstances.emplace_back(pumex::SkinningPaletteInstance(skinningClips.at(SkelAnimKey(human.typeID, human.animation)), renderTime + human.animationOffset, index));
+        continue;
+      }
+
+      float distanceToObserver = std::numeric_limits<float>::max();
+      for (const auto& observerPosition : observerPositions)
+        distanceToObserver = std::min(distanceToObserver, glm::distance(observerPosition, glm::vec3((*positionData)[index].position[3])));
+      uint32_t lodID = skeletalAssetBuffer->getLodID(human.typeID, distanceToObserver);
+      if (!animationLodScheduler.update(index, lodID, frameNumber))
+        continue;
 
-      animIndex.emplace_back(it->animation);
-      animOffset.emplace_back(it->animationOffset);
+      if (human.transitionTime > 0.0f)
+      {
+        getBlendTree(human.typeID);
+        blendedInstances.push_back(index);
+      }
+      else
+        skelAnimInstances[SkelAnimKey(human.typeID, human.animation, lodID)].push_back(index);
+    }
+
+    // each person remembers keyframes used in previous frame
+    animationCursors.resize(rData.people.size());
+
+    // divide instances into chunks that are evaluated in parallel
+    const uint32_t chunkSize = 64;
+    std::vector<float>                                                 animTimes;
+    std::vector<pumex::AnimationCursor*>                               cursors;
+    std::vector<glm::mat4*>                                            boneMatrices;
+    std::vector<std::tuple<pumex::AnimationEvaluator*, size_t, size_t>> chunks;
+    for (auto& sai : skelAnimInstances)
+    {
+      auto eit = animationEvaluators.find(sai.first);
+      if (eit == end(animationEvaluators))
+        eit = animationEvaluators.insert({ sai.first, createAnimationEvaluator(sai.first) }).first;
+      for (size_t first = 0; first < sai.second.size(); first += chunkSize)
+        chunks.push_back(std::make_tuple(eit->second.get(), animTimes.size() + first, std::min<size_t>(chunkSize, sai.second.size() - first)));
+      for (auto index : sai.second)
+      {
+        animTimes.push_back(renderTime + rData.people[index].animationOffset);
+        cursors.push_back(&animationCursors[index]);
+        boneMatrices.push_back((*positionData)[index].bones);
+      }
     }
 
     // calculate bone matrices for the people
     tbb::parallel_for
     (
-      tbb::blocked_range<size_t>(0, positionData->size()),
+      tbb::blocked_range<size_t>(0, chunks.size()),
       [&](const tbb::blocked_range<size_t>& r)
       {
         for (size_t i = r.begin(); i != r.end(); ++i)
         {
-          pumex::Animation& anim = animations[animIndex[i]];
-          pumex::Skeleton&  skel = skeletons[(*instanceData)[i].typeID];
-
-          uint32_t numAnimChannels = anim.channels.size();
-          uint32_t numSkelBones = skel.bones.size();
-          SkelAnimKey saKey((*instanceData)[i].typeID, animIndex[i]);
-
-          auto bmit = skelAnimBoneMapping.find(saKey);
-          if (bmit == end(skelAnimBoneMapping))
-          {
-            std::vector<uint32_t> boneChannelMapping(numSkelBones);
-            for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-            {
-              auto it = anim.invChannelNames.find(skel.boneNames[boneIndex]);
-              boneChannelMapping[boneIndex] = (it != end(anim.invChannelNames)) ? it->second : std::numeric_limits<uint32_t>::max();
-            }
-            bmit = skelAnimBoneMapping.insert({ saKey, boneChannelMapping }).first;
-          }
-
-          std::vector<glm::mat4> localTransforms(MAX_BONES);
-          std::vector<glm::mat4> globalTransforms(MAX_BONES);
-
-          const auto& boneChannelMapping = bmit->second;
-          anim.calculateLocalTransforms(renderTime + animOffset[i], localTransforms.data(), numAnimChannels);
-          uint32_t bcVal = boneChannelMapping[0];
-          glm::mat4 localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[0].localTransformation : localTransforms[bcVal];
-          globalTransforms[0] = skel.invGlobalTransform * localCurrentTransform;
-          for (uint32_t boneIndex = 1; boneIndex < numSkelBones; ++boneIndex)
-          {
-            bcVal = boneChannelMapping[boneIndex];
-            localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[boneIndex].localTransformation : localTransforms[bcVal];
-            globalTransforms[boneIndex] = globalTransforms[skel.bones[boneIndex].parentIndex] * localCurrentTransform;
-          }
-          for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-            (*positionData)[i].bones[boneIndex] = globalTransforms[boneIndex] * skel.bones[boneIndex].offsetMatrix;
+          size_t first = std::get<1>(chunks[i]);
+          std::get<0>(chunks[i])->evaluate(animTimes.data() + first, cursors.data() + first, boneMatrices.data() + first, static_cast<uint32_t>(std::get<2>(chunks[i])));
+        }
+      }
+    );
 
+    // blend previous and current animation of people changing animation
+    uint32_t animationCount = animations.size();
+    tbb::parallel_for
+    (
+      tbb::blocked_range<size_t>(0, blendedInstances.size()),
+      [&](const tbb::blocked_range<size_t>& r)
+      {
+        AnimationBlendData& blendData = animationBlendData.local();
+        for (size_t i = r.begin(); i != r.end(); ++i)
+        {
+          uint32_t          index     = blendedInstances[i];
+          const ObjectData& human     = rData.people[index];
+          pumex::BlendTree* blendTree = blendTrees.at(human.typeID).get();
+          float             weight    = 1.0f - human.transitionTime / ANIMATION_TRANSITION_DURATION;
+
+          blendData.parameters.assign(2 * animationCount, renderTime + human.animationOffset);
+          std::fill(begin(blendData.parameters) + animationCount, end(blendData.parameters), 0.0f);
+          blendData.parameters[animationCount + human.previousAnimation] = 1.0f - weight;
+          blendData.parameters[animationCount + human.animation]         = weight;
+          blendTree->evaluate(blendData.parameters.data(), nullptr, blendData.workspace, blendData.pose);
+          blendTree->calculateBoneMatrices(blendData.pose, blendData.workspace, (*positionData)[index].bones);
         }
       }
     );
@@ -573,10 +672,40 @@ struct CrowdApplicationData
     {
       instanceData->emplace_back(InstanceData(rData.clothOwners[ii], it->typeID, it->materialVariant, 0));
     }
+    if (skinningPaletteNode.get() != nullptr)
+      skinningPaletteNode->setInstances(skinningInstances);
     positionBuffer->invalidateData();
     instanceBuffer->invalidateData();
   }
 
+  // each LOD of a model animates only the bones that its LOD asset needs
+  std::shared_ptr<pumex::AnimationEvaluator> createAnimationEvaluator(const SkelAnimKey& key)
+  {
+    const pumex::Skeleton&  skeleton  = skeletons[key.skelID];
+    const pumex::Animation& animation = animations[key.animID];
+    std::shared_ptr<pumex::Asset> lodAsset = skeletalAssetBuffer->getAsset(key.skelID, key.lodID);
+    if (lodAsset.get() == nullptr)
+      return std::make_shared<pumex::AnimationEvaluator>(skeleton, animation);
+    return std::make_shared<pumex::AnimationEvaluator>(pumex::createLodBinding(skeleton, animation, *lodAsset, animationLodScheduler.getPolicy(key.lodID)));
+  }
+
+  // blend tree mixes all animations of a skeleton : parameters 0 .. N-1 are animation times, parameters N .. 2N-1 are animation weights
+  pumex::BlendTree* getBlendTree(uint32_t skelID)
+  {
+    auto it = blendTrees.find(skelID);
+    if (it != end(blendTrees))
+      return it->second.get();
+    auto blendTree = std::make_shared<pumex::BlendTree>(skeletons[skelID]);
+    std::vector<uint32_t> clipNodes, weightParameters;
+    for (uint32_t i = 0; i < animations.size(); ++i)
+      clipNodes.push_back(blendTree->addClip(animations[i], blendTree->addParameter("time" + std::to_string(i))));
+    for (uint32_t i = 0; i < animations.size(); ++i)
+      weightParameters.push_back(blendTree->addParameter("weight" + std::to_string(i)));
+    blendTree->addBlend(clipNodes, weightParameters);
+    blendTrees.insert({ skelID, blendTree });
+    return blendTree.get();
+  }
+
   void setSlaveViewMatrix(uint32_t index, const glm::mat4& matrix)
   {
     slaveViewMatrix[index] = matrix;
@@ -604,6 +733,7 @@ int main(int argc, char * argv[])
   args::ValueFlag<uint32_t>                    updatesPerSecond(parser, "update_frequency", "number of update calls per second", { 'u' }, 60);
   args::Flag                                   renderVRwindows(parser, "vrwindows", "create two halfscreen windows for VR", { 'v' });
   args::Flag                                   render3windows(parser, "three_windows", "render in three windows", {'t'});
+  args::Flag                                   gpuSkinning(parser, "gpu_skinning", "calculate bone matrices in compute shader ( experimental )", {'g'});
   try
   {
     parser.ParseCLI(argc, argv);
@@ -634,6 +764,8 @@ int main(int argc, char * argv[])
   LOG_INFO << "Crowd rendering";
   if (enableDebugging)
     LOG_INFO << " : Vulkan debugging enabled";
+  if (gpuSkinning)
+    LOG_INFO << " : bone matrices calculated on GPU ( experimental )";
   LOG_INFO << std::endl;
 
   std::vector<std::string> instanceExtensions;
@@ -690,15 +822,19 @@ int main(int argc, char * argv[])
     workflow->addRenderOperation("crowd_compute", pumex::RenderOperation::Compute);
       workflow->addBufferOutput( "crowd_compute", "compute_results", "indirect_results", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT );
       workflow->addBufferOutput( "crowd_compute", "compute_results", "indirect_draw",     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT );
+    if (gpuSkinning)
+      workflow->addBufferOutput( "crowd_compute", "compute_results", "positions",         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT );
 
     workflow->addRenderOperation("rendering", pumex::RenderOperation::Graphics);
       workflow->addBufferInput          ( "rendering", "compute_results", "indirect_results", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT );
       workflow->addBufferInput          ( "rendering", "compute_results", "indirect_draw",     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT );
+    if (gpuSkinning)
+      workflow->addBufferInput          ( "rendering", "compute_results", "positions",         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT );
       workflow->addAttachmentDepthOutput( "rendering", "depth_samples",   "depth",             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, pumex::loadOpClear(glm::vec2(1.0f, 0.0f)));
       workflow->addAttachmentOutput     ( "rendering", "surface",         "color",             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.3f, 0.3f, 0.3f, 1.0f)));
 
     // alocate 12 MB for uniform and storage buffers
-    auto buffersAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 12 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    auto buffersAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 12 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT, 1, true);
     // alocate 12 MB for buffers that are only GPU visible
     auto localBuffersAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 12 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // allocate 64 MB for vertex and index buffers
@@ -733,6 +869,16 @@ int main(int argc, char * argv[])
     computeRoot->setName("computeRoot");
     workflow->setRenderOperationNode("crowd_compute", computeRoot);
 
+    if (gpuSkinning)
+    {
+      // bone matrices are written after the position matrix of each PositionData
+      auto skinningPaletteNode = std::make_shared<pumex::SkinningPaletteNode>(viewer, pipelineCache, descriptorPool, buffersAllocator, applicationData->positionBuffer, sizeof(PositionData) / sizeof(glm::mat4), 1);
+      skinningPaletteNode->setName("skinningPaletteNode");
+      computeRoot->addChild(skinningPaletteNode);
+      workflow->associateMemoryObject("positions", applicationData->positionBuffer);
+      applicationData->setSkinningPaletteNode(skinningPaletteNode);
+    }
+
     std::vector<pumex::DescriptorSetLayoutBinding> filterLayoutBindings =
     {
       { 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
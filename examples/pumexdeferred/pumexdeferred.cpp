@@ -25,6 +25,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <pumex/Pumex.h>
 #include <pumex/AssetLoaderAssimp.h>
+#include <pumex/TextureLoaderGli.h>
 #include <pumex/utils/Shapes.h>
 #include <args.hxx>
 
@@ -33,9 +34,12 @@
 // - first one fills zbuffer
 // - second one fills gbuffers with data
 // - third one renders lights using gbuffers as input
+// Textures are stored in TextureRegistryBindless, so the device must support VK_EXT_descriptor_indexing extension
 
-const uint32_t              MAX_BONES       = 511;
-const uint32_t              MODEL_SPONZA_ID = 1;
+const uint32_t              MAX_BONES         = 511;
+const uint32_t              MODEL_SPONZA_ID   = 1;
+// must be the same as the size of texture arrays in deferred_buildz.frag and deferred_gbuffers.frag shaders
+const uint32_t              MAX_TEXTURE_COUNT = 1024;
 
 struct PositionData
 {
@@ -78,6 +82,13 @@ struct MaterialData
   }
 };
 
+// textures used by a material and the region of the scene in which they are visible. Used to choose mip levels for texture streaming
+struct StreamedMaterial
+{
+  pumex::BoundingBox      bbox;
+  std::array<uint32_t, 4> textureIndices; // texture index in each slot of the texture registry
+};
+
 // simple light point sent to GPU in a storage buffer
 struct LightPointData
 {
@@ -136,14 +147,44 @@ struct DeferredApplicationData
     camera.setTimeSinceStart(renderTime);
     camera.setProjectionMatrix(glm::perspective(glm::radians(60.0f), (float)renderWidth / (float)renderHeight, 0.1f, 10000.0f));
     cameraBuffer->setData(surface.get(), camera);
+    // texture streaming in the next frame uses this position
+    observerPosition = glm::vec3(camera.getObserverPosition());
 
     pumex::Camera textCamera;
     textCamera.setProjectionMatrix(glm::ortho(0.0f, (float)renderWidth, 0.0f, (float)renderHeight), false);
     textCameraBuffer->setData(surface.get(), textCamera);
   }
 
+  void setTextureStreaming(std::shared_ptr<pumex::TextureStreamer> streamer, std::shared_ptr<pumex::TextureRegistryBindless> registry, const std::vector<StreamedMaterial>& materials)
+  {
+    textureStreamer   = streamer;
+    textureRegistry   = registry;
+    streamedMaterials = materials;
+  }
+
   void prepareModelForRendering(pumex::Viewer* viewer, std::shared_ptr<pumex::AssetBuffer> assetBuffer, uint32_t modelTypeID)
   {
+    // textures of materials close to the camera are requested with finer mip levels and higher priority. Full resolution is requested
+    // when the camera is within fullDetailDistance from material's bounding box, and every doubling of that distance drops one mip level
+    if (textureStreamer != nullptr)
+    {
+      const float fullDetailDistance = 2.0f;
+      for (const auto& material : streamedMaterials)
+      {
+        glm::vec3 outside = glm::max(glm::max(material.bbox.bbMin - observerPosition, observerPosition - material.bbox.bbMax), glm::vec3(0.0f));
+        float distance    = glm::length(outside);
+        uint32_t mipLevel = (distance > fullDetailDistance) ? static_cast<uint32_t>(std::log2(distance / fullDetailDistance)) : 0;
+        float priority    = 1.0f / (1.0f + distance);
+        for (uint32_t slot = 0; slot < material.textureIndices.size(); ++slot)
+        {
+          auto& memoryImages = textureRegistry->getMemoryImages(slot);
+          if (material.textureIndices[slot] < memoryImages.size() && memoryImages[material.textureIndices[slot]] != nullptr)
+            textureStreamer->requestMipLevel(memoryImages[material.textureIndices[slot]], mipLevel, priority);
+        }
+      }
+      textureStreamer->update();
+    }
+
     std::shared_ptr<pumex::Asset> assetX = assetBuffer->getAsset(modelTypeID, 0);
     if (assetX->animations.empty())
       return;
@@ -153,30 +194,15 @@ struct DeferredApplicationData
     pumex::Animation& anim   = assetX->animations[0];
     pumex::Skeleton& skel    = assetX->skeleton;
     uint32_t numAnimChannels = anim.channels.size();
-    uint32_t numSkelBones    = skel.bones.size();
 
-    std::vector<uint32_t> boneChannelMapping(numSkelBones);
-    for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-    {
-      auto it = anim.invChannelNames.find(skel.boneNames[boneIndex]);
-      boneChannelMapping[boneIndex] = (it != end(anim.invChannelNames)) ? it->second : std::numeric_limits<uint32_t>::max();
-    }
+    if (animationBinding == nullptr)
+      animationBinding = std::make_shared<pumex::SkeletonAnimationBinding>(skel, anim);
 
     std::vector<glm::mat4> localTransforms(MAX_BONES);
     std::vector<glm::mat4> globalTransforms(MAX_BONES);
 
     anim.calculateLocalTransforms(renderTime, localTransforms.data(), numAnimChannels);
-    uint32_t bcVal = boneChannelMapping[0];
-    glm::mat4 localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[0].localTransformation : localTransforms[bcVal];
-    globalTransforms[0] = skel.invGlobalTransform * localCurrentTransform;
-    for (uint32_t boneIndex = 1; boneIndex < numSkelBones; ++boneIndex)
-    {
-      bcVal = boneChannelMapping[boneIndex];
-      localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[boneIndex].localTransformation : localTransforms[bcVal];
-      globalTransforms[boneIndex] = globalTransforms[skel.bones[boneIndex].parentIndex] * localCurrentTransform;
-    }
-    for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-      positionData->bones[boneIndex] = globalTransforms[boneIndex] * skel.bones[boneIndex].offsetMatrix;
+    animationBinding->calculateBoneMatrices(localTransforms.data(), globalTransforms.data(), positionData->bones);
 
     positionBuffer->invalidateData();
   }
@@ -191,6 +217,11 @@ struct DeferredApplicationData
   std::shared_ptr<pumex::Buffer<PositionData>>                positionBuffer;
   std::shared_ptr<pumex::Buffer<std::vector<LightPointData>>> lightsBuffer;
   std::shared_ptr<pumex::BasicCameraHandler>                  camHandler;
+  std::shared_ptr<pumex::SkeletonAnimationBinding>            animationBinding;
+  std::shared_ptr<pumex::TextureStreamer>                     textureStreamer;
+  std::shared_ptr<pumex::TextureRegistryBindless>             textureRegistry;
+  std::vector<StreamedMaterial>                               streamedMaterials;
+  glm::vec3                                                   observerPosition;
 };
 
 int main( int argc, char * argv[] )
@@ -220,6 +251,8 @@ int main( int argc, char * argv[] )
   args::ValueFlag<uint32_t>                         updatesPerSecond(parser, "update_frequency", "number of update calls per second", { 'u' }, 60);
   args::Flag                                        skipDepthPrepass(parser, "nodp", "skip depth prepass", { 'n' });
   args::MapFlag<std::string, VkSampleCountFlagBits> samplesPerPixel(parser, "samples", "samples per pixel (1,2,4,8)", { 's' }, availableSamplesPerPixel, VK_SAMPLE_COUNT_4_BIT);
+  args::ValueFlag<uint32_t>                         textureBudget(parser, "texture_budget", "stream textures using memory budget in MB ( 0 - no streaming )", { 't' }, 0);
+  args::Flag                                        compressTextures(parser, "compress", "compress textures that are not block compressed yet and store them in cache", { 'c' });
   try
   {
     parser.ParseCLI(argc, argv);
@@ -247,6 +280,7 @@ int main( int argc, char * argv[] )
   VkPresentModeKHR presentMode      = args::get(presentationMode);
   uint32_t updateFrequency          = std::max(1U, args::get(updatesPerSecond));
   VkSampleCountFlagBits sampleCount = args::get(samplesPerPixel);
+  uint32_t textureBudgetMB          = args::get(textureBudget);
 
   LOG_INFO << "Deferred rendering with physically based rendering and antialiasing : ";
   if (enableDebugging)
@@ -263,9 +297,14 @@ int main( int argc, char * argv[] )
   case VK_SAMPLE_COUNT_8_BIT: LOG_INFO << "8 samples per pixel"; break;
   default: LOG_INFO << "unknown number of samples per pixel"; break;
   }
+  if (textureBudgetMB > 0)
+    LOG_INFO << ", textures streamed with " << textureBudgetMB << " MB budget";
+  if (compressTextures)
+    LOG_INFO << ", textures compressed";
   LOG_INFO << std::endl;
 
-  std::vector<std::string> instanceExtensions;
+  // VK_EXT_descriptor_indexing features may only be queried through vkGetPhysicalDeviceFeatures2()
+  std::vector<std::string> instanceExtensions = { VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME };
   std::vector<std::string> requestDebugLayers;
   if (enableDebugging)
     requestDebugLayers.push_back("VK_LAYER_LUNARG_standard_validation");
@@ -277,7 +316,7 @@ int main( int argc, char * argv[] )
   {
     viewer = std::make_shared<pumex::Viewer>(viewerTraits);
 
-    std::vector<std::string> requestDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    std::vector<std::string> requestDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
     std::shared_ptr<pumex::Device> device = viewer->addDevice(0, requestDeviceExtensions);
 
     pumex::WindowTraits windowTraits{ 0, 100, 100, 1024, 768, useFullScreen ? pumex::WindowTraits::FULLSCREEN : pumex::WindowTraits::WINDOW, "Deferred rendering with PBR and antialiasing" };
@@ -339,13 +378,23 @@ int main( int argc, char * argv[] )
     std::shared_ptr<pumex::AssetBuffer> assetBuffer = std::make_shared<pumex::AssetBuffer>(assetSemantics, buffersAllocator, verticesAllocator);
 
     std::vector<pumex::TextureSemantic> textureSemantic = { { pumex::TextureSemantic::Diffuse, 0 },{ pumex::TextureSemantic::Specular, 1 },{ pumex::TextureSemantic::LightMap, 2 },{ pumex::TextureSemantic::Normals, 3 } };
-    std::shared_ptr<pumex::TextureRegistryArrayOfTextures> textureRegistry = std::make_shared<pumex::TextureRegistryArrayOfTextures>(buffersAllocator, texturesAllocator);
+    // each texture slot is a single descriptor array. Textures added later or recreated by texture streamer do not cause command buffer rebuild
+    std::shared_ptr<pumex::TextureRegistryBindless> textureRegistry = std::make_shared<pumex::TextureRegistryBindless>(texturesAllocator, MAX_TEXTURE_COUNT);
     textureRegistry->setSampledImage(0);
     textureRegistry->setSampledImage(1);
     textureRegistry->setSampledImage(2);
     textureRegistry->setSampledImage(3);
+    std::shared_ptr<pumex::TextureStreamer> textureStreamer;
+    if (textureBudgetMB > 0)
+    {
+      textureStreamer = std::make_shared<pumex::TextureStreamer>(static_cast<VkDeviceSize>(textureBudgetMB) * 1024 * 1024);
+      textureRegistry->setTextureStreamer(textureStreamer);
+    }
     std::shared_ptr<pumex::MaterialRegistry<MaterialData>> materialRegistry = std::make_shared<pumex::MaterialRegistry<MaterialData>>(buffersAllocator);
     std::shared_ptr<pumex::MaterialSet> materialSet = std::make_shared<pumex::MaterialSet>(viewer, materialRegistry, textureRegistry, buffersAllocator, textureSemantic);
+    // uncompressed textures are compressed to BC1 / BC3 on CPU once, and then read from cache on next runs
+    if (compressTextures)
+      materialSet->setTextureLoader(std::make_shared<pumex::TextureLoaderCompressed>(std::make_shared<pumex::TextureLoaderGli>()));
 
     pumex::AssetLoaderAssimp loader;
     loader.setImportFlags(loader.getImportFlags() | aiProcess_CalcTangentSpace );
@@ -358,6 +407,24 @@ int main( int argc, char * argv[] )
     materialSet->registerMaterials(MODEL_SPONZA_ID, asset);
     materialSet->endRegisterMaterials();
 
+    // each material streams its textures according to the distance between the camera and geometries that use it
+    if (textureStreamer != nullptr)
+    {
+      // Sponza is the only registered type and it has one material variant, so material definitions are indexed by asset material index
+      std::vector<StreamedMaterial> streamedMaterials;
+      for (const auto& md : *materialRegistry->materialDefinitions)
+        streamedMaterials.push_back(StreamedMaterial{ pumex::BoundingBox(), { { md.diffuseTextureIndex, md.roughnessTextureIndex, md.metallicTextureIndex, md.normalTextureIndex } } });
+      std::vector<glm::mat4> resetPosition = pumex::calculateResetPosition(*asset);
+      for (const auto& geometry : asset->geometries)
+        if ((geometry.renderMask & 1) && geometry.materialIndex < streamedMaterials.size())
+          streamedMaterials[geometry.materialIndex].bbox += pumex::calculateBoundingBox(geometry, resetPosition);
+      // materials without geometry are never requested, so their textures keep only the mip tail
+      streamedMaterials.erase(std::remove_if(begin(streamedMaterials), end(streamedMaterials), [](const StreamedMaterial& m) { return m.bbox.bbMin.x > m.bbox.bbMax.x; }), end(streamedMaterials));
+      applicationData->setTextureStreaming(textureStreamer, textureRegistry, streamedMaterials);
+    }
+    auto& textureStatistics = materialSet->getTextureLoadStatistics();
+    LOG_INFO << "Textures : " << textureStatistics.fileCount << " files ( " << textureStatistics.directFileCount << " mapped ) decoded in " << textureStatistics.decodeTime << " s, " << textureStatistics.layerCount << " textures uploaded in " << textureStatistics.uploadTime << " s" << std::endl;
+
     auto assetBufferNode = std::make_shared<pumex::AssetBufferNode>(assetBuffer, materialSet, 1, 0);
     assetBufferNode->setName("assetBufferNode");
 
@@ -373,6 +440,22 @@ int main( int argc, char * argv[] )
 
     auto cameraUbo  = std::make_shared<pumex::UniformBuffer>(applicationData->cameraBuffer);
     auto sampler    = std::make_shared<pumex::Sampler>(pumex::SamplerTraits());
+
+    // textures have their own descriptor set, shared by zPrepass and gBuffer pipelines. All bindings in that set are updated after bind,
+    // so adding or streaming textures rewrites only this descriptor set and command buffers are not rebuilt
+    std::vector<pumex::DescriptorSetLayoutBinding> texturesLayoutBindings =
+    {
+      textureRegistry->getLayoutBinding(0, 0, VK_SHADER_STAGE_FRAGMENT_BIT),
+      textureRegistry->getLayoutBinding(1, 1, VK_SHADER_STAGE_FRAGMENT_BIT),
+      textureRegistry->getLayoutBinding(2, 2, VK_SHADER_STAGE_FRAGMENT_BIT),
+      textureRegistry->getLayoutBinding(3, 3, VK_SHADER_STAGE_FRAGMENT_BIT)
+    };
+    auto texturesDescriptorSetLayout = std::make_shared<pumex::DescriptorSetLayout>(texturesLayoutBindings);
+    auto texturesDescriptorSet       = std::make_shared<pumex::DescriptorSet>(descriptorPool, texturesDescriptorSetLayout);
+    textureRegistry->addDescriptorSet(0, texturesDescriptorSet, 0);
+    textureRegistry->addDescriptorSet(1, texturesDescriptorSet, 1);
+    textureRegistry->addDescriptorSet(2, texturesDescriptorSet, 2);
+    textureRegistry->addDescriptorSet(3, texturesDescriptorSet, 3);
     /***********************************/
 
     if (!skipDepthPrepass)
@@ -388,14 +471,14 @@ int main( int argc, char * argv[] )
         { 2, 1,  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
         { 3, 1,  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
         { 4, 1,  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT },
-        { 5, 64, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT },
-        { 6, 1,  VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT }
+        { 5, 1,  VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT }
       };
       auto buildzDescriptorSetLayout = std::make_shared<pumex::DescriptorSetLayout>(buildzLayoutBindings);
 
       // building gbufferPipeline layout
       auto buildzPipelineLayout = std::make_shared<pumex::PipelineLayout>();
       buildzPipelineLayout->descriptorSetLayouts.push_back(buildzDescriptorSetLayout);
+      buildzPipelineLayout->descriptorSetLayouts.push_back(texturesDescriptorSetLayout);
 
       auto buildzPipeline = std::make_shared<pumex::GraphicsPipeline>(pipelineCache, buildzPipelineLayout);
       buildzPipeline->setName("buildzPipeline");
@@ -422,9 +505,9 @@ int main( int argc, char * argv[] )
       bzDescriptorSet->setDescriptor(2, std::make_shared<pumex::StorageBuffer>(materialSet->typeDefinitionBuffer));
       bzDescriptorSet->setDescriptor(3, std::make_shared<pumex::StorageBuffer>(materialSet->materialVariantBuffer));
       bzDescriptorSet->setDescriptor(4, std::make_shared<pumex::StorageBuffer>(materialRegistry->materialDefinitionBuffer));
-      bzDescriptorSet->setDescriptor(5, textureRegistry->getResources(0));
-      bzDescriptorSet->setDescriptor(6, sampler);
+      bzDescriptorSet->setDescriptor(5, sampler);
       buildzPipeline->setDescriptorSet(0, bzDescriptorSet);
+      buildzPipeline->setDescriptorSet(1, texturesDescriptorSet);
     }
 
     /***********************************/
@@ -440,18 +523,14 @@ int main( int argc, char * argv[] )
       { 2, 1,  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
       { 3, 1,  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
       { 4, 1,  VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT },
-      { 5, 64, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT },
-      { 6, 64, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT },
-      { 7, 64, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT },
-      { 8, 64, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT },
-      { 9, 1,  VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT }
-
+      { 5, 1,  VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT }
     };
     auto gbufferDescriptorSetLayout = std::make_shared<pumex::DescriptorSetLayout>(gbufferLayoutBindings);
 
     // building gbufferPipeline layout
     auto gbufferPipelineLayout = std::make_shared<pumex::PipelineLayout>();
     gbufferPipelineLayout->descriptorSetLayouts.push_back(gbufferDescriptorSetLayout);
+    gbufferPipelineLayout->descriptorSetLayouts.push_back(texturesDescriptorSetLayout);
 
     auto gbufferPipeline = std::make_shared<pumex::GraphicsPipeline>(pipelineCache, gbufferPipelineLayout);
     gbufferPipeline->setName("gbufferPipeline");
@@ -490,12 +569,9 @@ int main( int argc, char * argv[] )
     descriptorSet->setDescriptor(2, std::make_shared<pumex::StorageBuffer>(materialSet->typeDefinitionBuffer));
     descriptorSet->setDescriptor(3, std::make_shared<pumex::StorageBuffer>(materialSet->materialVariantBuffer));
     descriptorSet->setDescriptor(4, std::make_shared<pumex::StorageBuffer>(materialRegistry->materialDefinitionBuffer));
-    descriptorSet->setDescriptor(5, textureRegistry->getResources(0));
-    descriptorSet->setDescriptor(6, textureRegistry->getResources(1));
-    descriptorSet->setDescriptor(7, textureRegistry->getResources(2));
-    descriptorSet->setDescriptor(8, textureRegistry->getResources(3));
-    descriptorSet->setDescriptor(9, sampler);
+    descriptorSet->setDescriptor(5, sampler);
     gbufferPipeline->setDescriptorSet(0, descriptorSet);
+    gbufferPipeline->setDescriptorSet(1, texturesDescriptorSet);
 
 /**********************/
 
@@ -2,6 +2,10 @@
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// size of texture arrays must be the same as MAX_TEXTURE_COUNT in pumexdeferred.cpp
+#define MaxTextureCount 1024
 
 // change value below if a number of TextureSemantic types in MaterialSet.h has changed
 #define TextureSemanticCount 11
@@ -22,12 +26,12 @@ layout (std430,binding = 4) readonly buffer MaterialDataSbo
   MaterialData materialData[];
 };
 
-layout (binding = 5) uniform texture2D diffuseSamplers[64];
-layout (binding = 6) uniform sampler samp;
+layout (set = 0, binding = 5) uniform sampler samp;
+layout (set = 1, binding = 0) uniform texture2D diffuseSamplers[MaxTextureCount];
 
 void main()
 {
-  vec4 color = texture( sampler2D( diffuseSamplers[ materialData[materialID].diffuseTextureIndex ], samp ), inUV );
+  vec4 color = texture( sampler2D( diffuseSamplers[ nonuniformEXT(materialData[materialID].diffuseTextureIndex) ], samp ), inUV );
   if(color.a<0.5)
     discard;
 }
@@ -2,6 +2,10 @@
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// size of texture arrays must be the same as MAX_TEXTURE_COUNT in pumexdeferred.cpp
+#define MaxTextureCount 1024
 
 // change value below if a number of TextureSemantic types in MaterialSet.h has changed
 #define TextureSemanticCount 11
@@ -25,11 +29,11 @@ layout (std430,binding = 4) readonly buffer MaterialDataSbo
   MaterialData materialData[];
 };
 
-layout (binding = 5) uniform texture2D diffuseSamplers[64];
-layout (binding = 6) uniform texture2D roughnessSamplers[64];
-layout (binding = 7) uniform texture2D metallicSamplers[64];
-layout (binding = 8) uniform texture2D normalSamplers[64];
-layout (binding = 9) uniform sampler samp;
+layout (set = 0, binding = 5) uniform sampler samp;
+layout (set = 1, binding = 0) uniform texture2D diffuseSamplers[MaxTextureCount];
+layout (set = 1, binding = 1) uniform texture2D roughnessSamplers[MaxTextureCount];
+layout (set = 1, binding = 2) uniform texture2D metallicSamplers[MaxTextureCount];
+layout (set = 1, binding = 3) uniform texture2D normalSamplers[MaxTextureCount];
 
 
 layout (location = 0) out vec4 outPosition;
@@ -39,7 +43,7 @@ layout (location = 3) out vec3 outRoughnessMetallic;
 
 void main()
 {
-  vec4 color = texture( sampler2D( diffuseSamplers[ materialData[materialID].diffuseTextureIndex ], samp), inUV );
+  vec4 color = texture( sampler2D( diffuseSamplers[ nonuniformEXT(materialData[materialID].diffuseTextureIndex) ], samp), inUV );
   if(color.a<0.5)
     discard;
   color.rgb = pow( color.rgb, vec3(2.2));
@@ -47,8 +51,8 @@ void main()
 
   outRoughnessMetallic = vec3
   (
-    texture( sampler2D( roughnessSamplers[ materialData[materialID].roughnessTextureIndex ], samp ), inUV ).r,
-    texture( sampler2D( metallicSamplers[ materialData[materialID].metallicTextureIndex ], samp ), inUV ).r,
+    texture( sampler2D( roughnessSamplers[ nonuniformEXT(materialData[materialID].roughnessTextureIndex) ], samp ), inUV ).r,
+    texture( sampler2D( metallicSamplers[ nonuniformEXT(materialData[materialID].metallicTextureIndex) ], samp ), inUV ).r,
     0.0
   );
 
@@ -56,7 +60,7 @@ void main()
   vec3 T    = normalize(inTangent);
   vec3 B    = -cross(N, T);
   mat3 TBN  = mat3(T, B, N);
-  outNormal = texture( sampler2D( normalSamplers[ materialData[materialID].normalTextureIndex ], samp ), inUV ).xyz;
+  outNormal = texture( sampler2D( normalSamplers[ nonuniformEXT(materialData[materialID].normalTextureIndex) ], samp ), inUV ).xyz;
   outNormal = outNormal * 2.0 - vec3(1.0);
   outNormal = TBN * normalize(outNormal);
 
@@ -1247,6 +1247,7 @@ int main(int argc, char * argv[])
   args::Flag                                   render3windows(parser, "three_windows", "render in three windows", { 't' });
   args::Flag                                   skipStaticRendering(parser, "skip-static", "skip rendering of static objects", { "skip-static" });
   args::Flag                                   skipDynamicRendering(parser, "skip-dynamic", "skip rendering of dynamic objects", { "skip-dynamic" });
+  args::Flag                                   asyncCompute(parser, "async-compute", "perform culling on a dedicated compute queue", { "async-compute" });
   args::ValueFlag<float>                       staticAreaSizeArg(parser, "static-area-size", "size of the area for static rendering", { "static-area-size" }, 2000.0f);
   args::ValueFlag<float>                       dynamicAreaSizeArg(parser, "dynamic-area-size", "size of the area for dynamic rendering", { "dynamic-area-size" }, 1000.0f);
   args::ValueFlag<float>                       lodModifierArg(parser, "lod-modifier", "LOD range [%]", { "lod-modifier" }, 100.0f);
@@ -1338,7 +1339,7 @@ int main(int argc, char * argv[])
     // allocate 32 MB for frame buffers ( actually only depth buffer will be allocated )
     std::shared_ptr<pumex::DeviceMemoryAllocator> frameBufferAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 32 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // alocate 256 MB for uniform and storage buffers
-    std::shared_ptr<pumex::DeviceMemoryAllocator> buffersAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 256 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    std::shared_ptr<pumex::DeviceMemoryAllocator> buffersAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 256 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT, 1, true);
     // allocate 32 MB for vertex and index buffers
     std::shared_ptr<pumex::DeviceMemoryAllocator> verticesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 32 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // allocate 4 MB memory for font textures
@@ -1347,6 +1348,8 @@ int main(int argc, char * argv[])
     std::shared_ptr<pumex::DescriptorPool> descriptorPool = std::make_shared<pumex::DescriptorPool>();
 
     std::vector<pumex::QueueTraits> queueTraits{ { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 0, 0.75f } };
+    if (asyncCompute)
+      queueTraits.push_back({ VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT, 0.75f });
 
     std::shared_ptr<pumex::RenderWorkflow> workflow = std::make_shared<pumex::RenderWorkflow>("gpucull_workflow", frameBufferAllocator, queueTraits);
       workflow->addResourceType("depth_samples", false, VK_FORMAT_D32_SFLOAT,    VK_SAMPLE_COUNT_1_BIT, pumex::atDepth,   pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
@@ -1650,7 +1653,12 @@ int main(int argc, char * argv[])
     }
 
     // connecting workflow to all surfaces
-    std::shared_ptr<pumex::SingleQueueWorkflowCompiler> workflowCompiler = std::make_shared<pumex::SingleQueueWorkflowCompiler>();
+    // MultiQueueWorkflowCompiler moves filter passes to a dedicated compute queue, where they may overlap with graphics work
+    std::shared_ptr<pumex::RenderWorkflowCompiler> workflowCompiler;
+    if (asyncCompute)
+      workflowCompiler = std::make_shared<pumex::MultiQueueWorkflowCompiler>();
+    else
+      workflowCompiler = std::make_shared<pumex::SingleQueueWorkflowCompiler>();
     for (auto& surf : surfaces)
       surf->setRenderWorkflow(workflow, workflowCompiler);
 
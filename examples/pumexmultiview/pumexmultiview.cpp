@@ -170,30 +170,15 @@ struct MultiviewApplicationData
     pumex::Animation& anim   = assetX->animations[0];
     pumex::Skeleton& skel    = assetX->skeleton;
     uint32_t numAnimChannels = anim.channels.size();
-    uint32_t numSkelBones    = skel.bones.size();
 
-    std::vector<uint32_t> boneChannelMapping(numSkelBones);
-    for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-    {
-      auto it = anim.invChannelNames.find(skel.boneNames[boneIndex]);
-      boneChannelMapping[boneIndex] = (it != end(anim.invChannelNames)) ? it->second : std::numeric_limits<uint32_t>::max();
-    }
+    if (animationBinding == nullptr)
+      animationBinding = std::make_shared<pumex::SkeletonAnimationBinding>(skel, anim);
 
     std::vector<glm::mat4> localTransforms(MAX_BONES);
     std::vector<glm::mat4> globalTransforms(MAX_BONES);
 
     anim.calculateLocalTransforms(renderTime, localTransforms.data(), numAnimChannels);
-    uint32_t bcVal = boneChannelMapping[0];
-    glm::mat4 localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[0].localTransformation : localTransforms[bcVal];
-    globalTransforms[0] = skel.invGlobalTransform * localCurrentTransform;
-    for (uint32_t boneIndex = 1; boneIndex < numSkelBones; ++boneIndex)
-    {
-      bcVal = boneChannelMapping[boneIndex];
-      localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[boneIndex].localTransformation : localTransforms[bcVal];
-      globalTransforms[boneIndex] = globalTransforms[skel.bones[boneIndex].parentIndex] * localCurrentTransform;
-    }
-    for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-      positionData->bones[boneIndex] = globalTransforms[boneIndex] * skel.bones[boneIndex].offsetMatrix;
+    animationBinding->calculateBoneMatrices(localTransforms.data(), globalTransforms.data(), positionData->bones);
 
     positionBuffer->invalidateData();
   }
@@ -208,6 +193,7 @@ struct MultiviewApplicationData
   std::shared_ptr<pumex::Buffer<PositionData>>                positionBuffer;
   std::shared_ptr<pumex::Buffer<std::vector<LightPointData>>> lightsBuffer;
   std::shared_ptr<pumex::BasicCameraHandler>                  camHandler;
+  std::shared_ptr<pumex::SkeletonAnimationBinding>            animationBinding;
 };
 
 std::shared_ptr<pumex::Asset> buildMultiViewQuads()
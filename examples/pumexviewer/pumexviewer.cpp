@@ -30,6 +30,7 @@
 
 // pumexviewer is a very basic program, that performs textureless rendering of a 3D asset provided in a command line
 // The whole render workflow consists of only one render operation
+// Asset is loaded by AsyncLoader in the background, so the viewer starts rendering immediately and the model appears when it is ready
 
 const uint32_t MAX_BONES = 511;
 
@@ -48,7 +49,8 @@ struct PositionData
 
 struct ViewerApplicationData
 {
-  ViewerApplicationData( std::shared_ptr<pumex::DeviceMemoryAllocator> buffersAllocator )
+  ViewerApplicationData( std::shared_ptr<pumex::DeviceMemoryAllocator> buffersAllocator, std::shared_ptr<pumex::DeviceMemoryAllocator> verticesAlloc, const std::vector<pumex::VertexSemantic>& semantic )
+    : verticesAllocator{ verticesAlloc }, requiredSemantic( semantic )
   {
     // create buffers visible from renderer
     cameraBuffer     = std::make_shared<pumex::Buffer<pumex::Camera>>(buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pumex::pbPerSurface, pumex::swOnce, true);
@@ -62,6 +64,74 @@ struct ViewerApplicationData
     camHandler = bcamHandler;
   }
 
+  void setPipelines(std::shared_ptr<pumex::GraphicsPipeline> modelPipeline, std::shared_ptr<pumex::GraphicsPipeline> boxPipeline)
+  {
+    pipeline          = modelPipeline;
+    wireframePipeline = boxPipeline;
+  }
+
+  // requests the model ( and optionally the animation ) from AsyncLoader. Results are delivered to setModel() and setAnimation() by loader->dispatchCallbacks()
+  void loadModel(std::shared_ptr<pumex::Viewer> viewer, const std::string& modelFileName, const std::string& animationFileName)
+  {
+    loader = std::make_shared<pumex::AsyncLoader>(std::make_shared<pumex::AssetLoaderAssimp>(), nullptr);
+    animationRequested = !animationFileName.empty();
+    loadRequests.push_back(loader->loadAsset(viewer, modelFileName, false, requiredSemantic, std::bind(&ViewerApplicationData::setModel, this, std::placeholders::_1)));
+    if (animationRequested)
+      loadRequests.push_back(loader->loadAsset(viewer, animationFileName, true, requiredSemantic, std::bind(&ViewerApplicationData::setAnimation, this, std::placeholders::_1)));
+  }
+
+  void setModel(std::shared_ptr<pumex::Asset> loadedAsset)
+  {
+    asset = loadedAsset;
+    addModelToScene();
+  }
+
+  void setAnimation(std::shared_ptr<pumex::Asset> animAsset)
+  {
+    animations = animAsset->animations;
+    addModelToScene();
+  }
+
+  // scene graph is modified only in the render start event, before the render workflow is validated
+  void addModelToScene()
+  {
+    if (asset == nullptr || (animationRequested && animations.empty()))
+      return;
+    if (animationRequested)
+      asset->animations = animations;
+
+    // AssetNode class is a simple class that binds vertex and index buffers and also performs vkCmdDrawIndexed call on a model
+    std::shared_ptr<pumex::AssetNode> assetNode = std::make_shared<pumex::AssetNode>(asset, verticesAllocator, 1, 0);
+    assetNode->setName("assetNode");
+    pipeline->addChild(assetNode);
+
+    // if model uses animation then calculate bounding box using animation. Otherwise calculate bounding box using only vertices
+    pumex::BoundingBox bbox;
+    if (asset->animations.size() > 0)
+      bbox = pumex::calculateBoundingBox(asset->skeleton, asset->animations[0], true);
+    else
+      bbox = pumex::calculateBoundingBox(*asset, 1);
+
+    // create a bounding box as a geometry to render
+    pumex::Geometry boxg;
+    boxg.name = "box";
+    boxg.semantic = requiredSemantic;
+    pumex::addBox(boxg, bbox.bbMin, bbox.bbMax, true);
+    std::shared_ptr<pumex::Asset> boxAsset(pumex::createSimpleAsset(boxg, "root"));
+
+    // and connect this geometry to pipeline that draws wireframe
+    std::shared_ptr<pumex::AssetNode> boxAssetNode = std::make_shared<pumex::AssetNode>(boxAsset, verticesAllocator, 1, 0);
+    boxAssetNode->setName("boxAssetNode");
+    wireframePipeline->addChild(boxAssetNode);
+
+    // is this the fastest way to calculate all global transformations for a model ?
+    std::vector<glm::mat4> globalTransforms = pumex::calculateResetPosition(*asset);
+    std::copy(begin(globalTransforms), end(globalTransforms), std::begin(positionData->bones));
+    positionBuffer->invalidateData();
+
+    modelReady = true;
+  }
+
   void update(std::shared_ptr<pumex::Viewer> viewer)
   {
     camHandler->update(viewer.get());
@@ -89,8 +159,23 @@ struct ViewerApplicationData
     textCameraBuffer->setData(surface.get(), textCamera);
   }
 
-  void prepareModelForRendering(pumex::Viewer* viewer, std::shared_ptr<pumex::Asset> asset)
+  void prepareModelForRendering(pumex::Viewer* viewer)
   {
+    // pending count is read before dispatching, so that callbacks of all finished requests are already queued when it reaches zero
+    uint32_t pendingCount = loader->getPendingCount();
+    loader->dispatchCallbacks();
+    if (!modelReady)
+    {
+      if (pendingCount == 0)
+      {
+        // failed request rethrows the exception caught by the loader ( e.g. assimp error ). Viewer::run() passes it to main(), which reports it and exits
+        for (auto& request : loadRequests)
+          request.get();
+        CHECK_LOG_THROW(true, "Model or animation not loaded");
+      }
+      return;
+    }
+
     // animate asset if it has animation
     if (asset->animations.empty())
       return;
@@ -100,39 +185,36 @@ struct ViewerApplicationData
     pumex::Animation& anim   = asset->animations[0];
     pumex::Skeleton& skel    = asset->skeleton;
     uint32_t numAnimChannels = anim.channels.size();
-    uint32_t numSkelBones    = skel.bones.size();
 
-    std::vector<uint32_t> boneChannelMapping(numSkelBones);
-    for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-    {
-      auto it = anim.invChannelNames.find(skel.boneNames[boneIndex]);
-      boneChannelMapping[boneIndex] = (it != end(anim.invChannelNames)) ? it->second : std::numeric_limits<uint32_t>::max();
-    }
+    if (animationBinding == nullptr)
+      animationBinding = std::make_shared<pumex::SkeletonAnimationBinding>(skel, anim);
 
     std::vector<glm::mat4> localTransforms(MAX_BONES);
     std::vector<glm::mat4> globalTransforms(MAX_BONES);
 
     anim.calculateLocalTransforms(renderTime, localTransforms.data(), numAnimChannels);
-    uint32_t bcVal = boneChannelMapping[0];
-    glm::mat4 localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[0].localTransformation : localTransforms[bcVal];
-    globalTransforms[0] = skel.invGlobalTransform * localCurrentTransform;
-    for (uint32_t boneIndex = 1; boneIndex < numSkelBones; ++boneIndex)
-    {
-      bcVal = boneChannelMapping[boneIndex];
-      localCurrentTransform = (bcVal == std::numeric_limits<uint32_t>::max()) ? skel.bones[boneIndex].localTransformation : localTransforms[bcVal];
-      globalTransforms[boneIndex] = globalTransforms[skel.bones[boneIndex].parentIndex] * localCurrentTransform;
-    }
-    for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
-      positionData->bones[boneIndex] = globalTransforms[boneIndex] * skel.bones[boneIndex].offsetMatrix;
+    animationBinding->calculateBoneMatrices(localTransforms.data(), globalTransforms.data(), positionData->bones);
 
     positionBuffer->invalidateData();
   }
 
-  std::shared_ptr<pumex::Buffer<pumex::Camera>> cameraBuffer;
-  std::shared_ptr<pumex::Buffer<pumex::Camera>> textCameraBuffer;
-  std::shared_ptr<PositionData>                 positionData;
-  std::shared_ptr<pumex::Buffer<PositionData>>  positionBuffer;
-  std::shared_ptr<pumex::BasicCameraHandler>    camHandler;
+  std::shared_ptr<pumex::Buffer<pumex::Camera>>    cameraBuffer;
+  std::shared_ptr<pumex::Buffer<pumex::Camera>>    textCameraBuffer;
+  std::shared_ptr<PositionData>                    positionData;
+  std::shared_ptr<pumex::Buffer<PositionData>>     positionBuffer;
+  std::shared_ptr<pumex::BasicCameraHandler>       camHandler;
+  std::shared_ptr<pumex::SkeletonAnimationBinding> animationBinding;
+
+  std::shared_ptr<pumex::AsyncLoader>              loader;
+  std::vector<std::shared_future<std::shared_ptr<pumex::Asset>>> loadRequests;
+  std::shared_ptr<pumex::DeviceMemoryAllocator>    verticesAllocator;
+  std::vector<pumex::VertexSemantic>               requiredSemantic;
+  std::shared_ptr<pumex::GraphicsPipeline>         pipeline;
+  std::shared_ptr<pumex::GraphicsPipeline>         wireframePipeline;
+  std::shared_ptr<pumex::Asset>                    asset;
+  std::vector<pumex::Animation>                    animations;
+  bool                                             animationRequested = false;
+  bool                                             modelReady         = false;
 };
 
 int main( int argc, char * argv[] )
@@ -209,16 +291,6 @@ int main( int argc, char * argv[] )
     // vertex semantic defines how a single vertex in an asset will look like
     std::vector<pumex::VertexSemantic> requiredSemantic = { { pumex::VertexSemantic::Position, 3 },{ pumex::VertexSemantic::Normal, 3 },{ pumex::VertexSemantic::TexCoord, 2 },{ pumex::VertexSemantic::BoneWeight, 4 },{ pumex::VertexSemantic::BoneIndex, 4 } };
 
-    // we load an asset using Assimp asset loader
-    pumex::AssetLoaderAssimp loader;
-    std::shared_ptr<pumex::Asset> asset(loader.load(viewer, modelFileName, false, requiredSemantic));
-
-    if (!animationFileName.empty() )
-    {
-      std::shared_ptr<pumex::Asset> animAsset(loader.load(viewer, animationFileName, true, requiredSemantic));
-      asset->animations = animAsset->animations;
-    }
-
     // now is the time to create devices, windows and surfaces.
     std::vector<std::string> requestDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
     std::shared_ptr<pumex::Device> device = viewer->addDevice(0, requestDeviceExtensions);
@@ -301,11 +373,6 @@ int main( int argc, char * argv[] )
     };
     renderRoot->addChild(pipeline);
 
-    // AssetNode class is a simple class that binds vertex and index buffers and also performs vkCmdDrawIndexed call on a model
-    std::shared_ptr<pumex::AssetNode> assetNode = std::make_shared<pumex::AssetNode>(asset, verticesAllocator, 1, 0);
-    assetNode->setName("assetNode");
-    pipeline->addChild(assetNode);
-
     // Our additional pipeline will draw a wireframe bounding box using polygon mode VK_POLYGON_MODE_LINE using the same shaders
     auto wireframePipeline = std::make_shared<pumex::GraphicsPipeline>(pipelineCache, pipelineLayout);
     wireframePipeline->polygonMode = VK_POLYGON_MODE_LINE;
@@ -325,33 +392,11 @@ int main( int argc, char * argv[] )
     };
     renderRoot->addChild(wireframePipeline);
 
-    // if model uses animation then calculate bounding box using animation. Otherwise calculate bounding box using only vertices
-    pumex::BoundingBox bbox;
-    if (asset->animations.size() > 0)
-      bbox = pumex::calculateBoundingBox(asset->skeleton, asset->animations[0], true);
-    else
-      bbox = pumex::calculateBoundingBox(*asset, 1);
-
-    // create a bounding box as a geometry to render
-    pumex::Geometry boxg;
-    boxg.name = "box";
-    boxg.semantic = requiredSemantic;
-    pumex::addBox(boxg, bbox.bbMin, bbox.bbMax, true);
-    std::shared_ptr<pumex::Asset> boxAsset(pumex::createSimpleAsset(boxg, "root"));
-
-    // and connect this geometry to pipeline that draws wireframe
-    std::shared_ptr<pumex::AssetNode> boxAssetNode = std::make_shared<pumex::AssetNode>(boxAsset, verticesAllocator, 1, 0);
-    boxAssetNode->setName("boxAssetNode");
-    wireframePipeline->addChild(boxAssetNode);
-
     // Application data class stores all information required to update rendering ( animation state, camera position, etc )
-    std::shared_ptr<ViewerApplicationData> applicationData = std::make_shared<ViewerApplicationData>(buffersAllocator);
-
-    // is this the fastest way to calculate all global transformations for a model ?
-    std::vector<glm::mat4> globalTransforms = pumex::calculateResetPosition(*asset);
-    PositionData modelData;
-    std::copy(begin(globalTransforms), end(globalTransforms), std::begin(modelData.bones));
-    (*applicationData->positionData) = modelData;
+    // Model and its bounding box are added to both pipelines when AsyncLoader finishes loading them
+    std::shared_ptr<ViewerApplicationData> applicationData = std::make_shared<ViewerApplicationData>(buffersAllocator, verticesAllocator, requiredSemantic);
+    applicationData->setPipelines(pipeline, wireframePipeline);
+    applicationData->loadModel(viewer, modelFileName, animationFileName);
 
     // here we create above mentioned uniform buffers - one for camera state and one for model state
     auto cameraUbo   = std::make_shared<pumex::UniformBuffer>(applicationData->cameraBuffer);
@@ -371,6 +416,10 @@ int main( int argc, char * argv[] )
     std::shared_ptr<pumex::TimeStatisticsHandler> tsHandler = std::make_shared<pumex::TimeStatisticsHandler>(viewer, pipelineCache, buffersAllocator, texturesAllocator, applicationData->textCameraBuffer);
     viewer->addInputEventHandler(tsHandler);
     renderRoot->addChild(tsHandler->getRoot());
+    // memory usage of allocators is graphed together with surface statistics
+    tsHandler->addAllocatorStatistics(buffersAllocator,  L"Buffers");
+    tsHandler->addAllocatorStatistics(verticesAllocator, L"Vertices");
+    tsHandler->addAllocatorStatistics(texturesAllocator, L"Textures");
 
     // camera handler processes input events at the beggining of the update phase
     std::shared_ptr<pumex::BasicCameraHandler> bcamHandler = std::make_shared<pumex::BasicCameraHandler>();
@@ -390,7 +439,8 @@ int main( int argc, char * argv[] )
     tbb::flow::make_edge(update, viewer->opEndUpdateGraph);
 
     // events are used to call aplication data update methods. These methods generate data visisble by renderer through uniform buffers
-    viewer->setEventRenderStart( std::bind( &ViewerApplicationData::prepareModelForRendering, applicationData, std::placeholders::_1, asset) );
+    // prepareModelForRendering() also dispatches AsyncLoader callbacks
+    viewer->setEventRenderStart( std::bind( &ViewerApplicationData::prepareModelForRendering, applicationData, std::placeholders::_1) );
     surface->setEventSurfaceRenderStart( std::bind(&ViewerApplicationData::prepareCameraForRendering, applicationData, std::placeholders::_1) );
     // object calculating statistics must be also connected as an event
     surface->setEventSurfacePrepareStatistics(std::bind(&pumex::TimeStatisticsHandler::collectData, tsHandler, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -0,0 +1,257 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <fstream>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <pumex/Pumex.h>
+#include <args.hxx>
+
+// pumexworkflowreport compiles one of the sample workflows without creating Vulkan device or surface and writes compilation report.
+// JSON report may be stored and compared in regression tests ( operation order, barrier counts, render passes, aliasing, memory footprint ),
+// DOT report may be rendered with Graphviz : dot -Tsvg workflow.dot -o workflow.svg
+
+// workflow used by pumexdeferred example. Only this workflow uses multisampling
+std::shared_ptr<pumex::RenderWorkflow> createDeferredWorkflow(std::shared_ptr<pumex::DeviceMemoryAllocator> frameBufferAllocator, VkSampleCountFlagBits sampleCount, bool asyncCompute)
+{
+  std::vector<pumex::QueueTraits> queueTraits{ { VK_QUEUE_GRAPHICS_BIT, 0, 0.75f } };
+
+  std::shared_ptr<pumex::RenderWorkflow> workflow = std::make_shared<pumex::RenderWorkflow>("deferred_workflow", frameBufferAllocator, queueTraits);
+    workflow->addResourceType("vec3_samples",  false, VK_FORMAT_R16G16B16A16_SFLOAT, sampleCount,           pumex::atColor,   pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
+    workflow->addResourceType("color_samples", false, VK_FORMAT_B8G8R8A8_UNORM,      sampleCount,           pumex::atColor,   pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
+    workflow->addResourceType("depth_samples", false, VK_FORMAT_D32_SFLOAT,          sampleCount,           pumex::atDepth,   pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    workflow->addResourceType("resolve",       false, VK_FORMAT_B8G8R8A8_UNORM,      sampleCount,           pumex::atColor,   pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    workflow->addResourceType("surface",       true,  VK_FORMAT_B8G8R8A8_UNORM,      VK_SAMPLE_COUNT_1_BIT, pumex::atSurface, pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+
+  workflow->addRenderOperation("zPrepass", pumex::RenderOperation::Graphics);
+    workflow->addAttachmentDepthOutput("zPrepass", "depth_samples", "depth", VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, pumex::loadOpClear(glm::vec2(1.0f, 0.0f)));
+
+  workflow->addRenderOperation("gBuffer", pumex::RenderOperation::Graphics);
+    workflow->addAttachmentOutput     ("gBuffer", "vec3_samples",  "position", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+    workflow->addAttachmentOutput     ("gBuffer", "vec3_samples",  "normals",  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)));
+    workflow->addAttachmentOutput     ("gBuffer", "color_samples", "albedo",   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.3f, 0.3f, 0.3f, 1.0f)));
+    workflow->addAttachmentOutput     ("gBuffer", "color_samples", "pbr",      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)));
+    workflow->addAttachmentDepthInput ("gBuffer", "depth_samples", "depth",    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+  workflow->addRenderOperation("lighting", pumex::RenderOperation::Graphics);
+    workflow->addAttachmentInput        ("lighting", "vec3_samples",  "position",         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentInput        ("lighting", "vec3_samples",  "normals",          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentInput        ("lighting", "color_samples", "albedo",           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentInput        ("lighting", "color_samples", "pbr",              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentOutput       ("lighting", "resolve",       "resolve",          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+    workflow->addAttachmentResolveOutput("lighting", "surface",       "color", "resolve", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+  return workflow;
+}
+
+// workflow used by pumexgpucull example. Buffers must be associated with resources, because pipeline barriers are created for existing memory objects only
+std::shared_ptr<pumex::RenderWorkflow> createGpuCullWorkflow(std::shared_ptr<pumex::DeviceMemoryAllocator> frameBufferAllocator, VkSampleCountFlagBits sampleCount, bool asyncCompute)
+{
+  std::vector<pumex::QueueTraits> queueTraits{ { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 0, 0.75f } };
+  if (asyncCompute)
+    queueTraits.push_back({ VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT, 0.75f });
+
+  std::shared_ptr<pumex::RenderWorkflow> workflow = std::make_shared<pumex::RenderWorkflow>("gpucull_workflow", frameBufferAllocator, queueTraits);
+    workflow->addResourceType("depth_samples",   false, VK_FORMAT_D32_SFLOAT,    VK_SAMPLE_COUNT_1_BIT, pumex::atDepth,   pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    workflow->addResourceType("surface",         true,  VK_FORMAT_B8G8R8A8_UNORM, VK_SAMPLE_COUNT_1_BIT, pumex::atSurface, pumex::AttachmentSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    workflow->addResourceType("compute_results", false, pumex::RenderWorkflowResourceType::Buffer);
+
+  workflow->addRenderOperation("rendering", pumex::RenderOperation::Graphics);
+    workflow->addAttachmentDepthOutput("rendering", "depth_samples", "depth", VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, pumex::loadOpClear(glm::vec2(1.0f, 0.0f)));
+    workflow->addAttachmentOutput     ("rendering", "surface",       "color", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.3f, 0.3f, 0.3f, 1.0f)));
+
+  workflow->addRenderOperation("static_filter", pumex::RenderOperation::Compute);
+    workflow->addBufferOutput("static_filter", "compute_results", "static_indirect_results", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    workflow->addBufferOutput("static_filter", "compute_results", "static_indirect_draw",    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    workflow->addBufferInput ("rendering",     "compute_results", "static_indirect_results", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    workflow->addBufferInput ("rendering",     "compute_results", "static_indirect_draw",    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+  workflow->addRenderOperation("dynamic_filter", pumex::RenderOperation::Compute);
+    workflow->addBufferOutput("dynamic_filter", "compute_results", "dynamic_indirect_results", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    workflow->addBufferOutput("dynamic_filter", "compute_results", "dynamic_indirect_draw",    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    workflow->addBufferInput ("rendering",      "compute_results", "dynamic_indirect_results", VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    workflow->addBufferInput ("rendering",      "compute_results", "dynamic_indirect_draw",    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+  // buffers are never allocated - report does not need a device
+  for (auto& bufferName : { "static_indirect_results", "static_indirect_draw", "dynamic_indirect_results", "dynamic_indirect_draw" })
+  {
+    auto buffer = std::make_shared<pumex::Buffer<std::vector<uint32_t>>>(std::make_shared<std::vector<uint32_t>>(), frameBufferAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, pumex::pbPerSurface, pumex::swForEachImage);
+    workflow->associateMemoryObject(bufferName, buffer);
+  }
+  return workflow;
+}
+
+// deferred renderer followed by bloom postprocessing at half resolution. Short lived attachments may share images and memory
+std::shared_ptr<pumex::RenderWorkflow> createPostprocessWorkflow(std::shared_ptr<pumex::DeviceMemoryAllocator> frameBufferAllocator, VkSampleCountFlagBits sampleCount, bool asyncCompute)
+{
+  std::vector<pumex::QueueTraits> queueTraits{ { VK_QUEUE_GRAPHICS_BIT, 0, 0.75f } };
+
+  pumex::AttachmentSize fullSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(1.0f,1.0f) };
+  pumex::AttachmentSize halfSize{ pumex::AttachmentSize::SurfaceDependent, glm::vec2(0.5f,0.5f) };
+
+  std::shared_ptr<pumex::RenderWorkflow> workflow = std::make_shared<pumex::RenderWorkflow>("postprocess_workflow", frameBufferAllocator, queueTraits);
+    workflow->addResourceType("vec3",     false, VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT, pumex::atColor,   fullSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
+    workflow->addResourceType("color",    false, VK_FORMAT_B8G8R8A8_UNORM,      VK_SAMPLE_COUNT_1_BIT, pumex::atColor,   fullSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
+    workflow->addResourceType("depth",    false, VK_FORMAT_D32_SFLOAT,          VK_SAMPLE_COUNT_1_BIT, pumex::atDepth,   fullSize, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    workflow->addResourceType("hdr",      false, VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT, pumex::atColor,   fullSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    workflow->addResourceType("hdr_half", false, VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT, pumex::atColor,   halfSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    workflow->addResourceType("surface",  true,  VK_FORMAT_B8G8R8A8_UNORM,      VK_SAMPLE_COUNT_1_BIT, pumex::atSurface, fullSize, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+
+  workflow->addRenderOperation("gBuffer", pumex::RenderOperation::Graphics);
+    workflow->addAttachmentOutput     ("gBuffer", "vec3",  "position", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+    workflow->addAttachmentOutput     ("gBuffer", "vec3",  "normals",  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)));
+    workflow->addAttachmentOutput     ("gBuffer", "color", "albedo",   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,         pumex::loadOpClear(glm::vec4(0.3f, 0.3f, 0.3f, 1.0f)));
+    workflow->addAttachmentDepthOutput("gBuffer", "depth", "depth",    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, pumex::loadOpClear(glm::vec2(1.0f, 0.0f)));
+
+  workflow->addRenderOperation("lighting", pumex::RenderOperation::Graphics);
+    workflow->addAttachmentInput ("lighting", "vec3",  "position", VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentInput ("lighting", "vec3",  "normals",  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentInput ("lighting", "color", "albedo",   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentOutput("lighting", "hdr",   "hdr",      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+
+  workflow->addRenderOperation("bright_pass", pumex::RenderOperation::Graphics, 0x0, halfSize);
+    workflow->addImageInput      ("bright_pass", "hdr",      "hdr",    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentOutput("bright_pass", "hdr_half", "bright", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+
+  workflow->addRenderOperation("blur_horizontal", pumex::RenderOperation::Graphics, 0x0, halfSize);
+    workflow->addImageInput      ("blur_horizontal", "hdr_half", "bright", VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentOutput("blur_horizontal", "hdr_half", "blur_h", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+
+  workflow->addRenderOperation("blur_vertical", pumex::RenderOperation::Graphics, 0x0, halfSize);
+    workflow->addImageInput      ("blur_vertical", "hdr_half", "blur_h", VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentOutput("blur_vertical", "hdr_half", "blur_v", VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+
+  workflow->addRenderOperation("tonemapping", pumex::RenderOperation::Graphics);
+    workflow->addImageInput      ("tonemapping", "hdr",      "hdr",    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addImageInput      ("tonemapping", "hdr_half", "blur_v", VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    workflow->addAttachmentOutput("tonemapping", "surface",  "color",  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, pumex::loadOpDontCare());
+  return workflow;
+}
+
+typedef std::shared_ptr<pumex::RenderWorkflow>(*WorkflowCreator)(std::shared_ptr<pumex::DeviceMemoryAllocator>, VkSampleCountFlagBits, bool);
+
+int main( int argc, char * argv[] )
+{
+  SET_LOG_INFO;
+
+  std::unordered_map<std::string, WorkflowCreator> availableWorkflows
+  {
+    { "deferred",    createDeferredWorkflow },
+    { "gpucull",     createGpuCullWorkflow },
+    { "postprocess", createPostprocessWorkflow }
+  };
+  std::unordered_map<std::string, VkSampleCountFlagBits> availableSamplesPerPixel
+  {
+    {  "1", VK_SAMPLE_COUNT_1_BIT },
+    {  "2", VK_SAMPLE_COUNT_2_BIT },
+    {  "4", VK_SAMPLE_COUNT_4_BIT },
+    {  "8", VK_SAMPLE_COUNT_8_BIT }
+  };
+
+  args::ArgumentParser                              parser("pumex example : offline workflow compilation report");
+  args::HelpFlag                                    help(parser, "help", "display this help menu", { 'h', "help" });
+  args::MapFlag<std::string, WorkflowCreator>       workflowName(parser, "workflow", "sample workflow (deferred, gpucull, postprocess)", { 'w' }, availableWorkflows, createDeferredWorkflow);
+  args::MapFlag<std::string, VkSampleCountFlagBits> samplesPerPixel(parser, "samples", "samples per pixel (1,2,4,8)", { 's' }, availableSamplesPerPixel, VK_SAMPLE_COUNT_4_BIT);
+  args::Flag                                        multiQueue(parser, "multiqueue", "use MultiQueueWorkflowCompiler with dedicated compute queue", { 'm' });
+  args::ValueFlag<uint32_t>                         surfaceWidth(parser, "width", "surface width used by memory estimation", { 'x' }, 1920);
+  args::ValueFlag<uint32_t>                         surfaceHeight(parser, "height", "surface height used by memory estimation", { 'y' }, 1080);
+  args::ValueFlag<std::string>                      jsonFileName(parser, "json", "write JSON report to file", { 'j', "json" });
+  args::ValueFlag<std::string>                      dotFileName(parser, "dot", "write Graphviz DOT graph to file", { 'g', "dot" });
+  try
+  {
+    parser.ParseCLI(argc, argv);
+  }
+  catch (const args::Help&)
+  {
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 0;
+  }
+  catch (const args::ParseError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+  catch (const args::ValidationError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+
+  int result = 0;
+  try
+  {
+    // allocator is never used to allocate memory - workflow compilation does not create Vulkan objects
+    std::shared_ptr<pumex::DeviceMemoryAllocator> frameBufferAllocator = std::make_shared<pumex::DeviceMemoryAllocator>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 512 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    std::shared_ptr<pumex::RenderWorkflow> workflow = args::get(workflowName)(frameBufferAllocator, args::get(samplesPerPixel), multiQueue);
+
+    std::shared_ptr<pumex::RenderWorkflowCompiler> workflowCompiler;
+    if (multiQueue)
+      workflowCompiler = std::make_shared<pumex::MultiQueueWorkflowCompiler>();
+    else
+      workflowCompiler = std::make_shared<pumex::SingleQueueWorkflowCompiler>();
+
+    pumex::RenderWorkflowReport report(*workflow, workflowCompiler, VkExtent2D{ args::get(surfaceWidth), args::get(surfaceHeight) });
+
+    LOG_INFO << "Workflow " << workflow->getName() << " : " << report.getOperationCount() << " operations, " << report.getRenderPassCount() << " render passes, ";
+    LOG_INFO << report.getPipelineBarrierCount() << " pipeline barriers, " << report.getSubpassDependencyCount() << " subpass dependencies" << std::endl;
+    LOG_INFO << "Attachment memory : " << report.getAttachmentMemorySize(false) / 1024 << " kB without aliasing, " << report.getAttachmentMemorySize(true) / 1024 << " kB with aliasing" << std::endl;
+
+    if (jsonFileName)
+    {
+      std::ofstream jsonFile(args::get(jsonFileName));
+      CHECK_LOG_THROW(!jsonFile, "Cannot open file " << args::get(jsonFileName));
+      report.writeJSON(jsonFile);
+    }
+    if (dotFileName)
+    {
+      std::ofstream dotFile(args::get(dotFileName));
+      CHECK_LOG_THROW(!dotFile, "Cannot open file " << args::get(dotFileName));
+      report.writeDOT(dotFile);
+    }
+    if (!jsonFileName && !dotFileName)
+      report.writeJSON(std::cout);
+  }
+  catch (const std::exception& e)
+  {
+#if defined(_DEBUG) && defined(_WIN32)
+    OutputDebugStringA("Exception thrown : ");
+    OutputDebugStringA(e.what());
+    OutputDebugStringA("\n");
+#endif
+    LOG_ERROR << "Exception thrown : " << e.what() << std::endl;
+    result = 1;
+  }
+  catch (...)
+  {
+#if defined(_DEBUG) && defined(_WIN32)
+    OutputDebugStringA("Unknown error\n");
+#endif
+    LOG_ERROR << "Unknown error" << std::endl;
+    result = 1;
+  }
+  FLUSH_LOG;
+  return result;
+}
@@ -0,0 +1,138 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <vector>
+#include <string>
+#include <limits>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <pumex/Export.h>
+#include <pumex/Asset.h>
+
+namespace pumex
+{
+
+// Local transforms of all bones of a skeleton stored as separate arrays of translations, rotations and scales
+struct PUMEX_EXPORT SkeletonPose
+{
+  SkeletonPose() = default;
+  explicit SkeletonPose(uint32_t boneCount);
+
+  void            resize(uint32_t boneCount);
+  inline uint32_t getBoneCount() const;
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::quat> rotations;
+  std::vector<glm::vec3> scales;
+};
+
+// Temporary poses and transforms used by BlendTree. Workspace grows during first evaluation ( or BlendTree::prepareWorkspace() call ),
+// later evaluations do not allocate memory. Each thread evaluating a blend tree must use its own workspace
+struct PUMEX_EXPORT BlendWorkspace
+{
+  std::vector<SkeletonPose> poses;
+  std::vector<glm::mat4>    globalTransforms;
+};
+
+// BlendTree defines how animations are mixed to produce a skeleton pose. Tree consists of nodes :
+// - clip     : animation sampled at time taken from a parameter
+// - blend    : weighted average of N nodes. Weights taken from parameters are normalized, nodes with zero weight are not evaluated
+// - layer    : base node overridden by layer node with weight taken from a parameter and multiplied by bone mask ( e.g. upper body only )
+// - additive : difference between additive node and reference node added to base node with weight taken from a parameter and multiplied by bone mask
+// Animation channels are mapped to skeleton bones by name. Bones not animated by a clip use their bind pose ( Skeleton::Bone::localTransformation ).
+// Tree is not modified during evaluation, so it may be shared by many threads. State of an instance is an array of parameter values
+// ( and optionally an array of keyframe cursors - one for each clip ), state of a thread is a BlendWorkspace
+class PUMEX_EXPORT BlendTree
+{
+public:
+  BlendTree()                            = delete;
+  explicit BlendTree(const Skeleton& skeleton);
+  BlendTree(const BlendTree&)            = delete;
+  BlendTree& operator=(const BlendTree&) = delete;
+
+  uint32_t        addParameter(const std::string& name);
+  uint32_t        getParameterIndex(const std::string& name) const;
+  inline uint32_t getParameterCount() const;
+
+  // boneWeights[i] is a weight of i-th bone of a skeleton
+  uint32_t        addBoneMask(const std::vector<float>& boneWeights);
+  // mask containing a bone and all its descendants
+  uint32_t        addBoneMask(const std::string& boneName, float weight = 1.0f);
+
+  // methods adding nodes return node index. Animations must exist as long as the tree exists.
+  // The last added node is a root of the tree unless setRoot() is called
+  uint32_t        addClip(const Animation& animation, uint32_t timeParameter);
+  // binding must be created for the skeleton used by the tree
+  uint32_t        addClip(const SkeletonAnimationBinding& binding, uint32_t timeParameter);
+  uint32_t        addBlend(const std::vector<uint32_t>& inputs, const std::vector<uint32_t>& weightParameters);
+  uint32_t        addLayer(uint32_t base, uint32_t layer, uint32_t weightParameter, uint32_t boneMask = noBoneMask);
+  uint32_t        addAdditive(uint32_t base, uint32_t additive, uint32_t reference, uint32_t weightParameter, uint32_t boneMask = noBoneMask);
+  void            setRoot(uint32_t node);
+  inline uint32_t getClipCount() const;
+  inline uint32_t getBoneCount() const;
+
+  void            prepareWorkspace(BlendWorkspace& workspace) const;
+  // parameters point to getParameterCount() values, cursors point to getClipCount() cursors or are equal to nullptr
+  void            evaluate(const float* parameters, AnimationCursor* cursors, BlendWorkspace& workspace, SkeletonPose& pose) const;
+  // boneMatrices point to getBoneCount() matrices : boneMatrix = globalTransform * offsetMatrix
+  void            calculateBoneMatrices(const SkeletonPose& pose, BlendWorkspace& workspace, glm::mat4* boneMatrices) const;
+
+  static const uint32_t noBoneMask = std::numeric_limits<uint32_t>::max();
+
+protected:
+  struct Node
+  {
+    enum Type { Clip, Blend, Layer, Additive };
+    Type                  type;
+    uint32_t              clip      = 0;          // clip index ( Clip )
+    uint32_t              parameter = 0;          // time ( Clip ) or weight ( Layer, Additive )
+    uint32_t              boneMask  = noBoneMask; // Layer, Additive
+    std::vector<uint32_t> inputs;                 // child nodes
+    std::vector<uint32_t> weightParameters;       // Blend
+    uint32_t              poseCount = 0;          // number of temporary poses used by node and its children
+  };
+  struct Clip
+  {
+    const Animation*      animation;
+    std::vector<uint32_t> boneChannels;           // channel animating a bone, std::numeric_limits<uint32_t>::max() for bones that are not animated
+  };
+
+  uint32_t addNode(const Node& node);
+  void     evaluateNode(uint32_t nodeIndex, const float* parameters, AnimationCursor* cursors, BlendWorkspace& workspace, uint32_t firstPose, SkeletonPose& pose) const;
+  void     sampleClip(const Clip& clip, float time, AnimationCursor* cursor, SkeletonPose& pose) const;
+
+  Skeleton                        skeleton;
+  SkeletonPose                    bindPose;
+  std::vector<std::string>        parameterNames;
+  std::vector<std::vector<float>> boneMasks;
+  std::vector<Clip>               clips;
+  std::vector<Node>               nodes;
+  uint32_t                        root = std::numeric_limits<uint32_t>::max();
+};
+
+uint32_t SkeletonPose::getBoneCount() const   { return static_cast<uint32_t>(positions.size()); }
+uint32_t BlendTree::getParameterCount() const { return static_cast<uint32_t>(parameterNames.size()); }
+uint32_t BlendTree::getClipCount() const      { return static_cast<uint32_t>(clips.size()); }
+uint32_t BlendTree::getBoneCount() const      { return static_cast<uint32_t>(skeleton.bones.size()); }
+
+}
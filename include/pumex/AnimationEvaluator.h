@@ -0,0 +1,98 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <vector>
+#include <limits>
+#include <glm/glm.hpp>
+#include <pumex/Export.h>
+#include <pumex/Asset.h>
+
+namespace pumex
+{
+
+// Temporary transforms used by AnimationEvaluator. Workspace grows during first evaluation, later evaluations of skeletons
+// with the same or lower bone count do not allocate memory. Each thread evaluating animations must use its own workspace
+struct PUMEX_EXPORT AnimationEvaluatorWorkspace
+{
+  std::vector<unsigned char> storage; // raw memory, aligned by AnimationEvaluator
+};
+
+// AnimationEvaluator calculates bone matrices for many instances of the same skeleton animated by the same animation.
+// Keyframes are stored in SoA layout ( each coordinate of a value in a separate array ) and instances are evaluated in batches :
+// keyframe interpolation, quaternion slerp, conversion to matrices and propagation of transforms through bone hierarchy are performed
+// for all instances of a batch at once, using SSE instructions where available.
+// Results are the same as those calculated by Animation::calculateLocalTransforms() followed by a walk through skeleton hierarchy :
+// boneMatrix = globalTransform * offsetMatrix, where global transform of the root bone is premultiplied by skeleton's invGlobalTransform
+class PUMEX_EXPORT AnimationEvaluator
+{
+public:
+  AnimationEvaluator()                                     = delete;
+  explicit AnimationEvaluator(const Skeleton& skeleton, const Animation& animation);
+  explicit AnimationEvaluator(const SkeletonAnimationBinding& binding);
+  AnimationEvaluator(const AnimationEvaluator&)            = delete;
+  AnimationEvaluator& operator=(const AnimationEvaluator&) = delete;
+
+  // times[i] is the animation time of i-th instance, boneMatrices[i] points to getBoneCount() matrices of i-th instance.
+  // Evaluator is not modified, so many threads may evaluate different instances at once. Methods without workspace parameter use workspace owned by calling thread
+  void            evaluate(const float* times, glm::mat4* const* boneMatrices, uint32_t instanceCount) const;
+  void            evaluate(const float* times, glm::mat4* const* boneMatrices, uint32_t instanceCount, AnimationEvaluatorWorkspace& workspace) const;
+  // cursors[i] is a playback state of i-th instance ( see AnimationCursor ) that is used and updated during evaluation
+  void            evaluate(const float* times, AnimationCursor* const* cursors, glm::mat4* const* boneMatrices, uint32_t instanceCount) const;
+  void            evaluate(const float* times, AnimationCursor* const* cursors, glm::mat4* const* boneMatrices, uint32_t instanceCount, AnimationEvaluatorWorkspace& workspace) const;
+
+  inline uint32_t getBoneCount() const;
+  inline uint32_t getChannelCount() const;
+
+  // number of instances evaluated together
+  static const uint32_t batchSize = 4;
+
+  // keyframes of one channel component ( position, rotation or scale )
+  struct Track
+  {
+    std::vector<float> times;
+    std::vector<float> values[4];
+    float              beginTime = 0.0f;
+    float              endTime   = 0.0f;
+  };
+  struct ChannelTracks
+  {
+    Track                     position;
+    Track                     rotation;
+    Track                     scale;
+    Animation::Channel::State before = Animation::Channel::CLAMP;
+    Animation::Channel::State after  = Animation::Channel::CLAMP;
+  };
+
+protected:
+  std::vector<ChannelTracks> channels;
+  std::vector<uint32_t>      boneChannels;    // channel that animates a bone, std::numeric_limits<uint32_t>::max() for bones that are not animated
+  std::vector<uint32_t>      boneParents;
+  std::vector<glm::mat4>     boneLocalTransformations;
+  std::vector<glm::mat4>     boneOffsetMatrices;
+  glm::mat4                  invGlobalTransform;
+};
+
+uint32_t AnimationEvaluator::getBoneCount() const    { return static_cast<uint32_t>(boneChannels.size()); }
+uint32_t AnimationEvaluator::getChannelCount() const { return static_cast<uint32_t>(channels.size()); }
+
+}
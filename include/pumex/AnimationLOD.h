@@ -0,0 +1,79 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <pumex/Export.h>
+#include <pumex/Asset.h>
+
+namespace pumex
+{
+
+// Animation quality used by instances drawn with given LOD ( LOD index is returned by AssetBuffer::getLodID() )
+struct PUMEX_EXPORT AnimationLodPolicy
+{
+  AnimationLodPolicy(uint32_t ui = 1, float lwt = 0.0f)
+    : updateInterval{ ui }, leafWeightThreshold{ lwt }
+  {
+  }
+  uint32_t updateInterval;      // bone matrices are calculated every updateInterval frames, previous matrices are reused in between
+  float    leafWeightThreshold; // leaf bones with smaller share of skin weights of LOD asset are not animated ( see calculateAnimatedBones() )
+};
+
+// Returns share of all skin weights of an asset that belongs to each bone of a skeleton. Asset bones are matched with skeleton bones by name
+PUMEX_EXPORT std::vector<float> calculateBoneWeights(const Skeleton& skeleton, const Asset& asset);
+// Returns bones that must be animated : bones with weight not smaller than weightThreshold and all their ancestors. Remaining bones
+// keep their bind pose relative to parents. Bone count and bone order does not change, so bone indices stored in vertices stay valid
+PUMEX_EXPORT std::vector<bool>  calculateAnimatedBones(const Skeleton& skeleton, const std::vector<float>& boneWeights, float weightThreshold);
+// Creates binding that animates only the bones needed by LOD asset
+PUMEX_EXPORT SkeletonAnimationBinding createLodBinding(const Skeleton& skeleton, const Animation& animation, const Asset& lodAsset, const AnimationLodPolicy& policy);
+
+// AnimationLodScheduler decides which instances should have their bone matrices calculated in current frame.
+// Instances using update interval N are divided into N groups ( by instance index ) and each frame a different group is updated,
+// so that reduced rate updates are spread evenly across frames. Instance that was not updated for longer than its update interval
+// ( e.g. because it changed its LOD or was not visible ) is updated immediately.
+class PUMEX_EXPORT AnimationLodScheduler
+{
+public:
+  explicit AnimationLodScheduler(const std::vector<AnimationLodPolicy>& policies = std::vector<AnimationLodPolicy>());
+
+  void                             setPolicies(const std::vector<AnimationLodPolicy>& policies);
+  inline const AnimationLodPolicy& getPolicy(uint32_t lodID) const;
+  inline uint32_t                  getPolicyCount() const;
+  // forgets all previous updates
+  void                             reset(uint32_t instanceCount);
+
+  // Returns true when instance should be updated in a frame with given number. Instances that are not drawn ( lodID == std::numeric_limits<uint32_t>::max() )
+  // are never updated. Different threads may call this method for different instances at once
+  bool                             update(uint32_t instanceIndex, uint32_t lodID, uint64_t frameNumber);
+
+protected:
+  std::vector<AnimationLodPolicy> policies;
+  std::vector<uint64_t>           lastUpdate;
+};
+
+const AnimationLodPolicy& AnimationLodScheduler::getPolicy(uint32_t lodID) const { return policies[std::min<size_t>(lodID, policies.size() - 1)]; }
+uint32_t                  AnimationLodScheduler::getPolicyCount() const          { return static_cast<uint32_t>(policies.size()); }
+
+}
@@ -187,6 +187,26 @@ inline bool operator<(const TimeLine<T>& lhs, const TimeLine<T>& rhs)
   return lhs.time<rhs.time;
 }
 
+struct Animation;
+
+// Animation playback state of a single instance. Cursors remember keyframes used by the last sample of each channel, so that the next
+// sample ( usually one frame later ) finds its keyframes by advancing a cursor instead of doing a binary search. Binary search is used only
+// when time moves backwards or jumps over many keyframes ( seeks, animation loops ). Cursors affect performance only, never the results,
+// so the same AnimationCursor may be used with different animations
+struct PUMEX_EXPORT AnimationCursor
+{
+  struct ChannelCursor
+  {
+    uint32_t position = 0;
+    uint32_t rotation = 0;
+    uint32_t scale    = 0;
+  };
+
+  void reset(const Animation& animation);
+
+  std::vector<ChannelCursor> channels;
+};
+
 // class storing information about Asset animations
 struct PUMEX_EXPORT Animation
 {
@@ -209,9 +229,11 @@ struct PUMEX_EXPORT Animation
     float endTime() const;
 
     glm::mat4 calculateTransform(float time, Channel::State before, Channel::State after) const;
+    glm::mat4 calculateTransform(float time, Channel::State before, Channel::State after, AnimationCursor::ChannelCursor& cursor) const;
   };
 
   void calculateLocalTransforms(float time, glm::mat4* data, uint32_t size) const;
+  void calculateLocalTransforms(float time, glm::mat4* data, uint32_t size, AnimationCursor& cursor) const;
 
   std::string                        name;
   std::vector<Channel>               channels;
@@ -221,6 +243,35 @@ struct PUMEX_EXPORT Animation
   std::map<std::string, std::size_t> invChannelNames;
 };
 
+// SkeletonAnimationBinding maps skeleton bones to animation channels by name once, so that bone matrices may be calculated without string lookups.
+// Skeleton and animation must exist as long as the binding exists. Binding is not modified after construction, so many threads may use it at once
+class PUMEX_EXPORT SkeletonAnimationBinding
+{
+public:
+  SkeletonAnimationBinding()                                           = delete;
+  explicit SkeletonAnimationBinding(const Skeleton& skeleton, const Animation& animation);
+  // bones with animatedBones[boneIndex] == false are not bound to any channel ( see calculateAnimatedBones() )
+  explicit SkeletonAnimationBinding(const Skeleton& skeleton, const Animation& animation, const std::vector<bool>& animatedBones);
+  SkeletonAnimationBinding(const SkeletonAnimationBinding&)            = default;
+  SkeletonAnimationBinding& operator=(const SkeletonAnimationBinding&) = delete;
+
+  inline const Skeleton&              getSkeleton() const;
+  inline const Animation&             getAnimation() const;
+  inline uint32_t                     getBoneCount() const;
+  // channel animating a bone or std::numeric_limits<uint32_t>::max() when bone is not animated ( Skeleton::Bone::localTransformation is used then )
+  inline uint32_t                     getBoneChannel(uint32_t boneIndex) const;
+  inline const std::vector<uint32_t>& getBoneChannels() const;
+
+  // localTransforms point to animation channel transforms ( see Animation::calculateLocalTransforms() ), globalTransforms and boneMatrices point to getBoneCount() matrices.
+  // boneMatrix = globalTransform * offsetMatrix, where global transform of the root bone is premultiplied by skeleton's invGlobalTransform
+  void                                calculateBoneMatrices(const glm::mat4* localTransforms, glm::mat4* globalTransforms, glm::mat4* boneMatrices) const;
+
+protected:
+  const Skeleton&       skeleton;
+  const Animation&      animation;
+  std::vector<uint32_t> boneChannels;
+};
+
 // Main class for storing information about an asset loaded from file ( by assimp or custom created loaders )
 // TODO : should we add lights in some form here ?
 class PUMEX_EXPORT Asset
@@ -278,6 +329,48 @@ VkDeviceSize Geometry::getIndexCount() const     { return indices.size(); }
 VkDeviceSize Geometry::getIndexSize() const      { return indices.size() * sizeof(uint32_t); }
 VkDeviceSize Geometry::getPrimitiveCount() const { return indices.size() / calcPrimitiveSize(topology); }
 
+const Skeleton&              SkeletonAnimationBinding::getSkeleton() const                     { return skeleton; }
+const Animation&             SkeletonAnimationBinding::getAnimation() const                    { return animation; }
+uint32_t                     SkeletonAnimationBinding::getBoneCount() const                    { return static_cast<uint32_t>(boneChannels.size()); }
+uint32_t                     SkeletonAnimationBinding::getBoneChannel(uint32_t boneIndex) const { return boneChannels[boneIndex]; }
+const std::vector<uint32_t>& SkeletonAnimationBinding::getBoneChannels() const                 { return boneChannels; }
+
+// Precompiled conversion of vertices from one semantic to another. Each target vertex is built from default values
+// ( e.g. w = 1 for positions ) that are partially overwritten by contiguous spans of floats copied from a source vertex.
+// Conversion is not modified after construction, so many threads may convert different vertices at once
+class PUMEX_EXPORT VertexConversion
+{
+public:
+  VertexConversion()                                   = delete;
+  explicit VertexConversion(const std::vector<VertexSemantic>& targetSemantic, const std::vector<VertexSemantic>& sourceSemantic);
+
+  // converts vertexCount vertices. Target must have room for vertexCount * getTargetVertexSize() floats
+  void            convert(float* target, const float* source, size_t vertexCount) const;
+
+  inline uint32_t getTargetVertexSize() const;
+  inline uint32_t getSourceVertexSize() const;
+  // number of vertices stored in a source buffer of given size ( in floats )
+  inline size_t   getSourceVertexCount(size_t sourceSize) const;
+
+  struct Span
+  {
+    uint32_t targetOffset;
+    uint32_t sourceOffset;
+    uint32_t size;
+  };
+
+protected:
+  uint32_t           targetVertexSize;
+  uint32_t           sourceVertexSize;
+  bool               sameSemantic;
+  std::vector<float> defaultValues;
+  std::vector<Span>  spans;
+};
+
+uint32_t VertexConversion::getTargetVertexSize() const                 { return targetVertexSize; }
+uint32_t VertexConversion::getSourceVertexSize() const                 { return sourceVertexSize; }
+size_t   VertexConversion::getSourceVertexCount(size_t sourceSize) const { return (sourceVertexSize > 0) ? sourceSize / sourceVertexSize : 0; }
+
 // convert vertices from one semantic to another
 PUMEX_EXPORT void copyAndConvertVertices(std::vector<float>& targetBuffer, const std::vector<VertexSemantic>& targetSemantic, const std::vector<float>& sourceBuffer, const std::vector<VertexSemantic>& sourceSemantic);
 // transform vertices using matrix
@@ -313,6 +406,24 @@ inline uint32_t binarySearchIndex(const TimeLine<T>* values, uint32_t size, floa
   return begin;
 }
 
+// maximum number of keyframes that cursorSearchIndex() advances before falling back to binary search
+const uint32_t cursorMaxSteps = 4;
+
+// the same as binarySearchIndex(), but starts from the index found by previous search
+template<typename T>
+inline uint32_t cursorSearchIndex(const TimeLine<T>* values, uint32_t size, float time, uint32_t& cursor)
+{
+  uint32_t index = cursor;
+  if (index >= size || values[index].time > time)
+    return cursor = binarySearchIndex(values, size, time);
+  for (uint32_t step = 0; index + 1 < size && values[index + 1].time <= time; ++step, ++index)
+  {
+    if (step == cursorMaxSteps)
+      return cursor = index + binarySearchIndex(values + index, size - index, time);
+  }
+  return cursor = index;
+}
+
 template<typename T>
 inline float tBeginTime(const std::vector<TimeLine<T>>& values)
 {
@@ -385,5 +496,23 @@ inline T slerp(const TimeLine<T>* values, const uint32_t size, float time)
   return   glm::slerp(values[i].value, values[(i+1)%size].value, a);
 }
 
+// linear interpolation using keyframe cursor
+template<typename T>
+inline T mix(const TimeLine<T>* values, const uint32_t size, float time, uint32_t& cursor)
+{
+  uint32_t i = cursorSearchIndex(values, size, time, cursor);
+  float    a = (time - values[i].time) / (values[(i+1)%size].time - values[i].time);
+  return   glm::mix(values[i].value, values[(i+1)%size].value, a);
+}
+
+// spherical interpolation using keyframe cursor
+template<typename T>
+inline T slerp(const TimeLine<T>* values, const uint32_t size, float time, uint32_t& cursor)
+{
+  uint32_t i = cursorSearchIndex(values, size, time, cursor);
+  float    a = (time - values[i].time) / (values[(i+1)%size].time - values[i].time);
+  return   glm::slerp(values[i].value, values[(i+1)%size].value, a);
+}
+
 }
 
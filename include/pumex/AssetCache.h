@@ -0,0 +1,64 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <gli/texture.hpp>
+#include <pumex/Export.h>
+#include <pumex/Asset.h>
+
+namespace pumex
+{
+
+// Binary asset files ( *.pumexasset ) store skeleton, geometries, materials and animations of an Asset in a form that may be loaded
+// without any parsing : file is memory mapped and each array is copied into the Asset at once. Geometries are stored in the vertex
+// semantic they had when the file was saved. sourceKey identifies the data the asset was created from ( see AssetLoaderCache ).
+// loadAssetFile() returns nullptr when file does not exist, was saved by a different version of pumex or has a different sourceKey
+PUMEX_EXPORT void                   saveAssetFile(const Asset& asset, const std::string& fileName, const std::string& sourceKey = std::string());
+PUMEX_EXPORT std::shared_ptr<Asset> loadAssetFile(const std::string& fileName, const std::string& sourceKey = std::string());
+
+// Textures are stored in *.pumexasset files with their own header. Whole texture storage ( all layers, faces and levels ) is written as one block
+// and copied from the mapped file into gli::texture without any conversion. Functions follow the same rules as saveAssetFile() / loadAssetFile()
+PUMEX_EXPORT void                          saveTextureFile(const gli::texture& texture, const std::string& fileName, const std::string& sourceKey = std::string());
+PUMEX_EXPORT std::shared_ptr<gli::texture> loadTextureFile(const std::string& fileName, const std::string& sourceKey = std::string());
+
+// Asset loader that stores assets loaded by other loader ( e.g. AssetLoaderAssimp ) in asset files and loads them from there later.
+// Cached file is used only when path, modification time and size of the source file, animationOnly flag and required vertex semantic
+// are the same as during the first load. By default cache files are stored in temporary directory of the system
+class PUMEX_EXPORT AssetLoaderCache : public AssetLoader
+{
+public:
+  explicit AssetLoaderCache(std::shared_ptr<AssetLoader> loader, const std::string& cacheDirectory = std::string());
+  std::shared_ptr<Asset> load(std::shared_ptr<Viewer> viewer, const std::string& fileName, bool animationOnly = false, const std::vector<VertexSemantic>& requiredSemantic = std::vector<VertexSemantic>()) override;
+
+  inline const std::string& getCacheDirectory() const;
+
+protected:
+  std::shared_ptr<AssetLoader> loader;
+  std::string                  cacheDirectory;
+};
+
+const std::string& AssetLoaderCache::getCacheDirectory() const { return cacheDirectory; }
+
+}
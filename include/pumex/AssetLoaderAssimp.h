@@ -31,7 +31,7 @@
 namespace pumex
 {
 
-// asset loader that uses Assimp library
+// asset loader that uses Assimp library. Each call to load() uses its own Assimp::Importer, so the loader may be used by many threads at once
 class PUMEX_EXPORT AssetLoaderAssimp : public AssetLoader
 {
 public:
@@ -41,7 +41,6 @@ public:
   inline unsigned int getImportFlags() const;
   inline void setImportFlags(unsigned int flags);
 protected:
-  Assimp::Importer Importer;
   unsigned int     importFlags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_JoinIdenticalVertices; //  aiPostProcessSteps
   //  unsigned int flags = aiProcess_FlipWindingOrder | aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_SortByPType; //  aiPostProcessSteps
 
@@ -0,0 +1,78 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <tbb/task_group.h>
+#include <pumex/Export.h>
+#include <pumex/Asset.h>
+#include <pumex/Image.h>
+
+namespace pumex
+{
+
+// AsyncLoader decodes assets and textures on TBB worker threads, so that application may start rendering before all files are loaded.
+// Each load request returns a future and may register a callback. Callbacks are not called on worker threads - they are stored
+// and called by dispatchCallbacks(), which should be called from Viewer::setEventRenderStart() event ( or before Viewer::run() ).
+// This way callbacks may safely call AssetBuffer::registerObjectLOD(), MaterialSet::registerMaterials() and similar methods while the viewer is rendering.
+// Asset loader and texture loader must be reentrant ( AssetLoaderAssimp, AssetLoaderCache and TextureLoaderGli are ).
+// When a file fails to load, its future holds an exception and its callback is not called.
+class PUMEX_EXPORT AsyncLoader
+{
+public:
+  AsyncLoader()                              = delete;
+  explicit AsyncLoader(std::shared_ptr<AssetLoader> assetLoader, std::shared_ptr<TextureLoader> textureLoader);
+  AsyncLoader(const AsyncLoader&)            = delete;
+  AsyncLoader& operator=(const AsyncLoader&) = delete;
+  AsyncLoader(AsyncLoader&&)                 = delete;
+  AsyncLoader& operator=(AsyncLoader&&)      = delete;
+  virtual ~AsyncLoader();
+
+  std::shared_future<std::shared_ptr<Asset>>        loadAsset(std::shared_ptr<Viewer> viewer, const std::string& fileName, bool animationOnly = false, const std::vector<VertexSemantic>& requiredSemantic = std::vector<VertexSemantic>(), std::function<void(std::shared_ptr<Asset>)> callback = nullptr);
+  std::shared_future<std::shared_ptr<gli::texture>> loadTexture(std::shared_ptr<Viewer> viewer, const std::string& fileName, std::function<void(std::shared_ptr<gli::texture>)> callback = nullptr);
+
+  // calls callbacks of all requests finished since last call. Returns the number of called callbacks
+  uint32_t                                          dispatchCallbacks();
+  // waits until all requests are finished. Callbacks must be dispatched afterwards
+  void                                              wait();
+
+  inline uint32_t                                   getPendingCount() const;
+
+protected:
+  void                                              addCallback(std::function<void()> callback);
+
+  std::shared_ptr<AssetLoader>                      assetLoader;
+  std::shared_ptr<TextureLoader>                    textureLoader;
+  tbb::task_group                                   tasks;
+  std::atomic<uint32_t>                             pendingCount;
+  std::mutex                                        mutex;
+  std::vector<std::function<void()>>                finishedCallbacks;
+};
+
+uint32_t AsyncLoader::getPendingCount() const { return pendingCount.load(); }
+
+}
@@ -125,6 +125,8 @@ public:
   void            cmdDispatch(uint32_t x, uint32_t y, uint32_t z) const;
 
   void            cmdCopyBufferToImage(VkBuffer srcBuffer, const Image& image, VkImageLayout dstImageLayout, const std::vector<VkBufferImageCopy>& regions) const;
+  void            cmdCopyImage(const Image& srcImage, VkImageLayout srcImageLayout, const Image& dstImage, VkImageLayout dstImageLayout, const std::vector<VkImageCopy>& regions) const;
+  void            cmdBlitImage(const Image& srcImage, VkImageLayout srcImageLayout, const Image& dstImage, VkImageLayout dstImageLayout, const std::vector<VkImageBlit>& regions, VkFilter filter) const;
   void            cmdClearColorImage(const Image& image, VkImageLayout imageLayout, VkClearValue color, std::vector<VkImageSubresourceRange> subresourceRanges);
   void            cmdClearDepthStencilImage(const Image& image, VkImageLayout imageLayout, VkClearValue depthStencil, std::vector<VkImageSubresourceRange> subresourceRanges);
 
@@ -0,0 +1,80 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <vector>
+#include <string>
+#include <map>
+#include <glm/glm.hpp>
+#include <pumex/Export.h>
+#include <pumex/Asset.h>
+
+namespace pumex
+{
+
+// CompressedAnimation is a memory efficient equivalent of Animation :
+// - each track ( position, rotation or scale of a channel ) is resampled with uniform frequency, so key times are not stored
+// - each track uses the lowest number of keys that reproduces the original track within given tolerance. Constant tracks use a single key
+// - rotations are quantized using "smallest three" method : three smallest components are stored on 15 bits each, the largest one is reconstructed
+// - positions and scales are quantized to 16 bits per component within the range of values of their track
+// Each key takes 6 bytes instead of 16 bytes ( position, scale ) or 20 bytes ( rotation ) used by Animation. Keys are decoded during sampling.
+struct PUMEX_EXPORT CompressedAnimation
+{
+  struct Track
+  {
+    float     beginTime      = 0.0f;
+    float     endTime        = 0.0f;
+    float     invKeyInterval = 0.0f;
+    uint32_t  keyCount       = 0;                // 0 for empty tracks
+    uint32_t  dataOffset     = 0;                // index of the first key in keyData
+    glm::vec3 rangeMin       = glm::vec3(0.0f);  // quantization range of position and scale tracks
+    glm::vec3 rangeExtent    = glm::vec3(0.0f);
+  };
+  struct Channel
+  {
+    Track position;
+    Track rotation;
+    Track scale;
+  };
+
+  CompressedAnimation() = default;
+  // conversion from Animation ( loaded by AssetLoaderAssimp for example ). Position and scale tolerances are expressed in model units, rotation tolerance in radians
+  explicit CompressedAnimation(const Animation& animation, float positionTolerance = 0.0005f, float rotationTolerance = 0.001f, float scaleTolerance = 0.0005f);
+
+  glm::mat4   calculateTransform(uint32_t channel, float time) const;
+  void        calculateLocalTransforms(float time, glm::mat4* data, uint32_t size) const;
+  // memory used by tracks and keys
+  std::size_t getMemorySize() const;
+
+  // number of values stored for each key
+  static const uint32_t keySize = 3;
+
+  std::string                            name;
+  std::vector<Channel>                   channels;
+  std::vector<uint16_t>                  keyData;
+  std::vector<Animation::Channel::State> channelBefore;
+  std::vector<Animation::Channel::State> channelAfter;
+  std::vector<std::string>               channelNames;  // channel name = bone name
+  std::map<std::string, std::size_t>     invChannelNames;
+};
+
+}
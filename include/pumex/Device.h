@@ -28,6 +28,7 @@
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <pumex/Export.h>
+#include <pumex/utils/Buffer.h>
 
 namespace pumex
 {
@@ -107,6 +108,18 @@ public:
   std::shared_ptr<StagingBuffer>  acquireStagingBuffer( const void* data, VkDeviceSize size );
   void                            releaseStagingBuffer(std::shared_ptr<StagingBuffer> buffer);
 
+  // staging regions are suballocated from one persistently mapped ring buffer. When the ring is full, dedicated staging buffer is used instead
+  StagingRegion                   acquireStagingRegion(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+  void                            releaseStagingRegion(const StagingRegion& region);
+  void                            setStagingRingSize(VkDeviceSize size);
+  StagingRingStatistics           getStagingRingStatistics() const;
+
+  // ranges of persistently mapped, non coherent memory written by the host are collected here and flushed in one call before queue submission
+  void                            addMappedMemoryRangeToFlush(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size);
+  // removes pending ranges that lie within given part of memory. Must be called before the memory is freed
+  void                            removeMappedMemoryRangesToFlush(VkDeviceMemory memory, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+  void                            flushMappedMemoryRanges();
+
   inline void                     setID(uint32_t newID);
   inline uint32_t                 getID() const;
 
@@ -152,12 +165,18 @@ protected:
   std::vector<std::shared_ptr<Queue>>         queues;
   std::shared_ptr<DescriptorPool>             descriptorPool;
   std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
+  std::unique_ptr<StagingRing>                stagingRing;
+  VkDeviceSize                                stagingRingSize = 16 * 1024 * 1024;
 
   std::vector<const char*>                    requestedDeviceExtensions;
   std::vector<const char*>                    enabledDeviceExtensions;
 
+  VkDeviceSize                                nonCoherentAtomSize = 1;
+  std::vector<VkMappedMemoryRange>            mappedMemoryRangesToFlush;
+
   mutable std::mutex                          stagingMutex;
   mutable std::mutex                          submitMutex;
+  mutable std::mutex                          flushMutex;
 };
 
 void     Device::resetRequestedQueues()                   { requestedQueues.clear(); }
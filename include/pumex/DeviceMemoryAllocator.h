@@ -33,6 +33,7 @@ namespace pumex
 {
 
 class Device;
+class MemoryObject;
 
 struct PUMEX_EXPORT DeviceMemoryBlock
 {
@@ -44,6 +45,8 @@ struct PUMEX_EXPORT DeviceMemoryBlock
   VkDeviceSize   alignedOffset;
   VkDeviceSize   realSize;
   VkDeviceSize   alignedSize;
+  // pointer to alignedOffset when block comes from persistently mapped allocator, nullptr otherwise
+  uint8_t*       mappedPointer;
 };
 
 struct FreeBlock
@@ -53,24 +56,55 @@ struct FreeBlock
   VkDeviceSize size;
 };
 
+// statistics of a single allocator on a single device. Bytes are measured in whole blocks handed out by allocation strategy ( including alignment padding )
+struct PUMEX_EXPORT DeviceMemoryAllocatorStatistics
+{
+  VkDeviceSize reservedBytes       = 0; // memory taken from Vulkan by vkAllocateMemory()
+  VkDeviceSize usedBytes           = 0;
+  VkDeviceSize freeBytes           = 0;
+  VkDeviceSize largestFreeBlock    = 0;
+  VkDeviceSize peakUsedBytes       = 0;
+  uint32_t     freeBlockCount      = 0;
+  uint32_t     allocationCount     = 0;
+  uint32_t     allocationsPerFrame = 0; // allocations made during last finished frame
+  uint32_t     blockCount          = 0; // number of vkAllocateMemory() blocks
+};
+
+// AllocationStrategy manages free space inside a single range of device memory. Each range of memory allocated by DeviceMemoryAllocator
+// owns its own strategy object, so strategies are free to keep any internal data structures they need.
+// allocate() returns empty DeviceMemoryBlock ( alignedSize == 0 ) when there's no free space for requested data
+// allocateBelow() is used by defragmentation : it returns the lowest placed block that starts below maxOffset
 class PUMEX_EXPORT AllocationStrategy
 {
 public:
   virtual ~AllocationStrategy();
-  virtual DeviceMemoryBlock allocate(VkDeviceMemory storageMemory, std::list<FreeBlock>& freeBlocks, VkMemoryRequirements memoryRequirements) = 0;
-  virtual void deallocate(std::list<FreeBlock>& freeBlocks, const DeviceMemoryBlock& block) = 0;
+  virtual DeviceMemoryBlock allocate(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements) = 0;
+  virtual DeviceMemoryBlock allocateBelow(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements, VkDeviceSize maxOffset) = 0;
+  virtual void              deallocate(const DeviceMemoryBlock& block) = 0;
+  virtual void              getFreeBlocks(std::vector<FreeBlock>& freeBlocks) const = 0;
 };
 
-// DeviceMemoryAllocator is a class that enables user to store different data ( Vulkan buffers and images ) in a single block of
+// DeviceMemoryAllocator is a class that enables user to store different data ( Vulkan buffers and images ) in blocks of
 // GPU/host memory allocated by vkAllocateMemory(). User may define what type of memory he wants from the Vulkan ( VkMemoryPropertyFlags ),
-// how much of that memory should be allocated and what allocation strategy to use when allocating/deallocating memory.
-// For now only one strategy is implemented : first fit allocation.
+// how big each block of memory should be, how many blocks may be allocated and what allocation strategy to use when allocating/deallocating memory.
+// Blocks are allocated on demand : when none of existing blocks is able to store requested data, a new block is allocated ( unless maxBlockCount
+// blocks are already in use ). Allocation that is bigger than blockSize gets its own dedicated block. Blocks that become empty are released,
+// but the first block is kept for the lifetime of the allocator.
+// Available strategies :
+// - FIRST_FIT : first fit allocation on a sorted list of free blocks. Simple, but allocate() and deallocate() are linear in number of free blocks
+// - TLSF      : two level segregated fit. allocate() and deallocate() work in constant time regardless of how many blocks are stored in memory
+// Allocators using HOST_VISIBLE memory may be persistently mapped : each block of memory is mapped once, right after its allocation, and every
+// DeviceMemoryBlock carries a pointer to its data. Writes to such memory do not need vkMapMemory() and are not serialized on allocator mutex.
+// When memory is not HOST_COHERENT, written ranges are collected by the Device and flushed in a single vkFlushMappedMemoryRanges() call per frame.
+// MemoryBuffer and MemoryImage objects register themselves in their allocator, so that the allocator is able to defragment its memory.
+// Each call to defragment() moves a limited amount of data to the lowest free places in memory, so the whole process may be spread over many frames.
+// getStatistics() reports memory usage and fragmentation. Allocations are counted per frame - call finishFrame() once per frame to close the counter.
 class PUMEX_EXPORT DeviceMemoryAllocator
 {
 public:
-  enum EnumStrategy { FIRST_FIT };
+  enum EnumStrategy { FIRST_FIT, TLSF };
   DeviceMemoryAllocator()                                        = delete;
-  explicit DeviceMemoryAllocator(VkMemoryPropertyFlags propertyFlags, VkDeviceSize size, EnumStrategy strategy);
+  explicit DeviceMemoryAllocator(VkMemoryPropertyFlags propertyFlags, VkDeviceSize blockSize, EnumStrategy strategy, uint32_t maxBlockCount = 1, bool persistentlyMapped = false);
   DeviceMemoryAllocator(const DeviceMemoryAllocator&)            = delete;
   DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
   DeviceMemoryAllocator(DeviceMemoryAllocator&&)                 = delete;
@@ -81,40 +115,145 @@ public:
   DeviceMemoryBlock            allocate(Device* device, VkMemoryRequirements memoryRequirements);
   void                         deallocate(VkDevice device, const DeviceMemoryBlock& block);
 
-  // method that makes vkMapMemory() / std::memcpy() / vkUnmapMemory() behind a mutex - use it instead of performing is yourself
-  void                         copyToDeviceMemory(Device* device, VkDeviceSize offset, const void* data, VkDeviceSize size, VkMemoryMapFlags flags);
-  void                         bindBufferMemory(Device* device, VkBuffer buffer, VkDeviceSize offset);
+  // method that makes vkMapMemory() / std::memcpy() / vkUnmapMemory() behind a mutex - use it instead of performing is yourself.
+  // When allocator is persistently mapped - data is copied directly to block.mappedPointer without locking.
+  // Offset is measured from the beginning of the memory block
+  void                         copyToDeviceMemory(Device* device, const DeviceMemoryBlock& block, VkDeviceSize offset, const void* data, VkDeviceSize size, VkMemoryMapFlags flags);
+  // user that writes to block.mappedPointer by himself must call this method, so that non coherent memory may be flushed before next submission
+  void                         flushDeviceMemory(Device* device, const DeviceMemoryBlock& block, VkDeviceSize offset, VkDeviceSize size);
+  void                         bindBufferMemory(Device* device, VkBuffer buffer, const DeviceMemoryBlock& block);
+
+  void                         registerMemoryObject(MemoryObject* memoryObject);
+  void                         unregisterMemoryObject(MemoryObject* memoryObject);
+  // incremental defragmentation pass : chooses up to maxBytesToMove bytes of data that may be moved to lower addresses ( lower offset or earlier block of memory )
+  // and asks its owners to relocate it. Data is copied during next validation of each owner. Call it once per frame until it returns 0
+  VkDeviceSize                 defragment(Device* device, VkDeviceSize maxBytesToMove);
+  // allocates memory for data that is currently stored in a block, but places it lower in memory. Returns empty block when there's no such place
+  DeviceMemoryBlock            reallocate(Device* device, VkMemoryRequirements memoryRequirements, const DeviceMemoryBlock& block);
 
   inline VkMemoryPropertyFlags getMemoryPropertyFlags() const;
   inline VkDeviceSize          getMemorySize() const;
+  inline VkDeviceSize          getBlockSize() const;
+  inline uint32_t              getMaxBlockCount() const;
+  inline EnumStrategy          getStrategy() const;
+  inline bool                  isPersistentlyMapped() const;
+  // number of vkAllocateMemory() blocks currently held for a device
+  uint32_t                     getBlockCount(VkDevice device) const;
+  // free space statistics are computed on demand - cost is linear in number of free blocks
+  DeviceMemoryAllocatorStatistics getStatistics(VkDevice device) const;
+  // stores number of allocations made since last call as allocationsPerFrame and starts counting again
+  void                         finishFrame(VkDevice device);
+
+  static std::unique_ptr<AllocationStrategy> createAllocationStrategy(EnumStrategy strategy, VkDeviceSize size);
 
 protected:
+  struct StorageBlock
+  {
+    StorageBlock(VkDeviceMemory storageMemory, VkDeviceSize size, uint8_t* mappedPointer, std::unique_ptr<AllocationStrategy> allocationStrategy);
+
+    VkDeviceMemory                      storageMemory   = VK_NULL_HANDLE;
+    VkDeviceSize                        size            = 0;
+    uint8_t*                            mappedPointer   = nullptr;
+    uint32_t                            allocationCount = 0;
+    std::unique_ptr<AllocationStrategy> allocationStrategy;
+  };
   struct PerDeviceData
   {
     PerDeviceData()
     {
     }
-    VkDeviceMemory       storageMemory = VK_NULL_HANDLE;
-    std::list<FreeBlock> freeBlocks;
+    std::weak_ptr<Device>     device;
+    std::vector<StorageBlock> storageBlocks;
+    VkDeviceSize              usedBytes            = 0;
+    VkDeviceSize              peakUsedBytes        = 0;
+    uint32_t                  frameAllocations     = 0;
+    uint32_t                  lastFrameAllocations = 0;
   };
+
+  std::vector<StorageBlock>::iterator findStorageBlock(PerDeviceData& pdd, VkDeviceMemory memory);
+  void                                blockAllocated(PerDeviceData& pdd, StorageBlock& sb, DeviceMemoryBlock& block);
+  void                                removePendingFlushes(PerDeviceData& pdd, const StorageBlock& sb, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size);
+
   mutable std::mutex                          mutex;
   std::unordered_map<VkDevice, PerDeviceData> perDeviceData;
   VkMemoryPropertyFlags                       propertyFlags;
-  VkDeviceSize                                size;
-  std::unique_ptr<AllocationStrategy>         allocationStrategy;
+  VkDeviceSize                                blockSize;
+  uint32_t                                    maxBlockCount;
+  EnumStrategy                                strategy;
+  bool                                        persistentlyMapped;
+  // objects are guarded by a separate mutex, because they call allocator methods while holding their own locks
+  mutable std::mutex                          objectMutex;
+  std::vector<MemoryObject*>                  memoryObjects;
 };
 
-VkMemoryPropertyFlags DeviceMemoryAllocator::getMemoryPropertyFlags() const { return propertyFlags; }
-VkDeviceSize          DeviceMemoryAllocator::getMemorySize() const { return size; }
+VkMemoryPropertyFlags                       DeviceMemoryAllocator::getMemoryPropertyFlags() const { return propertyFlags; }
+VkDeviceSize                                DeviceMemoryAllocator::getMemorySize() const          { return blockSize; }
+VkDeviceSize                                DeviceMemoryAllocator::getBlockSize() const           { return blockSize; }
+uint32_t                                    DeviceMemoryAllocator::getMaxBlockCount() const       { return maxBlockCount; }
+DeviceMemoryAllocator::EnumStrategy         DeviceMemoryAllocator::getStrategy() const            { return strategy; }
+bool                                        DeviceMemoryAllocator::isPersistentlyMapped() const   { return persistentlyMapped; }
 
 class PUMEX_EXPORT FirstFitAllocationStrategy : public AllocationStrategy
 {
 public:
-  FirstFitAllocationStrategy();
+  explicit FirstFitAllocationStrategy(VkDeviceSize size);
   virtual ~FirstFitAllocationStrategy();
 
-  DeviceMemoryBlock allocate(VkDeviceMemory storageMemory, std::list<FreeBlock>& freeBlocks, VkMemoryRequirements memoryRequirements) override;
-  void              deallocate(std::list<FreeBlock>& freeBlocks, const DeviceMemoryBlock& block) override;
+  DeviceMemoryBlock allocate(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements) override;
+  DeviceMemoryBlock allocateBelow(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements, VkDeviceSize maxOffset) override;
+  void              deallocate(const DeviceMemoryBlock& block) override;
+  void              getFreeBlocks(std::vector<FreeBlock>& freeBlocks) const override;
+protected:
+  std::list<FreeBlock> freeBlocks;
+};
+
+// Two level segregated fit allocator ( M. Masmano, I. Ripoll, A. Crespo, J. Real : "TLSF: a new dynamic memory allocator for real-time systems" ).
+// Free blocks are stored in segregated lists indexed by two levels : first level is a power of two of block size, second level divides that
+// range linearly into TLSF_SL_COUNT lists. Both levels have bitmaps of non empty lists, so the search for suitable block takes constant time.
+// Blocks are kept in a pool and linked to their physical neighbours, so coalescing during deallocation also takes constant time.
+// allocateBelow() and getFreeBlocks() are linear in number of blocks - they're used only by defragmentation and statistics
+class PUMEX_EXPORT TLSFAllocationStrategy : public AllocationStrategy
+{
+public:
+  explicit TLSFAllocationStrategy(VkDeviceSize size);
+  virtual ~TLSFAllocationStrategy();
+
+  DeviceMemoryBlock allocate(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements) override;
+  DeviceMemoryBlock allocateBelow(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements, VkDeviceSize maxOffset) override;
+  void              deallocate(const DeviceMemoryBlock& block) override;
+  void              getFreeBlocks(std::vector<FreeBlock>& freeBlocks) const override;
+
+  static const uint32_t TLSF_SL_COUNT_LOG2 = 5;
+  static const uint32_t TLSF_SL_COUNT      = 1 << TLSF_SL_COUNT_LOG2;
+  static const uint32_t TLSF_FL_COUNT      = 64 - TLSF_SL_COUNT_LOG2 + 1;
+  static const uint32_t TLSF_INVALID_INDEX = 0xFFFFFFFF;
+protected:
+  struct Block
+  {
+    VkDeviceSize offset       = 0;
+    VkDeviceSize size         = 0;
+    uint32_t     prevPhysical = TLSF_INVALID_INDEX;
+    uint32_t     nextPhysical = TLSF_INVALID_INDEX;
+    uint32_t     prevFree     = TLSF_INVALID_INDEX;
+    uint32_t     nextFree     = TLSF_INVALID_INDEX;
+    bool         free         = false;
+  };
+
+  DeviceMemoryBlock useFreeBlock(uint32_t blockIndex, VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements);
+  uint32_t          createBlock(VkDeviceSize offset, VkDeviceSize size);
+  void              releaseBlock(uint32_t blockIndex);
+  void              insertFreeBlock(uint32_t blockIndex);
+  void              removeFreeBlock(uint32_t blockIndex);
+  uint32_t          findFreeBlock(VkDeviceSize size) const;
+  void              splitBlock(uint32_t blockIndex, VkDeviceSize size);
+  void              mergeWithNext(uint32_t blockIndex);
+
+  std::vector<Block>                         blocks;
+  std::vector<uint32_t>                      unusedBlocks;
+  std::unordered_map<VkDeviceSize, uint32_t> usedBlocks;
+  uint64_t                                   flBitmap = 0;
+  uint32_t                                   slBitmap[TLSF_FL_COUNT];
+  uint32_t                                   freeLists[TLSF_FL_COUNT][TLSF_SL_COUNT];
 };
 
 // OK, last time I read a book about C++ templates about seven years ago, so this code may look ugly in 2017
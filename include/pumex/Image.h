@@ -61,20 +61,29 @@ public:
   explicit Image(Device* device, const ImageTraits& imageTraits, std::shared_ptr<DeviceMemoryAllocator> allocator);
   // user delivers VkImage, Image does not own it, just creates VkImageView
   explicit Image(Device* device, VkImage image, VkFormat format, const VkExtent3D& extent, uint32_t mipLevels = 1, uint32_t arrayLayers = 1);
+  // Image takes ownership of VkImage and of memory allocated for it
+  explicit Image(Device* device, const ImageTraits& imageTraits, std::shared_ptr<DeviceMemoryAllocator> allocator, VkImage image, const DeviceMemoryBlock& memoryBlock);
+  // Image creates VkImage and binds it to memory owned by someone else ( memory shared by images that are never used at the same time )
+  explicit Image(Device* device, const ImageTraits& imageTraits, const DeviceMemoryBlock& memoryBlock);
   Image(const Image&)                = delete;
   Image& operator=(const Image&)     = delete;
   Image(Image&&)                     = delete;
   Image& operator=(Image&&)          = delete;
   virtual ~Image();
 
-  inline VkDevice           getDevice() const;
-  inline VkImage            getHandleImage() const;
-  inline VkDeviceSize       getMemorySize() const;
-  inline const ImageTraits& getImageTraits() const;
+  inline VkDevice                 getDevice() const;
+  inline VkImage                  getHandleImage() const;
+  inline VkDeviceSize             getMemorySize() const;
+  inline const ImageTraits&       getImageTraits() const;
+  inline const DeviceMemoryBlock& getMemoryBlock() const;
 
-  void                      getImageSubresourceLayout(VkImageSubresource& subRes, VkSubresourceLayout& subResLayout) const;
-  void*                     mapMemory(size_t offset, size_t range, VkMemoryMapFlags flags=0);
-  void                      unmapMemory();
+  void                            getImageSubresourceLayout(VkImageSubresource& subRes, VkSubresourceLayout& subResLayout) const;
+  void*                           mapMemory(size_t offset, size_t range, VkMemoryMapFlags flags=0);
+  void                            unmapMemory();
+
+  // creates new image with the same traits, placed lower in allocator's memory ( image content is not copied ).
+  // Returns nullptr when there's no such place
+  std::shared_ptr<Image>          relocate(Device* device) const;
 protected:
   ImageTraits                            imageTraits;
   VkDevice                               device       = VK_NULL_HANDLE;
@@ -85,13 +94,16 @@ protected:
 };
 
 // inlines
-VkDevice             Image::getDevice() const      { return device; }
-VkImage              Image::getHandleImage() const { return image; }
-VkDeviceSize         Image::getMemorySize() const  { return memoryBlock.alignedSize; }
-const ImageTraits&   Image::getImageTraits() const { return imageTraits; }
+VkDevice                 Image::getDevice() const      { return device; }
+VkImage                  Image::getHandleImage() const { return image; }
+VkDeviceSize             Image::getMemorySize() const  { return memoryBlock.alignedSize; }
+const ImageTraits&       Image::getImageTraits() const { return imageTraits; }
+const DeviceMemoryBlock& Image::getMemoryBlock() const { return memoryBlock; }
 
 // helper functions
-PUMEX_EXPORT ImageTraits        getImageTraitsFromTexture(const gli::texture& texture, VkImageUsageFlags usage);
+PUMEX_EXPORT ImageTraits          getImageTraitsFromTexture(const gli::texture& texture, VkImageUsageFlags usage);
+PUMEX_EXPORT VkMemoryRequirements getImageMemoryRequirements(VkDevice device, const ImageTraits& imageTraits);
+PUMEX_EXPORT uint32_t             getMipLevelCount(const VkExtent3D& extent);
 
 PUMEX_EXPORT VkFormat           vulkanFormatFromGliFormat(gli::texture::format_type format);
 PUMEX_EXPORT VkImageViewType    vulkanViewTypeFromGliTarget(gli::texture::target_type target);
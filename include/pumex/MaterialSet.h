@@ -25,6 +25,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <tuple>
 #include <vulkan/vulkan.h>
 #include <gli/load.hpp>
 #include <pumex/Export.h>
@@ -40,6 +41,11 @@ class  Sampler;
 class  MemoryImage;
 class  CombinedImageSampler;
 class  DeviceMemoryAllocator;
+class  TextureStreamer;
+class  TextureFile;
+class  TextureLoader;
+class  DescriptorSet;
+struct DescriptorSetLayoutBinding;
 class  Viewer;
 class  RenderContext;
 template <typename T> class Buffer;
@@ -81,6 +87,14 @@ public:
   virtual ~TextureRegistryBase();
 
   virtual void setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) = 0;
+  // sets many textures in one slot at once ( map key is a layer index ). By default calls setTexture() for each texture
+  virtual void setTextures(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<gli::texture>>& textures);
+
+  // Registries that create separate MemoryImage for each texture may send texture data straight from memory mapped files ( see TextureFile ).
+  // MaterialSet uses setTextureFiles() for files that need no conversion when supportsTextureFiles() returns true. By default texture file is loaded by gli and sent through setTexture()
+  virtual bool supportsTextureFiles() const;
+  virtual void setTextureFile(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<TextureFile> textureFile);
+  virtual void setTextureFiles(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<TextureFile>>& textureFiles);
 };
 
 // abstract virtual class that is used to deal with the materials
@@ -95,6 +109,18 @@ public:
   virtual void                  buildTypesAndVariants(std::vector<MaterialTypeDefinition>& typeDefinitions, std::vector<MaterialVariantDefinition>& variantDefinitions) = 0;
 };
 
+// time spent by MaterialSet on loading textures. Values are accumulated over all calls to MaterialSet::endRegisterMaterials()
+// Direct files ( see TextureFile::isDirect() ) are only mapped and their headers are parsed. Their data is copied from the mapping to staging memory
+// when textures are validated ( or when TextureStreamer makes their mip levels resident ), so that copy is counted neither in decodeTime nor in uploadTime
+struct TextureLoadStatistics
+{
+  uint32_t fileCount       = 0;   // number of decoded files ( each file is decoded once, even if it is used by many materials )
+  uint32_t directFileCount = 0;   // number of files from fileCount that were mapped instead of decoded
+  uint32_t layerCount      = 0;   // number of textures sent to texture registry
+  double   decodeTime      = 0.0; // time in seconds spent on decoding files ( and on parsing headers of direct files )
+  double   uploadTime      = 0.0; // time in seconds spent in texture registry ( copying data to textures and scheduling GPU transfers that will be performed during first validation )
+};
+
 // MaterialSet is the class that stores information about asset materials in a single place both in CPU and in GPU.
 // Material is a template T - you can use whatever structure you want, as long as the struct T :
 //   - is std430 compatible ( because it will be sent to GPU )
@@ -102,6 +128,7 @@ public:
 //      void registerProperties(const Material& material)
 //      void registerTextures(const std::map<TextureSemantic::Type, uint32_t>& textureIndices)
 // Check out different MaterialData implementations in examples ( crowd, gpucull and deferred ).
+// Textures used by registered materials are decoded in parallel during endRegisterMaterials() call.
 class PUMEX_EXPORT MaterialSet
 {
 public:
@@ -116,6 +143,10 @@ public:
   bool                                         getTargetTextureNames(uint32_t index, std::vector<std::string>& texNames) const;
   bool                                         setTargetTextureLayer(uint32_t index, uint32_t layer, const std::string& fileName, std::shared_ptr<gli::texture> tex);
 
+  // By default textures are decoded by TextureLoaderGli, and files that need no conversion are only mapped when texture registry supports texture files.
+  // Other loader ( e.g. TextureLoaderCompressed ) decodes all files. Files are decoded in parallel, so loader must be reentrant
+  void                                         setTextureLoader(std::shared_ptr<TextureLoader> textureLoader);
+
   void                                         registerMaterials(uint32_t typeID, std::shared_ptr<Asset> asset);
   void                                         registerMaterialVariant(uint32_t typeID, uint32_t materialVariant, const std::vector<Material>& materials);
   void                                         endRegisterMaterials();
@@ -123,18 +154,25 @@ public:
   std::vector<Material>                        getMaterials(uint32_t typeID) const;
   uint32_t                                     getMaterialVariantCount(uint32_t typeID) const;
 
+  inline const TextureLoadStatistics&          getTextureLoadStatistics() const;
+
   std::shared_ptr<Buffer<std::vector<MaterialTypeDefinition>>>    typeDefinitionBuffer;
   std::shared_ptr<Buffer<std::vector<MaterialVariantDefinition>>> materialVariantBuffer;
 
 private:
 
   std::map<TextureSemantic::Type, uint32_t>    registerTextures(const Material& mat);
+  void                                         loadPendingTextures();
 
   std::weak_ptr<Viewer>                        viewer;
   std::shared_ptr<MaterialRegistryBase>        materialRegistry;
   std::shared_ptr<TextureRegistryBase>         textureRegistry;
+  std::shared_ptr<TextureLoader>               textureLoader;
   std::vector<TextureSemantic>                 semantics;
   std::map<uint32_t, std::vector<std::string>> textureNames;
+  // textures registered but not loaded yet : slot index, layer index, full file name
+  std::vector<std::tuple<uint32_t, uint32_t, std::string>> pendingTextures;
+  TextureLoadStatistics                        textureLoadStatistics;
 };
 
 // material registry that is able to store any material in a form of T class
@@ -177,6 +215,7 @@ public:
   std::shared_ptr<Resource>                     getResource(uint32_t slotIndex);
 
   void                                          setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) override;
+  void                                          setTextures(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<gli::texture>>& textures) override;
 
   std::map<uint32_t, std::shared_ptr<MemoryImage>>  memoryImages;
   std::map<uint32_t, std::shared_ptr<Resource>>     resources;
@@ -191,17 +230,69 @@ public:
   void                                    setSampledImage(uint32_t slotIndex);
   void                                    setStorageImage(uint32_t slotIndex);
   std::vector<std::shared_ptr<Resource>>& getResources(uint32_t slotIndex);
+  const std::vector<std::shared_ptr<MemoryImage>>& getMemoryImages(uint32_t slotIndex);
+
+  // textures set after this call are streamed by textureStreamer
+  void                                    setTextureStreamer(std::shared_ptr<TextureStreamer> textureStreamer);
 
   void                                    setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) override;
+  // streamed textures must be created from gli::texture, so texture files are not used after call to setTextureStreamer()
+  bool                                    supportsTextureFiles() const override;
+  void                                    setTextureFile(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<TextureFile> textureFile) override;
 
 protected:
+  void                                    setMemoryImage(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<MemoryImage> memoryImage);
+
   std::shared_ptr<DeviceMemoryAllocator>                         textureAllocator;
+  std::shared_ptr<TextureStreamer>                               textureStreamer;
   std::map<uint32_t, std::vector<std::shared_ptr<MemoryImage>>>  memoryImages;
   std::map<uint32_t, uint32_t>                                   textureTypes;
   std::map<uint32_t, std::shared_ptr<Sampler>>                   textureSamplers;
   std::map<uint32_t, std::vector<std::shared_ptr<Resource>>>     resources;
 };
 
+// Texture registry that uses VK_EXT_descriptor_indexing : each slot is a single descriptor array declared as partially bound and updated after bind.
+// Materials reference textures by their index in a slot and that index never changes. Textures added later ( e.g. by next call to
+// MaterialSet::endRegisterMaterials() ) are written to the same descriptor sets, and command buffers that use them are not rebuilt.
+// Textures in a slot may have different sizes and formats. Device must be created with VK_EXT_descriptor_indexing extension.
+// Shaders should declare each slot as an array of maxTextureCount elements and use nonuniformEXT() when texture index is not uniform
+class PUMEX_EXPORT TextureRegistryBindless : public TextureRegistryBase
+{
+public:
+  TextureRegistryBindless(std::shared_ptr<DeviceMemoryAllocator> textureAlloc, uint32_t maxTextureCount = 4096);
+  void                                    setCombinedImageSampler(uint32_t slotIndex, std::shared_ptr<Sampler> sampler);
+  void                                    setSampledImage(uint32_t slotIndex);
+  // binding that should be used in descriptor set layout for a slot
+  DescriptorSetLayoutBinding              getLayoutBinding(uint32_t slotIndex, uint32_t binding, VkShaderStageFlags stageFlags) const;
+  // all textures of a slot ( also the ones added later ) are written to a binding of a descriptor set. Descriptor set is rewritten as a whole,
+  // so it should contain only bindings from getLayoutBinding() - otherwise each texture change rebuilds command buffers that use it
+  void                                    addDescriptorSet(uint32_t slotIndex, std::shared_ptr<DescriptorSet> descriptorSet, uint32_t binding);
+  const std::vector<std::shared_ptr<Resource>>&    getResources(uint32_t slotIndex);
+  const std::vector<std::shared_ptr<MemoryImage>>& getMemoryImages(uint32_t slotIndex);
+  inline uint32_t                         getMaxTextureCount() const;
+
+  // textures set after this call are streamed by textureStreamer
+  void                                    setTextureStreamer(std::shared_ptr<TextureStreamer> textureStreamer);
+
+  void                                    setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) override;
+  void                                    setTextures(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<gli::texture>>& textures) override;
+  bool                                    supportsTextureFiles() const override;
+  void                                    setTextureFile(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<TextureFile> textureFile) override;
+  void                                    setTextureFiles(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<TextureFile>>& textureFiles) override;
+protected:
+  void                                    createTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<MemoryImage> memoryImage);
+  void                                    updateDescriptorSets(uint32_t slotIndex);
+
+  std::shared_ptr<DeviceMemoryAllocator>                         textureAllocator;
+  std::shared_ptr<TextureStreamer>                               textureStreamer;
+  uint32_t                                                       maxTextureCount;
+  std::map<uint32_t, std::vector<std::shared_ptr<MemoryImage>>>  memoryImages;
+  std::map<uint32_t, uint32_t>                                   textureTypes;
+  std::map<uint32_t, std::shared_ptr<Sampler>>                   textureSamplers;
+  std::map<uint32_t, std::vector<std::shared_ptr<Resource>>>     resources;
+  std::multimap<uint32_t, std::pair<std::weak_ptr<DescriptorSet>, uint32_t>> descriptorSets;
+};
+
 class TextureRegistryNull : public TextureRegistryBase
 {
 public:
@@ -210,6 +301,9 @@ public:
   }
 };
 
+const TextureLoadStatistics& MaterialSet::getTextureLoadStatistics() const { return textureLoadStatistics; }
+uint32_t                     TextureRegistryBindless::getMaxTextureCount() const { return maxTextureCount; }
+
 template <typename T>
 MaterialRegistry<T>::MaterialRegistry(std::shared_ptr<DeviceMemoryAllocator> allocator)
 {
@@ -73,6 +73,9 @@ public:
 
   MemoryBuffer*                                 asMemoryBuffer() override;
 
+  void                                          getRelocatableMemoryBlocks(VkDevice device, std::vector<DeviceMemoryBlock>& blocks) const override;
+  void                                          relocateMemoryBlocks(VkDevice device, const std::vector<DeviceMemoryBlock>& blocks) override;
+
   inline const PerObjectBehaviour&              getPerObjectBehaviour() const;
   inline const SwapChainImageBehaviour&         getSwapChainImageBehaviour() const;
   inline std::shared_ptr<DeviceMemoryAllocator> getAllocator() const;
@@ -105,7 +108,7 @@ public:
   };
   struct Operation
   {
-    enum Type { SetBufferSize, SetData };
+    enum Type { SetBufferSize, SetData, Relocate };
     Operation(MemoryBuffer* o, Type t, const BufferSubresourceRange& r, uint32_t ac)
       : owner{ o }, type{ t }, bufferRange{ r }
     {
@@ -253,7 +256,7 @@ struct SetDataOperation : public MemoryBuffer::Operation
 
   std::shared_ptr<T>                          data;
   BufferSubresourceRange                      sourceRange;
-  std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
+  std::vector<StagingRegion> stagingRegions;
 };
 
 const PerObjectBehaviour&              MemoryBuffer::getPerObjectBehaviour() const      { return perObjectBehaviour; }
@@ -440,7 +443,7 @@ bool SetBufferSizeOperation<T>::perform(const RenderContext& renderContext, Memo
   internals.dataSize    = bufferCreateInfo.size;
   internals.memoryBlock = ownerAllocator->allocate(renderContext.device, memReqs);
   CHECK_LOG_THROW(internals.memoryBlock.alignedSize == 0, "Cannot create a bufer");
-  ownerAllocator->bindBufferMemory(renderContext.device, internals.buffer, internals.memoryBlock.alignedOffset);
+  ownerAllocator->bindBufferMemory(renderContext.device, internals.buffer, internals.memoryBlock);
 
   owner->notifyCommandBufferSources(renderContext);
   owner->notifyBufferViews(renderContext, bufferRange);
@@ -480,7 +483,7 @@ bool SetDataOperation<T>::perform(const RenderContext& renderContext, MemoryBuff
     internals.dataSize    = bufferCreateInfo.size;
     internals.memoryBlock = ownerAllocator->allocate(renderContext.device, memReqs);
     CHECK_LOG_THROW(internals.memoryBlock.alignedSize == 0, "Cannot create a buffer");
-    ownerAllocator->bindBufferMemory(renderContext.device, internals.buffer, internals.memoryBlock.alignedOffset);
+    ownerAllocator->bindBufferMemory(renderContext.device, internals.buffer, internals.memoryBlock);
 
     owner->notifyCommandBufferSources(renderContext);
     owner->notifyBufferViews(renderContext, bufferRange);
@@ -491,15 +494,16 @@ bool SetDataOperation<T>::perform(const RenderContext& renderContext, MemoryBuff
   {
     if (memoryIsLocal)
     {
-      std::shared_ptr<StagingBuffer> stagingBuffer = renderContext.device->acquireStagingBuffer(uglyGetPointer(*data), uglyGetSize(*data));
+      StagingRegion stagingRegion = renderContext.device->acquireStagingRegion(uglyGetPointer(*data), uglyGetSize(*data));
       VkBufferCopy copyRegion{};
-      copyRegion.size = uglyGetSize(*data);
-      commandBuffer->cmdCopyBuffer(stagingBuffer->buffer, internals.buffer, copyRegion);
-      stagingBuffers.push_back(stagingBuffer);
+      copyRegion.srcOffset = stagingRegion.offset;
+      copyRegion.size      = uglyGetSize(*data);
+      commandBuffer->cmdCopyBuffer(stagingRegion.buffer, internals.buffer, copyRegion);
+      stagingRegions.push_back(stagingRegion);
     }
     else
     {
-      ownerAllocator->copyToDeviceMemory(renderContext.device, internals.memoryBlock.alignedOffset, uglyGetPointer(*data), uglyGetSize(*data), 0);
+      ownerAllocator->copyToDeviceMemory(renderContext.device, internals.memoryBlock, 0, uglyGetPointer(*data), uglyGetSize(*data), 0);
     }
   }
 
@@ -510,9 +514,9 @@ bool SetDataOperation<T>::perform(const RenderContext& renderContext, MemoryBuff
 template<typename T>
 void SetDataOperation<T>::releaseResources(const RenderContext& renderContext)
 {
-  for (auto& s : stagingBuffers)
-    renderContext.device->releaseStagingBuffer(s);
-  stagingBuffers.clear();
+  for (auto& s : stagingRegions)
+    renderContext.device->releaseStagingRegion(s);
+  stagingRegions.clear();
 }
 
 }
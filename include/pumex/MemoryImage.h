@@ -22,6 +22,7 @@
 
 #pragma once
 #include <unordered_map>
+#include <map>
 #include <memory>
 #include <list>
 #include <mutex>
@@ -39,6 +40,8 @@ class RenderContext;
 class CommandBuffer;
 class CommandBufferSource;
 class ImageView;
+class MemoryAliasGroup;
+class TextureFile;
 
 // struct defining subresource range for image
 struct PUMEX_EXPORT ImageSubresourceRange
@@ -57,14 +60,18 @@ struct PUMEX_EXPORT ImageSubresourceRange
 };
 
 // MemoryImage class stores Vulkan images per sufrace or per device ( according to user's needs )
-// Class uses gli::texture to store texture data on CPU
+// Class uses gli::texture to store texture data on CPU, or sends texture data straight from memory mapped TextureFile
 // MemoryImage may contain 1D, 2D and 3D textures, texture arrays, texture cubes, arrays of texture cubes etc, but cubes were not tested in real life ( be aware )
 class PUMEX_EXPORT MemoryImage : public MemoryObject
 {
 public:
   MemoryImage()                              = delete;
   explicit MemoryImage(const ImageTraits& imageTraits, std::shared_ptr<DeviceMemoryAllocator> allocator, VkImageAspectFlags aspectMask, PerObjectBehaviour perObjectBehaviour = pbPerDevice, SwapChainImageBehaviour swapChainImageBehaviour = swForEachImage, bool sameTraitsPerObject = true, bool useSetImageMethods = true);
-  explicit MemoryImage(std::shared_ptr<gli::texture> texture, std::shared_ptr<DeviceMemoryAllocator> allocator, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT, PerObjectBehaviour perObjectBehaviour = pbPerDevice);
+  // when generateMipmaps is set and texture has only one mip level - full mip chain is created on GPU after each upload ( only for uncompressed formats )
+  explicit MemoryImage(std::shared_ptr<gli::texture> texture, std::shared_ptr<DeviceMemoryAllocator> allocator, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT, PerObjectBehaviour perObjectBehaviour = pbPerDevice, bool generateMipmaps = false);
+  // texture data is copied straight from memory mapped file to staging memory during each upload, so no gli::texture is kept on CPU side.
+  // Texture file must be readable directly ( TextureFile::isDirect() ) and stays mapped as long as MemoryImage exists
+  explicit MemoryImage(std::shared_ptr<TextureFile> textureFile, std::shared_ptr<DeviceMemoryAllocator> allocator, VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT, PerObjectBehaviour perObjectBehaviour = pbPerDevice, bool generateMipmaps = false);
   MemoryImage(const MemoryImage&)            = delete;
   MemoryImage& operator=(const MemoryImage&) = delete;
   MemoryImage(MemoryImage&&)                 = delete;
@@ -73,6 +80,9 @@ public:
 
   MemoryImage*                                  asMemoryImage() override;
 
+  void                                          getRelocatableMemoryBlocks(VkDevice device, std::vector<DeviceMemoryBlock>& blocks) const override;
+  void                                          relocateMemoryBlocks(VkDevice device, const std::vector<DeviceMemoryBlock>& blocks) override;
+
   void                                          setImageTraits(const ImageTraits& traits);
   void                                          setImageTraits(Surface* surface, const ImageTraits& traits);
   void                                          setImageTraits(Device* device, const ImageTraits& traits);
@@ -81,6 +91,14 @@ public:
   void                                          setImage(Surface* surface, std::shared_ptr<gli::texture> tex);
   void                                          setImage(Device* device, std::shared_ptr<gli::texture> tex);
   void                                          setImageLayer(uint32_t layer, std::shared_ptr<gli::texture> tex);
+  // sets many layers at once. Whole texture is sent to GPU using single staging region instead of one staging region per layer
+  void                                          setImageLayers(const std::map<uint32_t, std::shared_ptr<gli::texture>>& layers);
+
+  // MemoryImage created from gli::texture or TextureFile may keep only part of its mip levels on GPU ( from mip level "level" to the smallest one ).
+  // Changing resident mip level recreates the image during next validation : levels that were resident before are copied from previous image
+  // and only missing levels are sent from CPU ( TextureFile levels are read from the mapping, so they are loaded from disk on demand ). Used by TextureStreamer
+  void                                          setResidentMipLevel(uint32_t level);
+  inline uint32_t                               getResidentMipLevel() const;
   // use outside created images ( method created to catch swapchain images )
   void                                          setImages(Surface* surface, std::vector<std::shared_ptr<Image>>& images);
   void                                          setImages(Device* device, std::vector<std::shared_ptr<Image>>& images);
@@ -96,6 +114,13 @@ public:
   inline const SwapChainImageBehaviour&         getSwapChainImageBehaviour() const;
   inline std::shared_ptr<DeviceMemoryAllocator> getAllocator() const;
   inline std::shared_ptr<gli::texture>          getTexture() const;
+  inline std::shared_ptr<TextureFile>           getTextureFile() const;
+  inline bool                                   getSameTraitsPerObject() const;
+
+  // images from the same memory alias group share device memory, so they cannot be used at the same time.
+  // MemoryImage using the same traits per each object may change its group at any time - its images are created again during next validation
+  void                                          setMemoryAliasGroup(std::shared_ptr<MemoryAliasGroup> memoryAliasGroup);
+  inline std::shared_ptr<MemoryAliasGroup>      getMemoryAliasGroup() const;
 
   void                                          validate(const RenderContext& renderContext);
 
@@ -110,12 +135,15 @@ public:
 
   struct MemoryImageInternal
   {
-    std::shared_ptr<Image> image;
+    std::shared_ptr<Image>                                           image;
+    uint32_t                                                         residentMipLevel = 0;
+    // replaced images may still be used by frames being rendered, so they are released after these frames are finished ( pair.first is a frame number )
+    std::list<std::pair<unsigned long long, std::shared_ptr<Image>>> releasedImages;
   };
   // struct that defines all operations that may be performed on that Texture ( set new image traits, clear it, set new data )
   struct Operation
   {
-    enum Type { SetImageTraits, SetImage, NotifyImageViews, ClearImage };
+    enum Type { SetImageTraits, SetImage, NotifyImageViews, ClearImage, Relocate, GenerateMipmaps };
     Operation(MemoryImage* o, Type t, const ImageSubresourceRange& r, uint32_t ac)
       : owner{ o }, type{ t }, imageRange{ r }
     {
@@ -150,6 +178,8 @@ protected:
   struct MemoryImageLoadData
   {
     std::list<std::shared_ptr<Operation>> imageOperations;
+    // false when some texture data was not sent to current image before resident mip level has changed - such image cannot be a source of resident levels
+    bool                                  residentLevelsValid = true;
   };
   typedef PerObjectData<MemoryImageInternal, MemoryImageLoadData> MemoryImageData;
 
@@ -160,7 +190,12 @@ protected:
   bool                                            sameTraitsPerObject;
   ImageTraits                                     imageTraits;
   std::shared_ptr<gli::texture>                   texture;
+  std::shared_ptr<TextureFile>                    textureFile;
+  bool                                            generateMipmaps  = false;
+  // mip levels of a texture that are resident on GPU ( when residentMipLevel > 0 )
+  uint32_t                                        residentMipLevel = 0;
   std::shared_ptr<DeviceMemoryAllocator>          allocator;
+  std::shared_ptr<MemoryAliasGroup>               memoryAliasGroup;
   VkImageAspectFlags                              aspectMask;
   uint32_t                                        activeCount;
   // objects that may own a texture and must be informed when some changes happen
@@ -170,7 +205,50 @@ protected:
   void internalSetImageTraits(uint32_t key, VkDevice device, VkSurfaceKHR surface, const ImageTraits& traits, VkImageAspectFlags aMask);
   void internalSetImage(uint32_t key, VkDevice device, VkSurfaceKHR surface, std::shared_ptr<gli::texture> texture);
   void internalSetImages(uint32_t key, VkDevice device, VkSurfaceKHR surface, std::vector<std::shared_ptr<Image>>& images);
+  void internalSetTexture(MemoryImageData& data, uint32_t baseLevel, uint32_t levelCount);
+  void internalSetTextureFile(MemoryImageData& data, uint32_t baseLevel, uint32_t levelCount);
   void internalClearImage(uint32_t key, VkDevice device, VkSurfaceKHR surface, const glm::vec4& clearValue, const ImageSubresourceRange& range);
+  void checkImageLayer(uint32_t layer, std::shared_ptr<gli::texture> tex) const;
+  uint32_t getTextureLevels() const;
+  void internalGenerateMipmaps(MemoryImageData& data);
+};
+
+// Images that are never used at the same time ( e.g. render workflow attachments with disjoint lifetimes ) may share the same device memory.
+// MemoryAliasGroup allocates one memory block per surface/device, big enough to hold each of its members, and binds member images to it.
+// Block is reallocated when it is too small for new member traits, so all members must receive their new traits together ( e.g. after surface resize ).
+// Memory requirements of each member are queried once per traits change and cached
+class PUMEX_EXPORT MemoryAliasGroup
+{
+public:
+  MemoryAliasGroup()                                   = delete;
+  explicit MemoryAliasGroup(std::shared_ptr<DeviceMemoryAllocator> allocator);
+  MemoryAliasGroup(const MemoryAliasGroup&)            = delete;
+  MemoryAliasGroup& operator=(const MemoryAliasGroup&) = delete;
+  MemoryAliasGroup(MemoryAliasGroup&&)                 = delete;
+  MemoryAliasGroup& operator=(MemoryAliasGroup&&)      = delete;
+  virtual ~MemoryAliasGroup();
+
+  void                   setImageTraits(uint32_t key, MemoryImage* memoryImage, const ImageTraits& traits);
+  // traits of a member that uses the same traits for each surface/device
+  void                   setImageTraits(MemoryImage* memoryImage, const ImageTraits& traits);
+  void                   removeMemoryImage(MemoryImage* memoryImage);
+  std::shared_ptr<Image> createImage(uint32_t key, Device* device, const ImageTraits& traits);
+
+  inline std::shared_ptr<DeviceMemoryAllocator> getAllocator() const;
+protected:
+  struct AliasData
+  {
+    VkDevice                                               device      = VK_NULL_HANDLE;
+    DeviceMemoryBlock                                      memoryBlock;
+    VkMemoryRequirements                                   memoryRequirements{};
+    std::unordered_map<MemoryImage*, ImageTraits>          memberTraits;
+    std::unordered_map<MemoryImage*, VkMemoryRequirements> memberRequirements;
+    bool                                                   valid       = false;
+  };
+  mutable std::mutex                            mutex;
+  std::shared_ptr<DeviceMemoryAllocator>        allocator;
+  std::unordered_map<uint32_t, AliasData>       aliasData;
+  std::unordered_map<MemoryImage*, ImageTraits> commonTraits;
 };
 
 class PUMEX_EXPORT ImageView : public std::enable_shared_from_this<ImageView>
@@ -223,5 +301,10 @@ const PerObjectBehaviour&              MemoryImage::getPerObjectBehaviour() cons
 const SwapChainImageBehaviour&         MemoryImage::getSwapChainImageBehaviour() const { return swapChainImageBehaviour; }
 std::shared_ptr<DeviceMemoryAllocator> MemoryImage::getAllocator() const               { return allocator; }
 std::shared_ptr<gli::texture>          MemoryImage::getTexture() const                 { return texture; }
+std::shared_ptr<TextureFile>           MemoryImage::getTextureFile() const             { return textureFile; }
+bool                                   MemoryImage::getSameTraitsPerObject() const     { return sameTraitsPerObject; }
+uint32_t                               MemoryImage::getResidentMipLevel() const        { return residentMipLevel; }
+std::shared_ptr<MemoryAliasGroup>      MemoryImage::getMemoryAliasGroup() const        { return memoryAliasGroup; }
+std::shared_ptr<DeviceMemoryAllocator> MemoryAliasGroup::getAllocator() const          { return allocator; }
 
 }
@@ -21,7 +21,10 @@
 //
 
 #pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
 #include <pumex/Export.h>
+#include <pumex/DeviceMemoryAllocator.h>
 
 namespace pumex
 {
@@ -46,6 +49,11 @@ public:
   inline Type           getType();
   virtual MemoryImage*  asMemoryImage();
   virtual MemoryBuffer* asMemoryBuffer();
+
+  // defragmentation support ( see DeviceMemoryAllocator::defragment() ) : object reports memory blocks that it is able to move to other place in memory
+  virtual void          getRelocatableMemoryBlocks(VkDevice device, std::vector<DeviceMemoryBlock>& blocks) const;
+  // chosen blocks are moved during next validation of an object
+  virtual void          relocateMemoryBlocks(VkDevice device, const std::vector<DeviceMemoryBlock>& blocks);
 protected:
   Type type;
 };
@@ -36,6 +36,10 @@ namespace pumex
 class PUMEX_EXPORT MemoryObjectBarrier
 {
 public:
+  // Barrier between two queues of a workflow is a part of queue family ownership transfer. Workflow compiler does not know
+  // queue families, so it stores workflow queue indices instead. Family indices are resolved when command buffer is built
+  enum OwnershipTransfer { otNone, otRelease, otAcquire };
+
   MemoryObjectBarrier();
   MemoryObjectBarrier(VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex, std::shared_ptr<MemoryObject> memoryObject, VkImageLayout oldLayout, VkImageLayout newLayout, const ImageSubresourceRange& imageRange);
   MemoryObjectBarrier(VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex, std::shared_ptr<MemoryObject> memoryObject, const BufferSubresourceRange& bufferRange);
@@ -43,6 +47,8 @@ public:
   MemoryObjectBarrier& operator=(const MemoryObjectBarrier&);
   ~MemoryObjectBarrier();
 
+  void                          setOwnershipTransfer(OwnershipTransfer transfer, uint32_t srcQueueIndex, uint32_t dstQueueIndex);
+
   MemoryObject::Type            objectType;
   VkAccessFlags                 srcAccessMask;
   VkAccessFlags                 dstAccessMask;
@@ -54,6 +60,10 @@ public:
   VkImageLayout                 newLayout;   // used by images
   ImageSubresourceRange         imageRange;  // used by images
   BufferSubresourceRange        bufferRange; // used by buffers
+
+  OwnershipTransfer             ownershipTransfer = otNone;
+  uint32_t                      srcQueueIndex     = 0;
+  uint32_t                      dstQueueIndex     = 0;
 };
 
 struct PUMEX_EXPORT MemoryObjectBarrierGroup
@@ -50,21 +50,25 @@ public:
   bool                  deviceExtensionImplemented(const char* extensionName) const;
 
   // physical device
-  VkPhysicalDevice                       physicalDevice        = VK_NULL_HANDLE;
+  VkPhysicalDevice                                 physicalDevice        = VK_NULL_HANDLE;
 
-  VkPhysicalDeviceProperties             properties;
-  VkPhysicalDeviceMultiviewPropertiesKHR multiViewProperties;
+  VkPhysicalDeviceProperties                       properties;
+  VkPhysicalDeviceMultiviewPropertiesKHR           multiViewProperties;
+  // only when VK_EXT_descriptor_indexing extension is present
+  VkPhysicalDeviceDescriptorIndexingPropertiesEXT  descriptorIndexingProperties;
 
-  VkPhysicalDeviceFeatures               features;
-  VkPhysicalDeviceMultiviewFeaturesKHR   multiViewFeatures;
+  VkPhysicalDeviceFeatures                         features;
+  VkPhysicalDeviceMultiviewFeaturesKHR             multiViewFeatures;
+  // only when VK_EXT_descriptor_indexing extension is present
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT    descriptorIndexingFeatures;
 
-  VkPhysicalDeviceMemoryProperties       memoryProperties;
+  VkPhysicalDeviceMemoryProperties                 memoryProperties;
 
-  std::vector<VkExtensionProperties>     extensionProperties;
+  std::vector<VkExtensionProperties>               extensionProperties;
 
-  std::vector<VkQueueFamilyProperties>   queueFamilyProperties;
+  std::vector<VkQueueFamilyProperties>             queueFamilyProperties;
   // only when VK_EXT_KHR_display extension is present
-  std::vector<VkDisplayPropertiesKHR>    displayProperties;
+  std::vector<VkDisplayPropertiesKHR>              displayProperties;
 
 };
 
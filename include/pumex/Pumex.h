@@ -33,6 +33,7 @@
 #include <pumex/Window.h>
 #include <pumex/Surface.h>
 #include <pumex/RenderWorkflow.h>
+#include <pumex/RenderWorkflowReport.h>
 #include <pumex/Node.h>
 #include <pumex/NodeVisitor.h>
 #include <pumex/DeviceMemoryAllocator.h>
@@ -53,11 +54,21 @@
 #include <pumex/Command.h>
 #include <pumex/Query.h>
 #include <pumex/Asset.h>
+#include <pumex/AnimationBlending.h>
+#include <pumex/AnimationEvaluator.h>
+#include <pumex/AnimationLOD.h>
+#include <pumex/CompressedAnimation.h>
 #include <pumex/AssetBuffer.h>
 #include <pumex/AssetNode.h>
 #include <pumex/AssetBufferNode.h>
+#include <pumex/AssetCache.h>
+#include <pumex/AsyncLoader.h>
 #include <pumex/MaterialSet.h>
+#include <pumex/TextureStreamer.h>
+#include <pumex/TextureCompression.h>
+#include <pumex/TextureFile.h>
 #include <pumex/DispatchNode.h>
+#include <pumex/SkinningPaletteNode.h>
 #include <pumex/Text.h>
 #include <pumex/Camera.h>
 #include <pumex/Kinematic.h>
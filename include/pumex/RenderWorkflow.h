@@ -25,6 +25,7 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <vulkan/vulkan.h>
@@ -250,6 +251,21 @@ public:
 inline void getPipelineStageMasks(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<ResourceTransition> consumingTransition, VkPipelineStageFlags& srcStageMask, VkPipelineStageFlags& dstStageMask);
 inline void getAccessMasks(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<ResourceTransition> consumingTransition, VkAccessFlags& srcAccessMask, VkAccessFlags& dstAccessMask);
 
+// Estimated amount of memory used by an attachment. Sizes of surface dependent attachments are measured against surfaceExtent.
+// Real sizes ( with alignment and padding required by the device ) are known when images are created for a surface
+PUMEX_EXPORT VkDeviceSize estimateAttachmentMemorySize(const RenderWorkflowResourceType& resourceType, const VkExtent2D& surfaceExtent);
+
+// Commands of each queue are divided into submissions. Submission waits for all submissions from other queues
+// that generate resources consumed by its commands. Submissions are sorted in the order they must be sent to queues
+struct PUMEX_EXPORT QueueSubmission
+{
+  uint32_t                          queueIndex   = 0;
+  uint32_t                          firstCommand = 0;
+  uint32_t                          commandCount = 0;
+  std::vector<uint32_t>             waitSubmissions; // indices of submissions this submission waits for
+  std::vector<VkPipelineStageFlags> waitStages;      // pipeline stages at which each wait occurs
+};
+
 class PUMEX_EXPORT RenderWorkflowResults
 {
 public:
@@ -257,7 +273,11 @@ public:
 
   std::vector<QueueTraits>                                                           queueTraits;
   std::vector<std::vector<std::shared_ptr<RenderCommand>>>                           commands;
+  std::vector<QueueSubmission>                                                       submissions;
   std::map<std::string, std::string>                                                 resourceAlias;
+  // images that share memory with other images ( image name -> index of memory alias group )
+  std::map<std::string, uint32_t>                                                    memoryAlias;
+  std::vector<std::shared_ptr<MemoryAliasGroup>>                                     memoryAliasGroups;
   std::shared_ptr<RenderPass>                                                        outputRenderPass;
   uint32_t                                                                           presentationQueueIndex = 0;
   std::map<std::string, std::shared_ptr<MemoryBuffer>>                               registeredMemoryBuffers;
@@ -287,6 +307,8 @@ public:
   RenderWorkflow& operator=(RenderWorkflow&&)      = delete;
   ~RenderWorkflow();
 
+  inline const std::string&                        getName() const;
+
   void                                             addResourceType(std::shared_ptr<RenderWorkflowResourceType> tp);
   // two convenient functions for resource type creation
   void                                             addResourceType(const std::string& typeName, bool persistent, VkFormat format, VkSampleCountFlagBits samples, AttachmentType attachmentType, const AttachmentSize& attachmentSize, VkImageUsageFlags imageUsage);
@@ -333,7 +355,11 @@ public:
   std::set<std::shared_ptr<RenderOperation>>       getPreviousOperations(const std::string& opName) const;
   std::set<std::shared_ptr<RenderOperation>>       getNextOperations(const std::string& opName) const;
 
+  // compiles workflow when it was modified
   bool compile(std::shared_ptr<RenderWorkflowCompiler> compiler);
+  // description of everything that affects compilation results : resource types, operations, resources, transitions and associated objects.
+  // Objects are identified by names and properties, not by addresses, so the same workflow built again gets the same key
+  std::string                                      calculateStructuralKey() const;
 
   // data created during workflow compilation - may be used in many surfaces at once
   std::shared_ptr<DeviceMemoryAllocator>                                       frameBufferAllocator;
@@ -360,26 +386,60 @@ struct PUMEX_EXPORT StandardRenderWorkflowCostCalculator
 {
   void  tagOperationByAttachmentType(const RenderWorkflow& workflow);
   float calculateWorkflowCost(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSchedule) const;
+  // cost of performing nextOperation right after previousOperation. Workflow cost is a sum of transition costs
+  float calculateTransitionCost(const std::string& previousOperation, const std::string& nextOperation) const;
 
   std::unordered_map<std::string, int> attachmentTag;
 };
 
+// Operations are scheduled using beam search of width schedulingBeamWidth. The result is optimal as long as the number of distinct partial
+// schedules does not exceed the beam width, otherwise the cheapest partial schedules are extended.
+// Scheduling is the most expensive part of the compilation, so schedules of a few recently compiled workflows are cached by structural key
+// of a workflow. Only operation names are cached - compiled results ( render passes, frame buffers, images ) are created again on each compilation
 class PUMEX_EXPORT SingleQueueWorkflowCompiler : public RenderWorkflowCompiler
 {
 public:
+  explicit SingleQueueWorkflowCompiler(uint32_t schedulingBeamWidth = 64);
   std::shared_ptr<RenderWorkflowResults> compile(RenderWorkflow& workflow) override;
-private:
+  void                                   setScheduleCacheLimit(uint32_t limit);
+protected:
+  // divides scheduled operations between queues. Order of operations in each queue must follow the order of operationSequence
+  virtual void                           distributeOperations(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences);
   void                                   verifyOperations(const RenderWorkflow& workflow);
   void                                   calculatePartialOrdering(const RenderWorkflow& workflow, std::vector<std::shared_ptr<RenderOperation>>& partialOrdering);
   void                                   calculateAttachmentLayouts(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& partialOrdering, std::map<std::string, uint32_t>& resourceMap, std::map<std::string, uint32_t>& operationMap, std::vector<std::vector<VkImageLayout>>& allLayouts);
-  void                                   findAliasedResources(const RenderWorkflow& workflow, const std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences, std::shared_ptr<RenderWorkflowResults> workflowResults);
-  void                                   createCommandSequence(const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::shared_ptr<RenderCommand>>& commands);
+  std::vector<std::shared_ptr<RenderOperation>> getOperationSchedule(const RenderWorkflow& workflow, const StandardRenderWorkflowCostCalculator& costCalculator);
+  void                                   findAliasedResources(const RenderWorkflow& workflow, const StandardRenderWorkflowCostCalculator& costCalculator, const std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences, std::shared_ptr<RenderWorkflowResults> workflowResults);
+  void                                   createCommandSequence(const StandardRenderWorkflowCostCalculator& costCalculator, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::shared_ptr<RenderCommand>>& commands);
   void                                   buildFrameBuffersAndRenderPasses(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& partialOrdering, const std::map<std::string, uint32_t>& resourceMap, const std::map<std::string, uint32_t>& operationMap, const std::vector<std::vector<VkImageLayout>>& allLayouts, std::shared_ptr<RenderWorkflowResults> workflowResults);
   void                                   createPipelineBarriers(const RenderWorkflow& workflow, std::vector<std::vector<std::shared_ptr<RenderCommand>>>& commandSequences, std::shared_ptr<RenderWorkflowResults> workflowResults);
   void                                   createSubpassDependency(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<RenderCommand> generatingCommand, std::shared_ptr<ResourceTransition> consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, uint32_t generatingQueueIndex, uint32_t consumingQueueIndex, std::shared_ptr<RenderWorkflowResults> workflowResults);
   void                                   createPipelineBarrier(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<RenderCommand> generatingCommand, std::shared_ptr<ResourceTransition> consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, uint32_t generatingQueueIndex, uint32_t consumingQueueIndex, std::shared_ptr<RenderWorkflowResults> workflowResults);
+  // barrier between two consumers of the same resource in one queue, created when the latter one uses different layout or access
+  void                                   createConsumerBarrier(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<ResourceTransition> previousTransition, std::shared_ptr<ResourceTransition> consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, std::shared_ptr<RenderWorkflowResults> workflowResults);
+  std::shared_ptr<MemoryObject>          getBarrierMemoryObject(std::shared_ptr<ResourceTransition> transition, std::shared_ptr<RenderWorkflowResults> workflowResults);
+  void                                   createSubmissions(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::shared_ptr<RenderWorkflowResults> workflowResults);
+
+  uint32_t                               schedulingBeamWidth;
+  // compiler may be shared between workflows compiled in different threads
+  std::mutex                             scheduleMutex;
+  // most recently used schedules are at the front of the list
+  // schedules are identified by full structural key of a workflow, so two different workflows never share a schedule
+  std::list<std::pair<std::string, std::vector<std::string>>> scheduleCache;
+  uint32_t                               scheduleCacheLimit = 4;
+};
 
-  StandardRenderWorkflowCostCalculator   costCalculator;
+// Compiler that moves compute operations to a dedicated compute queue ( queue that must have VK_QUEUE_COMPUTE_BIT and must not have VK_QUEUE_GRAPHICS_BIT ),
+// so that they may overlap with graphics work. Compute operation is moved only when all of its previous operations are on the compute queue too,
+// so work never returns from graphics queue to compute queue during a frame. Resources passed between queues get queue family ownership transfers
+// and the submissions are synchronized with semaphores. Graphics operations and all other compute operations are placed on the first graphics queue.
+// When workflow has no dedicated compute queue, all operations are placed on the graphics queue
+class PUMEX_EXPORT MultiQueueWorkflowCompiler : public SingleQueueWorkflowCompiler
+{
+public:
+  explicit MultiQueueWorkflowCompiler(uint32_t schedulingBeamWidth = 64);
+protected:
+  void                                   distributeOperations(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences) override;
 };
 
 LoadOp             loadOpLoad()                        { return LoadOp(LoadOp::Load, glm::vec4(0.0f)); }
@@ -390,6 +450,7 @@ StoreOp            storeOpStore()                      { return StoreOp(StoreOp:
 StoreOp            storeOpDontCare()                   { return StoreOp(StoreOp::DontCare); }
 
 bool                            RenderWorkflowResourceType::isImageOrAttachment() const { return metaType == RenderWorkflowResourceType::Attachment || metaType == RenderWorkflowResourceType::Image; };
+const std::string&              RenderWorkflow::getName() const                         { return name; }
 const std::vector<QueueTraits>& RenderWorkflow::getQueueTraits() const                  { return queueTraits; }
 
 VkImageAspectFlags getAspectMask(AttachmentType at)
@@ -0,0 +1,85 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#pragma once
+#include <memory>
+#include <map>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <vulkan/vulkan.h>
+#include <pumex/Export.h>
+
+namespace pumex
+{
+
+class  RenderWorkflow;
+class  RenderWorkflowCompiler;
+class  RenderWorkflowResults;
+class  RenderCommand;
+class  RenderPass;
+class  MemoryObject;
+class  MemoryObjectBarrier;
+
+// RenderWorkflowReport describes decisions made by a workflow compiler : order of operations on each queue, grouping of operations
+// into render passes and subpasses, pipeline barriers, subpass dependencies, attachment layouts, resource aliasing and estimated memory footprint.
+// Report is created by a dry run of the compiler. Workflow compilation does not create any Vulkan objects ( these are created when compiled
+// workflow is validated on a surface ) so neither device nor surface is needed, and results already stored in a workflow are not touched.
+// Report may be written as JSON ( e.g. to track scheduling and barrier counts in regression tests ) or as Graphviz DOT graph.
+class PUMEX_EXPORT RenderWorkflowReport
+{
+public:
+  RenderWorkflowReport()                                       = delete;
+  explicit RenderWorkflowReport(RenderWorkflow& workflow, std::shared_ptr<RenderWorkflowCompiler> compiler, const VkExtent2D& surfaceExtent = VkExtent2D{ 1920, 1080 });
+  RenderWorkflowReport(const RenderWorkflowReport&)            = delete;
+  RenderWorkflowReport& operator=(const RenderWorkflowReport&) = delete;
+
+  uint32_t                                      getOperationCount() const;
+  uint32_t                                      getRenderPassCount() const;
+  uint32_t                                      getPipelineBarrierCount() const;
+  uint32_t                                      getSubpassDependencyCount() const;
+  // estimated memory used by attachments created by the workflow. Swapchain images and images associated by the user are not counted
+  VkDeviceSize                                  getAttachmentMemorySize(bool withAliasing) const;
+
+  void                                          writeJSON(std::ostream& stream) const;
+  void                                          writeDOT(std::ostream& stream) const;
+
+  inline std::shared_ptr<RenderWorkflowResults> getWorkflowResults() const;
+  inline const VkExtent2D&                      getSurfaceExtent() const;
+
+protected:
+  int                                           getRenderPassIndex(const RenderCommand* command) const;
+  std::string                                   getResourceName(const MemoryObjectBarrier& barrier) const;
+
+  RenderWorkflow&                               workflow;
+  std::shared_ptr<RenderWorkflowResults>        workflowResults;
+  VkExtent2D                                    surfaceExtent;
+  // render passes in order of their first use
+  std::vector<std::shared_ptr<RenderPass>>      renderPasses;
+  std::map<const MemoryObject*, std::string>    memoryObjectNames;
+};
+
+std::shared_ptr<RenderWorkflowResults> RenderWorkflowReport::getWorkflowResults() const { return workflowResults; }
+const VkExtent2D&                      RenderWorkflowReport::getSurfaceExtent() const   { return surfaceExtent; }
+
+}
@@ -0,0 +1,143 @@
+//
+// Copyright(c) 2017-2018 Paweł Księżopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <pumex/Export.h>
+#include <pumex/Node.h>
+#include <pumex/MemoryBuffer.h>
+
+namespace pumex
+{
+
+class Viewer;
+class PipelineCache;
+class DescriptorPool;
+class DeviceMemoryAllocator;
+class DispatchNode;
+class Skeleton;
+struct Animation;
+class SkeletonAnimationBinding;
+
+// Animation state of a single instance evaluated by SkinningPaletteNode
+struct PUMEX_EXPORT SkinningPaletteInstance
+{
+  SkinningPaletteInstance(uint32_t clip = 0, float time = 0.0f, uint32_t outputIndex = 0)
+    : clip{ clip }, time{ time }, outputIndex{ outputIndex }
+  {
+  }
+  uint32_t clip;        // index returned by SkinningPaletteNode::addClip()
+  float    time;        // animation time in seconds
+  uint32_t outputIndex; // bone matrices are written to output matrices starting at outputIndex * outputStride + outputOffset
+  uint32_t std430pad0;
+};
+
+// Node class that calculates bone matrices ( skinning palettes ) of many animated instances in a compute shader.
+// Skeleton hierarchies and animation keyframes are uploaded to storage buffers once ( see addClip() ), every frame only
+// SkinningPaletteInstance data is sent to GPU. Bone matrices are written directly into outputBuffer, which is treated
+// as an array of matrices : bone b of instance i lands at index ( outputIndex * outputStride + outputOffset + b ).
+// Output buffer must be a storage buffer. The node should be placed in a compute render operation whose output is
+// consumed by vertex shaders of the following operations.
+// Experimental : compute shader has not been compared against AnimationEvaluator results on real devices yet.
+
+class PUMEX_EXPORT SkinningPaletteNode : public Group
+{
+public:
+  SkinningPaletteNode(std::shared_ptr<Viewer> viewer, std::shared_ptr<PipelineCache> pipelineCache, std::shared_ptr<DescriptorPool> descriptorPool, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator, std::shared_ptr<MemoryBuffer> outputBuffer, uint32_t outputStride, uint32_t outputOffset);
+
+  void     validate(const RenderContext& renderContext) override;
+
+  // uploads skeleton hierarchy and animation keyframes. Returns index of a clip used by SkinningPaletteInstance::clip
+  uint32_t addClip(const SkeletonAnimationBinding& binding);
+  uint32_t addClip(const Skeleton& skeleton, const Animation& animation);
+  uint32_t getClipCount() const;
+
+  // sets instances evaluated in the next frame
+  void     setInstances(const std::vector<SkinningPaletteInstance>& instances);
+
+  static const uint32_t workGroupSize = 16;
+
+protected:
+  struct ClipDefinition
+  {
+    glm::mat4 invGlobalTransform;
+    uint32_t  firstBone;
+    uint32_t  boneCount;
+    uint32_t  std430pad0;
+    uint32_t  std430pad1;
+  };
+  struct BoneDefinition
+  {
+    glm::mat4 localTransformation;
+    glm::mat4 offsetMatrix;
+    uint32_t  parentIndex; // index relative to clip's first bone
+    uint32_t  channel;     // index in channel buffer or std::numeric_limits<uint32_t>::max() when bone is not animated
+    uint32_t  std430pad0;
+    uint32_t  std430pad1;
+  };
+  struct TrackDefinition
+  {
+    uint32_t firstKey;
+    uint32_t keyCount;
+    float    beginTime;
+    float    endTime;
+  };
+  struct ChannelDefinition
+  {
+    TrackDefinition position;
+    TrackDefinition rotation;
+    TrackDefinition scale;
+    uint32_t        before;
+    uint32_t        after;
+    uint32_t        std430pad0;
+    uint32_t        std430pad1;
+  };
+  struct Parameters
+  {
+    uint32_t instanceCount;
+    uint32_t outputStride;
+    uint32_t outputOffset;
+    uint32_t std430pad0;
+  };
+
+  std::shared_ptr<std::vector<ClipDefinition>>                  clips;
+  std::shared_ptr<std::vector<BoneDefinition>>                  bones;
+  std::shared_ptr<std::vector<ChannelDefinition>>               channels;
+  std::shared_ptr<std::vector<float>>                           keyTimes;
+  std::shared_ptr<std::vector<glm::vec4>>                       keyValues;
+  std::shared_ptr<std::vector<SkinningPaletteInstance>>         instances;
+
+  std::shared_ptr<Buffer<Parameters>>                           parametersBuffer;
+  std::shared_ptr<Buffer<std::vector<ClipDefinition>>>          clipBuffer;
+  std::shared_ptr<Buffer<std::vector<BoneDefinition>>>          boneBuffer;
+  std::shared_ptr<Buffer<std::vector<ChannelDefinition>>>       channelBuffer;
+  std::shared_ptr<Buffer<std::vector<float>>>                   keyTimeBuffer;
+  std::shared_ptr<Buffer<std::vector<glm::vec4>>>               keyValueBuffer;
+  std::shared_ptr<Buffer<std::vector<SkinningPaletteInstance>>> instanceBuffer;
+  std::shared_ptr<DispatchNode>                                 dispatchNode;
+  uint32_t                                                      outputStride;
+  uint32_t                                                      outputOffset;
+};
+
+}
@@ -24,6 +24,8 @@
 #include <memory>
 #include <array>
 #include <vector>
+#include <string>
+#include <map>
 #include <pumex/Export.h>
 #include <pumex/Node.h>
 #include <pumex/InputEvent.h>
@@ -47,6 +49,10 @@ class  Camera;
 struct VertexSemantic;
 template <typename T> class Buffer;
 
+// TimeStatisticsHandler shows FPS and graphs of viewer and surface time statistics. Key F4 switches between statistics sets.
+// Allocators added with addAllocatorStatistics() get their own groups of surface statistics channels : memory usage and allocation counts
+// are graphed for last frames and latest values are printed next to the group name. Allocator frame counters are closed once per viewer frame
+// by the first surface that collects data in that frame, so each allocator should be added to a single handler only.
 class PUMEX_EXPORT TimeStatisticsHandler : public InputEventHandler
 {
 public:
@@ -54,10 +60,20 @@ public:
 
   bool handle(const InputEvent& iEvent, Viewer* viewer) override;
   void collectData(Surface* surface, TimeStatistics* viewerStatistics, TimeStatistics* surfaceStatistics);
+  void addAllocatorStatistics(std::shared_ptr<DeviceMemoryAllocator> allocator, const std::wstring& name);
 
   inline std::shared_ptr<Group> getRoot() const;
 protected:
   void addChannelData(float minVal, uint32_t vertexSize, float h0, float h1, VertexAccumulator& acc, const TimeStatisticsChannel& channel, std::vector<float>& vertices, std::vector<uint32_t>& indices);
+  void addValueChannelData(float maxVal, uint32_t vertexSize, float h0, float h1, VertexAccumulator& acc, const TimeStatisticsChannel& channel, std::vector<float>& vertices, std::vector<uint32_t>& indices);
+  void collectAllocatorData(Surface* surface, TimeStatistics* surfaceStatistics, double frameBegin);
+
+  struct AllocatorEntry
+  {
+    std::shared_ptr<DeviceMemoryAllocator>     allocator;
+    std::wstring                               name;
+    std::map<VkDevice, unsigned long long>     lastFinishedFrame; // viewer frame in which finishFrame() was called for a device
+  };
 
   std::vector<VertexSemantic>        drawSemantic;
 
@@ -76,12 +92,15 @@ protected:
   uint32_t                           statisticsCollection       = 0;
   float                              windowTime                 = 0.01f;
   uint32_t                           framesCount                = 5;
+  uint32_t                           valueFramesCount           = 30;
 
   std::vector<char>                  showfFPS;
   std::vector<uint32_t>              viewerStatisticsToCollect;
   std::vector<uint32_t>              surfaceStatisticsToCollect;
   std::vector<std::vector<uint32_t>> viewerStatisticsGroups;
   std::vector<std::vector<uint32_t>> surfaceStatisticsGroups;
+  std::vector<AllocatorEntry>        allocators;
+  std::map<uint32_t, std::wstring>   allocatorGroupTexts;
 };
 
 class PUMEX_EXPORT BasicCameraHandler : public InputEventHandler
@@ -50,11 +50,17 @@ class TimeStatistics;
 const uint32_t TSS_STAT_BASIC   = 1;
 const uint32_t TSS_STAT_BUFFERS = 2;
 const uint32_t TSS_STAT_EVENTS  = 4;
+// collected by TimeStatisticsHandler for allocators added with addAllocatorStatistics()
+const uint32_t TSS_STAT_ALLOCATORS = 8;
 
 const uint32_t TSS_GROUP_BASIC             = 1;
 const uint32_t TSS_GROUP_EVENTS            = 2;
 const uint32_t TSS_GROUP_SECONDARY_BUFFERS = 20;
 const uint32_t TSS_GROUP_PRIMARY_BUFFERS   = 10;
+// groups and channels starting from these IDs are reserved for allocator statistics added by TimeStatisticsHandler::addAllocatorStatistics().
+// Base lies far above primary buffer channels ( 20 + 10 * queueIndex ), so both sets never overlap
+const uint32_t TSS_GROUP_ALLOCATORS        = 1000;
+const uint32_t TSS_CHANNEL_ALLOCATORS      = 1000;
 
 const uint32_t TSS_CHANNEL_BEGINFRAME                   = 1;
 const uint32_t TSS_CHANNEL_EVENTSURFACERENDERSTART      = 2;
@@ -164,9 +170,22 @@ protected:
 
   std::vector<VkFence>                          waitFences;
   std::shared_ptr<CommandBuffer>                prepareCommandBuffer;
-  std::vector<std::shared_ptr<CommandBuffer>>   primaryCommandBuffers;
   std::shared_ptr<CommandBuffer>                presentCommandBuffer;
 
+  // primary command buffers are built and submitted according to RenderWorkflowResults::submissions
+  struct PrimarySubmission
+  {
+    uint32_t                                    queueIndex;
+    uint32_t                                    firstCommand;
+    uint32_t                                    commandCount;
+    std::shared_ptr<CommandBuffer>              commandBuffer;
+    std::vector<VkSemaphore>                    waitSemaphores;
+    std::vector<VkPipelineStageFlags>           waitStages;
+    std::vector<VkSemaphore>                    signalSemaphores;
+  };
+  std::vector<PrimarySubmission>                primarySubmissions;
+  std::vector<VkSemaphore>                      submissionSemaphores;
+
   std::vector<Node*>                            secondaryCommandBufferNodes;
   std::vector<VkRenderPass>                     secondaryCommandBufferRenderPasses;
   std::vector<uint32_t>                         secondaryCommandBufferSubPasses;
@@ -182,6 +201,8 @@ protected:
 
   void                                          createSwapChain();
   bool                                          checkWorkflow();
+  void                                          createPrimarySubmissions();
+  void                                          destroyPrimarySubmissions();
 };
 
 bool                         Surface::isRealized() const                                                               { return realized; }
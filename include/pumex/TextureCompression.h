@@ -0,0 +1,61 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <string>
+#include <pumex/Export.h>
+#include <pumex/Image.h>
+
+namespace pumex
+{
+
+// tcAuto stores textures without transparent pixels as BC1 and all other as BC3. tcBC7 gives the best quality, but requires textureCompressionBC
+// on the device just like other formats and is the slowest to encode ( mode 6 only : one subset, 4 bit indices, RGBA endpoints )
+enum TextureCompressionFormat { tcAuto, tcBC1, tcBC3, tcBC7 };
+
+// Block compression of 8 bit RGB / RGBA textures on CPU.
+// When generateMipmaps is set and texture has only one level - the mip chain is created with a box filter before compression.
+// Blocks of each texture level are encoded in parallel. Textures that have other formats ( or are already compressed ) are returned unchanged
+PUMEX_EXPORT std::shared_ptr<gli::texture> compressTexture(std::shared_ptr<gli::texture> texture, TextureCompressionFormat format = tcAuto, bool generateMipmaps = true);
+
+// Texture loader that compresses textures loaded by other loader ( e.g. TextureLoaderGli ) and stores results in *.pumexasset files ( see saveTextureFile() )
+// in a cache directory shared with AssetLoaderCache. Cached file is used only when path, modification time and size of the source file, compression format
+// and generateMipmaps flag are the same as during the first load. Only textures that were really compressed are stored in the cache
+class PUMEX_EXPORT TextureLoaderCompressed : public TextureLoader
+{
+public:
+  explicit TextureLoaderCompressed(std::shared_ptr<TextureLoader> loader, const std::string& cacheDirectory = std::string(), TextureCompressionFormat format = tcAuto, bool generateMipmaps = true);
+  std::shared_ptr<gli::texture> load(const std::string& fileName) override;
+
+  inline const std::string& getCacheDirectory() const;
+
+protected:
+  std::shared_ptr<TextureLoader> loader;
+  std::string                    cacheDirectory;
+  TextureCompressionFormat       format;
+  bool                           generateMipmaps;
+};
+
+const std::string& TextureLoaderCompressed::getCacheDirectory() const { return cacheDirectory; }
+
+}
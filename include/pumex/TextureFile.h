@@ -0,0 +1,95 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <pumex/Export.h>
+#include <pumex/Image.h>
+
+namespace pumex
+{
+
+class MappedFile;
+
+// KTX or DDS texture file mapped into memory. Only the header is parsed, so texture data may be copied straight from the mapping
+// into staging memory ( see MemoryImage constructor that takes TextureFile ) without creating intermediate gli::texture.
+// isDirect() returns false when texture data cannot be sent to GPU as it is stored in a file ( unknown format, different endianness,
+// padded rows, legacy DDS pixel formats described with masks ). Such files must be converted by gli - see createTexture()
+class PUMEX_EXPORT TextureFile
+{
+public:
+  TextureFile()                              = delete;
+  explicit TextureFile(const std::string& fileName);
+  TextureFile(const TextureFile&)            = delete;
+  TextureFile& operator=(const TextureFile&) = delete;
+  ~TextureFile();
+
+  inline const std::string&     getFileName() const;
+  inline bool                   isDirect() const;
+  inline gli::target            getTarget() const;
+  inline gli::format            getFormat() const;
+  inline size_t                 getLayers() const;
+  inline size_t                 getFaces() const;
+  inline size_t                 getLevels() const;
+  gli::extent3d                 getExtent(size_t level = 0) const;
+
+  // data of a single layer, face and mip level. Pointer is valid as long as TextureFile exists. Available only when isDirect() == true
+  const char*                   data(size_t layer, size_t face, size_t level) const;
+  // size of a single layer and face of a mip level
+  size_t                        size(size_t level) const;
+  // size of all layers, faces and levels
+  size_t                        size() const;
+
+  // loads the texture using gli. Returns empty texture when file does not exist or cannot be read
+  std::shared_ptr<gli::texture> createTexture() const;
+
+protected:
+  bool parseKTX();
+  bool parseDDS();
+  void setTarget(bool isArray, uint32_t dimensions);
+
+  std::string                 fileName;
+  std::unique_ptr<MappedFile> file;
+  bool                        direct  = false;
+  gli::target                 target  = gli::TARGET_2D;
+  gli::format                 format  = gli::FORMAT_UNDEFINED;
+  gli::extent3d               extent  = gli::extent3d(1, 1, 1);
+  size_t                      layers  = 1;
+  size_t                      faces   = 1;
+  size_t                      levels  = 1;
+  // offsets of texture data in a file. Index = ( layer * faces + face ) * levels + level
+  std::vector<size_t>         offsets;
+};
+
+PUMEX_EXPORT ImageTraits getImageTraitsFromTextureFile(const TextureFile& textureFile, VkImageUsageFlags usage);
+
+const std::string& TextureFile::getFileName() const { return fileName; }
+bool               TextureFile::isDirect() const    { return direct; }
+gli::target        TextureFile::getTarget() const   { return target; }
+gli::format        TextureFile::getFormat() const   { return format; }
+size_t             TextureFile::getLayers() const   { return layers; }
+size_t             TextureFile::getFaces() const    { return faces; }
+size_t             TextureFile::getLevels() const   { return levels; }
+
+}
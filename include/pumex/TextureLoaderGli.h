@@ -26,7 +26,7 @@
 namespace pumex
 {
 
-// texture loader that is able to load DDS and KTX textures using GLI library
+// texture loader that is able to load DDS and KTX textures using GLI library. Files are memory mapped, so only texture data is allocated during loading
 class PUMEX_EXPORT TextureLoaderGli : public TextureLoader
 {
 public:
@@ -0,0 +1,95 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <vulkan/vulkan.h>
+#include <pumex/Export.h>
+
+namespace pumex
+{
+
+class MemoryImage;
+
+// TextureStreamer controls how many mip levels of textures are resident on GPU ( see MemoryImage::setResidentMipLevel() ).
+// Images created from gli::texture or from TextureFile may be streamed. Levels of TextureFile images are read from the mapping
+// when they become resident, so texture data that is never needed on GPU is never loaded from disk.
+// Each added image starts with its mip tail only ( mip levels not bigger than mipTailSize ), so startup uploads are small.
+// During each frame application requests the finest mip level that it needs for each used texture together with its priority
+// ( e.g. mip level may be calculated from distance to the object and priority may be an inverse of that distance ).
+// Then update() makes resident one more mip level of requested textures, most important textures first, until one of the budgets is reached :
+//   - uploadBudget limits the size of data sent to GPU during one update ( levels that were resident before are copied on GPU and are not counted )
+//   - memoryBudget limits the memory used by all streamed textures. Mip levels of textures that are not needed are evicted to make room for the new ones
+// Mip tails are always resident, so they are not limited by memoryBudget.
+class PUMEX_EXPORT TextureStreamer
+{
+public:
+  TextureStreamer()                                  = delete;
+  explicit TextureStreamer(VkDeviceSize memoryBudget, VkDeviceSize uploadBudget = 16 * 1024 * 1024, uint32_t mipTailSize = 64);
+  TextureStreamer(const TextureStreamer&)            = delete;
+  TextureStreamer& operator=(const TextureStreamer&) = delete;
+  TextureStreamer(TextureStreamer&&)                 = delete;
+  TextureStreamer& operator=(TextureStreamer&&)      = delete;
+
+  void                addImage(std::shared_ptr<MemoryImage> memoryImage);
+  void                removeImage(std::shared_ptr<MemoryImage> memoryImage);
+
+  // requests are collected until next update(). When the same image is requested many times - the finest level and the highest priority are used
+  void                requestMipLevel(std::shared_ptr<MemoryImage> memoryImage, uint32_t mipLevel, float priority);
+  void                update();
+
+  inline VkDeviceSize getMemoryBudget() const;
+  inline VkDeviceSize getUploadBudget() const;
+  void                setMemoryBudget(VkDeviceSize budget);
+  void                setUploadBudget(VkDeviceSize budget);
+  // memory used by resident mip levels of all streamed images
+  VkDeviceSize        getResidentSize() const;
+
+protected:
+  struct StreamedImage
+  {
+    StreamedImage(std::shared_ptr<MemoryImage> memoryImage, uint32_t tailLevel);
+
+    std::weak_ptr<MemoryImage> memoryImage;
+    std::vector<VkDeviceSize>  levelSizes;     // memory used by all levels from given level to the smallest one
+    uint32_t                   tailLevel;
+    uint32_t                   residentLevel;
+    uint32_t                   targetLevel;
+    bool                       requested       = false;
+    uint32_t                   requestedLevel  = 0;
+    float                      priority        = 0.0f;
+  };
+
+  std::vector<StreamedImage>::iterator findImage(MemoryImage* memoryImage);
+
+  mutable std::mutex         mutex;
+  std::vector<StreamedImage> images;
+  VkDeviceSize               memoryBudget;
+  VkDeviceSize               uploadBudget;
+  uint32_t                   mipTailSize;
+};
+
+VkDeviceSize TextureStreamer::getMemoryBudget() const { return memoryBudget; }
+VkDeviceSize TextureStreamer::getUploadBudget() const { return uploadBudget; }
+
+}
@@ -23,6 +23,7 @@
 #pragma once
 #include <memory>
 #include <vector>
+#include <deque>
 #include <vulkan/vulkan.h>
 #include <pumex/Export.h>
 
@@ -30,7 +31,7 @@ namespace pumex
 {
 
 // collection of helper functions to create Vulkan buffers
-// Note : this file is mainly outdated ( except for StagingBuffer class )
+// Note : this file is mainly outdated ( except for StagingBuffer, StagingRing and StagingRegion classes )
 
 class Device;
 
@@ -92,6 +93,68 @@ VkDeviceSize StagingBuffer::bufferSize() const { return memorySize; }
 bool         StagingBuffer::isReserved() const { return reserved; }
 void         StagingBuffer::setReserved(bool value) { reserved = value; }
 
+// part of a staging memory acquired from Device::acquireStagingRegion(). Data should be copied from buffer starting at offset.
+// When staging ring had no free space, region is served by a dedicated StagingBuffer ( fallbackBuffer )
+struct PUMEX_EXPORT StagingRegion
+{
+  VkBuffer                       buffer        = VK_NULL_HANDLE;
+  VkDeviceSize                   offset        = 0;
+  VkDeviceSize                   size          = 0;
+  uint8_t*                       mappedPointer = nullptr;
+  uint64_t                       allocationID  = 0;
+  std::shared_ptr<StagingBuffer> fallbackBuffer;
+};
+
+struct PUMEX_EXPORT StagingRingStatistics
+{
+  VkDeviceSize capacity        = 0;
+  VkDeviceSize usedBytes       = 0;
+  VkDeviceSize peakUsedBytes   = 0;
+  uint64_t     allocationCount = 0;
+  uint64_t     stallCount      = 0; // number of requests that did not fit into the ring and were served by dedicated staging buffer
+};
+
+// StagingRing is a single, persistently mapped, host visible buffer used as a circular queue of staging regions.
+// Regions are acquired at the head of the ring and recycled at its tail. Region may be released in any order, but its memory is reused
+// only after all regions acquired before it are released too. Acquiring and releasing regions makes no Vulkan calls.
+// Regions are released by MemoryBuffer/MemoryImage operations after the fence of their command buffer was signaled.
+class StagingRing
+{
+public:
+  StagingRing()                              = delete;
+  explicit StagingRing(Device* device, VkDeviceSize size);
+  StagingRing(const StagingRing&)            = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+  StagingRing(StagingRing&&)                 = delete;
+  StagingRing& operator=(StagingRing&&)      = delete;
+  virtual ~StagingRing();
+
+  // returns false when there's not enough free space in a ring
+  bool                  acquire(VkDeviceSize size, VkDeviceSize alignment, StagingRegion& region);
+  void                  release(const StagingRegion& region);
+
+  StagingRingStatistics getStatistics() const;
+
+protected:
+  struct Allocation
+  {
+    VkDeviceSize begin;
+    VkDeviceSize end;
+    bool         released;
+  };
+
+  VkDevice               device         = VK_NULL_HANDLE;
+  VkBuffer               buffer         = VK_NULL_HANDLE;
+  VkDeviceMemory         memory         = VK_NULL_HANDLE;
+  VkDeviceSize           memorySize     = 0;
+  uint8_t*               mappedPointer  = nullptr;
+  VkDeviceSize           head           = 0;
+  VkDeviceSize           tail           = 0;
+  std::deque<Allocation> allocations;
+  uint64_t               firstAllocationID = 0;
+  StagingRingStatistics  statistics;
+};
+
 
 
 }
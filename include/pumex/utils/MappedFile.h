@@ -0,0 +1,56 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+#include <string>
+#include <pumex/Export.h>
+
+namespace pumex
+{
+
+// read only memory mapping of a whole file. data() returns nullptr when file does not exist, is empty or cannot be mapped
+class PUMEX_EXPORT MappedFile
+{
+public:
+  MappedFile()                             = delete;
+  explicit MappedFile(const std::string& fileName);
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  inline const char* data() const;
+  inline size_t      size() const;
+
+protected:
+#if defined(_WIN32)
+  void*       file       = nullptr;
+  void*       mapping    = nullptr;
+#else
+  int         file       = -1;
+#endif
+  const char* mapped     = nullptr;
+  size_t      mappedSize = 0;
+};
+
+const char* MappedFile::data() const { return mapped; }
+size_t      MappedFile::size() const { return mappedSize; }
+
+}
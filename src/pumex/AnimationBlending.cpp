@@ -0,0 +1,380 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/AnimationBlending.h>
+#include <algorithm>
+#include <iterator>
+#include <pumex/utils/Log.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace pumex;
+
+namespace
+{
+
+// decomposition of a transformation without shear
+void decomposeTransform(const glm::mat4& matrix, glm::vec3& position, glm::quat& rotation, glm::vec3& scale)
+{
+  position = glm::vec3(matrix[3]);
+  scale    = glm::vec3(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])));
+  glm::mat3 rotationMatrix;
+  for (uint32_t i = 0; i < 3; ++i)
+    rotationMatrix[i] = (scale[i] > 0.0f) ? glm::vec3(matrix[i]) / scale[i] : glm::vec3(0.0f);
+  rotation = glm::normalize(glm::quat_cast(rotationMatrix));
+}
+
+inline glm::vec3 sampleVector(const std::vector<TimeLine<glm::vec3>>& values, float time, uint32_t* cursor, const glm::vec3& defaultValue)
+{
+  if (values.empty())
+    return defaultValue;
+  if (values.size() == 1)
+    return values[0].value;
+  return (cursor != nullptr) ? pumex::mix(values.data(), values.size(), time, *cursor) : pumex::mix(values.data(), values.size(), time);
+}
+
+inline glm::quat sampleRotation(const std::vector<TimeLine<glm::quat>>& values, float time, uint32_t* cursor)
+{
+  if (values.empty())
+    return glm::quat();
+  if (values.size() == 1)
+    return values[0].value;
+  return (cursor != nullptr) ? pumex::slerp(values.data(), values.size(), time, *cursor) : pumex::slerp(values.data(), values.size(), time);
+}
+
+}
+
+const uint32_t BlendTree::noBoneMask;
+
+SkeletonPose::SkeletonPose(uint32_t boneCount)
+{
+  resize(boneCount);
+}
+
+void SkeletonPose::resize(uint32_t boneCount)
+{
+  positions.resize(boneCount, glm::vec3(0.0f));
+  rotations.resize(boneCount, glm::quat());
+  scales.resize(boneCount, glm::vec3(1.0f));
+}
+
+BlendTree::BlendTree(const Skeleton& s)
+  : skeleton{ s }, bindPose{ static_cast<uint32_t>(s.bones.size()) }
+{
+  CHECK_LOG_THROW(skeleton.bones.empty(), "Skeleton " << skeleton.name << " has no bones");
+  for (uint32_t i = 0; i < skeleton.bones.size(); ++i)
+    decomposeTransform(skeleton.bones[i].localTransformation, bindPose.positions[i], bindPose.rotations[i], bindPose.scales[i]);
+}
+
+uint32_t BlendTree::addParameter(const std::string& name)
+{
+  CHECK_LOG_THROW(std::find(begin(parameterNames), end(parameterNames), name) != end(parameterNames), "Blend tree parameter " << name << " already exists");
+  parameterNames.push_back(name);
+  return static_cast<uint32_t>(parameterNames.size() - 1);
+}
+
+uint32_t BlendTree::getParameterIndex(const std::string& name) const
+{
+  auto it = std::find(begin(parameterNames), end(parameterNames), name);
+  CHECK_LOG_THROW(it == end(parameterNames), "Blend tree parameter " << name << " does not exist");
+  return static_cast<uint32_t>(std::distance(begin(parameterNames), it));
+}
+
+uint32_t BlendTree::addBoneMask(const std::vector<float>& boneWeights)
+{
+  CHECK_LOG_THROW(boneWeights.size() != skeleton.bones.size(), "Bone mask has " << boneWeights.size() << " weights, but skeleton has " << skeleton.bones.size() << " bones");
+  boneMasks.push_back(boneWeights);
+  return static_cast<uint32_t>(boneMasks.size() - 1);
+}
+
+uint32_t BlendTree::addBoneMask(const std::string& boneName, float weight)
+{
+  auto it = skeleton.invBoneNames.find(boneName);
+  CHECK_LOG_THROW(it == end(skeleton.invBoneNames), "Skeleton " << skeleton.name << " has no bone named " << boneName);
+  std::vector<float> boneWeights(skeleton.bones.size(), 0.0f);
+  std::vector<bool>  descendant(skeleton.bones.size(), false);
+  descendant[it->second] = true;
+  // parents are defined before their children
+  for (uint32_t i = it->second; i < skeleton.bones.size(); ++i)
+  {
+    uint32_t parentIndex = skeleton.bones[i].parentIndex;
+    if (descendant[i] || (parentIndex < skeleton.bones.size() && descendant[parentIndex]))
+    {
+      descendant[i]  = true;
+      boneWeights[i] = weight;
+    }
+  }
+  return addBoneMask(boneWeights);
+}
+
+uint32_t BlendTree::addClip(const Animation& animation, uint32_t timeParameter)
+{
+  return addClip(SkeletonAnimationBinding(skeleton, animation), timeParameter);
+}
+
+uint32_t BlendTree::addClip(const SkeletonAnimationBinding& binding, uint32_t timeParameter)
+{
+  CHECK_LOG_THROW(binding.getBoneCount() != skeleton.bones.size(), "Binding of animation " << binding.getAnimation().name << " was created for different skeleton");
+  Clip clip;
+  clip.animation    = &binding.getAnimation();
+  clip.boneChannels = binding.getBoneChannels();
+  clips.push_back(clip);
+
+  Node node;
+  node.type      = Node::Clip;
+  node.clip      = static_cast<uint32_t>(clips.size() - 1);
+  node.parameter = timeParameter;
+  return addNode(node);
+}
+
+uint32_t BlendTree::addBlend(const std::vector<uint32_t>& inputs, const std::vector<uint32_t>& weightParameters)
+{
+  CHECK_LOG_THROW(inputs.empty(), "Blend node has no inputs");
+  CHECK_LOG_THROW(inputs.size() != weightParameters.size(), "Blend node has " << inputs.size() << " inputs and " << weightParameters.size() << " weights");
+  Node node;
+  node.type             = Node::Blend;
+  node.inputs           = inputs;
+  node.weightParameters = weightParameters;
+  return addNode(node);
+}
+
+uint32_t BlendTree::addLayer(uint32_t base, uint32_t layer, uint32_t weightParameter, uint32_t boneMask)
+{
+  Node node;
+  node.type      = Node::Layer;
+  node.inputs    = { base, layer };
+  node.parameter = weightParameter;
+  node.boneMask  = boneMask;
+  return addNode(node);
+}
+
+uint32_t BlendTree::addAdditive(uint32_t base, uint32_t additive, uint32_t reference, uint32_t weightParameter, uint32_t boneMask)
+{
+  Node node;
+  node.type      = Node::Additive;
+  node.inputs    = { base, additive, reference };
+  node.parameter = weightParameter;
+  node.boneMask  = boneMask;
+  return addNode(node);
+}
+
+uint32_t BlendTree::addNode(const Node& node)
+{
+  for (auto input : node.inputs)
+    CHECK_LOG_THROW(input >= nodes.size(), "Blend tree node " << input << " does not exist");
+  for (auto parameter : node.weightParameters)
+    CHECK_LOG_THROW(parameter >= parameterNames.size(), "Blend tree parameter " << parameter << " does not exist");
+  CHECK_LOG_THROW(node.type != Node::Blend && node.parameter >= parameterNames.size(), "Blend tree parameter " << node.parameter << " does not exist");
+  CHECK_LOG_THROW(node.boneMask != noBoneMask && node.boneMask >= boneMasks.size(), "Bone mask " << node.boneMask << " does not exist");
+
+  nodes.push_back(node);
+  // first input of blend and layer nodes is evaluated directly into the result, remaining inputs need a temporary pose each
+  Node& added = nodes.back();
+  switch (added.type)
+  {
+  case Node::Clip:
+    added.poseCount = 0;
+    break;
+  case Node::Blend:
+  case Node::Layer:
+    added.poseCount = nodes[added.inputs[0]].poseCount;
+    for (uint32_t i = 1; i < added.inputs.size(); ++i)
+      added.poseCount = std::max(added.poseCount, 1 + nodes[added.inputs[i]].poseCount);
+    break;
+  case Node::Additive:
+    added.poseCount = std::max(nodes[added.inputs[0]].poseCount, 2 + std::max(nodes[added.inputs[1]].poseCount, nodes[added.inputs[2]].poseCount));
+    break;
+  }
+  root = static_cast<uint32_t>(nodes.size() - 1);
+  return root;
+}
+
+void BlendTree::setRoot(uint32_t node)
+{
+  CHECK_LOG_THROW(node >= nodes.size(), "Blend tree node " << node << " does not exist");
+  root = node;
+}
+
+void BlendTree::prepareWorkspace(BlendWorkspace& workspace) const
+{
+  CHECK_LOG_THROW(root >= nodes.size(), "Blend tree has no nodes");
+  uint32_t boneCount = getBoneCount();
+  if (workspace.poses.size() < nodes[root].poseCount)
+    workspace.poses.resize(nodes[root].poseCount);
+  for (auto& pose : workspace.poses)
+    if (pose.getBoneCount() != boneCount)
+      pose.resize(boneCount);
+  workspace.globalTransforms.resize(boneCount);
+}
+
+void BlendTree::evaluate(const float* parameters, AnimationCursor* cursors, BlendWorkspace& workspace, SkeletonPose& pose) const
+{
+  prepareWorkspace(workspace);
+  if (pose.getBoneCount() != getBoneCount())
+    pose.resize(getBoneCount());
+  evaluateNode(root, parameters, cursors, workspace, 0, pose);
+}
+
+void BlendTree::calculateBoneMatrices(const SkeletonPose& pose, BlendWorkspace& workspace, glm::mat4* boneMatrices) const
+{
+  uint32_t boneCount = getBoneCount();
+  CHECK_LOG_THROW(pose.getBoneCount() != boneCount, "Pose has " << pose.getBoneCount() << " bones, but skeleton has " << boneCount << " bones");
+  workspace.globalTransforms.resize(boneCount);
+  for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+  {
+    glm::mat4 localTransform = glm::scale(glm::translate(mat4unity, pose.positions[boneIndex]) * glm::mat4_cast(pose.rotations[boneIndex]), pose.scales[boneIndex]);
+    if (boneIndex == 0)
+      workspace.globalTransforms[boneIndex] = skeleton.invGlobalTransform * localTransform;
+    else
+      workspace.globalTransforms[boneIndex] = workspace.globalTransforms[skeleton.bones[boneIndex].parentIndex] * localTransform;
+    boneMatrices[boneIndex] = workspace.globalTransforms[boneIndex] * skeleton.bones[boneIndex].offsetMatrix;
+  }
+}
+
+void BlendTree::evaluateNode(uint32_t nodeIndex, const float* parameters, AnimationCursor* cursors, BlendWorkspace& workspace, uint32_t firstPose, SkeletonPose& pose) const
+{
+  const Node& node      = nodes[nodeIndex];
+  uint32_t    boneCount = getBoneCount();
+  switch (node.type)
+  {
+  case Node::Clip:
+    sampleClip(clips[node.clip], parameters[node.parameter], (cursors != nullptr) ? &cursors[node.clip] : nullptr, pose);
+    break;
+  case Node::Blend:
+  {
+    float weightSum = 0.0f;
+    for (auto parameter : node.weightParameters)
+      weightSum += std::max(0.0f, parameters[parameter]);
+    if (weightSum <= 0.0f)
+    {
+      evaluateNode(node.inputs[0], parameters, cursors, workspace, firstPose, pose);
+      break;
+    }
+    // rotations are averaged using normalized weighted sum of quaternions from the same hemisphere
+    SkeletonPose& input      = workspace.poses[firstPose];
+    uint32_t      inputCount = 0;
+    for (uint32_t i = 0; i < node.inputs.size(); ++i)
+    {
+      float weight = std::max(0.0f, parameters[node.weightParameters[i]]) / weightSum;
+      if (weight <= 0.0f)
+        continue;
+      if (inputCount++ == 0)
+      {
+        evaluateNode(node.inputs[i], parameters, cursors, workspace, firstPose, pose);
+        if (weight < 1.0f)
+        {
+          for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+          {
+            pose.positions[boneIndex] *= weight;
+            pose.rotations[boneIndex] *= weight;
+            pose.scales[boneIndex]    *= weight;
+          }
+        }
+        continue;
+      }
+      evaluateNode(node.inputs[i], parameters, cursors, workspace, firstPose + 1, input);
+      for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+      {
+        float rotationWeight = (glm::dot(pose.rotations[boneIndex], input.rotations[boneIndex]) < 0.0f) ? -weight : weight;
+        pose.positions[boneIndex] += input.positions[boneIndex] * weight;
+        pose.rotations[boneIndex] =  pose.rotations[boneIndex] + input.rotations[boneIndex] * rotationWeight;
+        pose.scales[boneIndex]    += input.scales[boneIndex] * weight;
+      }
+    }
+    if (inputCount > 1)
+    {
+      for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+        pose.rotations[boneIndex] = glm::normalize(pose.rotations[boneIndex]);
+    }
+    break;
+  }
+  case Node::Layer:
+  {
+    evaluateNode(node.inputs[0], parameters, cursors, workspace, firstPose, pose);
+    float weight = parameters[node.parameter];
+    if (weight <= 0.0f)
+      break;
+    SkeletonPose& layer = workspace.poses[firstPose];
+    evaluateNode(node.inputs[1], parameters, cursors, workspace, firstPose + 1, layer);
+    const float* mask = (node.boneMask != noBoneMask) ? boneMasks[node.boneMask].data() : nullptr;
+    for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+    {
+      float boneWeight = std::min(1.0f, (mask != nullptr) ? weight * mask[boneIndex] : weight);
+      if (boneWeight <= 0.0f)
+        continue;
+      pose.positions[boneIndex] = glm::mix(pose.positions[boneIndex], layer.positions[boneIndex], boneWeight);
+      pose.rotations[boneIndex] = glm::slerp(pose.rotations[boneIndex], layer.rotations[boneIndex], boneWeight);
+      pose.scales[boneIndex]    = glm::mix(pose.scales[boneIndex], layer.scales[boneIndex], boneWeight);
+    }
+    break;
+  }
+  case Node::Additive:
+  {
+    evaluateNode(node.inputs[0], parameters, cursors, workspace, firstPose, pose);
+    float weight = parameters[node.parameter];
+    if (weight == 0.0f)
+      break;
+    SkeletonPose& additive  = workspace.poses[firstPose];
+    SkeletonPose& reference = workspace.poses[firstPose + 1];
+    evaluateNode(node.inputs[1], parameters, cursors, workspace, firstPose + 2, additive);
+    evaluateNode(node.inputs[2], parameters, cursors, workspace, firstPose + 2, reference);
+    const float* mask = (node.boneMask != noBoneMask) ? boneMasks[node.boneMask].data() : nullptr;
+    for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+    {
+      float boneWeight = (mask != nullptr) ? weight * mask[boneIndex] : weight;
+      if (boneWeight == 0.0f)
+        continue;
+      glm::quat deltaRotation = glm::inverse(reference.rotations[boneIndex]) * additive.rotations[boneIndex];
+      glm::vec3 deltaScale    = additive.scales[boneIndex] / glm::max(reference.scales[boneIndex], glm::vec3(1e-6f));
+      pose.positions[boneIndex] += (additive.positions[boneIndex] - reference.positions[boneIndex]) * boneWeight;
+      pose.rotations[boneIndex] =  pose.rotations[boneIndex] * glm::slerp(glm::quat(), deltaRotation, boneWeight);
+      pose.scales[boneIndex]    *= glm::mix(glm::vec3(1.0f), deltaScale, boneWeight);
+    }
+    break;
+  }
+  }
+}
+
+void BlendTree::sampleClip(const Clip& clip, float time, AnimationCursor* cursor, SkeletonPose& pose) const
+{
+  const Animation& animation = *clip.animation;
+  if (cursor != nullptr && cursor->channels.size() != animation.channels.size())
+    cursor->reset(animation);
+  for (uint32_t boneIndex = 0; boneIndex < clip.boneChannels.size(); ++boneIndex)
+  {
+    uint32_t channelIndex = clip.boneChannels[boneIndex];
+    if (channelIndex == std::numeric_limits<uint32_t>::max())
+    {
+      pose.positions[boneIndex] = bindPose.positions[boneIndex];
+      pose.rotations[boneIndex] = bindPose.rotations[boneIndex];
+      pose.scales[boneIndex]    = bindPose.scales[boneIndex];
+      continue;
+    }
+    const Animation::Channel&       channel       = animation.channels[channelIndex];
+    Animation::Channel::State       before        = animation.channelBefore[channelIndex];
+    Animation::Channel::State       after         = animation.channelAfter[channelIndex];
+    AnimationCursor::ChannelCursor* channelCursor = (cursor != nullptr) ? &cursor->channels[channelIndex] : nullptr;
+
+    pose.positions[boneIndex] = sampleVector(channel.position, calculateAnimationTime(time, channel.positionTimeBegin, channel.positionTimeEnd, before, after), (channelCursor != nullptr) ? &channelCursor->position : nullptr, glm::vec3(0.0f));
+    pose.rotations[boneIndex] = sampleRotation(channel.rotation, calculateAnimationTime(time, channel.rotationTimeBegin, channel.rotationTimeEnd, before, after), (channelCursor != nullptr) ? &channelCursor->rotation : nullptr);
+    pose.scales[boneIndex]    = sampleVector(channel.scale,    calculateAnimationTime(time, channel.scaleTimeBegin,    channel.scaleTimeEnd,    before, after), (channelCursor != nullptr) ? &channelCursor->scale : nullptr, glm::vec3(1.0f));
+  }
+}
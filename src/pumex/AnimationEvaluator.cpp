@@ -0,0 +1,435 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/AnimationEvaluator.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <pumex/utils/Log.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+  #define PUMEX_ANIMATION_EVALUATOR_SSE
+  #include <emmintrin.h>
+#endif
+
+using namespace pumex;
+
+namespace
+{
+
+// Float4 stores one value for each instance of a batch. Masks returned by comparisons may only be used by select()
+#if defined(PUMEX_ANIMATION_EVALUATOR_SSE)
+struct Float4
+{
+  __m128 v;
+};
+
+inline Float4 set1(float a)                           { return Float4{ _mm_set1_ps(a) }; }
+inline Float4 load(const float* a)                    { return Float4{ _mm_load_ps(a) }; }
+inline void   storeu(float* a, const Float4& b)       { _mm_storeu_ps(a, b.v); }
+inline Float4 operator+(const Float4& a, const Float4& b) { return Float4{ _mm_add_ps(a.v, b.v) }; }
+inline Float4 operator-(const Float4& a, const Float4& b) { return Float4{ _mm_sub_ps(a.v, b.v) }; }
+inline Float4 operator*(const Float4& a, const Float4& b) { return Float4{ _mm_mul_ps(a.v, b.v) }; }
+inline Float4 operator/(const Float4& a, const Float4& b) { return Float4{ _mm_div_ps(a.v, b.v) }; }
+inline Float4 sqrt(const Float4& a)                   { return Float4{ _mm_sqrt_ps(a.v) }; }
+inline Float4 lessThan(const Float4& a, const Float4& b)    { return Float4{ _mm_cmplt_ps(a.v, b.v) }; }
+inline Float4 greaterThan(const Float4& a, const Float4& b) { return Float4{ _mm_cmpgt_ps(a.v, b.v) }; }
+// for each lane : mask ? b : a
+inline Float4 select(const Float4& a, const Float4& b, const Float4& mask) { return Float4{ _mm_or_ps(_mm_and_ps(mask.v, b.v), _mm_andnot_ps(mask.v, a.v)) }; }
+inline void   transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3)   { _MM_TRANSPOSE4_PS(r0.v, r1.v, r2.v, r3.v); }
+#else
+struct Float4
+{
+  float v[4];
+};
+
+inline Float4 set1(float a)                           { return Float4{ { a, a, a, a } }; }
+inline Float4 load(const float* a)                    { return Float4{ { a[0], a[1], a[2], a[3] } }; }
+inline void   storeu(float* a, const Float4& b)       { std::copy(b.v, b.v + 4, a); }
+inline Float4 operator+(const Float4& a, const Float4& b) { return Float4{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+inline Float4 operator-(const Float4& a, const Float4& b) { return Float4{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+inline Float4 operator*(const Float4& a, const Float4& b) { return Float4{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+inline Float4 operator/(const Float4& a, const Float4& b) { return Float4{ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+inline Float4 sqrt(const Float4& a)                   { return Float4{ { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } }; }
+inline Float4 lessThan(const Float4& a, const Float4& b)    { return Float4{ { a.v[0] < b.v[0] ? 1.0f : 0.0f, a.v[1] < b.v[1] ? 1.0f : 0.0f, a.v[2] < b.v[2] ? 1.0f : 0.0f, a.v[3] < b.v[3] ? 1.0f : 0.0f } }; }
+inline Float4 greaterThan(const Float4& a, const Float4& b) { return lessThan(b, a); }
+// for each lane : mask ? b : a
+inline Float4 select(const Float4& a, const Float4& b, const Float4& mask) { return Float4{ { mask.v[0] != 0.0f ? b.v[0] : a.v[0], mask.v[1] != 0.0f ? b.v[1] : a.v[1], mask.v[2] != 0.0f ? b.v[2] : a.v[2], mask.v[3] != 0.0f ? b.v[3] : a.v[3] } }; }
+inline void   transpose(Float4& r0, Float4& r1, Float4& r2, Float4& r3)
+{
+  std::swap(r0.v[1], r1.v[0]); std::swap(r0.v[2], r2.v[0]); std::swap(r0.v[3], r3.v[0]);
+  std::swap(r1.v[2], r2.v[1]); std::swap(r1.v[3], r3.v[1]); std::swap(r2.v[3], r3.v[2]);
+}
+#endif
+
+// matrix for each instance of a batch. Column major, like glm::mat4 : m[column][row]
+struct Matrix4
+{
+  Float4 m[4][4];
+};
+
+// acos(x) for x in <0,1> ( Abramowitz and Stegun 4.4.46, error < 2e-8 )
+inline Float4 acosPositive(const Float4& x)
+{
+  Float4 p = set1(-0.0012624911f);
+  p = p * x + set1( 0.0066700901f);
+  p = p * x + set1(-0.0170881256f);
+  p = p * x + set1( 0.0308918810f);
+  p = p * x + set1(-0.0501743046f);
+  p = p * x + set1( 0.0889789874f);
+  p = p * x + set1(-0.2145988016f);
+  p = p * x + set1( 1.5707963050f);
+  return sqrt(set1(1.0f) - x) * p;
+}
+
+// sin(x) for x in <0,pi/2> ( Taylor series, error < 6e-8 )
+inline Float4 sinHalfPi(const Float4& x)
+{
+  Float4 x2 = x * x;
+  Float4 p  = set1(-1.0f / 39916800.0f);
+  p = p * x2 + set1( 1.0f / 362880.0f);
+  p = p * x2 + set1(-1.0f / 5040.0f);
+  p = p * x2 + set1( 1.0f / 120.0f);
+  p = p * x2 + set1(-1.0f / 6.0f);
+  p = p * x2 + set1( 1.0f);
+  return p * x;
+}
+
+// the same as glm::mix() : a * (1 - t) + b * t
+inline Float4 mix(const Float4& a, const Float4& b, const Float4& t)
+{
+  return a * (set1(1.0f) - t) + b * t;
+}
+
+// the same as glm::slerp() : interpolation takes the shortest path, almost identical quaternions are interpolated linearly
+inline void slerp(const Float4* q0, const Float4* q1, const Float4& t, Float4* result)
+{
+  Float4 zero     = set1(0.0f);
+  Float4 one      = set1(1.0f);
+  Float4 cosTheta = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+  Float4 negative = lessThan(cosTheta, zero);
+  Float4 sign     = select(one, set1(-1.0f), negative);
+  cosTheta        = cosTheta * sign;
+
+  Float4 linear   = greaterThan(cosTheta, set1(1.0f - std::numeric_limits<float>::epsilon()));
+  Float4 angle    = acosPositive(cosTheta);
+  Float4 sinAngle = sinHalfPi(angle);
+  Float4 w0       = select(sinHalfPi((one - t) * angle) / sinAngle, one - t, linear);
+  Float4 w1       = select(sinHalfPi(t * angle) / sinAngle, t, linear) * sign;
+  for (uint32_t i = 0; i < 4; ++i)
+    result[i] = q0[i] * w0 + q1[i] * w1;
+}
+
+// given time belongs to <times[index]..times[index+1])
+inline uint32_t binarySearchIndex(const float* times, uint32_t size, float time)
+{
+  uint32_t begin = 0;
+  uint32_t end   = size;
+  uint32_t mid   = (end + begin) >> 1;
+  while (mid != begin)
+  {
+    if (times[mid] > time)
+      end = mid;
+    else
+      begin = mid;
+    mid = (end + begin) >> 1;
+  }
+  return begin;
+}
+
+// the same as pumex::cursorSearchIndex()
+inline uint32_t cursorSearchIndex(const float* times, uint32_t size, float time, uint32_t& cursor)
+{
+  uint32_t index = cursor;
+  if (index >= size || times[index] > time)
+    return cursor = binarySearchIndex(times, size, time);
+  for (uint32_t step = 0; index + 1 < size && times[index + 1] <= time; ++step, ++index)
+  {
+    if (step == cursorMaxSteps)
+      return cursor = index + binarySearchIndex(times + index, size - index, time);
+  }
+  return cursor = index;
+}
+
+typedef uint32_t AnimationCursor::ChannelCursor::* TrackCursor;
+
+// finds keyframes surrounding animation time of each instance and gathers their values into SoA registers
+void gatherKeys(const AnimationEvaluator::Track& track, const float* times, AnimationCursor::ChannelCursor* const* cursors, TrackCursor trackCursor, Animation::Channel::State before, Animation::Channel::State after, uint32_t valueSize, Float4* values0, Float4* values1, Float4& fraction)
+{
+  alignas(16) float v0[4][AnimationEvaluator::batchSize];
+  alignas(16) float v1[4][AnimationEvaluator::batchSize];
+  alignas(16) float f[AnimationEvaluator::batchSize];
+  uint32_t size = static_cast<uint32_t>(track.times.size());
+  for (uint32_t lane = 0; lane < AnimationEvaluator::batchSize; ++lane)
+  {
+    float time  = calculateAnimationTime(times[lane], track.beginTime, track.endTime, before, after);
+    uint32_t i0 = (cursors[lane] != nullptr) ? cursorSearchIndex(track.times.data(), size, time, cursors[lane]->*trackCursor) : binarySearchIndex(track.times.data(), size, time);
+    uint32_t i1 = (i0 + 1) % size;
+    // tracks with one keyframe have zero length
+    float span  = track.times[i1] - track.times[i0];
+    f[lane]     = (span != 0.0f) ? (time - track.times[i0]) / span : 0.0f;
+    for (uint32_t i = 0; i < valueSize; ++i)
+    {
+      v0[i][lane] = track.values[i][i0];
+      v1[i][lane] = track.values[i][i1];
+    }
+  }
+  for (uint32_t i = 0; i < valueSize; ++i)
+  {
+    values0[i] = load(v0[i]);
+    values1[i] = load(v1[i]);
+  }
+  fraction = load(f);
+}
+
+// the same as glm::scale(glm::translate(mat4unity, translation) * glm::mat4_cast(rotation), scale)
+void calculateLocalTransform(const AnimationEvaluator::ChannelTracks& channel, const float* times, AnimationCursor::ChannelCursor* const* cursors, Matrix4& result)
+{
+  Float4 zero = set1(0.0f);
+  Float4 one  = set1(1.0f);
+  Float4 two  = set1(2.0f);
+  Float4 values0[4], values1[4], fraction;
+
+  Float4 t[3] = { zero, zero, zero };
+  if (!channel.position.times.empty())
+  {
+    gatherKeys(channel.position, times, cursors, &AnimationCursor::ChannelCursor::position, channel.before, channel.after, 3, values0, values1, fraction);
+    for (uint32_t i = 0; i < 3; ++i)
+      t[i] = mix(values0[i], values1[i], fraction);
+  }
+  Float4 s[3] = { one, one, one };
+  if (!channel.scale.times.empty())
+  {
+    gatherKeys(channel.scale, times, cursors, &AnimationCursor::ChannelCursor::scale, channel.before, channel.after, 3, values0, values1, fraction);
+    for (uint32_t i = 0; i < 3; ++i)
+      s[i] = mix(values0[i], values1[i], fraction);
+  }
+  // quaternion coordinates are stored in x, y, z, w order
+  Float4 q[4] = { zero, zero, zero, one };
+  if (!channel.rotation.times.empty())
+  {
+    gatherKeys(channel.rotation, times, cursors, &AnimationCursor::ChannelCursor::rotation, channel.before, channel.after, 4, values0, values1, fraction);
+    slerp(values0, values1, fraction, q);
+  }
+
+  Float4 xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+  Float4 xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+  Float4 wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+
+  result.m[0][0] = (one - two * (yy + zz)) * s[0];
+  result.m[0][1] = two * (xy + wz) * s[0];
+  result.m[0][2] = two * (xz - wy) * s[0];
+  result.m[0][3] = zero;
+  result.m[1][0] = two * (xy - wz) * s[1];
+  result.m[1][1] = (one - two * (xx + zz)) * s[1];
+  result.m[1][2] = two * (yz + wx) * s[1];
+  result.m[1][3] = zero;
+  result.m[2][0] = two * (xz + wy) * s[2];
+  result.m[2][1] = two * (yz - wx) * s[2];
+  result.m[2][2] = (one - two * (xx + yy)) * s[2];
+  result.m[2][3] = zero;
+  result.m[3][0] = t[0];
+  result.m[3][1] = t[1];
+  result.m[3][2] = t[2];
+  result.m[3][3] = one;
+}
+
+void broadcast(const glm::mat4& a, Matrix4& result)
+{
+  for (uint32_t c = 0; c < 4; ++c)
+    for (uint32_t r = 0; r < 4; ++r)
+      result.m[c][r] = set1(a[c][r]);
+}
+
+// result = a * b
+void multiply(const Matrix4& a, const Matrix4& b, Matrix4& result)
+{
+  for (uint32_t c = 0; c < 4; ++c)
+    for (uint32_t r = 0; r < 4; ++r)
+      result.m[c][r] = a.m[0][r] * b.m[c][0] + a.m[1][r] * b.m[c][1] + a.m[2][r] * b.m[c][2] + a.m[3][r] * b.m[c][3];
+}
+
+void multiply(const glm::mat4& a, const Matrix4& b, Matrix4& result)
+{
+  for (uint32_t c = 0; c < 4; ++c)
+    for (uint32_t r = 0; r < 4; ++r)
+      result.m[c][r] = set1(a[0][r]) * b.m[c][0] + set1(a[1][r]) * b.m[c][1] + set1(a[2][r]) * b.m[c][2] + set1(a[3][r]) * b.m[c][3];
+}
+
+void multiply(const Matrix4& a, const glm::mat4& b, Matrix4& result)
+{
+  for (uint32_t c = 0; c < 4; ++c)
+    for (uint32_t r = 0; r < 4; ++r)
+      result.m[c][r] = a.m[0][r] * set1(b[c][0]) + a.m[1][r] * set1(b[c][1]) + a.m[2][r] * set1(b[c][2]) + a.m[3][r] * set1(b[c][3]);
+}
+
+// writes matrix of each instance of a batch into boneMatrices[instance][boneIndex]
+void store(const Matrix4& a, glm::mat4* const* boneMatrices, uint32_t boneIndex, uint32_t laneCount)
+{
+  for (uint32_t c = 0; c < 4; ++c)
+  {
+    Float4 lanes[4] = { a.m[c][0], a.m[c][1], a.m[c][2], a.m[c][3] };
+    transpose(lanes[0], lanes[1], lanes[2], lanes[3]);
+    for (uint32_t lane = 0; lane < laneCount; ++lane)
+      storeu(&boneMatrices[lane][boneIndex][c][0], lanes[lane]);
+  }
+}
+
+AnimationEvaluator::Track createTrack(const std::vector<TimeLine<glm::vec3>>& timeLine)
+{
+  AnimationEvaluator::Track track;
+  track.beginTime = tBeginTime(timeLine);
+  track.endTime   = tEndTime(timeLine);
+  for (const auto& key : timeLine)
+  {
+    track.times.push_back(key.time);
+    for (uint32_t i = 0; i < 3; ++i)
+      track.values[i].push_back(key.value[i]);
+  }
+  return track;
+}
+
+AnimationEvaluator::Track createTrack(const std::vector<TimeLine<glm::quat>>& timeLine)
+{
+  AnimationEvaluator::Track track;
+  track.beginTime = tBeginTime(timeLine);
+  track.endTime   = tEndTime(timeLine);
+  for (const auto& key : timeLine)
+  {
+    track.times.push_back(key.time);
+    track.values[0].push_back(key.value.x);
+    track.values[1].push_back(key.value.y);
+    track.values[2].push_back(key.value.z);
+    track.values[3].push_back(key.value.w);
+  }
+  return track;
+}
+
+// Matrix4 may require stricter alignment than operator new guarantees ( e.g. __m128 on 32-bit platforms ), so matrices are placed manually in workspace memory
+Matrix4* getGlobalTransforms(AnimationEvaluatorWorkspace& workspace, uint32_t boneCount)
+{
+  size_t size = boneCount * sizeof(Matrix4);
+  if (workspace.storage.size() < size + alignof(Matrix4))
+    workspace.storage.resize(size + alignof(Matrix4));
+  void*  pointer = workspace.storage.data();
+  size_t space   = workspace.storage.size();
+  return static_cast<Matrix4*>(std::align(alignof(Matrix4), size, pointer, space));
+}
+
+}
+
+const uint32_t AnimationEvaluator::batchSize;
+
+AnimationEvaluator::AnimationEvaluator(const Skeleton& skeleton, const Animation& animation)
+  : AnimationEvaluator(SkeletonAnimationBinding(skeleton, animation))
+{
+}
+
+AnimationEvaluator::AnimationEvaluator(const SkeletonAnimationBinding& binding)
+  : invGlobalTransform{ binding.getSkeleton().invGlobalTransform }
+{
+  const Skeleton&  skeleton  = binding.getSkeleton();
+  const Animation& animation = binding.getAnimation();
+  CHECK_LOG_THROW(skeleton.bones.empty(), "AnimationEvaluator : skeleton has no bones");
+  CHECK_LOG_THROW(animation.channelBefore.size() != animation.channels.size() || animation.channelAfter.size() != animation.channels.size(), "AnimationEvaluator : wrong channel state count in animation " << animation.name);
+
+  for (uint32_t i = 0; i < animation.channels.size(); ++i)
+  {
+    ChannelTracks channel;
+    channel.position = createTrack(animation.channels[i].position);
+    channel.rotation = createTrack(animation.channels[i].rotation);
+    channel.scale    = createTrack(animation.channels[i].scale);
+    channel.before   = animation.channelBefore[i];
+    channel.after    = animation.channelAfter[i];
+    channels.push_back(channel);
+  }
+
+  for (uint32_t i = 0; i < skeleton.bones.size(); ++i)
+  {
+    boneChannels.push_back(binding.getBoneChannel(i));
+    boneParents.push_back(skeleton.bones[i].parentIndex);
+    boneLocalTransformations.push_back(skeleton.bones[i].localTransformation);
+    boneOffsetMatrices.push_back(skeleton.bones[i].offsetMatrix);
+    CHECK_LOG_THROW(i > 0 && boneParents[i] >= i, "AnimationEvaluator : parent of bone " << i << " must be defined before its children");
+  }
+}
+
+void AnimationEvaluator::evaluate(const float* times, glm::mat4* const* boneMatrices, uint32_t instanceCount) const
+{
+  evaluate(times, nullptr, boneMatrices, instanceCount);
+}
+
+void AnimationEvaluator::evaluate(const float* times, glm::mat4* const* boneMatrices, uint32_t instanceCount, AnimationEvaluatorWorkspace& workspace) const
+{
+  evaluate(times, nullptr, boneMatrices, instanceCount, workspace);
+}
+
+void AnimationEvaluator::evaluate(const float* times, AnimationCursor* const* cursors, glm::mat4* const* boneMatrices, uint32_t instanceCount) const
+{
+  thread_local AnimationEvaluatorWorkspace workspace;
+  evaluate(times, cursors, boneMatrices, instanceCount, workspace);
+}
+
+void AnimationEvaluator::evaluate(const float* times, AnimationCursor* const* cursors, glm::mat4* const* boneMatrices, uint32_t instanceCount, AnimationEvaluatorWorkspace& workspace) const
+{
+  uint32_t boneCount = getBoneCount();
+  // global transforms of all bones of a batch are kept, because children need transforms of their parents
+  Matrix4* globalTransforms = getGlobalTransforms(workspace, boneCount);
+  Matrix4 localTransform, boneMatrix;
+  alignas(16) float laneTimes[batchSize];
+  AnimationCursor*                laneCursors[batchSize];
+  AnimationCursor::ChannelCursor* channelCursors[batchSize];
+
+  for (uint32_t firstInstance = 0; firstInstance < instanceCount; firstInstance += batchSize)
+  {
+    // last batch may be incomplete : missing lanes are calculated for the last instance, but they are not stored
+    uint32_t laneCount = std::min(batchSize, instanceCount - firstInstance);
+    for (uint32_t lane = 0; lane < batchSize; ++lane)
+    {
+      laneTimes[lane]   = times[firstInstance + std::min(lane, laneCount - 1)];
+      laneCursors[lane] = (cursors != nullptr) ? cursors[firstInstance + std::min(lane, laneCount - 1)] : nullptr;
+      if (laneCursors[lane] != nullptr && laneCursors[lane]->channels.size() != channels.size())
+        laneCursors[lane]->channels.assign(channels.size(), AnimationCursor::ChannelCursor());
+    }
+
+    // local transform, propagation through hierarchy and offset matrix are applied to a bone in one pass
+    for (uint32_t boneIndex = 0; boneIndex < boneCount; ++boneIndex)
+    {
+      uint32_t channelIndex = boneChannels[boneIndex];
+      if (channelIndex == std::numeric_limits<uint32_t>::max())
+        broadcast(boneLocalTransformations[boneIndex], localTransform);
+      else
+      {
+        for (uint32_t lane = 0; lane < batchSize; ++lane)
+          channelCursors[lane] = (laneCursors[lane] != nullptr) ? &laneCursors[lane]->channels[channelIndex] : nullptr;
+        calculateLocalTransform(channels[channelIndex], laneTimes, channelCursors, localTransform);
+      }
+
+      if (boneIndex == 0)
+        multiply(invGlobalTransform, localTransform, globalTransforms[0]);
+      else
+        multiply(globalTransforms[boneParents[boneIndex]], localTransform, globalTransforms[boneIndex]);
+      multiply(globalTransforms[boneIndex], boneOffsetMatrices[boneIndex], boneMatrix);
+      store(boneMatrix, boneMatrices + firstInstance, boneIndex, laneCount);
+    }
+  }
+}
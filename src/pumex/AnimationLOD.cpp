@@ -0,0 +1,148 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/AnimationLOD.h>
+#include <algorithm>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+namespace pumex
+{
+
+std::vector<float> calculateBoneWeights(const Skeleton& skeleton, const Asset& asset)
+{
+  // asset bones may be ordered differently than skeleton bones
+  std::vector<uint32_t> boneMapping(asset.skeleton.bones.size(), std::numeric_limits<uint32_t>::max());
+  for (uint32_t i = 0; i < boneMapping.size(); ++i)
+  {
+    if (i < asset.skeleton.boneNames.size())
+    {
+      auto it = skeleton.invBoneNames.find(asset.skeleton.boneNames[i]);
+      if (it != end(skeleton.invBoneNames))
+        boneMapping[i] = static_cast<uint32_t>(it->second);
+    }
+    else if (i < skeleton.bones.size())
+      boneMapping[i] = i;
+  }
+
+  std::vector<float> boneWeights(skeleton.bones.size(), 0.0f);
+  float weightSum = 0.0f;
+  for (const auto& geometry : asset.geometries)
+  {
+    uint32_t offset = 0, boneWeightOffset = std::numeric_limits<uint32_t>::max(), boneIndexOffset = std::numeric_limits<uint32_t>::max(), boneWeightSize = 0, boneIndexSize = 0;
+    for (VertexSemantic s : geometry.semantic)
+    {
+      if (s.type == VertexSemantic::BoneWeight)
+      {
+        boneWeightOffset = offset;
+        boneWeightSize   = s.size;
+      }
+      if (s.type == VertexSemantic::BoneIndex)
+      {
+        boneIndexOffset = offset;
+        boneIndexSize   = s.size;
+      }
+      offset += s.size;
+    }
+    if (boneWeightOffset == std::numeric_limits<uint32_t>::max() || boneIndexOffset == std::numeric_limits<uint32_t>::max())
+      continue;
+    uint32_t vertexSize = calcVertexSize(geometry.semantic);
+    uint32_t boneCount  = std::min(boneWeightSize, boneIndexSize);
+    for (size_t i = 0; i + vertexSize <= geometry.vertices.size(); i += vertexSize)
+    {
+      for (uint32_t j = 0; j < boneCount; ++j)
+      {
+        float    weight    = geometry.vertices[i + boneWeightOffset + j];
+        uint32_t boneIndex = static_cast<uint32_t>(geometry.vertices[i + boneIndexOffset + j]);
+        if (weight <= 0.0f || boneIndex >= boneMapping.size() || boneMapping[boneIndex] == std::numeric_limits<uint32_t>::max())
+          continue;
+        boneWeights[boneMapping[boneIndex]] += weight;
+        weightSum                           += weight;
+      }
+    }
+  }
+  if (weightSum > 0.0f)
+    for (auto& w : boneWeights)
+      w /= weightSum;
+  return boneWeights;
+}
+
+std::vector<bool> calculateAnimatedBones(const Skeleton& skeleton, const std::vector<float>& boneWeights, float weightThreshold)
+{
+  CHECK_LOG_THROW(boneWeights.size() != skeleton.bones.size(), "calculateAnimatedBones() : wrong size of bone weights vector");
+  std::vector<bool> animatedBones(skeleton.bones.size(), false);
+  if (animatedBones.empty())
+    return animatedBones;
+  // children are defined after their parents, so walking backwards visits all children before their parent
+  for (uint32_t boneIndex = animatedBones.size() - 1; boneIndex > 0; --boneIndex)
+  {
+    if (boneWeights[boneIndex] >= weightThreshold)
+      animatedBones[boneIndex] = true;
+    uint32_t parentIndex = skeleton.bones[boneIndex].parentIndex;
+    if (animatedBones[boneIndex] && parentIndex < animatedBones.size())
+      animatedBones[parentIndex] = true;
+  }
+  animatedBones[0] = true;
+  return animatedBones;
+}
+
+SkeletonAnimationBinding createLodBinding(const Skeleton& skeleton, const Animation& animation, const Asset& lodAsset, const AnimationLodPolicy& policy)
+{
+  if (policy.leafWeightThreshold <= 0.0f)
+    return SkeletonAnimationBinding(skeleton, animation);
+  return SkeletonAnimationBinding(skeleton, animation, calculateAnimatedBones(skeleton, calculateBoneWeights(skeleton, lodAsset), policy.leafWeightThreshold));
+}
+
+}
+
+AnimationLodScheduler::AnimationLodScheduler(const std::vector<AnimationLodPolicy>& p)
+{
+  setPolicies(p);
+}
+
+void AnimationLodScheduler::setPolicies(const std::vector<AnimationLodPolicy>& p)
+{
+  policies = p;
+  if (policies.empty())
+    policies.push_back(AnimationLodPolicy());
+  for (auto& policy : policies)
+    policy.updateInterval = std::max(policy.updateInterval, 1U);
+}
+
+void AnimationLodScheduler::reset(uint32_t instanceCount)
+{
+  lastUpdate.assign(instanceCount, std::numeric_limits<uint64_t>::max());
+}
+
+bool AnimationLodScheduler::update(uint32_t instanceIndex, uint32_t lodID, uint64_t frameNumber)
+{
+  CHECK_LOG_THROW(instanceIndex >= lastUpdate.size(), "AnimationLodScheduler::update() : instance index out of bounds");
+  if (lodID == std::numeric_limits<uint32_t>::max())
+    return false;
+  uint64_t updateInterval = getPolicy(lodID).updateInterval;
+  uint64_t& last          = lastUpdate[instanceIndex];
+  if (last != std::numeric_limits<uint64_t>::max() && frameNumber >= last && frameNumber - last < updateInterval && (frameNumber + instanceIndex) % updateInterval != 0)
+    return false;
+  last = frameNumber;
+  return true;
+}
@@ -315,6 +315,15 @@ glm::mat4 Animation::Channel::calculateTransform(float time, Channel::State befo
   return glm::scale(glm::translate(mat4unity, vTranslation) * glm::mat4_cast(qRotation), vScale);
 }
 
+glm::mat4 Animation::Channel::calculateTransform(float time, Channel::State before, Channel::State after, AnimationCursor::ChannelCursor& cursor) const
+{
+  glm::vec3 vScale       = scale.empty()    ? glm::vec3(1,1,1) : mix(scale.data(), scale.size(), calculateAnimationTime(time, scaleTimeBegin, scaleTimeEnd,  before, after), cursor.scale);
+  glm::quat qRotation    = rotation.empty() ? glm::quat()      : slerp(rotation.data(), rotation.size(), calculateAnimationTime(time, rotationTimeBegin, rotationTimeEnd, before, after), cursor.rotation);
+  glm::vec3 vTranslation = position.empty() ? glm::vec3(0,0,0) : mix(position.data(), position.size(), calculateAnimationTime(time, positionTimeBegin, positionTimeEnd, before, after), cursor.position);
+
+  return glm::scale(glm::translate(mat4unity, vTranslation) * glm::mat4_cast(qRotation), vScale);
+}
+
 void Animation::calculateLocalTransforms(float time, glm::mat4* data, uint32_t size) const
 {
   CHECK_LOG_THROW(size != channels.size(), "Wrong channel count");
@@ -322,6 +331,57 @@ void Animation::calculateLocalTransforms(float time, glm::mat4* data, uint32_t s
     *data = channels[i].calculateTransform(time, channelBefore[i], channelAfter[i]);
 }
 
+void Animation::calculateLocalTransforms(float time, glm::mat4* data, uint32_t size, AnimationCursor& cursor) const
+{
+  CHECK_LOG_THROW(size != channels.size(), "Wrong channel count");
+  if (cursor.channels.size() != channels.size())
+    cursor.reset(*this);
+  for (uint32_t i = 0; i < channels.size(); ++i, ++data)
+    *data = channels[i].calculateTransform(time, channelBefore[i], channelAfter[i], cursor.channels[i]);
+}
+
+SkeletonAnimationBinding::SkeletonAnimationBinding(const Skeleton& s, const Animation& a)
+  : skeleton{ s }, animation{ a }
+{
+  boneChannels.resize(skeleton.bones.size(), std::numeric_limits<uint32_t>::max());
+  for (uint32_t boneIndex = 0; boneIndex < skeleton.bones.size() && boneIndex < skeleton.boneNames.size(); ++boneIndex)
+  {
+    auto it = animation.invChannelNames.find(skeleton.boneNames[boneIndex]);
+    if (it != end(animation.invChannelNames))
+      boneChannels[boneIndex] = static_cast<uint32_t>(it->second);
+  }
+}
+
+SkeletonAnimationBinding::SkeletonAnimationBinding(const Skeleton& s, const Animation& a, const std::vector<bool>& animatedBones)
+  : SkeletonAnimationBinding(s, a)
+{
+  CHECK_LOG_THROW(animatedBones.size() != boneChannels.size(), "SkeletonAnimationBinding : wrong size of animated bones vector");
+  for (uint32_t boneIndex = 0; boneIndex < boneChannels.size(); ++boneIndex)
+    if (!animatedBones[boneIndex])
+      boneChannels[boneIndex] = std::numeric_limits<uint32_t>::max();
+}
+
+void SkeletonAnimationBinding::calculateBoneMatrices(const glm::mat4* localTransforms, glm::mat4* globalTransforms, glm::mat4* boneMatrices) const
+{
+  uint32_t numSkelBones = getBoneCount();
+  if (numSkelBones == 0)
+    return;
+  uint32_t bcVal = boneChannels[0];
+  globalTransforms[0] = skeleton.invGlobalTransform * ((bcVal == std::numeric_limits<uint32_t>::max()) ? skeleton.bones[0].localTransformation : localTransforms[bcVal]);
+  for (uint32_t boneIndex = 1; boneIndex < numSkelBones; ++boneIndex)
+  {
+    bcVal = boneChannels[boneIndex];
+    globalTransforms[boneIndex] = globalTransforms[skeleton.bones[boneIndex].parentIndex] * ((bcVal == std::numeric_limits<uint32_t>::max()) ? skeleton.bones[boneIndex].localTransformation : localTransforms[bcVal]);
+  }
+  for (uint32_t boneIndex = 0; boneIndex < numSkelBones; ++boneIndex)
+    boneMatrices[boneIndex] = globalTransforms[boneIndex] * skeleton.bones[boneIndex].offsetMatrix;
+}
+
+void AnimationCursor::reset(const Animation& animation)
+{
+  channels.assign(animation.channels.size(), ChannelCursor());
+}
+
 void Geometry::pushVertex(const VertexAccumulator& vertexAccumulator)
 {
   vertices.insert(end(vertices), cbegin(vertexAccumulator.values), cend(vertexAccumulator.values));
@@ -346,21 +406,15 @@ glm::vec4 Material::getProperty(const std::string& name, glm::vec4 defaultValue)
     return defaultValue;
 }
 
-void copyAndConvertVertices(std::vector<float>& targetBuffer, const std::vector<VertexSemantic>& targetSemantic, const std::vector<float>& sourceBuffer, const std::vector<VertexSemantic>& sourceSemantic)
+VertexConversion::VertexConversion(const std::vector<VertexSemantic>& targetSemantic, const std::vector<VertexSemantic>& sourceSemantic)
+  : targetVertexSize{ calcVertexSize(targetSemantic) }, sourceVertexSize{ calcVertexSize(sourceSemantic) }, sameSemantic{ targetSemantic == sourceSemantic }
 {
   // check if semantics are the same ( fast path )
-  if (targetSemantic == sourceSemantic)
-  {
-    std::copy(begin(sourceBuffer), end(sourceBuffer), std::back_inserter(targetBuffer));
+  if (sameSemantic)
     return;
-  }
-  // semantics are different - we need to do remapping
-  std::vector<float>    defaultValues( calcVertexSize(targetSemantic) );
-  std::vector<float>    targetValues( calcVertexSize(targetSemantic) );
-  std::vector<uint32_t> sourceValuesIndex( calcVertexSize(targetSemantic) );
 
   // setup default values
-  std::fill(begin(defaultValues), end(defaultValues), 0.0f);
+  defaultValues.resize(targetVertexSize, 0.0f);
   uint32_t offset=0;
   for (const auto& t : targetSemantic)
   {
@@ -394,8 +448,6 @@ void copyAndConvertVertices(std::vector<float>& targetBuffer, const std::vector<
 
   // setup remapping
   offset = 0;
-
-  std::fill(begin(sourceValuesIndex), end(sourceValuesIndex), std::numeric_limits<uint32_t>::max());
   uint32_t currentTargetColor    = 0;
   uint32_t currentTargetTexCoord = 0;
   for (const auto& t : targetSemantic)
@@ -426,25 +478,39 @@ void copyAndConvertVertices(std::vector<float>& targetBuffer, const std::vector<
     }
     if (i<sourceSemantic.size())
     {
-      for (uint32_t j = 0; j<t.size && j<sourceSemantic[i].size; ++j)
-      {
-        sourceValuesIndex[offset+j] = sourceOffset+j;
-      }
+      Span span{ offset, sourceOffset, std::min(t.size, sourceSemantic[i].size) };
+      // join spans that are contiguous both in source and in target
+      if (!spans.empty() && spans.back().targetOffset + spans.back().size == span.targetOffset && spans.back().sourceOffset + spans.back().size == span.sourceOffset)
+        spans.back().size += span.size;
+      else if (span.size > 0)
+        spans.push_back(span);
     }
-
     offset += t.size;
   }
-  uint32_t sourceVertexSize = calcVertexSize(sourceSemantic);
-  for (uint32_t i = 0; i < sourceBuffer.size(); i += sourceVertexSize)
+}
+
+void VertexConversion::convert(float* target, const float* source, size_t vertexCount) const
+{
+  if (sameSemantic)
   {
-    targetValues = defaultValues;
-    for (uint32_t j = 0; j<sourceValuesIndex.size(); ++j)
-    {
-      if (sourceValuesIndex[j] != std::numeric_limits<uint32_t>::max())
-        targetValues[j] = sourceBuffer[i + sourceValuesIndex[j]];
-    }
-    std::copy(begin(targetValues), end(targetValues), std::back_inserter(targetBuffer));
+    std::copy(source, source + vertexCount * sourceVertexSize, target);
+    return;
   }
+  for (size_t i = 0; i < vertexCount; ++i, target += targetVertexSize, source += sourceVertexSize)
+  {
+    std::copy(begin(defaultValues), end(defaultValues), target);
+    for (const auto& span : spans)
+      std::copy(source + span.sourceOffset, source + span.sourceOffset + span.size, target + span.targetOffset);
+  }
+}
+
+void copyAndConvertVertices(std::vector<float>& targetBuffer, const std::vector<VertexSemantic>& targetSemantic, const std::vector<float>& sourceBuffer, const std::vector<VertexSemantic>& sourceSemantic)
+{
+  VertexConversion conversion(targetSemantic, sourceSemantic);
+  size_t vertexCount = conversion.getSourceVertexCount(sourceBuffer.size());
+  size_t targetFirst = targetBuffer.size();
+  targetBuffer.resize(targetFirst + vertexCount * conversion.getTargetVertexSize());
+  conversion.convert(targetBuffer.data() + targetFirst, sourceBuffer.data(), vertexCount);
 }
 
 void transformGeometry(const glm::mat4& matrix, Geometry& geometry)
@@ -642,6 +708,7 @@ BoundingBox calculateBoundingBox(const Skeleton& skeleton, const Animation& anim
       timePoints.insert(p.time);
   }
   std::vector<glm::mat4> localTransforms(animation.channels.size());
+  SkeletonAnimationBinding binding(skeleton, animation);
 
   // calculate bones position for each time point. Add it to bbox
   BoundingBox bbox;
@@ -659,10 +726,8 @@ BoundingBox calculateBoundingBox(const Skeleton& skeleton, const Animation& anim
       if (skeleton.bones[boneIndex].boneTag != 1)
         continue;
       glm::mat4 globalParentTransform = std::get<1>(boneData);
-      glm::mat4 localCurrentTransform = skeleton.bones[boneIndex].localTransformation;
-      auto it = animation.invChannelNames.find(skeleton.boneNames[boneIndex]);
-      if (it != end(animation.invChannelNames))
-        localCurrentTransform = localTransforms[it->second];
+      uint32_t  channelIndex          = binding.getBoneChannel(boneIndex);
+      glm::mat4 localCurrentTransform = (channelIndex != std::numeric_limits<uint32_t>::max()) ? localTransforms[channelIndex] : skeleton.bones[boneIndex].localTransformation;
       glm::mat4 globalCurrentTransform = globalParentTransform * localCurrentTransform;
       glm::mat4 targetMatrix = skeleton.invGlobalTransform * globalCurrentTransform;
       glm::vec4 pt = targetMatrix * glm::vec4(0,0,0,1);
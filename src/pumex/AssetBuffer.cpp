@@ -23,6 +23,7 @@
 #include <pumex/AssetBuffer.h>
 #include <set>
 #include <iterator>
+#include <tbb/tbb.h>
 #include <pumex/Device.h>
 #include <pumex/Node.h>
 #include <pumex/PhysicalDevice.h>
@@ -150,12 +151,11 @@ bool AssetBuffer::validate(const RenderContext& renderContext)
 
       VkDeviceSize     verticesSoFar = 0;
       VkDeviceSize     indicesSoFar = 0;
-      rmData.vertices->resize(0);
-      rmData.indices->resize(0);
 
       std::vector<AssetTypeDefinition>     assetTypes = typeDefinitions;
       std::vector<AssetLodDefinition>      assetLods;
       std::vector<AssetGeometryDefinition> assetGeometries;
+      std::vector<const Geometry*>         geometries;
       for (uint32_t t = 0; t < assetTypes.size(); ++t)
       {
         auto typePair = std::equal_range(begin(gd.second), end(gd.second), InternalGeometryDefinition(t, 0, 0, 0, 0), [](const InternalGeometryDefinition& lhs, const InternalGeometryDefinition& rhs) {return lhs.typeID < rhs.typeID; });
@@ -177,12 +177,7 @@ bool AssetBuffer::validate(const RenderContext& renderContext)
               // calculating buffer sizes etc
               verticesSoFar += assets[it->assetIndex]->geometries[it->geometryIndex].getVertexCount();
               indicesSoFar += indexCount;
-
-              // copying vertices to a vertex buffer
-              copyAndConvertVertices(*(rmData.vertices), requiredSemantic, assets[it->assetIndex]->geometries[it->geometryIndex].vertices, assets[it->assetIndex]->geometries[it->geometryIndex].semantic);
-              // copying indices to an index buffer
-              const auto& indices = assets[it->assetIndex]->geometries[it->geometryIndex].indices;
-              std::copy(begin(indices), end(indices), std::back_inserter(*(rmData.indices)));
+              geometries.push_back(&assets[it->assetIndex]->geometries[it->geometryIndex]);
             }
             lodDef.geomSize = assetGeometries.size() - lodDef.geomFirst;
             assetLods.push_back(lodDef);
@@ -190,6 +185,25 @@ bool AssetBuffer::validate(const RenderContext& renderContext)
         }
         assetTypes[t].lodSize = assetLods.size() - assetTypes[t].lodFirst;
       }
+
+      // buffers are allocated once and each geometry is copied to its own part of the buffers, so geometries may be copied in parallel
+      uint32_t vertexSize = calcVertexSize(requiredSemantic);
+      rmData.vertices->resize(verticesSoFar * vertexSize);
+      rmData.indices->resize(indicesSoFar);
+      tbb::parallel_for
+      (
+        tbb::blocked_range<size_t>(0, geometries.size()),
+        [&](const tbb::blocked_range<size_t>& r)
+        {
+          for (size_t i = r.begin(); i != r.end(); ++i)
+          {
+            const Geometry* geometry = geometries[i];
+            VertexConversion conversion(requiredSemantic, geometry->semantic);
+            conversion.convert(rmData.vertices->data() + static_cast<size_t>(assetGeometries[i].vertexOffset) * vertexSize, geometry->vertices.data(), conversion.getSourceVertexCount(geometry->vertices.size()));
+            std::copy(begin(geometry->indices), end(geometry->indices), begin(*rmData.indices) + assetGeometries[i].firstIndex);
+          }
+        }
+      );
       rmData.vertexBuffer->invalidateData();
       rmData.indexBuffer->invalidateData();
       (*rmData.aTypes)    = assetTypes;
@@ -0,0 +1,443 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/AssetCache.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <thread>
+#include <pumex/Viewer.h>
+#include <pumex/utils/Log.h>
+#include <pumex/utils/MappedFile.h>
+
+using namespace pumex;
+
+namespace
+{
+
+const uint32_t assetFileMagic   = 0x54415850; // "PXAT"
+const uint32_t textureFileMagic = 0x58545850; // "PXTX"
+const uint32_t assetFileVersion = 1;
+// arrays are aligned in a file, so that they may be read directly from mapped memory
+const size_t   assetFileAlignment = 16;
+
+// Types written with write() and writeArray() must be plain data types ( values, vectors, matrices, simple structs )
+class AssetFileWriter
+{
+public:
+  template<typename T>
+  void write(const T& value)
+  {
+    append(&value, sizeof(T));
+  }
+  void write(const std::string& value)
+  {
+    write<uint64_t>(value.size());
+    append(value.data(), value.size());
+  }
+  template<typename T>
+  void writeArray(const std::vector<T>& values)
+  {
+    write<uint64_t>(values.size());
+    data.resize((data.size() + assetFileAlignment - 1) / assetFileAlignment * assetFileAlignment, 0);
+    append(values.data(), values.size() * sizeof(T));
+  }
+  void writeBlock(const void* ptr, size_t size)
+  {
+    write<uint64_t>(size);
+    data.resize((data.size() + assetFileAlignment - 1) / assetFileAlignment * assetFileAlignment, 0);
+    append(ptr, size);
+  }
+  void writeStrings(const std::vector<std::string>& values)
+  {
+    write<uint64_t>(values.size());
+    for (const auto& value : values)
+      write(value);
+  }
+
+  std::vector<char> data;
+protected:
+  void append(const void* ptr, size_t size)
+  {
+    const char* bytes = static_cast<const char*>(ptr);
+    data.insert(end(data), bytes, bytes + size);
+  }
+};
+
+class AssetFileReader
+{
+public:
+  AssetFileReader(const char* d, size_t s)
+    : data{ d }, position{ 0 }, size{ s }
+  {
+  }
+  template<typename T>
+  T read()
+  {
+    T value;
+    std::memcpy(&value, consume(sizeof(T)), sizeof(T));
+    return value;
+  }
+  std::string readString()
+  {
+    size_t length = static_cast<size_t>(read<uint64_t>());
+    const char* ptr = consume(length);
+    return std::string(ptr, length);
+  }
+  template<typename T>
+  void readArray(std::vector<T>& values)
+  {
+    size_t count = static_cast<size_t>(read<uint64_t>());
+    position = (position + assetFileAlignment - 1) / assetFileAlignment * assetFileAlignment;
+    CHECK_LOG_THROW(position > size || count > (size - position) / sizeof(T), "Asset file is truncated");
+    const T* ptr = reinterpret_cast<const T*>(consume(count * sizeof(T)));
+    values.assign(ptr, ptr + count);
+  }
+  const char* readBlock(size_t& blockSize)
+  {
+    blockSize = static_cast<size_t>(read<uint64_t>());
+    position  = (position + assetFileAlignment - 1) / assetFileAlignment * assetFileAlignment;
+    return consume(blockSize);
+  }
+  void readStrings(std::vector<std::string>& values)
+  {
+    size_t count = static_cast<size_t>(read<uint64_t>());
+    values.clear();
+    for (size_t i = 0; i < count; ++i)
+      values.push_back(readString());
+  }
+protected:
+  const char* consume(size_t bytes)
+  {
+    CHECK_LOG_THROW(position > size || bytes > size - position, "Asset file is truncated");
+    const char* result = data + position;
+    position += bytes;
+    return result;
+  }
+  const char* data;
+  size_t      position;
+  size_t      size;
+};
+
+void writeSkeleton(AssetFileWriter& writer, const Skeleton& skeleton)
+{
+  writer.writeArray(skeleton.bones);
+  writer.writeArray(skeleton.children);
+  writer.write(skeleton.invGlobalTransform);
+  writer.write(skeleton.name);
+  writer.writeStrings(skeleton.boneNames);
+  writer.write<uint64_t>(skeleton.invBoneNames.size());
+  for (const auto& boneName : skeleton.invBoneNames)
+  {
+    writer.write(boneName.first);
+    writer.write<uint64_t>(boneName.second);
+  }
+}
+
+void readSkeleton(AssetFileReader& reader, Skeleton& skeleton)
+{
+  reader.readArray(skeleton.bones);
+  reader.readArray(skeleton.children);
+  skeleton.invGlobalTransform = reader.read<glm::mat4>();
+  skeleton.name               = reader.readString();
+  reader.readStrings(skeleton.boneNames);
+  uint64_t boneNameCount = reader.read<uint64_t>();
+  for (uint64_t i = 0; i < boneNameCount; ++i)
+  {
+    std::string boneName = reader.readString();
+    skeleton.invBoneNames.insert({ boneName, static_cast<std::size_t>(reader.read<uint64_t>()) });
+  }
+}
+
+void writeGeometry(AssetFileWriter& writer, const Geometry& geometry)
+{
+  writer.write(geometry.name);
+  writer.write<uint32_t>(geometry.topology);
+  writer.writeArray(geometry.semantic);
+  writer.write(geometry.materialIndex);
+  writer.write(geometry.renderMask);
+  writer.writeArray(geometry.vertices);
+  writer.writeArray(geometry.indices);
+}
+
+void readGeometry(AssetFileReader& reader, Geometry& geometry)
+{
+  geometry.name          = reader.readString();
+  geometry.topology      = static_cast<VkPrimitiveTopology>(reader.read<uint32_t>());
+  reader.readArray(geometry.semantic);
+  geometry.materialIndex = reader.read<uint32_t>();
+  geometry.renderMask    = reader.read<uint32_t>();
+  reader.readArray(geometry.vertices);
+  reader.readArray(geometry.indices);
+}
+
+void writeMaterial(AssetFileWriter& writer, const Material& material)
+{
+  writer.write(material.name);
+  writer.write<uint64_t>(material.textures.size());
+  for (const auto& texture : material.textures)
+  {
+    writer.write(texture.first);
+    writer.write(texture.second);
+  }
+  writer.write<uint64_t>(material.properties.size());
+  for (const auto& property : material.properties)
+  {
+    writer.write(property.first);
+    writer.write(property.second);
+  }
+}
+
+void readMaterial(AssetFileReader& reader, Material& material)
+{
+  material.name = reader.readString();
+  uint64_t textureCount = reader.read<uint64_t>();
+  for (uint64_t i = 0; i < textureCount; ++i)
+  {
+    uint32_t semantic = reader.read<uint32_t>();
+    material.textures.insert({ semantic, reader.readString() });
+  }
+  uint64_t propertyCount = reader.read<uint64_t>();
+  for (uint64_t i = 0; i < propertyCount; ++i)
+  {
+    std::string name = reader.readString();
+    material.properties.insert({ name, reader.read<glm::vec4>() });
+  }
+}
+
+void writeAnimation(AssetFileWriter& writer, const Animation& animation)
+{
+  writer.write(animation.name);
+  writer.write<uint64_t>(animation.channels.size());
+  for (const auto& channel : animation.channels)
+  {
+    writer.writeArray(channel.position);
+    writer.writeArray(channel.rotation);
+    writer.writeArray(channel.scale);
+    writer.write(channel.positionTimeBegin);
+    writer.write(channel.positionTimeEnd);
+    writer.write(channel.rotationTimeBegin);
+    writer.write(channel.rotationTimeEnd);
+    writer.write(channel.scaleTimeBegin);
+    writer.write(channel.scaleTimeEnd);
+  }
+  writer.writeArray(animation.channelBefore);
+  writer.writeArray(animation.channelAfter);
+  writer.writeStrings(animation.channelNames);
+  writer.write<uint64_t>(animation.invChannelNames.size());
+  for (const auto& channelName : animation.invChannelNames)
+  {
+    writer.write(channelName.first);
+    writer.write<uint64_t>(channelName.second);
+  }
+}
+
+void readAnimation(AssetFileReader& reader, Animation& animation)
+{
+  animation.name = reader.readString();
+  animation.channels.resize(static_cast<size_t>(reader.read<uint64_t>()));
+  for (auto& channel : animation.channels)
+  {
+    reader.readArray(channel.position);
+    reader.readArray(channel.rotation);
+    reader.readArray(channel.scale);
+    channel.positionTimeBegin = reader.read<float>();
+    channel.positionTimeEnd   = reader.read<float>();
+    channel.rotationTimeBegin = reader.read<float>();
+    channel.rotationTimeEnd   = reader.read<float>();
+    channel.scaleTimeBegin    = reader.read<float>();
+    channel.scaleTimeEnd      = reader.read<float>();
+  }
+  reader.readArray(animation.channelBefore);
+  reader.readArray(animation.channelAfter);
+  reader.readStrings(animation.channelNames);
+  uint64_t channelNameCount = reader.read<uint64_t>();
+  for (uint64_t i = 0; i < channelNameCount; ++i)
+  {
+    std::string channelName = reader.readString();
+    animation.invChannelNames.insert({ channelName, static_cast<std::size_t>(reader.read<uint64_t>()) });
+  }
+}
+
+// file is written under temporary name first, so that other processes never see partially written file
+// ( thread id makes the name unique when the same file is saved by two threads at once )
+void writeAssetFileData(const AssetFileWriter& writer, const std::string& fileName)
+{
+  std::ostringstream threadID;
+  threadID << std::this_thread::get_id();
+  std::string tempFileName = fileName + "." + threadID.str() + ".tmp";
+  {
+    std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+    CHECK_LOG_THROW(!file, "Cannot create asset file : " << tempFileName);
+    file.write(writer.data.data(), writer.data.size());
+    CHECK_LOG_THROW(!file, "Cannot write asset file : " << tempFileName);
+  }
+  std::remove(fileName.c_str());
+  CHECK_LOG_THROW(std::rename(tempFileName.c_str(), fileName.c_str()) != 0, "Cannot rename asset file : " << tempFileName);
+}
+
+}
+
+namespace pumex
+{
+
+void saveAssetFile(const Asset& asset, const std::string& fileName, const std::string& sourceKey)
+{
+  AssetFileWriter writer;
+  writer.write(assetFileMagic);
+  writer.write(assetFileVersion);
+  writer.write(sourceKey);
+  writer.write(asset.fileName);
+  writeSkeleton(writer, asset.skeleton);
+  writer.write<uint64_t>(asset.geometries.size());
+  for (const auto& geometry : asset.geometries)
+    writeGeometry(writer, geometry);
+  writer.write<uint64_t>(asset.materials.size());
+  for (const auto& material : asset.materials)
+    writeMaterial(writer, material);
+  writer.write<uint64_t>(asset.animations.size());
+  for (const auto& animation : asset.animations)
+    writeAnimation(writer, animation);
+  writeAssetFileData(writer, fileName);
+}
+
+std::shared_ptr<Asset> loadAssetFile(const std::string& fileName, const std::string& sourceKey)
+{
+  MappedFile file(fileName);
+  if (file.data() == nullptr)
+    return std::shared_ptr<Asset>();
+  AssetFileReader reader(file.data(), file.size());
+  if (reader.read<uint32_t>() != assetFileMagic || reader.read<uint32_t>() != assetFileVersion || reader.readString() != sourceKey)
+    return std::shared_ptr<Asset>();
+
+  std::shared_ptr<Asset> asset = std::make_shared<Asset>();
+  asset->fileName = reader.readString();
+  readSkeleton(reader, asset->skeleton);
+  asset->geometries.resize(static_cast<size_t>(reader.read<uint64_t>()));
+  for (auto& geometry : asset->geometries)
+    readGeometry(reader, geometry);
+  asset->materials.resize(static_cast<size_t>(reader.read<uint64_t>()));
+  for (auto& material : asset->materials)
+    readMaterial(reader, material);
+  asset->animations.resize(static_cast<size_t>(reader.read<uint64_t>()));
+  for (auto& animation : asset->animations)
+    readAnimation(reader, animation);
+  return asset;
+}
+
+void saveTextureFile(const gli::texture& texture, const std::string& fileName, const std::string& sourceKey)
+{
+  CHECK_LOG_THROW(texture.empty(), "Cannot save empty texture : " << fileName);
+  AssetFileWriter writer;
+  writer.write(textureFileMagic);
+  writer.write(assetFileVersion);
+  writer.write(sourceKey);
+  writer.write<uint32_t>(texture.target());
+  writer.write<uint32_t>(texture.format());
+  writer.write(texture.extent(0));
+  writer.write<uint64_t>(texture.layers());
+  writer.write<uint64_t>(texture.faces());
+  writer.write<uint64_t>(texture.levels());
+  writer.write(texture.swizzles());
+  writer.writeBlock(texture.data(), texture.size());
+  writeAssetFileData(writer, fileName);
+}
+
+std::shared_ptr<gli::texture> loadTextureFile(const std::string& fileName, const std::string& sourceKey)
+{
+  MappedFile file(fileName);
+  if (file.data() == nullptr)
+    return std::shared_ptr<gli::texture>();
+  AssetFileReader reader(file.data(), file.size());
+  if (reader.read<uint32_t>() != textureFileMagic || reader.read<uint32_t>() != assetFileVersion || reader.readString() != sourceKey)
+    return std::shared_ptr<gli::texture>();
+
+  auto target   = static_cast<gli::target>(reader.read<uint32_t>());
+  auto format   = static_cast<gli::format>(reader.read<uint32_t>());
+  auto extent   = reader.read<gli::extent3d>();
+  auto layers   = static_cast<size_t>(reader.read<uint64_t>());
+  auto faces    = static_cast<size_t>(reader.read<uint64_t>());
+  auto levels   = static_cast<size_t>(reader.read<uint64_t>());
+  auto swizzles = reader.read<gli::swizzles>();
+  auto texture  = std::make_shared<gli::texture>(target, format, extent, layers, faces, levels, swizzles);
+  size_t blockSize;
+  const char* block = reader.readBlock(blockSize);
+  CHECK_LOG_THROW(blockSize != texture->size(), "Texture file has wrong size : " << fileName);
+  std::memcpy(texture->data(), block, blockSize);
+  return texture;
+}
+
+}
+
+AssetLoaderCache::AssetLoaderCache(std::shared_ptr<AssetLoader> l, const std::string& cd)
+  : loader{ l }, cacheDirectory{ cd }
+{
+  CHECK_LOG_THROW(loader.get() == nullptr, "AssetLoaderCache : loader not defined");
+  if (cacheDirectory.empty())
+    cacheDirectory = (filesystem::temp_directory_path() / filesystem::path("pumex_cache")).string();
+}
+
+std::shared_ptr<Asset> AssetLoaderCache::load(std::shared_ptr<Viewer> viewer, const std::string& fileName, bool animationOnly, const std::vector<VertexSemantic>& requiredSemantic)
+{
+  auto fullFileName = viewer->getAbsoluteFilePath(fileName);
+  CHECK_LOG_THROW(fullFileName.empty(), "Cannot find model file " << fileName);
+
+  // everything that affects the loaded asset
+  filesystem::path sourcePath(fullFileName);
+  std::ostringstream sourceKey;
+  sourceKey << fullFileName << "|" << filesystem::last_write_time(sourcePath).time_since_epoch().count() << "|" << filesystem::file_size(sourcePath) << "|" << animationOnly << "|";
+  for (const auto& semantic : requiredSemantic)
+    sourceKey << semantic.type << ":" << semantic.size << ",";
+
+  std::ostringstream cacheFileName;
+  cacheFileName << sourcePath.stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0') << static_cast<uint64_t>(std::hash<std::string>()(sourceKey.str())) << ".pumexasset";
+  filesystem::path cachePath = filesystem::path(cacheDirectory) / filesystem::path(cacheFileName.str());
+
+  try
+  {
+    std::shared_ptr<Asset> asset = loadAssetFile(cachePath.string(), sourceKey.str());
+    if (asset.get() != nullptr)
+    {
+      asset->fileName = fileName;
+      return asset;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    LOG_WARNING << "Cannot read cached asset " << cachePath.string() << " : " << e.what() << std::endl;
+  }
+
+  std::shared_ptr<Asset> asset = loader->load(viewer, fileName, animationOnly, requiredSemantic);
+  try
+  {
+    filesystem::create_directories(filesystem::path(cacheDirectory));
+    saveAssetFile(*asset, cachePath.string(), sourceKey.str());
+  }
+  catch (const std::exception& e)
+  {
+    LOG_WARNING << "Cannot write cached asset " << cachePath.string() << " : " << e.what() << std::endl;
+  }
+  return asset;
+}
@@ -81,7 +81,8 @@ std::shared_ptr<Asset> AssetLoaderAssimp::load(std::shared_ptr<Viewer> viewer, c
 {
   auto fullFileName = viewer->getAbsoluteFilePath(fileName);
   CHECK_LOG_THROW(fullFileName.empty(), "Cannot find model file " << fileName);
-  const aiScene* scene = Importer.ReadFile(fullFileName.c_str(), importFlags);
+  Assimp::Importer importer;
+  const aiScene* scene = importer.ReadFile(fullFileName.c_str(), importFlags);
   CHECK_LOG_THROW(scene == nullptr, "Cannot load model file : " << fullFileName)
 
   //creating asset
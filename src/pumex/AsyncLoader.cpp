@@ -0,0 +1,111 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#include <pumex/AsyncLoader.h>
+#include <pumex/Viewer.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+AsyncLoader::AsyncLoader(std::shared_ptr<AssetLoader> al, std::shared_ptr<TextureLoader> tl)
+  : assetLoader{ al }, textureLoader{ tl }, pendingCount{ 0 }
+{
+}
+
+AsyncLoader::~AsyncLoader()
+{
+  tasks.wait();
+}
+
+std::shared_future<std::shared_ptr<Asset>> AsyncLoader::loadAsset(std::shared_ptr<Viewer> viewer, const std::string& fileName, bool animationOnly, const std::vector<VertexSemantic>& requiredSemantic, std::function<void(std::shared_ptr<Asset>)> callback)
+{
+  CHECK_LOG_THROW(assetLoader.get() == nullptr, "AsyncLoader::loadAsset() : asset loader not defined");
+  auto promise = std::make_shared<std::promise<std::shared_ptr<Asset>>>();
+  std::shared_future<std::shared_ptr<Asset>> result = promise->get_future().share();
+  pendingCount++;
+  tasks.run([=]()
+  {
+    try
+    {
+      auto asset = assetLoader->load(viewer, fileName, animationOnly, requiredSemantic);
+      // callback is queued before the future becomes ready, so that callbacks dispatched after future.get() always include it
+      if (callback)
+        addCallback(std::bind(callback, asset));
+      promise->set_value(asset);
+    }
+    catch (...)
+    {
+      promise->set_exception(std::current_exception());
+    }
+    pendingCount--;
+  });
+  return result;
+}
+
+std::shared_future<std::shared_ptr<gli::texture>> AsyncLoader::loadTexture(std::shared_ptr<Viewer> viewer, const std::string& fileName, std::function<void(std::shared_ptr<gli::texture>)> callback)
+{
+  CHECK_LOG_THROW(textureLoader.get() == nullptr, "AsyncLoader::loadTexture() : texture loader not defined");
+  auto promise = std::make_shared<std::promise<std::shared_ptr<gli::texture>>>();
+  std::shared_future<std::shared_ptr<gli::texture>> result = promise->get_future().share();
+  pendingCount++;
+  tasks.run([=]()
+  {
+    try
+    {
+      auto fullFileName = viewer->getAbsoluteFilePath(fileName);
+      CHECK_LOG_THROW(fullFileName.empty(), "Cannot find texture file : " << fileName);
+      auto texture = textureLoader->load(fullFileName);
+      CHECK_LOG_THROW(texture.get() == nullptr || texture->empty(), "Texture not loaded : " << fileName);
+      if (callback)
+        addCallback(std::bind(callback, texture));
+      promise->set_value(texture);
+    }
+    catch (...)
+    {
+      promise->set_exception(std::current_exception());
+    }
+    pendingCount--;
+  });
+  return result;
+}
+
+uint32_t AsyncLoader::dispatchCallbacks()
+{
+  std::vector<std::function<void()>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    callbacks.swap(finishedCallbacks);
+  }
+  for (auto& callback : callbacks)
+    callback();
+  return callbacks.size();
+}
+
+void AsyncLoader::wait()
+{
+  tasks.wait();
+}
+
+void AsyncLoader::addCallback(std::function<void()> callback)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  finishedCallbacks.push_back(callback);
+}
@@ -226,6 +226,22 @@ void CommandBuffer::cmdPipelineBarrier(const RenderContext& renderContext, const
 
   for (const auto& b : barriers)
   {
+    uint32_t      srcQueueFamilyIndex = b.srcQueueFamilyIndex;
+    uint32_t      dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+    VkImageLayout newLayout           = b.newLayout;
+    if (b.ownershipTransfer != MemoryObjectBarrier::otNone)
+    {
+      srcQueueFamilyIndex = renderContext.surface->queues[b.srcQueueIndex]->familyIndex;
+      dstQueueFamilyIndex = renderContext.surface->queues[b.dstQueueIndex]->familyIndex;
+      // queues from the same family do not transfer ownership - semaphore between them is enough. Only acquire barrier performs layout transition then
+      if (srcQueueFamilyIndex == dstQueueFamilyIndex)
+      {
+        srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        if (b.ownershipTransfer == MemoryObjectBarrier::otRelease)
+          newLayout = b.oldLayout;
+      }
+    }
     switch (b.objectType)
     {
     case MemoryObject::moBuffer:
@@ -236,8 +252,8 @@ void CommandBuffer::cmdPipelineBarrier(const RenderContext& renderContext, const
         bufferBarrier.pNext               = nullptr;
         bufferBarrier.srcAccessMask       = b.srcAccessMask;
         bufferBarrier.dstAccessMask       = b.dstAccessMask;
-        bufferBarrier.srcQueueFamilyIndex = b.srcQueueFamilyIndex;
-        bufferBarrier.dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+        bufferBarrier.srcQueueFamilyIndex = srcQueueFamilyIndex;
+        bufferBarrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
         bufferBarrier.buffer              = memoryBuffer->getHandleBuffer(renderContext);
         bufferBarrier.offset              = b.bufferRange.offset;
         bufferBarrier.size                = b.bufferRange.range;
@@ -252,10 +268,10 @@ void CommandBuffer::cmdPipelineBarrier(const RenderContext& renderContext, const
         imageBarrier.pNext               = nullptr;
         imageBarrier.srcAccessMask       = b.srcAccessMask;
         imageBarrier.dstAccessMask       = b.dstAccessMask;
-        imageBarrier.srcQueueFamilyIndex = b.srcQueueFamilyIndex;
-        imageBarrier.dstQueueFamilyIndex = b.dstQueueFamilyIndex;
+        imageBarrier.srcQueueFamilyIndex = srcQueueFamilyIndex;
+        imageBarrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
         imageBarrier.oldLayout           = b.oldLayout;
-        imageBarrier.newLayout           = b.newLayout;
+        imageBarrier.newLayout           = newLayout;
         imageBarrier.image               = memoryImage->getImage(renderContext)->getHandleImage();
         imageBarrier.subresourceRange    = b.imageRange.getSubresource();
       imageBarriers.emplace_back(imageBarrier);
@@ -336,6 +352,16 @@ void CommandBuffer::cmdCopyBufferToImage(VkBuffer srcBuffer, const Image& image,
   vkCmdCopyBufferToImage(commandBuffer[activeIndex], srcBuffer, image.getHandleImage(), dstImageLayout, regions.size(), regions.data());
 }
 
+void CommandBuffer::cmdCopyImage(const Image& srcImage, VkImageLayout srcImageLayout, const Image& dstImage, VkImageLayout dstImageLayout, const std::vector<VkImageCopy>& regions) const
+{
+  vkCmdCopyImage(commandBuffer[activeIndex], srcImage.getHandleImage(), srcImageLayout, dstImage.getHandleImage(), dstImageLayout, regions.size(), regions.data());
+}
+
+void CommandBuffer::cmdBlitImage(const Image& srcImage, VkImageLayout srcImageLayout, const Image& dstImage, VkImageLayout dstImageLayout, const std::vector<VkImageBlit>& regions, VkFilter filter) const
+{
+  vkCmdBlitImage(commandBuffer[activeIndex], srcImage.getHandleImage(), srcImageLayout, dstImage.getHandleImage(), dstImageLayout, regions.size(), regions.data(), filter);
+}
+
 void CommandBuffer::cmdClearColorImage(const Image& image, VkImageLayout imageLayout, VkClearValue color, std::vector<VkImageSubresourceRange> subresourceRanges)
 {
   vkCmdClearColorImage(commandBuffer[activeIndex], image.getHandleImage(), imageLayout, &color.color, subresourceRanges.size(), subresourceRanges.data());
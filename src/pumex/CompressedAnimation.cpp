@@ -0,0 +1,266 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/CompressedAnimation.h>
+#include <algorithm>
+#include <cmath>
+#include <pumex/utils/Log.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace pumex;
+
+namespace
+{
+
+typedef CompressedAnimation::Track Track;
+
+// three smallest components of a normalized quaternion lie in [ -1/sqrt(2), 1/sqrt(2) ] range
+const float quatComponentRange = 0.70710678f;
+const float quatComponentMax   = 32767.0f;
+const float vec3ComponentMax   = 65535.0f;
+
+inline uint16_t quantize(float value, float rangeMin, float rangeExtent, float maxValue)
+{
+  if (rangeExtent <= 0.0f)
+    return 0;
+  return static_cast<uint16_t>(glm::clamp((value - rangeMin) / rangeExtent, 0.0f, 1.0f) * maxValue + 0.5f);
+}
+
+inline float dequantize(uint16_t value, float rangeMin, float rangeExtent, float maxValue)
+{
+  return rangeMin + rangeExtent * value / maxValue;
+}
+
+inline void encodeKey(const glm::vec3& value, const Track& track, uint16_t* key)
+{
+  for (uint32_t i = 0; i < 3; ++i)
+    key[i] = quantize(value[i], track.rangeMin[i], track.rangeExtent[i], vec3ComponentMax);
+}
+
+inline void decodeKey(const uint16_t* key, const Track& track, glm::vec3& value)
+{
+  value = glm::vec3(dequantize(key[0], track.rangeMin.x, track.rangeExtent.x, vec3ComponentMax),
+    dequantize(key[1], track.rangeMin.y, track.rangeExtent.y, vec3ComponentMax),
+    dequantize(key[2], track.rangeMin.z, track.rangeExtent.z, vec3ComponentMax));
+}
+
+// smallest three : index of the largest component is stored in the highest bits of the first two values
+inline void encodeKey(const glm::quat& value, const Track& track, uint16_t* key)
+{
+  float    q[4]    = { value.x, value.y, value.z, value.w };
+  uint32_t largest = 0;
+  for (uint32_t i = 1; i < 4; ++i)
+    if (std::abs(q[i]) > std::abs(q[largest]))
+      largest = i;
+  // q and -q represent the same rotation, so the largest component may be always positive
+  float sign = (q[largest] < 0.0f) ? -1.0f : 1.0f;
+  for (uint32_t i = 0, j = 0; i < 4; ++i)
+  {
+    if (i == largest)
+      continue;
+    key[j++] = quantize(sign * q[i], -quatComponentRange, 2.0f * quatComponentRange, quatComponentMax);
+  }
+  key[0] |= (largest & 1) << 15;
+  key[1] |= (largest >> 1) << 15;
+}
+
+inline void decodeKey(const uint16_t* key, const Track& track, glm::quat& value)
+{
+  uint32_t largest = (key[0] >> 15) | ((key[1] >> 15) << 1);
+  float    q[4];
+  float    sum     = 0.0f;
+  for (uint32_t i = 0, j = 0; i < 4; ++i)
+  {
+    if (i == largest)
+      continue;
+    q[i] = dequantize(key[j++] & 0x7FFF, -quatComponentRange, 2.0f * quatComponentRange, quatComponentMax);
+    sum += q[i] * q[i];
+  }
+  q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+  value = glm::quat(q[3], q[0], q[1], q[2]);
+}
+
+inline glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); }
+inline glm::quat interpolate(const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); }
+
+inline float difference(const glm::vec3& a, const glm::vec3& b)
+{
+  return glm::length(a - b);
+}
+
+// rotation angle between quaternions, computed from the chord length because acos() is imprecise for small angles
+inline float difference(const glm::quat& a, const glm::quat& b)
+{
+  float sign = (glm::dot(a, b) < 0.0f) ? -1.0f : 1.0f;
+  glm::vec4 chord(a.x - sign * b.x, a.y - sign * b.y, a.z - sign * b.z, a.w - sign * b.w);
+  return 4.0f * std::asin(std::min(1.0f, 0.5f * glm::length(chord)));
+}
+
+inline void updateRange(const std::vector<TimeLine<glm::vec3>>& values, Track& track)
+{
+  glm::vec3 rangeMax = values.front().value;
+  track.rangeMin     = values.front().value;
+  for (const auto& v : values)
+  {
+    track.rangeMin = glm::min(track.rangeMin, v.value);
+    rangeMax       = glm::max(rangeMax, v.value);
+  }
+  track.rangeExtent = rangeMax - track.rangeMin;
+}
+
+// intentionally empty : smallest three components of a unit quaternion always lie in [ -quatComponentRange, quatComponentRange ],
+// so rotation keys are quantized in that fixed range and rotation tracks do not use rangeMin / rangeExtent
+inline void updateRange(const std::vector<TimeLine<glm::quat>>& /*values*/, Track& /*track*/)
+{
+}
+
+// sample of an uncompressed track in [ beginTime, endTime ] range
+template<typename T>
+T sampleTrack(const std::vector<TimeLine<T>>& values, float time)
+{
+  uint32_t i = binarySearchIndex(values.data(), values.size(), time);
+  if (i + 1 >= values.size() || values[i + 1].time <= values[i].time)
+    return values[i].value;
+  float a = (time - values[i].time) / (values[i + 1].time - values[i].time);
+  return interpolate(values[i].value, values[i + 1].value, glm::clamp(a, 0.0f, 1.0f));
+}
+
+template<typename T>
+T sampleCompressedTrack(const Track& track, const uint16_t* keyData, float time, const T& defaultValue)
+{
+  T a, b;
+  if (track.keyCount == 0)
+    return defaultValue;
+  const uint16_t* keys = keyData + track.dataOffset;
+  if (track.keyCount == 1)
+  {
+    decodeKey(keys, track, a);
+    return a;
+  }
+  float    position = glm::clamp((time - track.beginTime) * track.invKeyInterval, 0.0f, static_cast<float>(track.keyCount - 1));
+  uint32_t index    = std::min(static_cast<uint32_t>(position), track.keyCount - 2);
+  decodeKey(keys + index * CompressedAnimation::keySize, track, a);
+  decodeKey(keys + (index + 1) * CompressedAnimation::keySize, track, b);
+  return interpolate(a, b, position - index);
+}
+
+// Track is resampled with increasing number of keys until quantized keys reproduce the original track within tolerance.
+// Key counts of 2^n+1 are tried first, then the number of original keys ( exact for tracks sampled uniformly ) and its multiples.
+// Errors are measured at original key times and between them
+template<typename T>
+void compressTrack(const std::vector<TimeLine<T>>& values, float tolerance, Track& track, std::vector<uint16_t>& keyData)
+{
+  track = Track();
+  track.dataOffset = keyData.size();
+  if (values.empty())
+    return;
+  track.beginTime = values.front().time;
+  track.endTime   = values.back().time;
+  updateRange(values, track);
+
+  std::vector<float> testTimes;
+  for (uint32_t i = 0; i < values.size(); ++i)
+  {
+    testTimes.push_back(values[i].time);
+    if (i + 1 < values.size())
+      testTimes.push_back(0.5f * (values[i].time + values[i + 1].time));
+  }
+  std::vector<T> expectedValues;
+  for (auto t : testTimes)
+    expectedValues.push_back(sampleTrack(values, t));
+
+  std::vector<uint32_t> keyCounts{ 1 };
+  uint32_t segmentCount = values.size() - 1;
+  if (track.endTime > track.beginTime)
+  {
+    for (uint32_t s = 1; s < segmentCount; s *= 2)
+      keyCounts.push_back(s + 1);
+    for (uint32_t s = segmentCount; s <= 8 * segmentCount; s *= 2)
+      keyCounts.push_back(s + 1);
+  }
+
+  std::vector<uint16_t> candidateData;
+  Track                 candidate = track;
+  for (auto keyCount : keyCounts)
+  {
+    candidate.keyCount       = keyCount;
+    candidate.dataOffset     = 0;
+    candidate.invKeyInterval = (keyCount > 1) ? (keyCount - 1) / (track.endTime - track.beginTime) : 0.0f;
+    candidateData.resize(keyCount * CompressedAnimation::keySize);
+    for (uint32_t k = 0; k < keyCount; ++k)
+    {
+      float time = (keyCount > 1) ? track.beginTime + k * (track.endTime - track.beginTime) / (keyCount - 1) : track.beginTime;
+      encodeKey(sampleTrack(values, time), candidate, candidateData.data() + k * CompressedAnimation::keySize);
+    }
+    float error = 0.0f;
+    for (uint32_t i = 0; i < testTimes.size() && error <= tolerance; ++i)
+      error = std::max(error, difference(sampleCompressedTrack(candidate, candidateData.data(), testTimes[i], expectedValues[i]), expectedValues[i]));
+    if (error <= tolerance)
+      break;
+  }
+  track.keyCount       = candidate.keyCount;
+  track.invKeyInterval = candidate.invKeyInterval;
+  keyData.insert(keyData.end(), candidateData.begin(), candidateData.end());
+}
+
+}
+
+const uint32_t CompressedAnimation::keySize;
+
+CompressedAnimation::CompressedAnimation(const Animation& animation, float positionTolerance, float rotationTolerance, float scaleTolerance)
+  : name{ animation.name }, channelBefore{ animation.channelBefore }, channelAfter{ animation.channelAfter }, channelNames{ animation.channelNames }, invChannelNames{ animation.invChannelNames }
+{
+  CHECK_LOG_THROW(animation.channelBefore.size() != animation.channels.size() || animation.channelAfter.size() != animation.channels.size(), "Animation " << animation.name << " has wrong number of channel states");
+  channels.resize(animation.channels.size());
+  for (uint32_t i = 0; i < animation.channels.size(); ++i)
+  {
+    compressTrack(animation.channels[i].position, positionTolerance, channels[i].position, keyData);
+    compressTrack(animation.channels[i].rotation, rotationTolerance, channels[i].rotation, keyData);
+    compressTrack(animation.channels[i].scale,    scaleTolerance,    channels[i].scale,    keyData);
+  }
+  keyData.shrink_to_fit();
+}
+
+glm::mat4 CompressedAnimation::calculateTransform(uint32_t channel, float time) const
+{
+  const Channel&            ch     = channels[channel];
+  Animation::Channel::State before = channelBefore[channel];
+  Animation::Channel::State after  = channelAfter[channel];
+
+  glm::vec3 vScale       = sampleCompressedTrack(ch.scale,    keyData.data(), calculateAnimationTime(time, ch.scale.beginTime,    ch.scale.endTime,    before, after), glm::vec3(1, 1, 1));
+  glm::quat qRotation    = sampleCompressedTrack(ch.rotation, keyData.data(), calculateAnimationTime(time, ch.rotation.beginTime, ch.rotation.endTime, before, after), glm::quat());
+  glm::vec3 vTranslation = sampleCompressedTrack(ch.position, keyData.data(), calculateAnimationTime(time, ch.position.beginTime, ch.position.endTime, before, after), glm::vec3(0, 0, 0));
+
+  return glm::scale(glm::translate(mat4unity, vTranslation) * glm::mat4_cast(qRotation), vScale);
+}
+
+void CompressedAnimation::calculateLocalTransforms(float time, glm::mat4* data, uint32_t size) const
+{
+  CHECK_LOG_THROW(size != channels.size(), "Wrong channel count");
+  for (uint32_t i = 0; i < channels.size(); ++i, ++data)
+    *data = calculateTransform(i, time);
+}
+
+std::size_t CompressedAnimation::getMemorySize() const
+{
+  return channels.size() * sizeof(Channel) + keyData.size() * sizeof(uint16_t);
+}
@@ -24,6 +24,7 @@
 #include <map>
 #include <algorithm>
 #include <pumex/Device.h>
+#include <pumex/PhysicalDevice.h>
 #include <pumex/Surface.h>
 #include <pumex/Viewer.h>
 #include <pumex/Node.h>
@@ -33,8 +34,8 @@
 
 using namespace pumex;
 
-DescriptorSetLayoutBinding::DescriptorSetLayoutBinding(uint32_t b, uint32_t bc, VkDescriptorType dt, VkShaderStageFlags sf)
-  : binding{ b }, bindingCount{ bc }, descriptorType{ dt }, stageFlags{ sf }
+DescriptorSetLayoutBinding::DescriptorSetLayoutBinding(uint32_t b, uint32_t bc, VkDescriptorType dt, VkShaderStageFlags sf, VkDescriptorBindingFlagsEXT bf)
+  : binding{ b }, bindingCount{ bc }, descriptorType{ dt }, stageFlags{ sf }, bindingFlags{ bf }
 {
 }
 
@@ -45,13 +46,41 @@ std::size_t computeHash(const std::vector<DescriptorSetLayoutBinding> layoutBind
   std::size_t seed = 0;
   for (auto& v : layoutBindings)
   {
-    std::size_t a = hash_value(v.binding, v.bindingCount, v.descriptorType, v.stageFlags);
+    std::size_t a = hash_value(v.binding, v.bindingCount, v.descriptorType, v.stageFlags, v.bindingFlags);
     seed ^= a + 0x9e3779b9 + (seed << 6) + (seed >> 2);
   }
   return seed;
 }
 }
 
+namespace
+{
+// binding flags from VK_EXT_descriptor_indexing may only be used when physical device implements respective features
+bool bindingFlagsSupported(const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features, VkDescriptorType descriptorType, VkDescriptorBindingFlagsEXT bindingFlags)
+{
+  if ((bindingFlags & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT) != 0 && features.descriptorBindingPartiallyBound != VK_TRUE)
+    return false;
+  if ((bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT) != 0 && features.descriptorBindingUpdateUnusedWhilePending != VK_TRUE)
+    return false;
+  if ((bindingFlags & VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT) != 0 && features.descriptorBindingVariableDescriptorCount != VK_TRUE)
+    return false;
+  if ((bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) == 0)
+    return true;
+  switch (descriptorType)
+  {
+  case VK_DESCRIPTOR_TYPE_SAMPLER:
+  case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+  case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:        return features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE;
+  case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:        return features.descriptorBindingStorageImageUpdateAfterBind == VK_TRUE;
+  case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:       return features.descriptorBindingUniformBufferUpdateAfterBind == VK_TRUE;
+  case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:       return features.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE;
+  case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: return features.descriptorBindingUniformTexelBufferUpdateAfterBind == VK_TRUE;
+  case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: return features.descriptorBindingStorageTexelBufferUpdateAfterBind == VK_TRUE;
+  default:                                      return false; // dynamic buffers and input attachments cannot be updated after bind
+  }
+}
+}
+
 DescriptorPool::DescriptorPool()
 {
 }
@@ -102,6 +131,8 @@ DescriptorPool::~DescriptorPool()
         descriptorPoolCI.pPoolSizes    = poolSizes.data();
         descriptorPoolCI.maxSets       = poolSize;
         descriptorPoolCI.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // we will free our descriptor sets manually
+        if (poolDefinitions[index].layout->hasUpdateAfterBindBindings())
+          descriptorPoolCI.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
         pddit->second.data[0].descriptorPools.resize(poolDefinitions.size(), VK_NULL_HANDLE);
         pddit->second.data[0].allocatedDescriptors.resize(poolDefinitions.size(), 0);
         VK_CHECK_LOG_THROW(vkCreateDescriptorPool(pddit->second.device, &descriptorPoolCI, nullptr, &pddit->second.data[0].descriptorPools[index]), "Cannot create descriptor pool");
@@ -157,6 +188,8 @@ void DescriptorSetLayout::validate(const RenderContext& renderContext)
     return;
 
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+  std::vector<VkDescriptorBindingFlagsEXT>  setLayoutBindingFlags;
+  bool useBindingFlags = false;
   for ( const auto& b : bindings )
   {
     VkDescriptorSetLayoutBinding setLayoutBinding{};
@@ -165,12 +198,29 @@ void DescriptorSetLayout::validate(const RenderContext& renderContext)
       setLayoutBinding.binding         = b.binding;
       setLayoutBinding.descriptorCount = b.bindingCount;
     setLayoutBindings.emplace_back(setLayoutBinding);
+    setLayoutBindingFlags.push_back(b.bindingFlags);
+    useBindingFlags |= (b.bindingFlags != 0);
   }
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
     descriptorSetLayoutCI.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     descriptorSetLayoutCI.pBindings    = setLayoutBindings.data();
     descriptorSetLayoutCI.bindingCount = setLayoutBindings.size();
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCI{};
+  if (useBindingFlags)
+  {
+    CHECK_LOG_THROW(!renderContext.device->deviceExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME), "Cannot create descriptor set layout with binding flags - device was created without " << VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME << " extension");
+    const auto& descriptorIndexingFeatures = renderContext.device->physical.lock()->descriptorIndexingFeatures;
+    for (const auto& b : bindings)
+      CHECK_LOG_THROW(!bindingFlagsSupported(descriptorIndexingFeatures, b.descriptorType, b.bindingFlags), "Cannot create descriptor set layout - physical device does not support binding flags " << b.bindingFlags << " used by binding " << b.binding);
+    bindingFlagsCI.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsCI.bindingCount  = setLayoutBindingFlags.size();
+    bindingFlagsCI.pBindingFlags = setLayoutBindingFlags.data();
+    descriptorSetLayoutCI.pNext  = &bindingFlagsCI;
+    if (hasUpdateAfterBindBindings())
+      descriptorSetLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+  }
   VK_CHECK_LOG_THROW(vkCreateDescriptorSetLayout(pddit->second.device, &descriptorSetLayoutCI, nullptr, &pddit->second.data[0].descriptorSetLayout), "Cannot create descriptor set layout");
   pddit->second.valid[0] = true;
 }
@@ -205,6 +255,21 @@ uint32_t DescriptorSetLayout::getDescriptorBindingCount(uint32_t binding) const
   return 0;
 }
 
+VkDescriptorBindingFlagsEXT DescriptorSetLayout::getDescriptorBindingFlags(uint32_t binding) const
+{
+  for (const auto& b : bindings)
+  {
+    if (binding == b.binding)
+      return b.bindingFlags;
+  }
+  return 0;
+}
+
+bool DescriptorSetLayout::hasUpdateAfterBindBindings() const
+{
+  return std::any_of(begin(bindings), end(bindings), [](const DescriptorSetLayoutBinding& b) { return (b.bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0; });
+}
+
 std::vector<VkDescriptorPoolSize> DescriptorSetLayout::getDescriptorPoolSize(uint32_t poolSize) const
 {
   std::vector<VkDescriptorPoolSize> poolSizes;
@@ -230,16 +295,19 @@ Descriptor::Descriptor(std::shared_ptr<DescriptorSet> o, const std::vector<std::
   resources = r;
 }
 
+// resources may contain empty elements when descriptor is declared as partially bound
 void Descriptor::registerInResources()
 {
   for (auto& res : resources)
-    res->addDescriptor(shared_from_this());
+    if (res != nullptr)
+      res->addDescriptor(shared_from_this());
 }
 
 void Descriptor::unregisterFromResources()
 {
   for (auto& res : resources)
-    res->removeDescriptor(shared_from_this());
+    if (res != nullptr)
+      res->removeDescriptor(shared_from_this());
 }
 
 Descriptor::~Descriptor()
@@ -249,7 +317,8 @@ Descriptor::~Descriptor()
 void Descriptor::validate(const RenderContext& renderContext)
 {
   for (auto& res : resources)
-    res->validate(renderContext);
+    if (res != nullptr)
+      res->validate(renderContext);
 }
 
 void Descriptor::invalidateDescriptorSet()
@@ -266,6 +335,11 @@ void Descriptor::getDescriptorValues(const RenderContext& renderContext, std::ve
 {
   for (auto& res : resources)
   {
+    if (res == nullptr)
+    {
+      values.push_back(DescriptorValue());
+      continue;
+    }
     auto dsv = res->getDescriptorValue(renderContext);
     values.push_back(dsv);
   }
@@ -314,7 +388,8 @@ void DescriptorSet::validate( const RenderContext& renderContext )
   if (pddit->second.valid[activeIndex])
     return;
 
-  if (pddit->second.data[activeIndex].descriptorSet == VK_NULL_HANDLE)
+  bool newDescriptorSet = (pddit->second.data[activeIndex].descriptorSet == VK_NULL_HANDLE);
+  if (newDescriptorSet)
   {
     pddit->second.data[activeIndex].descriptorSet = pool->allocate(renderContext, poolIndex);
     pddit->second.commonData                      = renderContext.device->getID();
@@ -334,10 +409,49 @@ void DescriptorSet::validate( const RenderContext& renderContext )
   std::vector<VkDescriptorImageInfo>  imageInfos(dsvSize);
   uint32_t bufferInfosCurrentSize = 0;
   uint32_t imageInfosCurrentSize  = 0;
+  bool     updateAfterBind        = true;
   for (const auto& v : values)
   {
     if (v.second.empty())
       continue;
+    VkDescriptorBindingFlagsEXT bindingFlags = layout->getDescriptorBindingFlags(v.first);
+    updateAfterBind = updateAfterBind && ((bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0);
+    if ((bindingFlags & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT) != 0)
+    {
+      // partially bound array may have holes. Each continuous range of defined values is written separately
+      for (uint32_t i = 0; i < v.second.size(); )
+      {
+        if (v.second[i].vType == DescriptorValue::Undefined)
+        {
+          ++i;
+          continue;
+        }
+        uint32_t first = i;
+        while (i < v.second.size() && v.second[i].vType == v.second[first].vType)
+          ++i;
+        VkWriteDescriptorSet writeDescriptorSet{};
+          writeDescriptorSet.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+          writeDescriptorSet.dstSet          = pddit->second.data[activeIndex].descriptorSet;
+          writeDescriptorSet.descriptorType  = layout->getDescriptorType(v.first);
+          writeDescriptorSet.dstBinding      = v.first;
+          writeDescriptorSet.dstArrayElement = first;
+          writeDescriptorSet.descriptorCount = i - first;
+          if (v.second[first].vType == DescriptorValue::Buffer)
+          {
+            writeDescriptorSet.pBufferInfo = &bufferInfos[bufferInfosCurrentSize];
+            for (uint32_t j = first; j < i; ++j)
+              bufferInfos[bufferInfosCurrentSize++] = v.second[j].bufferInfo;
+          }
+          else
+          {
+            writeDescriptorSet.pImageInfo = &imageInfos[imageInfosCurrentSize];
+            for (uint32_t j = first; j < i; ++j)
+              imageInfos[imageInfosCurrentSize++] = v.second[j].imageInfo;
+          }
+        writeDescriptorSets.push_back(writeDescriptorSet);
+      }
+      continue;
+    }
     VkWriteDescriptorSet writeDescriptorSet{};
       writeDescriptorSet.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
       writeDescriptorSet.dstSet          = pddit->second.data[activeIndex].descriptorSet;
@@ -365,7 +479,9 @@ void DescriptorSet::validate( const RenderContext& renderContext )
   }
   vkUpdateDescriptorSets(pddit->second.device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, nullptr);
   pddit->second.valid[activeIndex] = true;
-  notifyCommandBuffers(activeIndex);
+  // descriptor set update invalidates command buffers that use it - unless all updated bindings were declared as update after bind
+  if (newDescriptorSet || writeDescriptorSets.empty() || !updateAfterBind)
+    notifyCommandBuffers(activeIndex);
 }
 
 VkDescriptorSet DescriptorSet::getHandle(const RenderContext& renderContext) const
@@ -22,6 +22,8 @@
 
 #include <pumex/Device.h>
 #include <iterator>
+#include <algorithm>
+#include <cstring>
 #include <pumex/Viewer.h>
 #include <pumex/PhysicalDevice.h>
 #include <pumex/Command.h>
@@ -138,6 +140,16 @@ void Device::realize()
     deviceCreateInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
   }
 
+  // all descriptor indexing features implemented by physical device are enabled, just like the core features above.
+  // Features are known only when they were queried with VK_KHR_get_physical_device_properties2 - otherwise structure is empty and cannot be chained
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = physicalDevice->descriptorIndexingFeatures;
+  if (deviceExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+  {
+    CHECK_LOG_THROW(descriptorIndexingFeatures.sType != VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT, "Cannot enable " << VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME << " features - instance was created without " << VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME << " extension");
+    descriptorIndexingFeatures.pNext = nullptr;
+    deviceCreateInfo.pNext           = &descriptorIndexingFeatures;
+  }
+
   VK_CHECK_LOG_THROW( vkCreateDevice(physicalDevice->physicalDevice, &deviceCreateInfo, nullptr, &device), "Could not create logical device" );
 
   // collect all created queues
@@ -160,6 +172,8 @@ void Device::realize()
     pfnCmdDebugMarkerInsert     = reinterpret_cast<PFN_vkCmdDebugMarkerInsertEXT>(vkGetDeviceProcAddr(device, "vkCmdDebugMarkerInsertEXT"));
   }
 
+  nonCoherentAtomSize = std::max<VkDeviceSize>(1, physicalDevice->properties.limits.nonCoherentAtomSize);
+
   // create descriptor pool
   descriptorPool = std::make_shared<DescriptorPool>();
 }
@@ -168,7 +182,9 @@ void Device::cleanup()
 {
   if (device != VK_NULL_HANDLE)
   {
+    stagingRing = nullptr;
     stagingBuffers.clear();
+    mappedMemoryRangesToFlush.clear();
     descriptorPool = nullptr;
     vkDestroyDevice(device, nullptr);
     device = VK_NULL_HANDLE;
@@ -243,6 +259,105 @@ void Device::releaseStagingBuffer(std::shared_ptr<StagingBuffer> buffer)
   buffer->setReserved(false);
 }
 
+StagingRegion Device::acquireStagingRegion(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+  StagingRegion region;
+  bool acquired;
+  {
+    std::lock_guard<std::mutex> lock(stagingMutex);
+    if (stagingRing.get() == nullptr)
+      stagingRing = std::make_unique<StagingRing>(this, stagingRingSize);
+    acquired = stagingRing->acquire(size, alignment, region);
+  }
+  if (!acquired)
+  {
+    region.fallbackBuffer = acquireStagingBuffer(nullptr, size);
+    region.buffer         = region.fallbackBuffer->buffer;
+    region.offset         = 0;
+    region.size           = size;
+    region.mappedPointer  = static_cast<uint8_t*>(region.fallbackBuffer->mapMemory(size));
+  }
+  if (data != nullptr)
+    std::memcpy(region.mappedPointer, data, size);
+  return region;
+}
+
+void Device::releaseStagingRegion(const StagingRegion& region)
+{
+  if (region.fallbackBuffer.get() != nullptr)
+  {
+    region.fallbackBuffer->unmapMemory();
+    releaseStagingBuffer(region.fallbackBuffer);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  CHECK_LOG_THROW(stagingRing.get() == nullptr, "Cannot release staging region : staging ring does not exist");
+  stagingRing->release(region);
+}
+
+void Device::setStagingRingSize(VkDeviceSize size)
+{
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  CHECK_LOG_THROW(stagingRing.get() != nullptr, "Cannot change staging ring size after it was created");
+  stagingRingSize = size;
+}
+
+StagingRingStatistics Device::getStagingRingStatistics() const
+{
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  if (stagingRing.get() == nullptr)
+    return StagingRingStatistics();
+  return stagingRing->getStatistics();
+}
+
+void Device::addMappedMemoryRangeToFlush(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size)
+{
+  // range must be aligned to nonCoherentAtomSize. DeviceMemoryAllocator allocates non coherent blocks with size being a multiple of it,
+  // so the range rounded up never exceeds the memory size
+  VkDeviceSize alignedOffset = (offset / nonCoherentAtomSize) * nonCoherentAtomSize;
+  VkDeviceSize alignedEnd    = ((offset + size + nonCoherentAtomSize - 1) / nonCoherentAtomSize) * nonCoherentAtomSize;
+  VkMappedMemoryRange memoryRange{};
+    memoryRange.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    memoryRange.memory = memory;
+    memoryRange.offset = alignedOffset;
+    memoryRange.size   = alignedEnd - alignedOffset;
+  std::lock_guard<std::mutex> lock(flushMutex);
+  mappedMemoryRangesToFlush.push_back(memoryRange);
+}
+
+void Device::removeMappedMemoryRangesToFlush(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size)
+{
+  std::lock_guard<std::mutex> lock(flushMutex);
+  auto eit = std::remove_if(begin(mappedMemoryRangesToFlush), end(mappedMemoryRangesToFlush), [memory, offset, size](const VkMappedMemoryRange& r)
+  {
+    return r.memory == memory && (size == VK_WHOLE_SIZE || (r.offset >= offset && r.offset + r.size <= offset + size));
+  });
+  mappedMemoryRangesToFlush.erase(eit, end(mappedMemoryRangesToFlush));
+}
+
+void Device::flushMappedMemoryRanges()
+{
+  std::vector<VkMappedMemoryRange> memoryRanges;
+  {
+    std::lock_guard<std::mutex> lock(flushMutex);
+    if (mappedMemoryRangesToFlush.empty())
+      return;
+    memoryRanges.swap(mappedMemoryRangesToFlush);
+  }
+  // merge overlapping and adjacent ranges, so that each frame ends with a small number of flushed ranges
+  std::sort(begin(memoryRanges), end(memoryRanges), [](const VkMappedMemoryRange& lhs, const VkMappedMemoryRange& rhs) { return (lhs.memory != rhs.memory) ? (lhs.memory < rhs.memory) : (lhs.offset < rhs.offset); });
+  uint32_t last = 0;
+  for (uint32_t i = 1; i < memoryRanges.size(); ++i)
+  {
+    if (memoryRanges[i].memory == memoryRanges[last].memory && memoryRanges[i].offset <= memoryRanges[last].offset + memoryRanges[last].size)
+      memoryRanges[last].size = std::max(memoryRanges[last].offset + memoryRanges[last].size, memoryRanges[i].offset + memoryRanges[i].size) - memoryRanges[last].offset;
+    else
+      memoryRanges[++last] = memoryRanges[i];
+  }
+  memoryRanges.resize(last + 1);
+  VK_CHECK_LOG_THROW(vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(memoryRanges.size()), memoryRanges.data()), "Cannot flush mapped memory ranges");
+}
+
 bool Device::deviceExtensionEnabled(const char* extensionName) const
 {
   for (const auto& e : enabledDeviceExtensions)
@@ -265,6 +380,8 @@ void Device::endSingleTimeCommands(std::shared_ptr<CommandBuffer> commandBuffer,
   commandBuffer->cmdEnd();
   if (submit)
   {
+    flushMappedMemoryRanges();
+
     VkFence fence;
     VkFenceCreateInfo fenceCreateInfo{};
     fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
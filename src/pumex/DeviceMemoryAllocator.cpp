@@ -21,7 +21,13 @@
 //
 
 #include <cstring>
+#include <algorithm>
+#include <limits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include <pumex/DeviceMemoryAllocator.h>
+#include <pumex/MemoryObject.h>
 #include <pumex/Device.h>
 #include <pumex/PhysicalDevice.h>
 #include <pumex/utils/Log.h>
@@ -29,12 +35,12 @@
 using namespace pumex;
 
 DeviceMemoryBlock::DeviceMemoryBlock()
-  : memory{ VK_NULL_HANDLE }, realOffset{ 0 }, alignedOffset{ 0 }, realSize{ 0 }, alignedSize{ 0 }
+  : memory{ VK_NULL_HANDLE }, realOffset{ 0 }, alignedOffset{ 0 }, realSize{ 0 }, alignedSize{ 0 }, mappedPointer{ nullptr }
 {
 }
 
 DeviceMemoryBlock::DeviceMemoryBlock(VkDeviceMemory m, VkDeviceSize ro, VkDeviceSize ao, VkDeviceSize rs, VkDeviceSize as)
-  : memory{ m }, realOffset{ ro }, alignedOffset{ ao }, realSize{ rs }, alignedSize{ as }
+  : memory{ m }, realOffset{ ro }, alignedOffset{ ao }, realSize{ rs }, alignedSize{ as }, mappedPointer{ nullptr }
 {
 }
 
@@ -47,19 +53,30 @@ AllocationStrategy::~AllocationStrategy()
 {
 }
 
-DeviceMemoryAllocator::DeviceMemoryAllocator(VkMemoryPropertyFlags pf, VkDeviceSize s, EnumStrategy st)
-  : propertyFlags{ pf }, size{ s }
+DeviceMemoryAllocator::StorageBlock::StorageBlock(VkDeviceMemory m, VkDeviceSize s, uint8_t* mp, std::unique_ptr<AllocationStrategy> as)
+  : storageMemory{ m }, size{ s }, mappedPointer{ mp }, allocationCount{ 0 }, allocationStrategy{ std::move(as) }
 {
-  switch (st)
-  {
-  case FIRST_FIT: allocationStrategy = std::make_unique<FirstFitAllocationStrategy>(); break;
-  }
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator(VkMemoryPropertyFlags pf, VkDeviceSize bs, EnumStrategy st, uint32_t mbc, bool pm)
+  : propertyFlags{ pf }, blockSize{ bs }, maxBlockCount{ mbc }, strategy{ st }, persistentlyMapped{ pm }
+{
+  CHECK_LOG_THROW(maxBlockCount == 0, "DeviceMemoryAllocator must be able to allocate at least one block of memory");
+  CHECK_LOG_THROW(persistentlyMapped && ((propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0), "DeviceMemoryAllocator : only HOST_VISIBLE memory may be persistently mapped");
 }
 
 DeviceMemoryAllocator::~DeviceMemoryAllocator()
 {
   for (auto& pddit : perDeviceData)
-    vkFreeMemory(pddit.first, pddit.second.storageMemory, nullptr);
+  {
+    for (auto& sb : pddit.second.storageBlocks)
+    {
+      removePendingFlushes(pddit.second, sb, sb.storageMemory, 0, VK_WHOLE_SIZE);
+      if (sb.mappedPointer != nullptr)
+        vkUnmapMemory(pddit.first, sb.storageMemory);
+      vkFreeMemory(pddit.first, sb.storageMemory, nullptr);
+    }
+  }
 }
 
 DeviceMemoryBlock DeviceMemoryAllocator::allocate(Device* device, VkMemoryRequirements memoryRequirements)
@@ -67,68 +84,357 @@ DeviceMemoryBlock DeviceMemoryAllocator::allocate(Device* device, VkMemoryRequir
   std::lock_guard<std::mutex> lock(mutex);
   auto pddit = perDeviceData.find(device->device);
   if (pddit == end(perDeviceData))
+  {
     pddit = perDeviceData.insert({ device->device, PerDeviceData() }).first;
-  if (pddit->second.storageMemory == VK_NULL_HANDLE)
+    pddit->second.device = device->shared_from_this();
+  }
+
+  // try to fit data into one of existing blocks
+  for (auto& sb : pddit->second.storageBlocks)
   {
-    VkMemoryAllocateInfo memAlloc{};
-      memAlloc.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-      memAlloc.allocationSize  = size;
-      memAlloc.memoryTypeIndex = device->physical.lock()->getMemoryType(memoryRequirements.memoryTypeBits, propertyFlags);
-    VK_CHECK_LOG_THROW(vkAllocateMemory(device->device, &memAlloc, nullptr, &pddit->second.storageMemory), "Cannot allocate memory in DeviceMemoryAllocator");
-    pddit->second.freeBlocks.push_front(FreeBlock(0, size));
+    DeviceMemoryBlock block = sb.allocationStrategy->allocate(sb.storageMemory, memoryRequirements);
+    if (block.alignedSize > 0)
+    {
+      blockAllocated(pddit->second, sb, block);
+      return block;
+    }
   }
-  return allocationStrategy->allocate(pddit->second.storageMemory, pddit->second.freeBlocks, memoryRequirements);
+
+  // none of the blocks has enough free space - we have to allocate a new one. Data bigger than blockSize gets its own block
+  CHECK_LOG_THROW(pddit->second.storageBlocks.size() >= maxBlockCount, "memory allocation failed : " << memoryRequirements.size << " ( all " << maxBlockCount << " blocks of memory are in use )");
+  VkDeviceSize newBlockSize = std::max(blockSize, memoryRequirements.size + std::max<VkDeviceSize>(1, memoryRequirements.alignment) - 1);
+  // flushed ranges of non coherent memory are rounded to nonCoherentAtomSize, so the whole block must be a multiple of it
+  if (persistentlyMapped && ((propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0))
+  {
+    VkDeviceSize atomSize = std::max<VkDeviceSize>(1, device->physical.lock()->properties.limits.nonCoherentAtomSize);
+    newBlockSize = ((newBlockSize + atomSize - 1) / atomSize) * atomSize;
+  }
+  VkDeviceMemory storageMemory;
+  VkMemoryAllocateInfo memAlloc{};
+    memAlloc.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAlloc.allocationSize  = newBlockSize;
+    memAlloc.memoryTypeIndex = device->physical.lock()->getMemoryType(memoryRequirements.memoryTypeBits, propertyFlags);
+  VK_CHECK_LOG_THROW(vkAllocateMemory(device->device, &memAlloc, nullptr, &storageMemory), "Cannot allocate memory in DeviceMemoryAllocator");
+  uint8_t* mappedPointer = nullptr;
+  if (persistentlyMapped)
+    VK_CHECK_LOG_THROW(vkMapMemory(device->device, storageMemory, 0, VK_WHOLE_SIZE, 0, (void **)&mappedPointer), "Cannot map memory in DeviceMemoryAllocator");
+  pddit->second.storageBlocks.push_back(StorageBlock(storageMemory, newBlockSize, mappedPointer, createAllocationStrategy(strategy, newBlockSize)));
+
+  auto& sb = pddit->second.storageBlocks.back();
+  DeviceMemoryBlock block = sb.allocationStrategy->allocate(sb.storageMemory, memoryRequirements);
+  CHECK_LOG_THROW(block.alignedSize == 0, "memory allocation failed : " << memoryRequirements.size);
+  blockAllocated(pddit->second, sb, block);
+  return block;
 }
 
 void DeviceMemoryAllocator::deallocate(VkDevice device, const DeviceMemoryBlock& block)
 {
+  // objects that never allocated their memory may still call deallocate()
+  if (block.memory == VK_NULL_HANDLE)
+    return;
   std::lock_guard<std::mutex> lock(mutex);
   auto pddit = perDeviceData.find(device);
   CHECK_LOG_THROW(pddit == end(perDeviceData), "Cannot deallocate memory - device memory was never allocated");
-  allocationStrategy->deallocate(pddit->second.freeBlocks, block);
+  auto sbit = findStorageBlock(pddit->second, block.memory);
+  CHECK_LOG_THROW(sbit == end(pddit->second.storageBlocks), "Cannot deallocate memory - memory block does not belong to this allocator");
+  sbit->allocationStrategy->deallocate(block);
+  sbit->allocationCount--;
+  pddit->second.usedBytes -= block.alignedSize;
+  // release empty blocks, but keep the first one, so that allocators working on a single block do not call vkAllocateMemory() over and over again
+  if (sbit->allocationCount == 0 && sbit != begin(pddit->second.storageBlocks))
+  {
+    removePendingFlushes(pddit->second, *sbit, sbit->storageMemory, 0, VK_WHOLE_SIZE);
+    if (sbit->mappedPointer != nullptr)
+      vkUnmapMemory(device, sbit->storageMemory);
+    vkFreeMemory(device, sbit->storageMemory, nullptr);
+    pddit->second.storageBlocks.erase(sbit);
+  }
+  else
+    removePendingFlushes(pddit->second, *sbit, block.memory, block.alignedOffset, block.alignedSize);
+}
+
+DeviceMemoryBlock DeviceMemoryAllocator::reallocate(Device* device, VkMemoryRequirements memoryRequirements, const DeviceMemoryBlock& block)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perDeviceData.find(device->device);
+  CHECK_LOG_THROW(pddit == end(perDeviceData), "Cannot reallocate memory - device memory was never allocated");
+  auto sbit = findStorageBlock(pddit->second, block.memory);
+  CHECK_LOG_THROW(sbit == end(pddit->second.storageBlocks), "Cannot reallocate memory - memory block does not belong to this allocator");
+  // earlier blocks of memory are checked first. In the block of memory that stores the data, new place must lie below the current one
+  for (auto it = begin(pddit->second.storageBlocks); it <= sbit; ++it)
+  {
+    VkDeviceSize maxOffset = (it == sbit) ? block.realOffset : it->size;
+    DeviceMemoryBlock newBlock = it->allocationStrategy->allocateBelow(it->storageMemory, memoryRequirements, maxOffset);
+    if (newBlock.alignedSize > 0)
+    {
+      blockAllocated(pddit->second, *it, newBlock);
+      return newBlock;
+    }
+  }
+  return DeviceMemoryBlock();
+}
+
+void DeviceMemoryAllocator::registerMemoryObject(MemoryObject* memoryObject)
+{
+  std::lock_guard<std::mutex> lock(objectMutex);
+  memoryObjects.push_back(memoryObject);
+}
+
+void DeviceMemoryAllocator::unregisterMemoryObject(MemoryObject* memoryObject)
+{
+  std::lock_guard<std::mutex> lock(objectMutex);
+  memoryObjects.erase(std::remove(begin(memoryObjects), end(memoryObjects), memoryObject), end(memoryObjects));
+}
+
+VkDeviceSize DeviceMemoryAllocator::defragment(Device* device, VkDeviceSize maxBytesToMove)
+{
+  std::lock_guard<std::mutex> objectLock(objectMutex);
+
+  struct FreeSpace
+  {
+    uint32_t     storageIndex;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+  std::vector<FreeSpace>                       freeSpaces;
+  std::unordered_map<VkDeviceMemory, uint32_t> storageIndices;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto pddit = perDeviceData.find(device->device);
+    if (pddit == end(perDeviceData))
+      return 0;
+    std::vector<FreeBlock> freeBlocks;
+    for (uint32_t i = 0; i < pddit->second.storageBlocks.size(); ++i)
+    {
+      auto& sb = pddit->second.storageBlocks[i];
+      storageIndices.insert({ sb.storageMemory, i });
+      freeBlocks.clear();
+      sb.allocationStrategy->getFreeBlocks(freeBlocks);
+      for (auto& fb : freeBlocks)
+        freeSpaces.push_back({ i, fb.offset, fb.size });
+    }
+  }
+  if (freeSpaces.empty())
+    return 0;
+  // lowest free space is filled first
+  std::sort(begin(freeSpaces), end(freeSpaces), [](const FreeSpace& lhs, const FreeSpace& rhs) { return (lhs.storageIndex < rhs.storageIndex) || (lhs.storageIndex == rhs.storageIndex && lhs.offset < rhs.offset); });
+
+  // collect blocks that their owners are able to move. Blocks lying at the end of memory are moved first
+  struct Candidate
+  {
+    MemoryObject*     memoryObject;
+    DeviceMemoryBlock block;
+    uint32_t          storageIndex;
+  };
+  std::vector<Candidate>         candidates;
+  std::vector<DeviceMemoryBlock> blocks;
+  for (auto memoryObject : memoryObjects)
+  {
+    blocks.clear();
+    memoryObject->getRelocatableMemoryBlocks(device->device, blocks);
+    for (auto& block : blocks)
+    {
+      auto sit = storageIndices.find(block.memory);
+      if (sit != end(storageIndices))
+        candidates.push_back({ memoryObject, block, sit->second });
+    }
+  }
+  std::sort(begin(candidates), end(candidates), [](const Candidate& lhs, const Candidate& rhs) { return (lhs.storageIndex > rhs.storageIndex) || (lhs.storageIndex == rhs.storageIndex && lhs.block.realOffset > rhs.block.realOffset); });
+
+  // moves are simulated on a list of free spaces, so that two blocks are never planned into the same place
+  std::unordered_map<MemoryObject*, std::vector<DeviceMemoryBlock>> relocations;
+  VkDeviceSize plannedBytes = 0;
+  for (auto& c : candidates)
+  {
+    if (plannedBytes + c.block.alignedSize > maxBytesToMove)
+      continue;
+    // original alignment is not stored in a block, but aligned offset is a multiple of it ( alignments above 64 kB are not expected )
+    VkDeviceSize alignment = 65536;
+    if (c.block.alignedOffset > 0)
+      alignment = std::min<VkDeviceSize>(alignment, c.block.alignedOffset & (~c.block.alignedOffset + 1));
+    auto fit = std::find_if(begin(freeSpaces), end(freeSpaces), [&c, alignment](const FreeSpace& fs)
+    {
+      bool below = (fs.storageIndex < c.storageIndex) || (fs.storageIndex == c.storageIndex && fs.offset < c.block.realOffset);
+      VkDeviceSize padding = (alignment - fs.offset % alignment) % alignment;
+      return below && fs.size >= padding + c.block.alignedSize;
+    });
+    if (fit == end(freeSpaces))
+      continue;
+    VkDeviceSize usedSize = (alignment - fit->offset % alignment) % alignment + c.block.alignedSize;
+    fit->offset  += usedSize;
+    fit->size    -= usedSize;
+    plannedBytes += c.block.alignedSize;
+    relocations[c.memoryObject].push_back(c.block);
+  }
+  for (auto& r : relocations)
+    r.first->relocateMemoryBlocks(device->device, r.second);
+  return plannedBytes;
+}
+
+uint32_t DeviceMemoryAllocator::getBlockCount(VkDevice device) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perDeviceData.find(device);
+  if (pddit == end(perDeviceData))
+    return 0;
+  return static_cast<uint32_t>(pddit->second.storageBlocks.size());
+}
+
+DeviceMemoryAllocatorStatistics DeviceMemoryAllocator::getStatistics(VkDevice device) const
+{
+  DeviceMemoryAllocatorStatistics result;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perDeviceData.find(device);
+  if (pddit == end(perDeviceData))
+    return result;
+  result.usedBytes           = pddit->second.usedBytes;
+  result.peakUsedBytes       = pddit->second.peakUsedBytes;
+  result.allocationsPerFrame = pddit->second.lastFrameAllocations;
+  result.blockCount          = static_cast<uint32_t>(pddit->second.storageBlocks.size());
+  std::vector<FreeBlock> freeBlocks;
+  for (const auto& sb : pddit->second.storageBlocks)
+  {
+    result.reservedBytes   += sb.size;
+    result.allocationCount += sb.allocationCount;
+    freeBlocks.clear();
+    sb.allocationStrategy->getFreeBlocks(freeBlocks);
+    for (const auto& fb : freeBlocks)
+    {
+      result.freeBytes        += fb.size;
+      result.largestFreeBlock  = std::max(result.largestFreeBlock, fb.size);
+    }
+    result.freeBlockCount += static_cast<uint32_t>(freeBlocks.size());
+  }
+  return result;
 }
 
-void DeviceMemoryAllocator::copyToDeviceMemory(Device* device, VkDeviceSize offset, const void* data, VkDeviceSize size, VkMemoryMapFlags flags)
+void DeviceMemoryAllocator::finishFrame(VkDevice device)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perDeviceData.find(device);
+  if (pddit == end(perDeviceData))
+    return;
+  pddit->second.lastFrameAllocations = pddit->second.frameAllocations;
+  pddit->second.frameAllocations     = 0;
+}
+
+void DeviceMemoryAllocator::blockAllocated(PerDeviceData& pdd, StorageBlock& sb, DeviceMemoryBlock& block)
+{
+  if (sb.mappedPointer != nullptr)
+    block.mappedPointer = sb.mappedPointer + block.alignedOffset;
+  sb.allocationCount++;
+  pdd.usedBytes     += block.alignedSize;
+  pdd.peakUsedBytes  = std::max(pdd.peakUsedBytes, pdd.usedBytes);
+  pdd.frameAllocations++;
+}
+
+// ranges written to non coherent memory wait in a Device until next submission. Ranges of released memory must not be flushed
+void DeviceMemoryAllocator::removePendingFlushes(PerDeviceData& pdd, const StorageBlock& sb, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size)
+{
+  if (sb.mappedPointer == nullptr || (propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+    return;
+  auto device = pdd.device.lock();
+  if (device != nullptr)
+    device->removeMappedMemoryRangesToFlush(memory, offset, size);
+}
+
+std::vector<DeviceMemoryAllocator::StorageBlock>::iterator DeviceMemoryAllocator::findStorageBlock(PerDeviceData& pdd, VkDeviceMemory memory)
+{
+  return std::find_if(begin(pdd.storageBlocks), end(pdd.storageBlocks), [memory](const StorageBlock& sb) { return sb.storageMemory == memory; });
+}
+
+std::unique_ptr<AllocationStrategy> DeviceMemoryAllocator::createAllocationStrategy(EnumStrategy st, VkDeviceSize s)
+{
+  switch (st)
+  {
+  case FIRST_FIT: return std::make_unique<FirstFitAllocationStrategy>(s);
+  case TLSF:      return std::make_unique<TLSFAllocationStrategy>(s);
+  }
+  return std::unique_ptr<AllocationStrategy>();
+}
+
+void DeviceMemoryAllocator::copyToDeviceMemory(Device* device, const DeviceMemoryBlock& block, VkDeviceSize offset, const void* data, VkDeviceSize size, VkMemoryMapFlags flags)
 {
   if (size == 0)
     return;
+  // persistently mapped memory is written without taking the mutex. Different blocks never overlap, so concurrent writes are safe
+  if (block.mappedPointer != nullptr)
+  {
+    std::memcpy(block.mappedPointer + offset, data, size);
+    flushDeviceMemory(device, block, offset, size);
+    return;
+  }
   std::lock_guard<std::mutex> lock(mutex);
   auto pddit = perDeviceData.find(device->device);
   CHECK_LOG_THROW(pddit == end(perDeviceData), "DeviceMemoryAllocator::copyToDeviceMemory() : cannot copy to memory that not have been allocated yet");
+  CHECK_LOG_THROW(findStorageBlock(pddit->second, block.memory) == end(pddit->second.storageBlocks), "DeviceMemoryAllocator::copyToDeviceMemory() : memory block does not belong to this allocator");
+  if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+  {
+    // non coherent memory must be flushed before it's unmapped. Flushed range must start at a multiple of nonCoherentAtomSize
+    VkDeviceSize atomSize  = std::max<VkDeviceSize>(1, device->physical.lock()->properties.limits.nonCoherentAtomSize);
+    VkDeviceSize mapOffset = ((block.alignedOffset + offset) / atomSize) * atomSize;
+    uint8_t *pData;
+    VK_CHECK_LOG_THROW(vkMapMemory(device->device, block.memory, mapOffset, VK_WHOLE_SIZE, 0, (void **)&pData), "Cannot map memory");
+    std::memcpy(pData + (block.alignedOffset + offset - mapOffset), data, size);
+    VkMappedMemoryRange memoryRange{};
+      memoryRange.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+      memoryRange.memory = block.memory;
+      memoryRange.offset = mapOffset;
+      memoryRange.size   = VK_WHOLE_SIZE;
+    VK_CHECK_LOG_THROW(vkFlushMappedMemoryRanges(device->device, 1, &memoryRange), "Cannot flush memory");
+    vkUnmapMemory(device->device, block.memory);
+    return;
+  }
   uint8_t *pData;
-  VK_CHECK_LOG_THROW(vkMapMemory(device->device, pddit->second.storageMemory, offset, size, 0, (void **)&pData), "Cannot map memory");
+  VK_CHECK_LOG_THROW(vkMapMemory(device->device, block.memory, block.alignedOffset + offset, size, 0, (void **)&pData), "Cannot map memory");
   std::memcpy(pData, data, size);
-  vkUnmapMemory(device->device, pddit->second.storageMemory);
+  vkUnmapMemory(device->device, block.memory);
 }
 
-void DeviceMemoryAllocator::bindBufferMemory(Device* device, VkBuffer buffer, VkDeviceSize offset)
+void DeviceMemoryAllocator::flushDeviceMemory(Device* device, const DeviceMemoryBlock& block, VkDeviceSize offset, VkDeviceSize size)
+{
+  // only persistently mapped memory needs deferred flush - copyToDeviceMemory() flushes other memory before unmapping it
+  if (size == 0 || block.mappedPointer == nullptr || (propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+    return;
+  device->addMappedMemoryRangeToFlush(block.memory, block.alignedOffset + offset, size);
+}
+
+void DeviceMemoryAllocator::bindBufferMemory(Device* device, VkBuffer buffer, const DeviceMemoryBlock& block)
 {
   std::lock_guard<std::mutex> lock(mutex);
   auto pddit = perDeviceData.find(device->device);
   CHECK_LOG_THROW(pddit == end(perDeviceData), "DeviceMemoryAllocator::bindBufferMemory() : cannot bind memory that not have been allocated yet");
-  VK_CHECK_LOG_THROW(vkBindBufferMemory(device->device, buffer, pddit->second.storageMemory, offset), "Cannot bind memory to buffer");
+  VK_CHECK_LOG_THROW(vkBindBufferMemory(device->device, buffer, block.memory, block.alignedOffset), "Cannot bind memory to buffer");
 }
 
-FirstFitAllocationStrategy::FirstFitAllocationStrategy()
+FirstFitAllocationStrategy::FirstFitAllocationStrategy(VkDeviceSize s)
 {
+  freeBlocks.push_front(FreeBlock(0, s));
 }
 
 FirstFitAllocationStrategy::~FirstFitAllocationStrategy()
 {
 }
 
-DeviceMemoryBlock FirstFitAllocationStrategy::allocate(VkDeviceMemory storageMemory, std::list<FreeBlock>& freeBlocks, VkMemoryRequirements memoryRequirements)
+DeviceMemoryBlock FirstFitAllocationStrategy::allocate(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements)
+{
+  return allocateBelow(storageMemory, memoryRequirements, std::numeric_limits<VkDeviceSize>::max());
+}
+
+DeviceMemoryBlock FirstFitAllocationStrategy::allocateBelow(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements, VkDeviceSize maxOffset)
 {
+  // free blocks are sorted by offset, so the first block that fits is also the lowest one
   auto it = begin(freeBlocks);
   VkDeviceSize additionalSize;
-  for (; it != end(freeBlocks); ++it)
+  for (; it != end(freeBlocks) && it->offset < maxOffset; ++it)
   {
     VkDeviceSize modd = it->offset % memoryRequirements.alignment;
     additionalSize = (modd == 0) ? 0 : memoryRequirements.alignment - modd;
     if (it->size >= memoryRequirements.size + additionalSize)
       break;
   }
-  CHECK_LOG_THROW(it == end(freeBlocks), "memory allocation failed : " << memoryRequirements.size);
+  if (it == end(freeBlocks) || it->offset >= maxOffset)
+    return DeviceMemoryBlock();
 
   DeviceMemoryBlock block(storageMemory, it->offset, it->offset + additionalSize, memoryRequirements.size, memoryRequirements.size + additionalSize);
   it->offset += memoryRequirements.size + additionalSize;
@@ -138,9 +444,9 @@ DeviceMemoryBlock FirstFitAllocationStrategy::allocate(VkDeviceMemory storageMem
   return block;
 }
 
-void FirstFitAllocationStrategy::deallocate(std::list<FreeBlock>& freeBlocks, const DeviceMemoryBlock& block)
+void FirstFitAllocationStrategy::deallocate(const DeviceMemoryBlock& block)
 {
-  FreeBlock fBlock(block.realOffset, block.realSize);
+  FreeBlock fBlock(block.realOffset, block.alignedSize);
   if (freeBlocks.empty())
   {
     freeBlocks.push_back(fBlock);
@@ -187,3 +493,286 @@ void FirstFitAllocationStrategy::deallocate(std::list<FreeBlock>& freeBlocks, co
     freeBlocks.erase(nit);
   }
 }
+
+void FirstFitAllocationStrategy::getFreeBlocks(std::vector<FreeBlock>& fb) const
+{
+  fb.insert(end(fb), begin(freeBlocks), end(freeBlocks));
+}
+
+namespace
+{
+
+// index of the least significant bit set. Value must not be 0
+inline uint32_t tlsfLowestBit(uint64_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+// index of the most significant bit set. Value must not be 0
+inline uint32_t tlsfHighestBit(uint64_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+// blocks smaller than TLSF_SL_COUNT are stored in first level 0 with one second level list per byte
+inline void tlsfMapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+{
+  if (size < TLSFAllocationStrategy::TLSF_SL_COUNT)
+  {
+    fl = 0;
+    sl = static_cast<uint32_t>(size);
+    return;
+  }
+  uint32_t highestBit = tlsfHighestBit(size);
+  fl = highestBit - TLSFAllocationStrategy::TLSF_SL_COUNT_LOG2 + 1;
+  sl = static_cast<uint32_t>(size >> (highestBit - TLSFAllocationStrategy::TLSF_SL_COUNT_LOG2)) ^ TLSFAllocationStrategy::TLSF_SL_COUNT;
+}
+
+}
+
+const uint32_t TLSFAllocationStrategy::TLSF_SL_COUNT_LOG2;
+const uint32_t TLSFAllocationStrategy::TLSF_SL_COUNT;
+const uint32_t TLSFAllocationStrategy::TLSF_FL_COUNT;
+const uint32_t TLSFAllocationStrategy::TLSF_INVALID_INDEX;
+
+TLSFAllocationStrategy::TLSFAllocationStrategy(VkDeviceSize s)
+{
+  std::fill(slBitmap, slBitmap + TLSF_FL_COUNT, 0);
+  for (uint32_t i = 0; i < TLSF_FL_COUNT; ++i)
+    std::fill(freeLists[i], freeLists[i] + TLSF_SL_COUNT, TLSF_INVALID_INDEX);
+  if (s > 0)
+    insertFreeBlock(createBlock(0, s));
+}
+
+TLSFAllocationStrategy::~TLSFAllocationStrategy()
+{
+}
+
+DeviceMemoryBlock TLSFAllocationStrategy::allocate(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements)
+{
+  VkDeviceSize alignment = std::max<VkDeviceSize>(1, memoryRequirements.alignment);
+  VkDeviceSize blockSize = std::max<VkDeviceSize>(1, memoryRequirements.size);
+
+  // block found for unaligned size is used only when its offset happens to be aligned. Otherwise we look for a block that is guaranteed to fit after alignment
+  uint32_t blockIndex = findFreeBlock(blockSize);
+  if (blockIndex == TLSF_INVALID_INDEX || (blocks[blockIndex].offset % alignment) != 0)
+  {
+    blockIndex = findFreeBlock(blockSize + alignment - 1);
+    if (blockIndex == TLSF_INVALID_INDEX)
+      return DeviceMemoryBlock();
+  }
+  return useFreeBlock(blockIndex, storageMemory, memoryRequirements);
+}
+
+DeviceMemoryBlock TLSFAllocationStrategy::allocateBelow(VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements, VkDeviceSize maxOffset)
+{
+  VkDeviceSize alignment = std::max<VkDeviceSize>(1, memoryRequirements.alignment);
+  VkDeviceSize blockSize = std::max<VkDeviceSize>(1, memoryRequirements.size);
+
+  // free lists are not sorted by offset, so we have to check all blocks
+  uint32_t blockIndex = TLSF_INVALID_INDEX;
+  for (uint32_t i = 0; i < blocks.size(); ++i)
+  {
+    if (!blocks[i].free || blocks[i].offset >= maxOffset)
+      continue;
+    if (blockIndex != TLSF_INVALID_INDEX && blocks[i].offset >= blocks[blockIndex].offset)
+      continue;
+    VkDeviceSize padding = (alignment - blocks[i].offset % alignment) % alignment;
+    if (blocks[i].size >= padding + blockSize)
+      blockIndex = i;
+  }
+  if (blockIndex == TLSF_INVALID_INDEX)
+    return DeviceMemoryBlock();
+  return useFreeBlock(blockIndex, storageMemory, memoryRequirements);
+}
+
+// free block must be big enough to store aligned data
+DeviceMemoryBlock TLSFAllocationStrategy::useFreeBlock(uint32_t blockIndex, VkDeviceMemory storageMemory, VkMemoryRequirements memoryRequirements)
+{
+  VkDeviceSize alignment = std::max<VkDeviceSize>(1, memoryRequirements.alignment);
+  VkDeviceSize blockSize = std::max<VkDeviceSize>(1, memoryRequirements.size);
+  removeFreeBlock(blockIndex);
+
+  // padding required by alignment is returned to free lists as a separate block
+  VkDeviceSize modd = blocks[blockIndex].offset % alignment;
+  if (modd != 0)
+  {
+    VkDeviceSize padding = alignment - modd;
+    splitBlock(blockIndex, padding);
+    uint32_t paddingIndex = blockIndex;
+    blockIndex            = blocks[paddingIndex].nextPhysical;
+    // padding block may be merged with previous free block
+    uint32_t prevIndex = blocks[paddingIndex].prevPhysical;
+    if (prevIndex != TLSF_INVALID_INDEX && blocks[prevIndex].free)
+    {
+      removeFreeBlock(prevIndex);
+      mergeWithNext(prevIndex);
+      paddingIndex = prevIndex;
+    }
+    insertFreeBlock(paddingIndex);
+  }
+  // remaining space at the end of a block also goes back to free lists
+  if (blocks[blockIndex].size > blockSize)
+  {
+    splitBlock(blockIndex, blockSize);
+    insertFreeBlock(blocks[blockIndex].nextPhysical);
+  }
+  usedBlocks.insert({ blocks[blockIndex].offset, blockIndex });
+  return DeviceMemoryBlock(storageMemory, blocks[blockIndex].offset, blocks[blockIndex].offset, memoryRequirements.size, blockSize);
+}
+
+void TLSFAllocationStrategy::deallocate(const DeviceMemoryBlock& block)
+{
+  auto it = usedBlocks.find(block.realOffset);
+  CHECK_LOG_THROW(it == end(usedBlocks), "memory deallocation failed : block was not allocated " << block.realOffset);
+  uint32_t blockIndex = it->second;
+  usedBlocks.erase(it);
+
+  uint32_t nextIndex = blocks[blockIndex].nextPhysical;
+  if (nextIndex != TLSF_INVALID_INDEX && blocks[nextIndex].free)
+  {
+    removeFreeBlock(nextIndex);
+    mergeWithNext(blockIndex);
+  }
+  uint32_t prevIndex = blocks[blockIndex].prevPhysical;
+  if (prevIndex != TLSF_INVALID_INDEX && blocks[prevIndex].free)
+  {
+    removeFreeBlock(prevIndex);
+    mergeWithNext(prevIndex);
+    blockIndex = prevIndex;
+  }
+  insertFreeBlock(blockIndex);
+}
+
+void TLSFAllocationStrategy::getFreeBlocks(std::vector<FreeBlock>& fb) const
+{
+  for (const auto& block : blocks)
+    if (block.free)
+      fb.push_back(FreeBlock(block.offset, block.size));
+}
+
+uint32_t TLSFAllocationStrategy::createBlock(VkDeviceSize offset, VkDeviceSize size)
+{
+  uint32_t blockIndex;
+  if (!unusedBlocks.empty())
+  {
+    blockIndex = unusedBlocks.back();
+    unusedBlocks.pop_back();
+    blocks[blockIndex] = Block();
+  }
+  else
+  {
+    blockIndex = static_cast<uint32_t>(blocks.size());
+    blocks.push_back(Block());
+  }
+  blocks[blockIndex].offset = offset;
+  blocks[blockIndex].size   = size;
+  return blockIndex;
+}
+
+void TLSFAllocationStrategy::releaseBlock(uint32_t blockIndex)
+{
+  blocks[blockIndex].free = false;
+  unusedBlocks.push_back(blockIndex);
+}
+
+void TLSFAllocationStrategy::insertFreeBlock(uint32_t blockIndex)
+{
+  uint32_t fl, sl;
+  tlsfMapping(blocks[blockIndex].size, fl, sl);
+  uint32_t head = freeLists[fl][sl];
+  blocks[blockIndex].free     = true;
+  blocks[blockIndex].prevFree = TLSF_INVALID_INDEX;
+  blocks[blockIndex].nextFree = head;
+  if (head != TLSF_INVALID_INDEX)
+    blocks[head].prevFree = blockIndex;
+  freeLists[fl][sl] = blockIndex;
+  flBitmap     |= (1ull << fl);
+  slBitmap[fl] |= (1u << sl);
+}
+
+void TLSFAllocationStrategy::removeFreeBlock(uint32_t blockIndex)
+{
+  uint32_t fl, sl;
+  tlsfMapping(blocks[blockIndex].size, fl, sl);
+  uint32_t prevFree = blocks[blockIndex].prevFree;
+  uint32_t nextFree = blocks[blockIndex].nextFree;
+  if (prevFree != TLSF_INVALID_INDEX)
+    blocks[prevFree].nextFree = nextFree;
+  if (nextFree != TLSF_INVALID_INDEX)
+    blocks[nextFree].prevFree = prevFree;
+  if (freeLists[fl][sl] == blockIndex)
+  {
+    freeLists[fl][sl] = nextFree;
+    if (nextFree == TLSF_INVALID_INDEX)
+    {
+      slBitmap[fl] &= ~(1u << sl);
+      if (slBitmap[fl] == 0)
+        flBitmap &= ~(1ull << fl);
+    }
+  }
+  blocks[blockIndex].free     = false;
+  blocks[blockIndex].prevFree = TLSF_INVALID_INDEX;
+  blocks[blockIndex].nextFree = TLSF_INVALID_INDEX;
+}
+
+uint32_t TLSFAllocationStrategy::findFreeBlock(VkDeviceSize size) const
+{
+  // round size up to the next list boundary, so that every block in found list is big enough ( good fit instead of best fit )
+  if (size >= TLSF_SL_COUNT)
+  {
+    VkDeviceSize round = (VkDeviceSize(1) << (tlsfHighestBit(size) - TLSF_SL_COUNT_LOG2)) - 1;
+    if (size > std::numeric_limits<VkDeviceSize>::max() - round)
+      return TLSF_INVALID_INDEX;
+    size += round;
+  }
+  uint32_t fl, sl;
+  tlsfMapping(size, fl, sl);
+
+  uint32_t slMap = slBitmap[fl] & (~0u << sl);
+  if (slMap == 0)
+  {
+    uint64_t flMap = (fl + 1 < 64) ? (flBitmap & (~0ull << (fl + 1))) : 0;
+    if (flMap == 0)
+      return TLSF_INVALID_INDEX;
+    fl    = tlsfLowestBit(flMap);
+    slMap = slBitmap[fl];
+  }
+  sl = tlsfLowestBit(slMap);
+  return freeLists[fl][sl];
+}
+
+void TLSFAllocationStrategy::splitBlock(uint32_t blockIndex, VkDeviceSize size)
+{
+  uint32_t newIndex  = createBlock(blocks[blockIndex].offset + size, blocks[blockIndex].size - size);
+  uint32_t nextIndex = blocks[blockIndex].nextPhysical;
+  blocks[newIndex].prevPhysical   = blockIndex;
+  blocks[newIndex].nextPhysical   = nextIndex;
+  if (nextIndex != TLSF_INVALID_INDEX)
+    blocks[nextIndex].prevPhysical = newIndex;
+  blocks[blockIndex].nextPhysical = newIndex;
+  blocks[blockIndex].size         = size;
+}
+
+void TLSFAllocationStrategy::mergeWithNext(uint32_t blockIndex)
+{
+  uint32_t nextIndex     = blocks[blockIndex].nextPhysical;
+  uint32_t nextNextIndex = blocks[nextIndex].nextPhysical;
+  blocks[blockIndex].size        += blocks[nextIndex].size;
+  blocks[blockIndex].nextPhysical = nextNextIndex;
+  if (nextNextIndex != TLSF_INVALID_INDEX)
+    blocks[nextNextIndex].prevPhysical = blockIndex;
+  releaseBlock(nextIndex);
+}
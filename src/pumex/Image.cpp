@@ -23,6 +23,7 @@
 #include <pumex/Image.h>
 #include <pumex/Device.h>
 #include <pumex/utils/Log.h>
+#include <algorithm>
 
 using namespace pumex;
 
@@ -57,9 +58,12 @@ ImageTraits& ImageTraits::operator=(const ImageTraits& traits)
   return *this;
 }
 
-Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAllocator> a)
-  : imageTraits{ it }, device(d->device), allocator{ a }, ownsImage{ true }
+namespace
 {
+
+VkImage createImage(VkDevice device, const ImageTraits& imageTraits)
+{
+  VkImage image;
   VkImageCreateInfo imageCI{};
     imageCI.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageCI.flags         = imageTraits.imageCreate;
@@ -76,6 +80,15 @@ Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAlloc
 //    imageCI.pQueueFamilyIndices;
     imageCI.initialLayout = imageTraits.initialLayout;
   VK_CHECK_LOG_THROW(vkCreateImage(device, &imageCI, nullptr, &image), "failed vkCreateImage");
+  return image;
+}
+
+}
+
+Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAllocator> a)
+  : imageTraits{ it }, device(d->device), allocator{ a }, ownsImage{ true }
+{
+  image = createImage(device, imageTraits);
 
   VkMemoryRequirements memReqs;
   vkGetImageMemoryRequirements(device, image, &memReqs);
@@ -95,13 +108,34 @@ Image::Image(Device* d, VkImage i, VkFormat format, const VkExtent3D& extent, ui
   imageTraits.arrayLayers = arrayLayers;
 }
 
+Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAllocator> a, VkImage i, const DeviceMemoryBlock& mb)
+  : imageTraits{ it }, device(d->device), allocator{ a }, image{ i }, memoryBlock{ mb }, ownsImage{ true }
+{
+}
+
+Image::Image(Device* d, const ImageTraits& it, const DeviceMemoryBlock& mb)
+  : imageTraits{ it }, device(d->device), memoryBlock{ mb }, ownsImage{ true }
+{
+  image = createImage(device, imageTraits);
+
+  VkMemoryRequirements memReqs;
+  vkGetImageMemoryRequirements(device, image, &memReqs);
+  bool imageFits = (memReqs.size <= memoryBlock.alignedSize) && (memoryBlock.alignedOffset % memReqs.alignment == 0);
+  if (!imageFits)
+    vkDestroyImage(device, image, nullptr);
+  CHECK_LOG_THROW(!imageFits, "Image does not fit into delivered memory block");
+  VK_CHECK_LOG_THROW(vkBindImageMemory(device, image, memoryBlock.memory, memoryBlock.alignedOffset), "failed vkBindImageMemory");
+}
+
 Image::~Image()
 {
   if (ownsImage)
   {
     if (image != VK_NULL_HANDLE)
       vkDestroyImage(device, image, nullptr);
-    allocator->deallocate(device, memoryBlock);
+    // memory is not released when it is owned by someone else
+    if (allocator != nullptr)
+      allocator->deallocate(device, memoryBlock);
   }
 }
 
@@ -113,6 +147,9 @@ void Image::getImageSubresourceLayout(VkImageSubresource& subRes, VkSubresourceL
 
 void* Image::mapMemory(size_t offset, size_t range, VkMemoryMapFlags flags)
 {
+  // memory from persistently mapped allocator cannot be mapped again
+  if (memoryBlock.mappedPointer != nullptr)
+    return memoryBlock.mappedPointer + offset;
   void* data;
   VK_CHECK_LOG_THROW(vkMapMemory(device, memoryBlock.memory, memoryBlock.alignedSize + offset, range, flags, &data), "Cannot map memory to image");
   return data;
@@ -120,9 +157,28 @@ void* Image::mapMemory(size_t offset, size_t range, VkMemoryMapFlags flags)
 
 void Image::unmapMemory()
 {
+  if (memoryBlock.mappedPointer != nullptr)
+    return;
   vkUnmapMemory(device, memoryBlock.memory);
 }
 
+std::shared_ptr<Image> Image::relocate(Device* d) const
+{
+  CHECK_LOG_THROW(!ownsImage || allocator == nullptr, "Cannot relocate image that is not owned by pumex::Image");
+  VkImage newImage = createImage(device, imageTraits);
+  // images created with the same parameters have the same memory requirements
+  VkMemoryRequirements memReqs;
+  vkGetImageMemoryRequirements(device, newImage, &memReqs);
+  DeviceMemoryBlock newBlock = allocator->reallocate(d, memReqs, memoryBlock);
+  if (newBlock.alignedSize == 0)
+  {
+    vkDestroyImage(device, newImage, nullptr);
+    return std::shared_ptr<Image>();
+  }
+  VK_CHECK_LOG_THROW(vkBindImageMemory(device, newImage, newBlock.memory, newBlock.alignedOffset), "failed vkBindImageMemory");
+  return std::make_shared<Image>(d, imageTraits, allocator, newImage, newBlock);
+}
+
 namespace pumex
 {
 
@@ -133,6 +189,27 @@ ImageTraits getImageTraitsFromTexture(const gli::texture& texture, VkImageUsageF
     texture.levels(), texture.layers(), VK_SAMPLE_COUNT_1_BIT, false, VK_IMAGE_LAYOUT_UNDEFINED, 0, vulkanImageTypeFromTextureExtents(t), VK_SHARING_MODE_EXCLUSIVE);
 }
 
+VkMemoryRequirements getImageMemoryRequirements(VkDevice device, const ImageTraits& imageTraits)
+{
+  VkImage image = createImage(device, imageTraits);
+  VkMemoryRequirements memReqs;
+  vkGetImageMemoryRequirements(device, image, &memReqs);
+  vkDestroyImage(device, image, nullptr);
+  return memReqs;
+}
+
+uint32_t getMipLevelCount(const VkExtent3D& extent)
+{
+  uint32_t maxDimension = std::max(extent.width, std::max(extent.height, extent.depth));
+  uint32_t result = 1;
+  while (maxDimension > 1)
+  {
+    maxDimension >>= 1;
+    ++result;
+  }
+  return result;
+}
+
 VkFormat vulkanFormatFromGliFormat(gli::texture::format_type format)
 {
   // Formats are almost identical. Looks like someone implemented GLI and Vulkan at the same time
@@ -29,6 +29,12 @@
 #include <pumex/CombinedImageSampler.h>
 #include <pumex/SampledImage.h>
 #include <pumex/StorageImage.h>
+#include <pumex/Descriptor.h>
+#include <pumex/TextureStreamer.h>
+#include <pumex/TextureLoaderGli.h>
+#include <pumex/TextureFile.h>
+#include <pumex/HPClock.h>
+#include <tbb/tbb.h>
 
 using namespace pumex;
 
@@ -36,6 +42,28 @@ TextureRegistryBase::~TextureRegistryBase()
 {
 }
 
+void TextureRegistryBase::setTextures(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<gli::texture>>& textures)
+{
+  for (const auto& t : textures)
+    setTexture(slotIndex, t.first, t.second);
+}
+
+bool TextureRegistryBase::supportsTextureFiles() const
+{
+  return false;
+}
+
+void TextureRegistryBase::setTextureFile(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<TextureFile> textureFile)
+{
+  setTexture(slotIndex, layerIndex, textureFile->createTexture());
+}
+
+void TextureRegistryBase::setTextureFiles(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<TextureFile>>& textureFiles)
+{
+  for (const auto& t : textureFiles)
+    setTextureFile(slotIndex, t.first, t.second);
+}
+
 MaterialRegistryBase::~MaterialRegistryBase()
 {
 }
@@ -54,6 +82,11 @@ MaterialSet::~MaterialSet()
 {
 }
 
+void MaterialSet::setTextureLoader(std::shared_ptr<TextureLoader> tl)
+{
+  textureLoader = tl;
+}
+
 bool MaterialSet::getTargetTextureNames(uint32_t index, std::vector<std::string>& texNames) const
 {
   auto it = textureNames.find(index);
@@ -71,6 +104,8 @@ bool MaterialSet::setTargetTextureLayer(uint32_t slotIndex, uint32_t layerIndex,
   if (nit->second.size() <= layerIndex)
     nit->second.resize(layerIndex + 1);
   nit->second[layerIndex] = fileName;
+  // texture set by user must not be overwritten by texture loaded in endRegisterMaterials()
+  pendingTextures.erase(std::remove_if(begin(pendingTextures), end(pendingTextures), [slotIndex, layerIndex](const std::tuple<uint32_t, uint32_t, std::string>& pt) { return std::get<0>(pt) == slotIndex && std::get<1>(pt) == layerIndex; }), end(pendingTextures));
   textureRegistry->setTexture(slotIndex, layerIndex, tex);
   return true;
 }
@@ -123,6 +158,7 @@ void MaterialSet::registerMaterialVariant(uint32_t typeID, uint32_t materialVari
 
 void MaterialSet::endRegisterMaterials()
 {
+  loadPendingTextures();
   materialRegistry->buildTypesAndVariants(*typeDefinitionBuffer->getData(), *materialVariantBuffer->getData());
   typeDefinitionBuffer->invalidateData();
   materialVariantBuffer->invalidateData();
@@ -166,9 +202,8 @@ std::map<TextureSemantic::Type, uint32_t> MaterialSet::registerTextures(const Ma
 
           auto fullFileName = viewer.lock()->getAbsoluteFilePath(it->second);
           CHECK_LOG_THROW(fullFileName.empty(), "Cannot find file : " << it->second);
-          auto tex = std::make_shared<gli::texture>(gli::load(fullFileName));
-          CHECK_LOG_THROW(tex->empty(), "Texture not loaded : " << it->second);
-          textureRegistry->setTexture(s.index, textureIndex, tex);
+          // texture will be loaded in endRegisterMaterials()
+          pendingTextures.push_back(std::make_tuple(s.index, textureIndex, fullFileName));
         }
         registeredTextures[s.type] = textureIndex;
       }
@@ -177,6 +212,71 @@ std::map<TextureSemantic::Type, uint32_t> MaterialSet::registerTextures(const Ma
   return registeredTextures;
 }
 
+void MaterialSet::loadPendingTextures()
+{
+  if (pendingTextures.empty())
+    return;
+
+  // each file is decoded only once, even when it's used in many slots
+  std::vector<std::string> fileNames;
+  for (const auto& pt : pendingTextures)
+    fileNames.push_back(std::get<2>(pt));
+  std::sort(begin(fileNames), end(fileNames));
+  fileNames.erase(std::unique(begin(fileNames), end(fileNames)), end(fileNames));
+
+  // when default loader is used and texture registry is able to use texture files - files that need no conversion are only mapped and their headers are parsed.
+  // Texture data is copied from the mapping straight to staging memory later. All other files are decoded by texture loader
+  auto decodeStart = HPClock::now();
+  bool useTextureFiles = (textureLoader == nullptr) && textureRegistry->supportsTextureFiles();
+  std::shared_ptr<TextureLoader> loader = (textureLoader != nullptr) ? textureLoader : std::make_shared<TextureLoaderGli>();
+  std::vector<std::shared_ptr<TextureFile>>  textureFiles(fileNames.size());
+  std::vector<std::shared_ptr<gli::texture>> textures(fileNames.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, fileNames.size(), 1), [&](const tbb::blocked_range<size_t>& r)
+  {
+    for (size_t i = r.begin(); i != r.end(); ++i)
+    {
+      if (useTextureFiles)
+      {
+        auto textureFile = std::make_shared<TextureFile>(fileNames[i]);
+        if (textureFile->isDirect())
+          textureFiles[i] = textureFile;
+        else
+          textures[i] = textureFile->createTexture();
+      }
+      else
+        textures[i] = loader->load(fileNames[i]);
+    }
+  });
+  for (size_t i = 0; i < fileNames.size(); ++i)
+    CHECK_LOG_THROW(textureFiles[i] == nullptr && (textures[i] == nullptr || textures[i]->empty()), "Texture not loaded : " << fileNames[i]);
+  auto decodeEnd = HPClock::now();
+
+  // all textures of a single slot are sent to texture registry in one call
+  std::map<uint32_t, std::map<uint32_t, std::shared_ptr<gli::texture>>> slotTextures;
+  std::map<uint32_t, std::map<uint32_t, std::shared_ptr<TextureFile>>>  slotTextureFiles;
+  for (const auto& pt : pendingTextures)
+  {
+    auto fit   = std::lower_bound(begin(fileNames), end(fileNames), std::get<2>(pt));
+    auto index = std::distance(begin(fileNames), fit);
+    if (textureFiles[index] != nullptr)
+      slotTextureFiles[std::get<0>(pt)][std::get<1>(pt)] = textureFiles[index];
+    else
+      slotTextures[std::get<0>(pt)][std::get<1>(pt)] = textures[index];
+  }
+  for (const auto& st : slotTextures)
+    textureRegistry->setTextures(st.first, st.second);
+  for (const auto& st : slotTextureFiles)
+    textureRegistry->setTextureFiles(st.first, st.second);
+  auto uploadEnd = HPClock::now();
+
+  textureLoadStatistics.fileCount       += fileNames.size();
+  textureLoadStatistics.directFileCount += static_cast<uint32_t>(std::count_if(begin(textureFiles), end(textureFiles), [](const std::shared_ptr<TextureFile>& textureFile) { return textureFile != nullptr; }));
+  textureLoadStatistics.layerCount += pendingTextures.size();
+  textureLoadStatistics.decodeTime += inSeconds(decodeEnd - decodeStart);
+  textureLoadStatistics.uploadTime += inSeconds(uploadEnd - decodeEnd);
+  pendingTextures.clear();
+}
+
 void TextureRegistryTextureArray::setCombinedImageSampler(uint32_t slotIndex, std::shared_ptr<MemoryImage> memoryImage, std::shared_ptr<Sampler> sampler)
 {
   memoryImages[slotIndex] = memoryImage;
@@ -213,6 +313,14 @@ void TextureRegistryTextureArray::setTexture(uint32_t slotIndex, uint32_t layerI
   it->second->setImageLayer(layerIndex, tex);
 }
 
+void TextureRegistryTextureArray::setTextures(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<gli::texture>>& textures)
+{
+  auto it = memoryImages.find(slotIndex);
+  if (it == end(memoryImages))
+    return;
+  it->second->setImageLayers(textures);
+}
+
 TextureRegistryArrayOfTextures::TextureRegistryArrayOfTextures(std::shared_ptr<DeviceMemoryAllocator> allocator, std::shared_ptr<DeviceMemoryAllocator> textureAlloc)
   : textureAllocator{ textureAlloc }
 {
@@ -248,7 +356,50 @@ std::vector<std::shared_ptr<Resource>>& TextureRegistryArrayOfTextures::getResou
   return it->second;
 }
 
+const std::vector<std::shared_ptr<MemoryImage>>& TextureRegistryArrayOfTextures::getMemoryImages(uint32_t slotIndex)
+{
+  auto it = memoryImages.find(slotIndex);
+  CHECK_LOG_THROW(it == end(memoryImages), "There's no textures registered. Slot index " << slotIndex);
+  return it->second;
+}
+
+void TextureRegistryArrayOfTextures::setTextureStreamer(std::shared_ptr<TextureStreamer> ts)
+{
+  textureStreamer = ts;
+}
+
 void TextureRegistryArrayOfTextures::setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex)
+{
+  auto tit = textureTypes.find(slotIndex);
+  CHECK_LOG_THROW(tit == end(textureTypes), "There's no textures registered. Slot index " << slotIndex);
+  // this texture will not be modified by GPU, so it is enough to declare it as swOnce
+  // sampled textures loaded without mip levels get their mip chain generated on GPU
+  bool storage     = (tit->second == 2);
+  auto memoryImage = std::make_shared<MemoryImage>(tex, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, storage ? VK_IMAGE_USAGE_STORAGE_BIT : VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice, !storage);
+  setMemoryImage(slotIndex, layerIndex, memoryImage);
+  if (textureStreamer != nullptr)
+    textureStreamer->addImage(memoryImage);
+}
+
+bool TextureRegistryArrayOfTextures::supportsTextureFiles() const
+{
+  return textureStreamer == nullptr;
+}
+
+void TextureRegistryArrayOfTextures::setTextureFile(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<TextureFile> textureFile)
+{
+  if (textureStreamer != nullptr || !textureFile->isDirect())
+  {
+    setTexture(slotIndex, layerIndex, textureFile->createTexture());
+    return;
+  }
+  auto tit = textureTypes.find(slotIndex);
+  CHECK_LOG_THROW(tit == end(textureTypes), "There's no textures registered. Slot index " << slotIndex);
+  bool storage = (tit->second == 2);
+  setMemoryImage(slotIndex, layerIndex, std::make_shared<MemoryImage>(textureFile, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, storage ? VK_IMAGE_USAGE_STORAGE_BIT : VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice, !storage));
+}
+
+void TextureRegistryArrayOfTextures::setMemoryImage(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<MemoryImage> memoryImage)
 {
   auto it = memoryImages.find(slotIndex);
   CHECK_LOG_THROW(it == end(memoryImages), "There's no textures registered. Slot index " << slotIndex);
@@ -259,20 +410,151 @@ void TextureRegistryArrayOfTextures::setTexture(uint32_t slotIndex, uint32_t lay
     it->second.resize(layerIndex + 1);
     rit->second.resize(layerIndex + 1);
   }
-  // this texture will not be modified by GPU, so it is enough to declare it as swOnce
+  it->second[layerIndex] = memoryImage;
+  auto imageView = std::make_shared<ImageView>(memoryImage, memoryImage->getFullImageRange(), VK_IMAGE_VIEW_TYPE_2D);
   switch (textureTypes[slotIndex])
   {
   case 0: // combined image samplers
-    it->second[layerIndex]  = std::make_shared<MemoryImage>(tex, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice);
-    rit->second[layerIndex] = std::make_shared<CombinedImageSampler>(std::make_shared<ImageView>(it->second[layerIndex], it->second[layerIndex]->getFullImageRange(), VK_IMAGE_VIEW_TYPE_2D), textureSamplers[slotIndex]);
+    rit->second[layerIndex] = std::make_shared<CombinedImageSampler>(imageView, textureSamplers[slotIndex]);
     break;
   case 1: // sampled images
-    it->second[layerIndex]  = std::make_shared<MemoryImage>(tex, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice);
-    rit->second[layerIndex] = std::make_shared<SampledImage>(std::make_shared<ImageView>(it->second[layerIndex], it->second[layerIndex]->getFullImageRange(), VK_IMAGE_VIEW_TYPE_2D));
+    rit->second[layerIndex] = std::make_shared<SampledImage>(imageView);
     break;
   case 2: // storage images
-    it->second[layerIndex]  = std::make_shared<MemoryImage>(tex, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_STORAGE_BIT, pbPerDevice);
-    rit->second[layerIndex] = std::make_shared<StorageImage>(std::make_shared<ImageView>(it->second[layerIndex], it->second[layerIndex]->getFullImageRange(), VK_IMAGE_VIEW_TYPE_2D));
+    rit->second[layerIndex] = std::make_shared<StorageImage>(imageView);
     break;
   }
 }
+
+TextureRegistryBindless::TextureRegistryBindless(std::shared_ptr<DeviceMemoryAllocator> textureAlloc, uint32_t mtc)
+  : textureAllocator{ textureAlloc }, maxTextureCount{ mtc }
+{
+}
+
+void TextureRegistryBindless::setCombinedImageSampler(uint32_t slotIndex, std::shared_ptr<Sampler> sampler)
+{
+  textureTypes[slotIndex]    = 0;
+  textureSamplers[slotIndex] = sampler;
+  memoryImages[slotIndex]    = std::vector<std::shared_ptr<MemoryImage>>();
+  resources[slotIndex]       = std::vector<std::shared_ptr<Resource>>();
+}
+
+void TextureRegistryBindless::setSampledImage(uint32_t slotIndex)
+{
+  textureTypes[slotIndex]    = 1;
+  memoryImages[slotIndex]    = std::vector<std::shared_ptr<MemoryImage>>();
+  resources[slotIndex]       = std::vector<std::shared_ptr<Resource>>();
+}
+
+DescriptorSetLayoutBinding TextureRegistryBindless::getLayoutBinding(uint32_t slotIndex, uint32_t binding, VkShaderStageFlags stageFlags) const
+{
+  auto it = textureTypes.find(slotIndex);
+  CHECK_LOG_THROW(it == end(textureTypes), "There's no textures registered. Slot index " << slotIndex);
+  VkDescriptorType descriptorType = (it->second == 0) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  // descriptor sets are written per swapchain image, after previous use of that image has finished. So UPDATE_UNUSED_WHILE_PENDING is not required
+  return DescriptorSetLayoutBinding(binding, maxTextureCount, descriptorType, stageFlags, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT);
+}
+
+void TextureRegistryBindless::addDescriptorSet(uint32_t slotIndex, std::shared_ptr<DescriptorSet> descriptorSet, uint32_t binding)
+{
+  CHECK_LOG_THROW(textureTypes.find(slotIndex) == end(textureTypes), "There's no textures registered. Slot index " << slotIndex);
+  descriptorSets.insert({ slotIndex, { descriptorSet, binding } });
+  if (!resources[slotIndex].empty())
+    descriptorSet->setDescriptor(binding, resources[slotIndex], (textureTypes[slotIndex] == 0) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+}
+
+const std::vector<std::shared_ptr<Resource>>& TextureRegistryBindless::getResources(uint32_t slotIndex)
+{
+  auto it = resources.find(slotIndex);
+  CHECK_LOG_THROW(it == end(resources), "There's no resource registered. Slot index " << slotIndex);
+  return it->second;
+}
+
+const std::vector<std::shared_ptr<MemoryImage>>& TextureRegistryBindless::getMemoryImages(uint32_t slotIndex)
+{
+  auto it = memoryImages.find(slotIndex);
+  CHECK_LOG_THROW(it == end(memoryImages), "There's no textures registered. Slot index " << slotIndex);
+  return it->second;
+}
+
+void TextureRegistryBindless::setTextureStreamer(std::shared_ptr<TextureStreamer> ts)
+{
+  textureStreamer = ts;
+}
+
+void TextureRegistryBindless::setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex)
+{
+  createTexture(slotIndex, layerIndex, std::make_shared<MemoryImage>(tex, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice, true));
+  updateDescriptorSets(slotIndex);
+}
+
+void TextureRegistryBindless::setTextures(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<gli::texture>>& textures)
+{
+  // descriptor sets are updated once for all textures
+  for (const auto& t : textures)
+    createTexture(slotIndex, t.first, std::make_shared<MemoryImage>(t.second, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice, true));
+  updateDescriptorSets(slotIndex);
+}
+
+bool TextureRegistryBindless::supportsTextureFiles() const
+{
+  return true;
+}
+
+void TextureRegistryBindless::setTextureFile(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<TextureFile> textureFile)
+{
+  setTextureFiles(slotIndex, { { layerIndex, textureFile } });
+}
+
+void TextureRegistryBindless::setTextureFiles(uint32_t slotIndex, const std::map<uint32_t, std::shared_ptr<TextureFile>>& textureFiles)
+{
+  for (const auto& t : textureFiles)
+  {
+    if (t.second->isDirect())
+      createTexture(slotIndex, t.first, std::make_shared<MemoryImage>(t.second, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice, true));
+    else
+      createTexture(slotIndex, t.first, std::make_shared<MemoryImage>(t.second->createTexture(), textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice, true));
+  }
+  updateDescriptorSets(slotIndex);
+}
+
+void TextureRegistryBindless::createTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<MemoryImage> memoryImage)
+{
+  auto it = memoryImages.find(slotIndex);
+  CHECK_LOG_THROW(it == end(memoryImages), "There's no textures registered. Slot index " << slotIndex);
+  CHECK_LOG_THROW(layerIndex >= maxTextureCount, "Texture index out of bounds : " << layerIndex << " should be lower than " << maxTextureCount);
+  auto rit = resources.find(slotIndex);
+
+  // elements that were not set yet stay empty. Descriptor arrays are partially bound, so these elements are not written to descriptor sets
+  if (layerIndex >= it->second.size())
+  {
+    it->second.resize(layerIndex + 1);
+    rit->second.resize(layerIndex + 1);
+  }
+  it->second[layerIndex] = memoryImage;
+  auto imageView = std::make_shared<ImageView>(it->second[layerIndex], it->second[layerIndex]->getFullImageRange(), VK_IMAGE_VIEW_TYPE_2D);
+  if (textureTypes[slotIndex] == 0)
+    rit->second[layerIndex] = std::make_shared<CombinedImageSampler>(imageView, textureSamplers[slotIndex]);
+  else
+    rit->second[layerIndex] = std::make_shared<SampledImage>(imageView);
+  if (textureStreamer != nullptr)
+    textureStreamer->addImage(memoryImage);
+}
+
+// descriptor is recreated with all resources of a slot. Descriptor set handle stays the same
+void TextureRegistryBindless::updateDescriptorSets(uint32_t slotIndex)
+{
+  VkDescriptorType descriptorType = (textureTypes[slotIndex] == 0) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  auto range = descriptorSets.equal_range(slotIndex);
+  for (auto it = range.first; it != range.second; )
+  {
+    auto descriptorSet = it->second.first.lock();
+    if (descriptorSet == nullptr)
+    {
+      it = descriptorSets.erase(it);
+      continue;
+    }
+    descriptorSet->setDescriptor(it->second.second, resources[slotIndex], descriptorType);
+    ++it;
+  }
+}
@@ -44,15 +44,73 @@ bool BufferSubresourceRange::contains(const BufferSubresourceRange& subRange) co
   return (offset <= subRange.offset) && (offset + range >= subRange.offset + subRange.range);
 }
 
+// moves buffer data to a place in memory chosen by DeviceMemoryAllocator::reallocate()
+struct RelocateBufferOperation : public MemoryBuffer::Operation
+{
+  RelocateBufferOperation(MemoryBuffer* o, const std::vector<DeviceMemoryBlock>& b, uint32_t ac)
+    : MemoryBuffer::Operation(o, MemoryBuffer::Operation::Relocate, BufferSubresourceRange(), ac), blocks(b)
+  {}
+  bool perform(const RenderContext& renderContext, MemoryBuffer::MemoryBufferInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
+  {
+    // buffer may have been recreated since relocation was planned
+    if (internals.buffer == VK_NULL_HANDLE || std::none_of(begin(blocks), end(blocks), [&internals](const DeviceMemoryBlock& b) { return b.memory == internals.memoryBlock.memory && b.realOffset == internals.memoryBlock.realOffset; }))
+      return false;
+    auto ownerAllocator = owner->getAllocator();
+    VkBuffer newBuffer;
+    VkBufferCreateInfo bufferCreateInfo{};
+      bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      bufferCreateInfo.usage = owner->getBufferUsage();
+      bufferCreateInfo.size  = std::max<VkDeviceSize>(1, internals.dataSize);
+    VK_CHECK_LOG_THROW(vkCreateBuffer(renderContext.vkDevice, &bufferCreateInfo, nullptr, &newBuffer), "Cannot create a buffer");
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(renderContext.vkDevice, newBuffer, &memReqs);
+    DeviceMemoryBlock newBlock = ownerAllocator->reallocate(renderContext.device, memReqs, internals.memoryBlock);
+    if (newBlock.alignedSize == 0)
+    {
+      vkDestroyBuffer(renderContext.vkDevice, newBuffer, nullptr);
+      return false;
+    }
+    ownerAllocator->bindBufferMemory(renderContext.device, newBuffer, newBlock);
+
+    VkBufferCopy copyRegion{};
+      copyRegion.size = bufferCreateInfo.size;
+    commandBuffer->cmdCopyBuffer(internals.buffer, newBuffer, copyRegion);
+    // old buffer is released after the copy is finished - the same way SetBufferSizeOperation releases it
+    oldBuffers.push_back({ internals.buffer, internals.memoryBlock });
+    internals.buffer      = newBuffer;
+    internals.memoryBlock = newBlock;
+
+    owner->notifyCommandBufferSources(renderContext);
+    owner->notifyBufferViews(renderContext, BufferSubresourceRange(0, internals.dataSize));
+    owner->notifyResources(renderContext);
+    return true;
+  }
+  void releaseResources(const RenderContext& renderContext) override
+  {
+    for (auto& ob : oldBuffers)
+    {
+      vkDestroyBuffer(renderContext.vkDevice, ob.first, nullptr);
+      owner->getAllocator()->deallocate(renderContext.vkDevice, ob.second);
+    }
+    oldBuffers.clear();
+  }
+
+  std::vector<DeviceMemoryBlock>                      blocks;
+  std::vector<std::pair<VkBuffer, DeviceMemoryBlock>> oldBuffers;
+};
+
 MemoryBuffer::MemoryBuffer(std::shared_ptr<DeviceMemoryAllocator> a, VkBufferUsageFlags bu, PerObjectBehaviour pob, SwapChainImageBehaviour scib, bool sdpo, bool usdm)
   : MemoryObject(MemoryObject::moBuffer), perObjectBehaviour{ pob }, swapChainImageBehaviour{ scib }, sameDataPerObject{ sdpo }, allocator{ a }, bufferUsage{ bu }, activeCount{ 1 }
 {
+  // buffers that are able to receive data are also able to send it, so they may be moved during defragmentation
   if (usdm)
-    bufferUsage = bufferUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferUsage = bufferUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  allocator->registerMemoryObject(this);
 }
 
 MemoryBuffer::~MemoryBuffer()
 {
+  allocator->unregisterMemoryObject(this);
   std::lock_guard<std::mutex> lock(mutex);
   for (auto& pdd : perObjectData)
   {
@@ -69,6 +127,53 @@ MemoryBuffer* MemoryBuffer::asMemoryBuffer()
   return this;
 }
 
+void MemoryBuffer::getRelocatableMemoryBlocks(VkDevice device, std::vector<DeviceMemoryBlock>& blocks) const
+{
+  const VkBufferUsageFlags transferFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  if ((bufferUsage & transferFlags) != transferFlags)
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& pdd : perObjectData)
+  {
+    if (pdd.second.device != device)
+      continue;
+    // do not plan new moves before previous ones are finished
+    if (std::any_of(begin(pdd.second.commonData.bufferOperations), end(pdd.second.commonData.bufferOperations), [](std::shared_ptr<Operation> bufop) { return bufop->type == MemoryBuffer::Operation::Relocate; }))
+      continue;
+    for (auto& d : pdd.second.data)
+      if (d.buffer != VK_NULL_HANDLE && d.memoryBlock.memory != VK_NULL_HANDLE)
+        blocks.push_back(d.memoryBlock);
+  }
+}
+
+void MemoryBuffer::relocateMemoryBlocks(VkDevice device, const std::vector<DeviceMemoryBlock>& blocks)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bool relocated = false;
+  for (auto& pdd : perObjectData)
+  {
+    if (pdd.second.device != device)
+      continue;
+    auto operation = std::make_shared<RelocateBufferOperation>(this, blocks, activeCount);
+    bool found = false;
+    for (uint32_t i = 0; i < pdd.second.data.size(); ++i)
+    {
+      bool moved = std::any_of(begin(blocks), end(blocks), [&](const DeviceMemoryBlock& b) { return b.memory == pdd.second.data[i].memoryBlock.memory && b.realOffset == pdd.second.data[i].memoryBlock.realOffset; });
+      // only chosen buffers are moved, operation is marked as done for the rest of them
+      operation->updated[i] = !moved;
+      if (moved)
+        pdd.second.valid[i] = false;
+      found |= moved;
+    }
+    if (!found)
+      continue;
+    pdd.second.commonData.bufferOperations.push_back(operation);
+    relocated = true;
+  }
+  if (relocated)
+    invalidateResources();
+}
+
 VkBuffer MemoryBuffer::getHandleBuffer(const RenderContext& renderContext) const
 {
   std::lock_guard<std::mutex> lock(mutex);
@@ -128,7 +233,7 @@ void MemoryBuffer::validate(const RenderContext& renderContext)
     pddit->second.data[activeIndex].dataSize    = bufferCreateInfo.size;
     pddit->second.data[activeIndex].memoryBlock = allocator->allocate(renderContext.device, memReqs);
     CHECK_LOG_THROW(pddit->second.data[activeIndex].memoryBlock.alignedSize == 0, "Cannot create a bufer");
-    allocator->bindBufferMemory(renderContext.device, pddit->second.data[activeIndex].buffer, pddit->second.data[activeIndex].memoryBlock.alignedOffset);
+    allocator->bindBufferMemory(renderContext.device, pddit->second.data[activeIndex].buffer, pddit->second.data[activeIndex].memoryBlock);
 
     BufferSubresourceRange allBufferRange(0, getDataSize());
     notifyCommandBufferSources(renderContext);
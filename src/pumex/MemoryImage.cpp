@@ -23,9 +23,12 @@
 #include <pumex/MemoryImage.h>
 #include <pumex/Surface.h>
 #include <pumex/Device.h>
+#include <pumex/PhysicalDevice.h>
 #include <pumex/Command.h>
 #include <pumex/RenderContext.h>
 #include <pumex/Resource.h>
+#include <pumex/TextureFile.h>
+#include <pumex/Viewer.h>
 #include <pumex/utils/Buffer.h>
 #include <pumex/utils/Log.h>
 #include <algorithm>
@@ -64,6 +67,38 @@ bool ImageSubresourceRange::contains(const ImageSubresourceRange& subRange) cons
   return true;
 }
 
+namespace
+{
+
+std::shared_ptr<Viewer> getViewer(const RenderContext& renderContext)
+{
+  if (renderContext.surface == nullptr)
+    return std::shared_ptr<Viewer>();
+  return renderContext.surface->viewer.lock();
+}
+
+// replaced image may still be used by up to imageCount frames that are being rendered at the moment, so it's released after these frames.
+// When there's no viewer that counts the frames - image is released during next validation
+void releaseImageLater(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<Image> image)
+{
+  if (image == nullptr)
+    return;
+  auto viewer = getViewer(renderContext);
+  unsigned long long releaseFrame = (viewer != nullptr) ? viewer->getFrameNumber() + renderContext.imageCount : 0;
+  internals.releasedImages.push_back({ releaseFrame, image });
+}
+
+void releaseUnusedImages(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals)
+{
+  if (internals.releasedImages.empty())
+    return;
+  auto viewer = getViewer(renderContext);
+  unsigned long long frameNumber = (viewer != nullptr) ? viewer->getFrameNumber() : 0;
+  internals.releasedImages.remove_if([frameNumber](const std::pair<unsigned long long, std::shared_ptr<Image>>& ri) { return ri.first <= frameNumber; });
+}
+
+}
+
 struct SetImageTraitsOperation : public MemoryImage::Operation
 {
   SetImageTraitsOperation(MemoryImage* o, const ImageTraits& t, VkImageAspectFlags am, uint32_t ac)
@@ -72,7 +107,11 @@ struct SetImageTraitsOperation : public MemoryImage::Operation
   bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
   {
     internals.image = nullptr; // release image before creating a new one
-    internals.image = std::make_shared<Image>(renderContext.device, imageTraits, owner->getAllocator());
+    auto memoryAliasGroup = owner->getMemoryAliasGroup();
+    if (memoryAliasGroup != nullptr)
+      internals.image = memoryAliasGroup->createImage(getKeyID(renderContext, owner->getPerObjectBehaviour()), renderContext.device, imageTraits);
+    else
+      internals.image = std::make_shared<Image>(renderContext.device, imageTraits, owner->getAllocator());
     owner->notifyCommandBufferSources(renderContext);
     owner->notifyImageViews(renderContext, imageRange);
     // no operations sent to command buffer
@@ -89,9 +128,10 @@ struct SetImageOperation : public MemoryImage::Operation
   bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
   {
     CHECK_LOG_THROW(internals.image == nullptr, "Image was not created before call to setImage operation, which should not happen because this call is made automatically during setImage() setup...");
-    gli::texture::extent_type extent = texture->extent();
+    // source mip levels may differ from target mip levels ( e.g. when only some levels of a texture are resident )
+    gli::texture::extent_type extent = texture->extent(sourceRange.baseMipLevel);
     const ImageTraits& imageTraits   = internals.image->getImageTraits();
-    VkExtent3D currExtent            = imageTraits.extent;
+    VkExtent3D currExtent{ std::max(1u, imageTraits.extent.width >> imageRange.baseMipLevel), std::max(1u, imageTraits.extent.height >> imageRange.baseMipLevel), std::max(1u, imageTraits.extent.depth >> imageRange.baseMipLevel) };
     CHECK_LOG_THROW((extent.x != currExtent.width) || (extent.y != currExtent.height) || (extent.z != currExtent.depth), "MemoryImage has wrong size : ( " << extent.x << " x " << extent.y << " x " << extent.z << " ) should be ( " << currExtent.width << " x " << currExtent.height << " x " << currExtent.depth << " )");
 
     auto ownerAllocator = owner->getAllocator();
@@ -100,9 +140,12 @@ struct SetImageOperation : public MemoryImage::Operation
 
     if (memoryIsLocal)
     {
-      // copy texture data to staging buffer manually
-      auto stagingBuffer = renderContext.device->acquireStagingBuffer(nullptr, texture->size());
-      unsigned char* mapAddress = (unsigned char*)stagingBuffer->mapMemory(texture->size());
+      // copy texture data to staging region manually. Buffer offset must be a multiple of 4 and of texel block size
+      size_t stagingSize = 0;
+      for (uint32_t level = sourceRange.baseMipLevel; level < sourceRange.baseMipLevel + sourceRange.levelCount; ++level)
+        stagingSize += texture->size(level) * sourceRange.layerCount;
+      auto stagingRegion = renderContext.device->acquireStagingRegion(nullptr, stagingSize, 4 * gli::block_size(texture->format()));
+      unsigned char* mapAddress = stagingRegion.mappedPointer;
       size_t offset = 0;
       for (uint32_t layer = sourceRange.baseArrayLayer; layer < sourceRange.baseArrayLayer + sourceRange.layerCount; ++layer)
       {
@@ -112,25 +155,24 @@ struct SetImageOperation : public MemoryImage::Operation
           offset += texture->size(level);
         }
       }
-      stagingBuffer->unmapMemory();
 
       // we have to copy a texture to local device memory using staging buffers
       std::vector<VkBufferImageCopy> bufferCopyRegions;
       offset = 0;
-      for (uint32_t layer = imageRange.baseArrayLayer ; layer < imageRange.baseArrayLayer + imageRange.layerCount; ++layer)
+      for (uint32_t layer = sourceRange.baseArrayLayer, targetLayer = imageRange.baseArrayLayer; layer < sourceRange.baseArrayLayer + sourceRange.layerCount; ++layer, ++targetLayer)
       {
-        for (uint32_t level = imageRange.baseMipLevel; level < imageRange.baseMipLevel + imageRange.levelCount; ++level)
+        for (uint32_t level = sourceRange.baseMipLevel, targetLevel = imageRange.baseMipLevel; level < sourceRange.baseMipLevel + sourceRange.levelCount; ++level, ++targetLevel)
         {
           auto mipMapExtents = texture->extent(level);
           VkBufferImageCopy bufferCopyRegion{};
             bufferCopyRegion.imageSubresource.aspectMask     = aspectMask;
-            bufferCopyRegion.imageSubresource.mipLevel       = level;
-            bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
+            bufferCopyRegion.imageSubresource.mipLevel       = targetLevel;
+            bufferCopyRegion.imageSubresource.baseArrayLayer = targetLayer;
             bufferCopyRegion.imageSubresource.layerCount     = 1;
             bufferCopyRegion.imageExtent.width               = static_cast<uint32_t>(mipMapExtents.x);
             bufferCopyRegion.imageExtent.height              = static_cast<uint32_t>(mipMapExtents.y);
             bufferCopyRegion.imageExtent.depth               = static_cast<uint32_t>(mipMapExtents.z);
-            bufferCopyRegion.bufferOffset                    = offset;
+            bufferCopyRegion.bufferOffset                    = stagingRegion.offset + offset;
           bufferCopyRegions.push_back(bufferCopyRegion);
 
           // Increase offset into staging buffer for next level / face
@@ -142,12 +184,12 @@ struct SetImageOperation : public MemoryImage::Operation
       commandBuffer->setImageLayout( *(internals.image), aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
       // Copy mip levels from staging buffer
-      commandBuffer->cmdCopyBufferToImage(stagingBuffer->buffer, *(internals.image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopyRegions);
+      commandBuffer->cmdCopyBufferToImage(stagingRegion.buffer, *(internals.image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopyRegions);
 
       // Change texture image layout to shader read after all mip levels have been copied
       commandBuffer->setImageLayout( *(internals.image), aspectMask, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
 
-      stagingBuffers.push_back(stagingBuffer);
+      stagingRegions.push_back(stagingRegion);
     }
     else
     {
@@ -179,14 +221,110 @@ struct SetImageOperation : public MemoryImage::Operation
   }
   void releaseResources(const RenderContext& renderContext) override
   {
-    for (auto& s : stagingBuffers)
-      renderContext.device->releaseStagingBuffer(s);
-    stagingBuffers.clear();
+    for (auto& s : stagingRegions)
+      renderContext.device->releaseStagingRegion(s);
+    stagingRegions.clear();
   }
 
   std::shared_ptr<gli::texture>               texture;
   ImageSubresourceRange                       sourceRange;
-  std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
+  std::vector<StagingRegion> stagingRegions;
+};
+
+// sends texture data straight from memory mapped texture file - levels are copied from the mapping to staging region one by one.
+// Texture level baseLevel is sent to image level imageRange.baseMipLevel, so pages of the file that hold levels not sent to GPU are never read from disk
+struct SetImageFileOperation : public MemoryImage::Operation
+{
+  SetImageFileOperation(MemoryImage* o, const ImageSubresourceRange& r, std::shared_ptr<TextureFile> tf, uint32_t bl, uint32_t ac)
+    : MemoryImage::Operation(o, MemoryImage::Operation::SetImage, r, ac), textureFile{ tf }, baseLevel{ bl }
+  {}
+  bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
+  {
+    CHECK_LOG_THROW(internals.image == nullptr, "Image was not created before call to setImage operation, which should not happen because this call is made automatically during setImage() setup...");
+
+    auto ownerAllocator = owner->getAllocator();
+    bool memoryIsLocal  = ((ownerAllocator->getMemoryPropertyFlags() & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    auto aspectMask     = imageRange.aspectMask;
+    uint32_t layers     = static_cast<uint32_t>(textureFile->getLayers());
+    uint32_t faces      = static_cast<uint32_t>(textureFile->getFaces());
+    uint32_t levels     = imageRange.levelCount;
+
+    if (memoryIsLocal)
+    {
+      // Buffer offset must be a multiple of 4 and of texel block size. Sizes of all levels are multiples of block size, so levels may be packed tightly
+      size_t stagingSize = 0;
+      for (uint32_t level = 0; level < levels; ++level)
+        stagingSize += textureFile->size(baseLevel + level) * layers * faces;
+      auto stagingRegion = renderContext.device->acquireStagingRegion(nullptr, stagingSize, 4 * gli::block_size(textureFile->getFormat()));
+      std::vector<VkBufferImageCopy> bufferCopyRegions;
+      size_t offset = 0;
+      for (uint32_t layer = 0; layer < layers; ++layer)
+      {
+        for (uint32_t face = 0; face < faces; ++face)
+        {
+          for (uint32_t level = 0; level < levels; ++level)
+          {
+            std::memcpy(stagingRegion.mappedPointer + offset, textureFile->data(layer, face, baseLevel + level), textureFile->size(baseLevel + level));
+
+            auto mipMapExtents = textureFile->getExtent(baseLevel + level);
+            VkBufferImageCopy bufferCopyRegion{};
+              bufferCopyRegion.imageSubresource.aspectMask     = aspectMask;
+              bufferCopyRegion.imageSubresource.mipLevel       = imageRange.baseMipLevel + level;
+              bufferCopyRegion.imageSubresource.baseArrayLayer = layer * faces + face;
+              bufferCopyRegion.imageSubresource.layerCount     = 1;
+              bufferCopyRegion.imageExtent.width               = static_cast<uint32_t>(mipMapExtents.x);
+              bufferCopyRegion.imageExtent.height              = static_cast<uint32_t>(mipMapExtents.y);
+              bufferCopyRegion.imageExtent.depth               = static_cast<uint32_t>(mipMapExtents.z);
+              bufferCopyRegion.bufferOffset                    = stagingRegion.offset + offset;
+            bufferCopyRegions.push_back(bufferCopyRegion);
+
+            offset += textureFile->size(baseLevel + level);
+          }
+        }
+      }
+      commandBuffer->setImageLayout(*(internals.image), aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+      commandBuffer->cmdCopyBufferToImage(stagingRegion.buffer, *(internals.image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopyRegions);
+      commandBuffer->setImageLayout(*(internals.image), aspectMask, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+
+      stagingRegions.push_back(stagingRegion);
+    }
+    else
+    {
+      // only works for images created with linear tiling
+      unsigned char* data = (unsigned char*)internals.image->mapMemory(0, internals.image->getMemorySize(), 0);
+      for (uint32_t layer = 0; layer < layers; ++layer)
+      {
+        for (uint32_t face = 0; face < faces; ++face)
+        {
+          for (uint32_t level = 0; level < levels; ++level)
+          {
+            VkImageSubresource subRes{};
+            subRes.aspectMask = aspectMask;
+            subRes.arrayLayer = layer * faces + face;
+            subRes.mipLevel   = imageRange.baseMipLevel + level;
+
+            VkSubresourceLayout subResLayout;
+            internals.image->getImageSubresourceLayout(subRes, subResLayout);
+            std::memcpy(data + subResLayout.offset, textureFile->data(layer, face, baseLevel + level), textureFile->size(baseLevel + level));
+          }
+        }
+      }
+      internals.image->unmapMemory();
+
+      commandBuffer->setImageLayout(*(internals.image), aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    return memoryIsLocal;
+  }
+  void releaseResources(const RenderContext& renderContext) override
+  {
+    for (auto& s : stagingRegions)
+      renderContext.device->releaseStagingRegion(s);
+    stagingRegions.clear();
+  }
+
+  std::shared_ptr<TextureFile> textureFile;
+  uint32_t                     baseLevel;
+  std::vector<StagingRegion>   stagingRegions;
 };
 
 struct NotifyImageViewsOperation : public MemoryImage::Operation
@@ -224,14 +362,161 @@ struct ClearImageOperation : public MemoryImage::Operation
   VkClearValue clearValue;
 };
 
+// fills mip levels 1..n of the image using blits from the previous level. Operation is added after each upload of level 0
+struct GenerateMipmapsOperation : public MemoryImage::Operation
+{
+  GenerateMipmapsOperation(MemoryImage* o, const ImageSubresourceRange& r, uint32_t ac)
+    : MemoryImage::Operation(o, MemoryImage::Operation::GenerateMipmaps, r, ac)
+  {}
+  bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
+  {
+    CHECK_LOG_THROW(internals.image == nullptr, "Image was not created before call to generateMipmaps operation");
+    const ImageTraits& traits = internals.image->getImageTraits();
+    if (traits.mipLevels < 2)
+      return false;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(renderContext.device->physical.lock()->physicalDevice, traits.format, &formatProperties);
+    const VkFormatFeatureFlags blitFlags = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ((formatProperties.optimalTilingFeatures & blitFlags) != blitFlags)
+    {
+      LOG_WARNING << "Cannot generate mipmaps - image format " << traits.format << " does not support blits" << std::endl;
+      return false;
+    }
+    VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    for (uint32_t level = 1; level < traits.mipLevels; ++level)
+    {
+      ImageSubresourceRange srcRange(imageRange.aspectMask, level - 1, 1, 0, traits.arrayLayers);
+      ImageSubresourceRange dstRange(imageRange.aspectMask, level, 1, 0, traits.arrayLayers);
+      // level 0 was uploaded and left in general layout, every next level was a blit target in previous iteration
+      VkImageLayout srcLayout = (level == 1) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      commandBuffer->setImageLayout(*(internals.image), imageRange.aspectMask, srcLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, srcRange.getSubresource());
+      commandBuffer->setImageLayout(*(internals.image), imageRange.aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, dstRange.getSubresource());
+
+      VkImageBlit imageBlit{};
+        imageBlit.srcSubresource.aspectMask     = imageRange.aspectMask;
+        imageBlit.srcSubresource.mipLevel       = level - 1;
+        imageBlit.srcSubresource.baseArrayLayer = 0;
+        imageBlit.srcSubresource.layerCount     = traits.arrayLayers;
+        imageBlit.srcOffsets[1].x               = std::max(1u, traits.extent.width  >> (level - 1));
+        imageBlit.srcOffsets[1].y               = std::max(1u, traits.extent.height >> (level - 1));
+        imageBlit.srcOffsets[1].z               = std::max(1u, traits.extent.depth  >> (level - 1));
+        imageBlit.dstSubresource                = imageBlit.srcSubresource;
+        imageBlit.dstSubresource.mipLevel       = level;
+        imageBlit.dstOffsets[1].x               = std::max(1u, traits.extent.width  >> level);
+        imageBlit.dstOffsets[1].y               = std::max(1u, traits.extent.height >> level);
+        imageBlit.dstOffsets[1].z               = std::max(1u, traits.extent.depth  >> level);
+      commandBuffer->cmdBlitImage(*(internals.image), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *(internals.image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, { imageBlit }, filter);
+
+      commandBuffer->setImageLayout(*(internals.image), imageRange.aspectMask, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, srcRange.getSubresource());
+    }
+    ImageSubresourceRange lastRange(imageRange.aspectMask, traits.mipLevels - 1, 1, 0, traits.arrayLayers);
+    commandBuffer->setImageLayout(*(internals.image), imageRange.aspectMask, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, lastRange.getSubresource());
+    return true;
+  }
+};
+
+// moves image to a place in memory chosen by DeviceMemoryAllocator::reallocate(). Images owned by MemoryImage
+// are kept in VK_IMAGE_LAYOUT_GENERAL between operations, so the content is copied using that layout
+struct RelocateImageOperation : public MemoryImage::Operation
+{
+  RelocateImageOperation(MemoryImage* o, const std::vector<DeviceMemoryBlock>& b, uint32_t ac)
+    : MemoryImage::Operation(o, MemoryImage::Operation::Relocate, o->getFullImageRange(), ac), blocks(b)
+  {}
+  bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
+  {
+    // image may have been recreated since relocation was planned
+    if (internals.image == nullptr)
+      return false;
+    const DeviceMemoryBlock& memoryBlock = internals.image->getMemoryBlock();
+    if (std::none_of(begin(blocks), end(blocks), [&memoryBlock](const DeviceMemoryBlock& b) { return b.memory == memoryBlock.memory && b.realOffset == memoryBlock.realOffset; }))
+      return false;
+    auto newImage = internals.image->relocate(renderContext.device);
+    if (newImage == nullptr)
+      return false;
+
+    const ImageTraits& traits = internals.image->getImageTraits();
+    std::vector<VkImageCopy> imageCopyRegions;
+    for (uint32_t level = 0; level < traits.mipLevels; ++level)
+    {
+      VkImageCopy imageCopyRegion{};
+        imageCopyRegion.srcSubresource.aspectMask     = imageRange.aspectMask;
+        imageCopyRegion.srcSubresource.mipLevel       = level;
+        imageCopyRegion.srcSubresource.baseArrayLayer = 0;
+        imageCopyRegion.srcSubresource.layerCount     = traits.arrayLayers;
+        imageCopyRegion.dstSubresource                = imageCopyRegion.srcSubresource;
+        imageCopyRegion.extent.width                  = std::max(1u, traits.extent.width >> level);
+        imageCopyRegion.extent.height                 = std::max(1u, traits.extent.height >> level);
+        imageCopyRegion.extent.depth                  = std::max(1u, traits.extent.depth >> level);
+      imageCopyRegions.push_back(imageCopyRegion);
+    }
+    commandBuffer->setImageLayout(*newImage, imageRange.aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    commandBuffer->cmdCopyImage(*(internals.image), VK_IMAGE_LAYOUT_GENERAL, *newImage, VK_IMAGE_LAYOUT_GENERAL, imageCopyRegions);
+    commandBuffer->setImageLayout(*newImage, imageRange.aspectMask, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+
+    // old image is released after the copy and all frames that use it are finished
+    ImageSubresourceRange fullRange(imageRange.aspectMask, 0, traits.mipLevels, 0, traits.arrayLayers);
+    releaseImageLater(renderContext, internals, internals.image);
+    internals.image = newImage;
+    owner->notifyCommandBufferSources(renderContext);
+    owner->notifyImageViews(renderContext, fullRange);
+    return true;
+  }
+
+  std::vector<DeviceMemoryBlock> blocks;
+};
+
+// copies mip levels that stay resident from previous image to the new one, when resident mip level of a texture changes.
+// Image levels starting from imageRange.baseMipLevel receive levels of source image starting from sourceLevel.
+// When no other operation sent data to the image before - the copy is responsible for image layout initialization
+struct CopyResidentLevelsOperation : public MemoryImage::Operation
+{
+  CopyResidentLevelsOperation(MemoryImage* o, const ImageSubresourceRange& r, std::shared_ptr<Image> si, uint32_t sl, bool il, uint32_t ac)
+    : MemoryImage::Operation(o, MemoryImage::Operation::SetImage, r, ac), sourceImage{ si }, sourceLevel{ sl }, initializeLayout{ il }
+  {}
+  bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
+  {
+    CHECK_LOG_THROW(internals.image == nullptr, "Image was not created before call to copy resident levels operation");
+    const ImageTraits& traits = internals.image->getImageTraits();
+    std::vector<VkImageCopy> imageCopyRegions;
+    for (uint32_t level = 0; level < imageRange.levelCount; ++level)
+    {
+      uint32_t targetLevel = imageRange.baseMipLevel + level;
+      VkImageCopy imageCopyRegion{};
+        imageCopyRegion.srcSubresource.aspectMask     = imageRange.aspectMask;
+        imageCopyRegion.srcSubresource.mipLevel       = sourceLevel + level;
+        imageCopyRegion.srcSubresource.baseArrayLayer = 0;
+        imageCopyRegion.srcSubresource.layerCount     = traits.arrayLayers;
+        imageCopyRegion.dstSubresource                = imageCopyRegion.srcSubresource;
+        imageCopyRegion.dstSubresource.mipLevel       = targetLevel;
+        imageCopyRegion.extent.width                  = std::max(1u, traits.extent.width >> targetLevel);
+        imageCopyRegion.extent.height                 = std::max(1u, traits.extent.height >> targetLevel);
+        imageCopyRegion.extent.depth                  = std::max(1u, traits.extent.depth >> targetLevel);
+      imageCopyRegions.push_back(imageCopyRegion);
+    }
+    if (initializeLayout)
+      commandBuffer->setImageLayout(*(internals.image), imageRange.aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    commandBuffer->cmdCopyImage(*sourceImage, VK_IMAGE_LAYOUT_GENERAL, *(internals.image), VK_IMAGE_LAYOUT_GENERAL, imageCopyRegions);
+    commandBuffer->setImageLayout(*(internals.image), imageRange.aspectMask, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+    return true;
+  }
+
+  std::shared_ptr<Image> sourceImage;
+  uint32_t               sourceLevel;
+  bool                   initializeLayout;
+};
+
 MemoryImage::MemoryImage(const ImageTraits& it, std::shared_ptr<DeviceMemoryAllocator> a, VkImageAspectFlags am, PerObjectBehaviour pob, SwapChainImageBehaviour scib, bool stpo, bool useSetImageMethods)
   : MemoryObject(MemoryObject::moImage), perObjectBehaviour{ pob }, swapChainImageBehaviour{ scib }, sameTraitsPerObject{ stpo }, imageTraits{ it }, allocator { a }, aspectMask{ am }, activeCount{ 1 }
 {
+  // images that are able to receive data are also able to send it, so they may be moved during defragmentation
   if(useSetImageMethods)
-    imageTraits.usage = imageTraits.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageTraits.usage = imageTraits.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  allocator->registerMemoryObject(this);
 }
 
-MemoryImage::MemoryImage(std::shared_ptr<gli::texture> tex, std::shared_ptr<DeviceMemoryAllocator> a, VkImageAspectFlags am, VkImageUsageFlags iu, PerObjectBehaviour pob)
+MemoryImage::MemoryImage(std::shared_ptr<gli::texture> tex, std::shared_ptr<DeviceMemoryAllocator> a, VkImageAspectFlags am, VkImageUsageFlags iu, PerObjectBehaviour pob, bool gm)
   : MemoryObject(MemoryObject::moImage), perObjectBehaviour{ pob }, swapChainImageBehaviour{ swOnce }, sameTraitsPerObject{ true }, allocator{ a }, aspectMask{ am }, activeCount{ 1 }
 {
   // for now we will only use textures that have base_level==0 and base_layer==0
@@ -241,12 +526,35 @@ MemoryImage::MemoryImage(std::shared_ptr<gli::texture> tex, std::shared_ptr<Devi
 
   texture     = tex;
   imageTraits = getImageTraitsFromTexture(*texture, iu);
-  // flag VK_IMAGE_USAGE_TRANSFER_DST_BIT because user wants to send gli::texture to GPU memory
-  imageTraits.usage = imageTraits.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  // flag VK_IMAGE_USAGE_TRANSFER_DST_BIT because user wants to send gli::texture to GPU memory ( and VK_IMAGE_USAGE_TRANSFER_SRC_BIT for defragmentation )
+  imageTraits.usage = imageTraits.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  // blits cannot write to compressed formats, so only uncompressed textures without mip levels get their mip chain generated on GPU
+  generateMipmaps = gm && texture->levels() == 1 && !gli::is_compressed(texture->format()) && !imageTraits.linearTiling;
+  if (generateMipmaps)
+    imageTraits.mipLevels = getMipLevelCount(imageTraits.extent);
+  allocator->registerMemoryObject(this);
+}
+
+MemoryImage::MemoryImage(std::shared_ptr<TextureFile> tf, std::shared_ptr<DeviceMemoryAllocator> a, VkImageAspectFlags am, VkImageUsageFlags iu, PerObjectBehaviour pob, bool gm)
+  : MemoryObject(MemoryObject::moImage), perObjectBehaviour{ pob }, swapChainImageBehaviour{ swOnce }, sameTraitsPerObject{ true }, allocator{ a }, aspectMask{ am }, activeCount{ 1 }
+{
+  CHECK_LOG_THROW(tf == nullptr, "Cannot create MemoryImage object without data");
+  CHECK_LOG_THROW(!tf->isDirect(), "Cannot create MemoryImage object from texture file that must be converted : " << tf->getFileName());
+
+  textureFile = tf;
+  imageTraits = getImageTraitsFromTextureFile(*textureFile, iu);
+  imageTraits.usage = imageTraits.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  generateMipmaps = gm && textureFile->getLevels() == 1 && !gli::is_compressed(textureFile->getFormat()) && !imageTraits.linearTiling;
+  if (generateMipmaps)
+    imageTraits.mipLevels = getMipLevelCount(imageTraits.extent);
+  allocator->registerMemoryObject(this);
 }
 
 MemoryImage::~MemoryImage()
 {
+  allocator->unregisterMemoryObject(this);
+  if (memoryAliasGroup != nullptr)
+    memoryAliasGroup->removeMemoryImage(this);
   std::lock_guard<std::mutex> lock(mutex);
   perObjectData.clear();
 }
@@ -256,13 +564,74 @@ MemoryImage* MemoryImage::asMemoryImage()
   return this;
 }
 
+void MemoryImage::getRelocatableMemoryBlocks(VkDevice device, std::vector<DeviceMemoryBlock>& blocks) const
+{
+  // attachments change their layouts during rendering and linear images may be mapped by the user - these images stay where they are
+  const VkImageUsageFlags transferFlags   = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  const VkImageUsageFlags attachmentFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+  std::lock_guard<std::mutex> lock(mutex);
+  // memory of aliased images belongs to their memory alias group
+  if (memoryAliasGroup != nullptr)
+    return;
+  for (auto& pdd : perObjectData)
+  {
+    if (pdd.second.device != device)
+      continue;
+    // do not plan new moves before previous ones are finished
+    if (std::any_of(begin(pdd.second.commonData.imageOperations), end(pdd.second.commonData.imageOperations), [](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::Relocate; }))
+      continue;
+    for (auto& d : pdd.second.data)
+    {
+      if (d.image == nullptr || d.image->getMemoryBlock().memory == VK_NULL_HANDLE)
+        continue;
+      const ImageTraits& traits = d.image->getImageTraits();
+      if ((traits.usage & transferFlags) != transferFlags || (traits.usage & attachmentFlags) != 0 || traits.linearTiling)
+        continue;
+      blocks.push_back(d.image->getMemoryBlock());
+    }
+  }
+}
+
+void MemoryImage::relocateMemoryBlocks(VkDevice device, const std::vector<DeviceMemoryBlock>& blocks)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bool relocated = false;
+  for (auto& pdd : perObjectData)
+  {
+    if (pdd.second.device != device)
+      continue;
+    auto operation = std::make_shared<RelocateImageOperation>(this, blocks, activeCount);
+    bool found = false;
+    for (uint32_t i = 0; i < pdd.second.data.size(); ++i)
+    {
+      if (pdd.second.data[i].image == nullptr)
+        continue;
+      const DeviceMemoryBlock& memoryBlock = pdd.second.data[i].image->getMemoryBlock();
+      bool moved = std::any_of(begin(blocks), end(blocks), [&memoryBlock](const DeviceMemoryBlock& b) { return b.memory == memoryBlock.memory && b.realOffset == memoryBlock.realOffset; });
+      // only chosen images are moved, operation is marked as done for the rest of them
+      operation->updated[i] = !moved;
+      if (moved)
+        pdd.second.valid[i] = false;
+      found |= moved;
+    }
+    if (!found)
+      continue;
+    pdd.second.commonData.imageOperations.push_back(operation);
+    relocated = true;
+  }
+  if (relocated)
+    invalidateImageViews();
+}
+
 void MemoryImage::setImageTraits(const ImageTraits& traits)
 {
   CHECK_LOG_THROW(!sameTraitsPerObject, "Cannot set image traits for all objects - MemoryImage uses different traits per each surface");
-  CHECK_LOG_THROW(texture != nullptr, "Cannot set image traits - there's a gli::texture that prevents it");
+  CHECK_LOG_THROW(texture != nullptr || textureFile != nullptr, "Cannot set image traits - there's a gli::texture or texture file that prevents it");
 
   std::lock_guard<std::mutex> lock(mutex);
   imageTraits = traits;
+  if (memoryAliasGroup != nullptr)
+    memoryAliasGroup->setImageTraits(this, traits);
   for (auto& pdd : perObjectData)
   {
     // remove all previous calls to setImageTraits
@@ -290,22 +659,47 @@ void MemoryImage::setImageTraits(Device* device, const ImageTraits& traits)
   internalSetImageTraits(device->getID(), device->device, VK_NULL_HANDLE, traits, aspectMask);
 }
 
-void MemoryImage::invalidateImage()
+void MemoryImage::setMemoryAliasGroup(std::shared_ptr<MemoryAliasGroup> group)
 {
-  CHECK_LOG_THROW(texture == nullptr, "Cannot invalidate texture - wrong constructor used to create an object");
+  CHECK_LOG_THROW(group != nullptr && swapChainImageBehaviour != swOnce, "Cannot alias memory of MemoryImage that has an image for each swapchain image");
+  CHECK_LOG_THROW(group != nullptr && (texture != nullptr || textureFile != nullptr), "Cannot alias memory of MemoryImage that stores texture data");
   std::lock_guard<std::mutex> lock(mutex);
-  ImageSubresourceRange range(aspectMask, texture->base_level(), texture->levels(), texture->base_layer(), texture->layers());
+  if (memoryAliasGroup == group)
+    return;
+  CHECK_LOG_THROW(!sameTraitsPerObject && !perObjectData.empty(), "Memory alias group must be set before images are created");
+  if (memoryAliasGroup != nullptr)
+    memoryAliasGroup->removeMemoryImage(this);
+  memoryAliasGroup = group;
+  if (!sameTraitsPerObject)
+    return;
+  if (memoryAliasGroup != nullptr)
+    memoryAliasGroup->setImageTraits(this, imageTraits);
+  // existing images are bound to memory of previous group
   for (auto& pdd : perObjectData)
   {
-    // remove all previous calls to setImage
-    pdd.second.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage; });
-    // add setImage operation with full texture size
-    pdd.second.commonData.imageOperations.push_back(std::make_shared<SetImageOperation>(this, range, range, texture, activeCount));
+    for (auto& d : pdd.second.data)
+      d.image = nullptr;
     pdd.second.invalidate();
   }
   invalidateImageViews();
 }
 
+void MemoryImage::invalidateImage()
+{
+  CHECK_LOG_THROW(texture == nullptr && textureFile == nullptr, "Cannot invalidate texture - wrong constructor used to create an object");
+  std::lock_guard<std::mutex> lock(mutex);
+  // all resident levels are sent again
+  uint32_t levelCount = getTextureLevels() - residentMipLevel;
+  for (auto& pdd : perObjectData)
+  {
+    if (textureFile != nullptr)
+      internalSetTextureFile(pdd.second, residentMipLevel, levelCount);
+    else
+      internalSetTexture(pdd.second, residentMipLevel, levelCount);
+  }
+  invalidateImageViews();
+}
+
 void MemoryImage::setImage(Surface* surface, std::shared_ptr<gli::texture> tex)
 {
   CHECK_LOG_THROW(perObjectBehaviour != pbPerSurface, "Cannot set image per surface for this texture");
@@ -324,16 +718,13 @@ void MemoryImage::setImage(Device* device, std::shared_ptr<gli::texture> tex)
 
 void MemoryImage::setImageLayer(uint32_t layer, std::shared_ptr<gli::texture> tex)
 {
-  CHECK_LOG_THROW(texture == nullptr, "Cannot set texture layer - wrong constructor used to create an object");
-  CHECK_LOG_THROW(!sameTraitsPerObject, "Cannot set texture layer when each device/surface may use different traits");
-  CHECK_LOG_THROW((layer >= texture->layers()), "Layer out of bounds : " << layer << " should be between 0 and " << texture->layers() - 1);
-  CHECK_LOG_THROW(tex->format() != texture->format(), "Input texture has wrong format : " << tex->format() << " should be " << texture->format());
-  CHECK_LOG_THROW(tex->layers() > 1, "Cannot call setTextureLayer() with texture that has more than one layer");
-  CHECK_LOG_THROW(tex->base_level() != texture->base_level(), "Cannot set image layer when there are different base mip levels");
-  CHECK_LOG_THROW(tex->levels() != texture->levels(), "Cannot set image layer when there is different count of mip levels");
-  gli::texture::extent_type extent = tex->extent();
-  gli::texture::extent_type myExtent = texture->extent();
-  CHECK_LOG_THROW((extent.x != myExtent.x) || (extent.y != myExtent.y) , "Texture has wrong size : ( " << extent.x << " x " << extent.y << " ) should be ( " << myExtent.x << " x " << myExtent.y << " )");
+  checkImageLayer(layer, tex);
+  // streamed image sends all its resident mip levels at once
+  if (residentMipLevel > 0)
+  {
+    setImageLayers({ { layer, tex } });
+    return;
+  }
 
   // place the data in a texture, so that texture on CPU side is in sync with texture on GPU side
   std::lock_guard<std::mutex> lock(mutex);
@@ -352,6 +743,54 @@ void MemoryImage::setImageLayer(uint32_t layer, std::shared_ptr<gli::texture> te
     pdd.second.commonData.imageOperations.remove_if([&targetRange](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage && targetRange.contains(texop->imageRange); });
     // add setImage operation
     pdd.second.commonData.imageOperations.push_back(std::make_shared<SetImageOperation>(this, targetRange, sourceRange, tex, activeCount));
+    internalGenerateMipmaps(pdd.second);
+    pdd.second.invalidate();
+  }
+  invalidateImageViews();
+}
+
+void MemoryImage::setImageLayers(const std::map<uint32_t, std::shared_ptr<gli::texture>>& layers)
+{
+  if (layers.empty())
+    return;
+  for (const auto& layer : layers)
+    checkImageLayer(layer.first, layer.second);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& layer : layers)
+  {
+    for (uint32_t level = texture->base_level(); level < texture->levels(); ++level)
+      std::memcpy(texture->data(layer.first, 0, level), layer.second->data(0, 0, level), layer.second->size(level));
+  }
+
+  // texture on CPU side holds all the layers now, so it's enough to send its resident levels in one operation. This operation replaces all previous setImage calls
+  for (auto& pdd : perObjectData)
+    internalSetTexture(pdd.second, residentMipLevel, getTextureLevels() - residentMipLevel);
+  invalidateImageViews();
+}
+
+void MemoryImage::setResidentMipLevel(uint32_t level)
+{
+  CHECK_LOG_THROW(texture == nullptr && textureFile == nullptr, "Cannot set resident mip level - wrong constructor used to create an object");
+  std::lock_guard<std::mutex> lock(mutex);
+  level = std::min(level, getTextureLevels() - 1);
+  if (level == residentMipLevel)
+    return;
+  residentMipLevel = level;
+  imageTraits = (texture != nullptr) ? getImageTraitsFromTexture(*texture, imageTraits.usage) : getImageTraitsFromTextureFile(*textureFile, imageTraits.usage);
+  // image holds resident levels only - texture level residentMipLevel is level 0 of an image
+  imageTraits.extent.width  = std::max(1u, imageTraits.extent.width >> residentMipLevel);
+  imageTraits.extent.height = std::max(1u, imageTraits.extent.height >> residentMipLevel);
+  imageTraits.extent.depth  = std::max(1u, imageTraits.extent.depth >> residentMipLevel);
+  imageTraits.mipLevels     = imageTraits.mipLevels - residentMipLevel;
+  // pending operations were prepared for previous image. New image is created and filled with resident mip levels during validation
+  for (auto& pdd : perObjectData)
+  {
+    auto operationCount = pdd.second.commonData.imageOperations.size();
+    pdd.second.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage; });
+    // previous image did not receive all its data, so its levels cannot be copied to the new image
+    if (pdd.second.commonData.imageOperations.size() != operationCount)
+      pdd.second.commonData.residentLevelsValid = false;
     pdd.second.invalidate();
   }
   invalidateImageViews();
@@ -434,6 +873,8 @@ void MemoryImage::validate(const RenderContext& renderContext)
   if (pddit == end(perObjectData))
     pddit = perObjectData.insert({ keyValue, MemoryImageData(renderContext, swapChainImageBehaviour) }).first;
   uint32_t activeIndex = renderContext.activeIndex % activeCount;
+  auto& internals = pddit->second.data[activeIndex];
+  releaseUnusedImages(renderContext, internals);
   if (pddit->second.valid[activeIndex])
     return;
 
@@ -445,14 +886,43 @@ void MemoryImage::validate(const RenderContext& renderContext)
     pddit->second.device = renderContext.vkDevice;
 
   // images are created here, when MemoryImage uses sameTraitsPerObject - otherwise it's a reponsibility of the user to create them through setImageTraits() call
-  if (pddit->second.data[activeIndex].image == nullptr && sameTraitsPerObject)
+  // Image is also recreated when resident mip level has changed. Old image is released when frames that use it are finished
+  if ((internals.image == nullptr || internals.residentMipLevel != residentMipLevel) && sameTraitsPerObject)
   {
-    pddit->second.data[activeIndex].image = std::make_shared<Image>(renderContext.device, imageTraits, allocator);
+    auto oldImage                = internals.image;
+    uint32_t oldResidentMipLevel = internals.residentMipLevel;
+    if (memoryAliasGroup != nullptr)
+      internals.image            = memoryAliasGroup->createImage(keyValue, renderContext.device, imageTraits);
+    else
+      internals.image            = std::make_shared<Image>(renderContext.device, imageTraits, allocator);
+    internals.residentMipLevel   = residentMipLevel;
     notifyCommandBufferSources(renderContext);
-    notifyImageViews(renderContext, ImageSubresourceRange(aspectMask, 0, imageTraits.mipLevels, 0, imageTraits.arrayLayers));
-    // if there's a texture - it must be sent now
-    if (texture != nullptr)
-      internalSetImage(keyValue, renderContext.vkDevice, renderContext.vkSurface, texture);
+    // image views may be created for all mip levels of a texture, not only for the resident ones
+    notifyImageViews(renderContext, ImageSubresourceRange(aspectMask, 0, residentMipLevel + imageTraits.mipLevels, 0, imageTraits.arrayLayers));
+    // if there's a texture - it must be sent now. Levels that were resident in previous image are copied from it, so only missing levels are sent from CPU
+    if (texture != nullptr || textureFile != nullptr)
+    {
+      auto& imageOperations  = pddit->second.commonData.imageOperations;
+      uint32_t textureLevels = getTextureLevels();
+      uint32_t copiedLevel   = textureLevels;
+      bool setImagePending   = std::any_of(begin(imageOperations), end(imageOperations), [](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage; });
+      if (oldImage != nullptr && pddit->second.commonData.residentLevelsValid && !setImagePending)
+        copiedLevel = std::max(oldResidentMipLevel, residentMipLevel);
+      if (copiedLevel > residentMipLevel)
+      {
+        if (texture != nullptr)
+          internalSetTexture(pddit->second, residentMipLevel, copiedLevel - residentMipLevel);
+        else
+          internalSetTextureFile(pddit->second, residentMipLevel, copiedLevel - residentMipLevel);
+      }
+      if (copiedLevel < textureLevels)
+      {
+        ImageSubresourceRange copiedRange(aspectMask, copiedLevel - residentMipLevel, textureLevels - copiedLevel, 0, imageTraits.arrayLayers);
+        imageOperations.push_back(std::make_shared<CopyResidentLevelsOperation>(this, copiedRange, oldImage, copiedLevel - oldResidentMipLevel, copiedLevel == residentMipLevel, activeCount));
+      }
+      pddit->second.commonData.residentLevelsValid = true;
+    }
+    releaseImageLater(renderContext, internals, oldImage);
   }
   // if there are some pending texture operations
   if (!pddit->second.commonData.imageOperations.empty())
@@ -464,7 +934,7 @@ void MemoryImage::validate(const RenderContext& renderContext)
     {
       if (!texop->updated[activeIndex])
       {
-        submit |= texop->perform(renderContext, pddit->second.data[activeIndex], cmdBuffer);
+        submit |= texop->perform(renderContext, internals, cmdBuffer);
         // mark operation as done for this activeIndex
         texop->updated[activeIndex] = true;
       }
@@ -475,12 +945,14 @@ void MemoryImage::validate(const RenderContext& renderContext)
     // if all operations are done for each index - remove them from list
     pddit->second.commonData.imageOperations.remove_if(([](std::shared_ptr<Operation> texop) { return texop->allUpdated(); }));
   }
+  releaseUnusedImages(renderContext, internals);
   pddit->second.valid[activeIndex] = true;
 }
 
 ImageSubresourceRange MemoryImage::getFullImageRange()
 {
-  return ImageSubresourceRange(aspectMask, 0, imageTraits.mipLevels, 0, imageTraits.arrayLayers);
+  // range covers all mip levels of a texture, even when only some of them are resident
+  return ImageSubresourceRange(aspectMask, 0, residentMipLevel + imageTraits.mipLevels, 0, imageTraits.arrayLayers);
 }
 
 void MemoryImage::addCommandBufferSource(std::shared_ptr<CommandBufferSource> cbSource)
@@ -533,6 +1005,8 @@ void MemoryImage::internalSetImageTraits(uint32_t key, VkDevice device, VkSurfac
   pddit->second.commonData.imageOperations.push_back(std::make_shared<SetImageTraitsOperation>(this, traits, aMask, activeCount));
   pddit->second.invalidate();
   invalidateImageViews();
+  if (memoryAliasGroup != nullptr)
+    memoryAliasGroup->setImageTraits(key, this, traits);
 }
 
 // caution : mutex lock must be called prior to this method
@@ -545,6 +1019,8 @@ void MemoryImage::internalSetImage(uint32_t key, VkDevice device, VkSurfaceKHR s
     // image does not exist at that moment - we should add imageTraits
     // image usage is always taken from main imageTraits
     auto traits = getImageTraitsFromTexture(*tex, imageTraits.usage);
+    if (generateMipmaps)
+      traits.mipLevels = getMipLevelCount(traits.extent);
     internalSetImageTraits(key, device, surface, traits, aspectMask);
   }
 
@@ -553,10 +1029,33 @@ void MemoryImage::internalSetImage(uint32_t key, VkDevice device, VkSurfaceKHR s
   pddit->second.commonData.imageOperations.remove_if([&range](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage && range.contains(texop->imageRange); });
   // add setImage operation
   pddit->second.commonData.imageOperations.push_back(std::make_shared<SetImageOperation>(this, range, range, tex, activeCount));
+  internalGenerateMipmaps(pddit->second);
   pddit->second.invalidate();
   invalidateImageViews();
 }
 
+// sends texture levels from baseLevel to baseLevel + levelCount - 1. Texture level residentMipLevel is level 0 of an image
+// caution : mutex lock must be called prior to this method
+void MemoryImage::internalSetTexture(MemoryImageData& data, uint32_t baseLevel, uint32_t levelCount)
+{
+  ImageSubresourceRange targetRange(aspectMask, baseLevel - residentMipLevel, levelCount, 0, static_cast<uint32_t>(texture->layers()));
+  ImageSubresourceRange sourceRange(aspectMask, baseLevel, levelCount, 0, static_cast<uint32_t>(texture->layers()));
+  data.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage; });
+  data.commonData.imageOperations.push_back(std::make_shared<SetImageOperation>(this, targetRange, sourceRange, texture, activeCount));
+  internalGenerateMipmaps(data);
+  data.invalidate();
+}
+
+// caution : mutex lock must be called prior to this method
+void MemoryImage::internalSetTextureFile(MemoryImageData& data, uint32_t baseLevel, uint32_t levelCount)
+{
+  ImageSubresourceRange range(aspectMask, baseLevel - residentMipLevel, levelCount, 0, static_cast<uint32_t>(textureFile->getLayers() * textureFile->getFaces()));
+  data.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImage; });
+  data.commonData.imageOperations.push_back(std::make_shared<SetImageFileOperation>(this, range, textureFile, baseLevel, activeCount));
+  internalGenerateMipmaps(data);
+  data.invalidate();
+}
+
 // set foreign images as images used by texture
 // caution : mutex lock must be called prior to this method
 void MemoryImage::internalSetImages(uint32_t key, VkDevice device, VkSurfaceKHR surface, std::vector<std::shared_ptr<Image>>& images)
@@ -591,6 +1090,37 @@ void MemoryImage::internalSetImages(uint32_t key, VkDevice device, VkSurfaceKHR
   invalidateImageViews();
 }
 
+// mip chain must be generated after all uploads, so previous generateMipmaps operation is moved to the end of the list
+// caution : mutex lock must be called prior to this method
+void MemoryImage::internalGenerateMipmaps(MemoryImageData& data)
+{
+  if (!generateMipmaps)
+    return;
+  data.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::GenerateMipmaps; });
+  data.commonData.imageOperations.push_back(std::make_shared<GenerateMipmapsOperation>(this, getFullImageRange(), activeCount));
+}
+
+// count of all mip levels of a texture, resident or not
+uint32_t MemoryImage::getTextureLevels() const
+{
+  return (texture != nullptr) ? static_cast<uint32_t>(texture->levels()) : static_cast<uint32_t>(textureFile->getLevels());
+}
+
+// check if texture may be placed in a layer of this image
+void MemoryImage::checkImageLayer(uint32_t layer, std::shared_ptr<gli::texture> tex) const
+{
+  CHECK_LOG_THROW(texture == nullptr, "Cannot set texture layer - wrong constructor used to create an object");
+  CHECK_LOG_THROW(!sameTraitsPerObject, "Cannot set texture layer when each device/surface may use different traits");
+  CHECK_LOG_THROW((layer >= texture->layers()), "Layer out of bounds : " << layer << " should be between 0 and " << texture->layers() - 1);
+  CHECK_LOG_THROW(tex->format() != texture->format(), "Input texture has wrong format : " << tex->format() << " should be " << texture->format());
+  CHECK_LOG_THROW(tex->layers() > 1, "Cannot call setTextureLayer() with texture that has more than one layer");
+  CHECK_LOG_THROW(tex->base_level() != texture->base_level(), "Cannot set image layer when there are different base mip levels");
+  CHECK_LOG_THROW(tex->levels() != texture->levels(), "Cannot set image layer when there is different count of mip levels");
+  gli::texture::extent_type extent = tex->extent();
+  gli::texture::extent_type myExtent = texture->extent();
+  CHECK_LOG_THROW((extent.x != myExtent.x) || (extent.y != myExtent.y) , "Texture has wrong size : ( " << extent.x << " x " << extent.y << " ) should be ( " << myExtent.x << " x " << myExtent.y << " )");
+}
+
 // build clear value depending on Texture aspectMask
 // caution : mutex lock must be called prior to this method
 void MemoryImage::internalClearImage(uint32_t key, VkDevice device, VkSurfaceKHR surface, const glm::vec4& clearValue, const ImageSubresourceRange& range)
@@ -610,6 +1140,91 @@ void MemoryImage::internalClearImage(uint32_t key, VkDevice device, VkSurfaceKHR
   pddit->second.invalidate();
 }
 
+MemoryAliasGroup::MemoryAliasGroup(std::shared_ptr<DeviceMemoryAllocator> a)
+  : allocator{ a }
+{
+}
+
+MemoryAliasGroup::~MemoryAliasGroup()
+{
+  for (auto& ad : aliasData)
+    if (ad.second.memoryBlock.alignedSize > 0)
+      allocator->deallocate(ad.second.device, ad.second.memoryBlock);
+}
+
+void MemoryAliasGroup::setImageTraits(uint32_t key, MemoryImage* memoryImage, const ImageTraits& traits)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& ad = aliasData[key];
+  ad.memberTraits.erase(memoryImage);
+  ad.memberTraits.insert({ memoryImage, traits });
+  ad.memberRequirements.erase(memoryImage);
+  ad.valid = false;
+}
+
+void MemoryAliasGroup::setImageTraits(MemoryImage* memoryImage, const ImageTraits& traits)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  commonTraits.erase(memoryImage);
+  commonTraits.insert({ memoryImage, traits });
+  for (auto& ad : aliasData)
+  {
+    ad.second.memberRequirements.erase(memoryImage);
+    ad.second.valid = false;
+  }
+}
+
+void MemoryAliasGroup::removeMemoryImage(MemoryImage* memoryImage)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  commonTraits.erase(memoryImage);
+  for (auto& ad : aliasData)
+  {
+    ad.second.memberTraits.erase(memoryImage);
+    ad.second.memberRequirements.erase(memoryImage);
+  }
+}
+
+std::shared_ptr<Image> MemoryAliasGroup::createImage(uint32_t key, Device* device, const ImageTraits& traits)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& ad = aliasData[key];
+  if (!ad.valid)
+  {
+    // memory block must be able to hold each member of the group ( alignments are powers of two, so the biggest one is suitable for all members ).
+    // Requirements are queried through a temporary image, so they're cached until member traits change
+    VkMemoryRequirements memReqs{ 0, 1, ~0u };
+    auto addRequirements = [&](MemoryImage* memoryImage, const ImageTraits& memberTraits)
+    {
+      auto mrit = ad.memberRequirements.find(memoryImage);
+      if (mrit == end(ad.memberRequirements))
+        mrit = ad.memberRequirements.insert({ memoryImage, getImageMemoryRequirements(device->device, memberTraits) }).first;
+      memReqs.size            = std::max(memReqs.size, mrit->second.size);
+      memReqs.alignment       = std::max(memReqs.alignment, mrit->second.alignment);
+      memReqs.memoryTypeBits &= mrit->second.memoryTypeBits;
+    };
+    for (auto& mt : ad.memberTraits)
+      addRequirements(mt.first, mt.second);
+    for (auto& ct : commonTraits)
+      addRequirements(ct.first, ct.second);
+    CHECK_LOG_THROW(memReqs.memoryTypeBits == 0, "Cannot alias images - there is no memory type suitable for all of them");
+
+    // previous block is reused when it is still big enough
+    bool blockFits = (ad.memoryBlock.alignedSize >= memReqs.size) && (ad.memoryBlock.alignedOffset % memReqs.alignment == 0) && ((ad.memoryRequirements.memoryTypeBits & ~memReqs.memoryTypeBits) == 0);
+    if (!blockFits)
+    {
+      if (ad.memoryBlock.alignedSize > 0)
+        allocator->deallocate(ad.device, ad.memoryBlock);
+      ad.device             = device->device;
+      ad.memoryBlock        = allocator->allocate(device, memReqs);
+      ad.memoryRequirements = memReqs;
+      CHECK_LOG_THROW(ad.memoryBlock.alignedSize == 0, "Cannot allocate memory for memory alias group");
+    }
+    ad.valid = true;
+  }
+  return std::make_shared<Image>(device, traits, ad.memoryBlock);
+}
+
 ImageView::ImageView(std::shared_ptr<MemoryImage> mi, const ImageSubresourceRange& sr, VkImageViewType vt, VkFormat f, const gli::swizzles& sw)
   : std::enable_shared_from_this<ImageView>(), memoryImage{ mi }, subresourceRange{ sr }, viewType{ vt }, swizzles{ sw }, activeCount{ 1 }
 {
@@ -677,6 +1292,13 @@ void ImageView::validate(const RenderContext& renderContext)
     imageViewCI.format           = format;
     imageViewCI.components       = vulkanComponentMappingFromGliComponentMapping(swizzles);
     imageViewCI.subresourceRange = subresourceRange.getSubresource();
+  // streamed textures may have less mip levels than image view expects
+  uint32_t mipLevels = memoryImage->getImage(renderContext)->getImageTraits().mipLevels;
+  if (imageViewCI.subresourceRange.levelCount != VK_REMAINING_MIP_LEVELS && imageViewCI.subresourceRange.baseMipLevel + imageViewCI.subresourceRange.levelCount > mipLevels)
+  {
+    imageViewCI.subresourceRange.baseMipLevel = std::min(imageViewCI.subresourceRange.baseMipLevel, mipLevels - 1);
+    imageViewCI.subresourceRange.levelCount   = mipLevels - imageViewCI.subresourceRange.baseMipLevel;
+  }
   VK_CHECK_LOG_THROW(vkCreateImageView(pddit->second.device, &imageViewCI, nullptr, &pddit->second.data[activeIndex].imageView), "failed vkCreateImageView");
 
   notifyResources(renderContext);
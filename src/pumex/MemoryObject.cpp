@@ -42,3 +42,11 @@ MemoryBuffer* MemoryObject::asMemoryBuffer()
 {
   return nullptr;
 }
+
+void MemoryObject::getRelocatableMemoryBlocks(VkDevice device, std::vector<DeviceMemoryBlock>& blocks) const
+{
+}
+
+void MemoryObject::relocateMemoryBlocks(VkDevice device, const std::vector<DeviceMemoryBlock>& blocks)
+{
+}
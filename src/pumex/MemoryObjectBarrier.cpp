@@ -41,7 +41,8 @@ MemoryObjectBarrier::MemoryObjectBarrier(VkAccessFlags sam, VkAccessFlags dam, u
 
 MemoryObjectBarrier::MemoryObjectBarrier(const MemoryObjectBarrier& rhs)
   : objectType(rhs.objectType), srcAccessMask{ rhs.srcAccessMask }, dstAccessMask{ rhs.dstAccessMask }, srcQueueFamilyIndex{ rhs.srcQueueFamilyIndex }, dstQueueFamilyIndex{ rhs.dstQueueFamilyIndex }, memoryObject{ rhs.memoryObject },
-    oldLayout{ rhs.oldLayout }, newLayout{ rhs.newLayout }, imageRange{ rhs.imageRange }, bufferRange{ rhs.bufferRange }
+    oldLayout{ rhs.oldLayout }, newLayout{ rhs.newLayout }, imageRange{ rhs.imageRange }, bufferRange{ rhs.bufferRange },
+    ownershipTransfer{ rhs.ownershipTransfer }, srcQueueIndex{ rhs.srcQueueIndex }, dstQueueIndex{ rhs.dstQueueIndex }
 {
 }
 
@@ -59,6 +60,9 @@ MemoryObjectBarrier& MemoryObjectBarrier::operator=(const MemoryObjectBarrier& r
     newLayout             = rhs.newLayout;
     imageRange            = rhs.imageRange;
     bufferRange           = rhs.bufferRange;
+    ownershipTransfer     = rhs.ownershipTransfer;
+    srcQueueIndex         = rhs.srcQueueIndex;
+    dstQueueIndex         = rhs.dstQueueIndex;
   }
   return *this;
 }
@@ -67,6 +71,13 @@ MemoryObjectBarrier::~MemoryObjectBarrier()
 {
 }
 
+void MemoryObjectBarrier::setOwnershipTransfer(OwnershipTransfer transfer, uint32_t sqi, uint32_t dqi)
+{
+  ownershipTransfer = transfer;
+  srcQueueIndex     = sqi;
+  dstQueueIndex     = dqi;
+}
+
 MemoryObjectBarrierGroup::MemoryObjectBarrierGroup(VkPipelineStageFlags ssm, VkPipelineStageFlags dsm, VkDependencyFlags d)
   : srcStageMask{ ssm }, dstStageMask{ dsm }, dependencyFlags{ d }
 {
@@ -29,8 +29,18 @@
 using namespace pumex;
 
 PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
-  : physicalDevice{ device }, properties{}, multiViewProperties{}, features{}, multiViewFeatures{}
+  : physicalDevice{ device }, properties{}, multiViewProperties{}, descriptorIndexingProperties{}, features{}, multiViewFeatures{}, descriptorIndexingFeatures{}
 {
+  // extensions are collected first, because structures from device extensions may be queried only when these extensions are present
+  uint32_t extensionCount = 0;
+  VK_CHECK_LOG_THROW( vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr), "failed vkEnumerateDeviceExtensionProperties");
+  if (extensionCount>0)
+  {
+    extensionProperties.resize(extensionCount);
+    VK_CHECK_LOG_THROW(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data()), "failed vkEnumerateDeviceExtensionProperties" << extensionCount);
+  }
+  bool descriptorIndexingImplemented = deviceExtensionImplemented(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
   // collect all available data about the device with or without VK_KHR_get_physical_device_properties2 extension
 
   if (viewer->instanceExtensionEnabled(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
@@ -41,6 +51,11 @@ PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
 
     properties2.pNext = &multiViewProperties;
     multiViewProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+    if (descriptorIndexingImplemented)
+    {
+      multiViewProperties.pNext          = &descriptorIndexingProperties;
+      descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    }
 
     viewer->pfn_vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
     properties = properties2.properties;
@@ -51,6 +66,11 @@ PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
 
     features2.pNext         = &multiViewFeatures;
     multiViewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    if (descriptorIndexingImplemented)
+    {
+      multiViewFeatures.pNext          = &descriptorIndexingFeatures;
+      descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    }
 
     viewer->pfn_vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
     features = features2.features;
@@ -64,14 +84,6 @@ PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
   // physical device memory properties
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 
-  uint32_t extensionCount = 0;
-  VK_CHECK_LOG_THROW( vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr), "failed vkEnumerateDeviceExtensionProperties");
-  if (extensionCount>0)
-  {
-    extensionProperties.resize(extensionCount);
-    VK_CHECK_LOG_THROW(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data()), "failed vkEnumerateDeviceExtensionProperties" << extensionCount);
-  }
-
   uint32_t queueFamilyCount;
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
   if(queueFamilyCount > 0)
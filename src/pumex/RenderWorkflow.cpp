@@ -22,13 +22,18 @@
 
 #include <pumex/RenderWorkflow.h>
 #include <algorithm>
+#include <cmath>
 #include <sstream>
+#include <limits>
 #include <iterator>
+#include <random>
+#include <tbb/parallel_invoke.h>
 #include <pumex/Device.h>
 #include <pumex/DeviceMemoryAllocator.h>
 #include <pumex/FrameBuffer.h>
 #include <pumex/RenderPass.h>
 #include <pumex/utils/Log.h>
+#include <pumex/utils/HashCombine.h>
 
 using namespace pumex;
 
@@ -523,6 +528,18 @@ std::vector<std::shared_ptr<ResourceTransition>> RenderWorkflow::getResourceIO(c
   return results;
 }
 
+// user image may share memory with other images, when its contents are not defined on CPU side and it has a single image per surface/device
+std::shared_ptr<MemoryImage> getAliasableMemoryImage(const RenderWorkflow& workflow, const std::string& resourceName)
+{
+  auto memoryObject = workflow.getAssociatedMemoryObject(resourceName);
+  if (memoryObject == nullptr || memoryObject->getType() != MemoryObject::moImage)
+    return nullptr;
+  auto memoryImage = std::dynamic_pointer_cast<MemoryImage>(memoryObject);
+  if (!memoryImage->getSameTraitsPerObject() || memoryImage->getSwapChainImageBehaviour() != swOnce || memoryImage->getTexture() != nullptr || memoryImage->getTextureFile() != nullptr)
+    return nullptr;
+  return memoryImage;
+}
+
 bool RenderWorkflow::compile(std::shared_ptr<RenderWorkflowCompiler> compiler)
 {
   if (valid)
@@ -531,10 +548,81 @@ bool RenderWorkflow::compile(std::shared_ptr<RenderWorkflowCompiler> compiler)
   if (valid)
     return true;
   workflowResults = compiler->compile(*this);
+  // associated images do not belong to compilation results, so their memory alias groups must be set each time the results change
+  for (const auto& mo : associatedMemoryObjects)
+  {
+    auto memoryImage = getAliasableMemoryImage(*this, mo.first);
+    if (memoryImage == nullptr)
+      continue;
+    auto mit = workflowResults->memoryAlias.find(mo.first);
+    memoryImage->setMemoryAliasGroup(mit != end(workflowResults->memoryAlias) ? workflowResults->memoryAliasGroups[mit->second] : nullptr);
+  }
   valid = true;
   return true;
 };
 
+namespace
+{
+// values are separated and strings are prefixed with their length, so two different workflows never produce the same key
+void appendKey(std::ostringstream& key, const std::string& value)
+{
+  key << value.size() << ':' << value << '|';
+}
+
+template <typename T>
+void appendKey(std::ostringstream& key, const T& value)
+{
+  key << value << '|';
+}
+
+template <typename Head, typename... Tail>
+void appendKey(std::ostringstream& key, const Head& value, const Tail&... tail)
+{
+  appendKey(key, value);
+  appendKey(key, tail...);
+}
+}
+
+std::string RenderWorkflow::calculateStructuralKey() const
+{
+  // unordered maps are written in name order, so that key does not depend on the order of insertions
+  std::ostringstream key;
+  key.precision(std::numeric_limits<float>::max_digits10);
+  appendKey(key, name, queueTraits.size());
+  for (const auto& qt : queueTraits)
+    appendKey(key, qt.mustHave, qt.mustNotHave, qt.priority);
+
+  std::map<std::string, std::shared_ptr<RenderWorkflowResourceType>> sortedTypes(begin(resourceTypes), end(resourceTypes));
+  for (const auto& rt : sortedTypes)
+  {
+    const auto& at = rt.second->attachment;
+    appendKey(key, rt.first, rt.second->metaType, rt.second->persistent, at.format, at.samples, at.attachmentType, at.attachmentSize.attachmentSize, at.attachmentSize.imageSize.x, at.attachmentSize.imageSize.y, at.attachmentSize.imageSize.z, at.imageUsage);
+    appendKey(key, at.swizzles.r, at.swizzles.g, at.swizzles.b, at.swizzles.a);
+  }
+
+  std::map<std::string, std::shared_ptr<RenderOperation>> sortedOperations(begin(renderOperations), end(renderOperations));
+  for (const auto& op : sortedOperations)
+    appendKey(key, op.first, op.second->operationType, op.second->multiViewMask, op.second->attachmentSize.attachmentSize, op.second->attachmentSize.imageSize.x, op.second->attachmentSize.imageSize.y, op.second->attachmentSize.imageSize.z);
+
+  std::map<std::string, std::shared_ptr<WorkflowResource>> sortedResources(begin(resources), end(resources));
+  for (const auto& res : sortedResources)
+    appendKey(key, res.first, res.second->resourceType->typeName);
+
+  for (const auto& tr : transitions)
+  {
+    appendKey(key, tr->operation->name, tr->resource->name, tr->transitionType, tr->layout, tr->load.loadType, tr->load.clearColor.x, tr->load.clearColor.y, tr->load.clearColor.z, tr->load.clearColor.w);
+    appendKey(key, tr->resolveResource != nullptr ? tr->resolveResource->name : std::string());
+    appendKey(key, tr->imageSubresourceRange.aspectMask, tr->imageSubresourceRange.baseMipLevel, tr->imageSubresourceRange.levelCount, tr->imageSubresourceRange.baseArrayLayer, tr->imageSubresourceRange.layerCount);
+    appendKey(key, tr->pipelineStage, tr->accessFlags, tr->bufferSubresourceRange.offset, tr->bufferSubresourceRange.range);
+  }
+
+  for (const auto& mo : associatedMemoryObjects)
+    appendKey(key, mo.first, mo.second->getType());
+  for (const auto& iv : associatedMemoryImageViews)
+    appendKey(key, iv.first, iv.second->viewType);
+  return key.str();
+}
+
 void StandardRenderWorkflowCostCalculator::tagOperationByAttachmentType(const RenderWorkflow& workflow)
 {
   std::unordered_map<int, AttachmentSize> tags;
@@ -570,126 +658,178 @@ void StandardRenderWorkflowCostCalculator::tagOperationByAttachmentType(const Re
 
 float StandardRenderWorkflowCostCalculator::calculateWorkflowCost(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSchedule) const
 {
-  if (operationSchedule.empty())
-    return 0.0f;
   float result = 0.0f;
+  for (uint32_t i = 1; i < operationSchedule.size(); ++i)
+    result += calculateTransitionCost(operationSchedule[i - 1]->name, operationSchedule[i]->name);
+  return result;
+}
 
+float StandardRenderWorkflowCostCalculator::calculateTransitionCost(const std::string& previousOperation, const std::string& nextOperation) const
+{
   // first preference : prefer operations with the same tags ( render pass grouping )
-  int tag = attachmentTag.at(operationSchedule[0]->name);
-  for (int i = 1; i < operationSchedule.size(); ++i)
-  {
-    int newTag = attachmentTag.at(operationSchedule[i]->name);
-    if (newTag != tag)
-      result += 10.0f;
-    tag = newTag;
-  }
-
-  return result;
+  return (attachmentTag.at(previousOperation) != attachmentTag.at(nextOperation)) ? 10.0f : 0.0f;
 }
 
-std::vector<std::shared_ptr<RenderOperation>> recursiveScheduleOperations(const RenderWorkflow& workflow, const std::set<std::shared_ptr<RenderOperation>>& doneOperations, StandardRenderWorkflowCostCalculator* costCalculator)
+// Operations are scheduled using beam search : partial schedules are extended by one operation that has all its predecessors done.
+// Partial schedules with the same set of done operations and the same last operation have the same future costs, so only the cheapest
+// one is kept. When the number of such schedules does not exceed beamWidth the result is optimal, otherwise only beamWidth cheapest
+// schedules are extended. Each of n steps extends up to beamWidth schedules by up to n operations, and each candidate is compared and copied
+// in O( n ), so complexity is O( n^3 * beamWidth ) instead of O( n! ) of exhaustive search.
+std::vector<std::shared_ptr<RenderOperation>> scheduleOperations(const RenderWorkflow& workflow, const StandardRenderWorkflowCostCalculator& costCalculator, uint32_t beamWidth)
 {
-  std::set<std::shared_ptr<RenderOperation>> newDoneOperations;
   auto operationNames = workflow.getRenderOperationNames();
-  if (doneOperations.empty())
+  std::sort(begin(operationNames), end(operationNames));
+  uint32_t operationCount = static_cast<uint32_t>(operationNames.size());
+
+  std::vector<std::shared_ptr<RenderOperation>> operations;
+  std::map<std::shared_ptr<RenderOperation>, uint32_t> operationIndex;
+  for (uint32_t i = 0; i < operationCount; ++i)
   {
-    for (auto& operationName : operationNames)
+    operations.push_back(workflow.getRenderOperation(operationNames[i]));
+    operationIndex.insert({ operations.back(), i });
+  }
+  std::vector<std::vector<uint32_t>> nextOperations(operationCount);
+  std::vector<uint32_t>              previousCount(operationCount, 0);
+  for (uint32_t i = 0; i < operationCount; ++i)
+  {
+    for (auto& nextOp : workflow.getNextOperations(operationNames[i]))
     {
-      auto operation = workflow.getRenderOperation(operationName);
-      auto nextOperations = workflow.getNextOperations(operationName);
-      if (nextOperations.empty())
-        newDoneOperations.insert(operation);
+      nextOperations[i].push_back(operationIndex.at(nextOp));
+      previousCount[operationIndex.at(nextOp)]++;
     }
   }
-  else
+
+  // each operation gets a random key, set of done operations is identified by xor of its keys
+  std::vector<std::size_t> operationKeys(operationCount);
+  std::mt19937_64 keyGenerator;
+  for (auto& key : operationKeys)
+    key = static_cast<std::size_t>(keyGenerator());
+
+  struct PartialSchedule
+  {
+    std::vector<uint32_t> sequence;
+    std::vector<uint32_t> waitingFor; // number of predecessors that are not done yet
+    std::vector<bool>     done;
+    std::size_t           doneKey;
+    float                 cost;
+  };
+  struct Candidate
+  {
+    uint32_t schedule;
+    uint32_t operation;
+    float    cost;
+  };
+  std::vector<PartialSchedule> schedules{ { {}, previousCount, std::vector<bool>(operationCount, false), 0, 0.0f } };
+  for (uint32_t step = 0; step < operationCount; ++step)
   {
-    for (auto& operationName : operationNames)
+    // candidates are light, so partial schedules are copied only for candidates that survive
+    std::vector<Candidate> candidates;
+    std::unordered_multimap<std::size_t, uint32_t> candidateIndex;
+    for (uint32_t s = 0; s < schedules.size(); ++s)
     {
-      auto operation = workflow.getRenderOperation(operationName);
-      if (doneOperations.find(operation) != end(doneOperations))
-        continue;
-      auto nextOperations = workflow.getNextOperations(operationName);
-      bool final = true;
-      // check if ALL outputs point at operations in doneOperations
-      for (auto& nextOp : nextOperations)
+      const auto& schedule = schedules[s];
+      for (uint32_t i = 0; i < operationCount; ++i)
       {
-        if (doneOperations.find(nextOp) == end(doneOperations))
+        if (schedule.done[i] || schedule.waitingFor[i] > 0)
+          continue;
+        float cost = schedule.cost + (schedule.sequence.empty() ? 0.0f : costCalculator.calculateTransitionCost(operationNames[schedule.sequence.back()], operationNames[i]));
+        // the same operations are done, and the same operation is the last one - just keep a cheaper schedule
+        std::size_t key = schedule.doneKey ^ operationKeys[i];
+        hash_combine(key, i);
+        auto range = candidateIndex.equal_range(key);
+        auto cit   = std::find_if(range.first, range.second, [&](const std::pair<const std::size_t, uint32_t>& ci) { return candidates[ci.second].operation == i && schedules[candidates[ci.second].schedule].done == schedule.done; });
+        if (cit == range.second)
         {
-          final = false;
-          break;
+          candidateIndex.insert({ key, static_cast<uint32_t>(candidates.size()) });
+          candidates.push_back({ s, i, cost });
         }
+        else if (cost < candidates[cit->second].cost)
+          candidates[cit->second] = { s, i, cost };
       }
-      if (final)
-        newDoneOperations.insert(operation);
     }
+    CHECK_LOG_THROW(candidates.empty(), "Cannot schedule operations : workflow contains a loop");
+    std::stable_sort(begin(candidates), end(candidates), [](const Candidate& lhs, const Candidate& rhs) { return lhs.cost < rhs.cost; });
+    if (candidates.size() > beamWidth)
+      candidates.resize(std::max<uint32_t>(1, beamWidth));
+
+    std::vector<PartialSchedule> nextSchedules;
+    for (const auto& candidate : candidates)
+    {
+      PartialSchedule newSchedule = schedules[candidate.schedule];
+      newSchedule.sequence.push_back(candidate.operation);
+      newSchedule.done[candidate.operation] = true;
+      newSchedule.doneKey ^= operationKeys[candidate.operation];
+      for (auto n : nextOperations[candidate.operation])
+        newSchedule.waitingFor[n]--;
+      newSchedule.cost = candidate.cost;
+      nextSchedules.push_back(std::move(newSchedule));
+    }
+    schedules = std::move(nextSchedules);
   }
-  if (newDoneOperations.empty())
-    return std::vector<std::shared_ptr<RenderOperation>>();
-
-  std::vector<std::vector<std::shared_ptr<RenderOperation>>> results;
-  std::vector<float> cost;
-  for (const auto& x : newDoneOperations)
-  {
-    auto a = doneOperations;
-    a.insert(x);
-    auto xx = recursiveScheduleOperations(workflow, a, costCalculator);
-    xx.push_back(x);
-    cost.push_back(costCalculator->calculateWorkflowCost(workflow, xx));
-    results.push_back(xx);
-  }
-  // return a result with lowest cost
-  auto minit = std::min_element(begin(cost), end(cost));
-  auto i = std::distance(begin(cost), minit);
-  return results[i];
+
+  std::vector<std::shared_ptr<RenderOperation>> results;
+  if (!schedules.empty())
+    for (auto i : schedules.front().sequence)
+      results.push_back(operations[i]);
+  return results;
+}
+
+SingleQueueWorkflowCompiler::SingleQueueWorkflowCompiler(uint32_t sbw)
+  : schedulingBeamWidth{ sbw }
+{
 }
 
 std::shared_ptr<RenderWorkflowResults> SingleQueueWorkflowCompiler::compile(RenderWorkflow& workflow)
 {
-  // verify operations
+  // workflow must be verified before it is analyzed. Partial ordering with attachment layouts and operation tagging are independent
+  // from each other, so they run in parallel. Cost calculator is local, because the same compiler may compile many workflows at once
   verifyOperations(workflow);
 
-  // calculate partial ordering
+  StandardRenderWorkflowCostCalculator          costCalculator;
   std::vector<std::shared_ptr<RenderOperation>> partialOrdering;
-  calculatePartialOrdering(workflow, partialOrdering);
-
-  std::map<std::string, uint32_t>         resourceMap;
-  std::map<std::string, uint32_t>         operationMap;
-  std::vector<std::vector<VkImageLayout>> allLayouts;
-  calculateAttachmentLayouts(workflow, partialOrdering, resourceMap, operationMap, allLayouts);
+  std::map<std::string, uint32_t>               resourceMap;
+  std::map<std::string, uint32_t>               operationMap;
+  std::vector<std::vector<VkImageLayout>>       allLayouts;
+  tbb::parallel_invoke(
+    [&]
+    {
+      calculatePartialOrdering(workflow, partialOrdering);
+      calculateAttachmentLayouts(workflow, partialOrdering, resourceMap, operationMap, allLayouts);
+    },
+    [&]
+    {
+      // Tags are used to prefer graphics operations with the same tag value to be performed one after another ( subpass grouping ).
+      // Look at calculateWorkflowCost()
+      // - each compute operation gets its own tag
+      // - all graphics operations with the same attachment size get the same tag
+      // - two graphics operations with different attachment size get different tag
+      costCalculator.tagOperationByAttachmentType(workflow);
+    });
 
   auto workflowResults         = std::make_shared<RenderWorkflowResults>();
   workflowResults->queueTraits = workflow.getQueueTraits();
 
-  // Tags are used to prefer graphics operations with the same tag value to be performed one after another ( subpass grouping ).
-  // Look at calculateWorkflowCost()
-  // - each compute operation gets its own tag
-  // - all graphics operations with the same attachment size get the same tag
-  // - two graphics operations with different attachment size get different tag
-  costCalculator.tagOperationByAttachmentType(workflow);
-
-  // Build a vector storing proper sequence of operations - FIXME : IT ONLY WORKS FOR ONE QUEUE NOW.
-  // TARGET FOR THE FUTURE  : build as many operation sequences as there is queues, take VkQueueFlags into consideration
-  // ( be aware that scheduling algorithms may be NP-complete ).
+  // Build a vector storing proper sequence of operations and divide it between queues. Each queue gets its own sequence ( possibly empty )
+  auto operationSequence = getOperationSchedule(workflow, costCalculator);
   std::vector<std::vector<std::shared_ptr<RenderOperation>>> operationSequences;
-  {
-    // FIXME : IT ONLY GENERATES ONE SEQUENCE NOW, ALSO IGNORES TYPE OF THE QUEUE
-    std::set<std::shared_ptr<RenderOperation>> doneOperations;
-    auto operationSequence = recursiveScheduleOperations(workflow, doneOperations, &costCalculator);
-    operationSequences.push_back(operationSequence);
-  }
+  distributeOperations(workflow, operationSequence, operationSequences);
 
-  // find resources that may be reused
-  findAliasedResources(workflow, operationSequences, workflowResults);
-
-  // construct render command sequences ( render passes, compute passes )
-  std::vector<std::shared_ptr<RenderPass>> renderPasses;
+  // find resources that may be reused and construct render command sequences ( render passes, compute passes ) in parallel
   std::vector<std::vector<std::shared_ptr<RenderCommand>>> commands;
-  for( auto& operationSequence : operationSequences )
-  {
-    std::vector<std::shared_ptr<RenderCommand>> commandSequence;
-    createCommandSequence(operationSequence, commandSequence);
-    commands.push_back(commandSequence);
-  }
+  tbb::parallel_invoke(
+    [&]
+    {
+      findAliasedResources(workflow, costCalculator, operationSequences, workflowResults);
+    },
+    [&]
+    {
+      for (auto& operationSequence : operationSequences)
+      {
+        std::vector<std::shared_ptr<RenderCommand>> commandSequence;
+        createCommandSequence(costCalculator, operationSequence, commandSequence);
+        commands.push_back(commandSequence);
+      }
+    });
   workflowResults->commands = commands;
 
   // Build framebuffer for each render pass
@@ -719,9 +859,94 @@ std::shared_ptr<RenderWorkflowResults> SingleQueueWorkflowCompiler::compile(Rend
   // create pipeline barriers
   createPipelineBarriers(workflow, commands, workflowResults);
 
+  // divide commands into submissions synchronized by semaphores
+  createSubmissions(workflow, operationSequence, workflowResults);
+
   return workflowResults;
 }
 
+void SingleQueueWorkflowCompiler::setScheduleCacheLimit(uint32_t limit)
+{
+  std::lock_guard<std::mutex> lock(scheduleMutex);
+  scheduleCacheLimit = limit;
+  while (scheduleCache.size() > scheduleCacheLimit)
+    scheduleCache.pop_back();
+}
+
+// workflow that has the same structure as one of recently compiled workflows ( e.g. the same workflow built again ) reuses its schedule
+std::vector<std::shared_ptr<RenderOperation>> SingleQueueWorkflowCompiler::getOperationSchedule(const RenderWorkflow& workflow, const StandardRenderWorkflowCostCalculator& costCalculator)
+{
+  std::string key = workflow.calculateStructuralKey();
+  std::vector<std::shared_ptr<RenderOperation>> results;
+  {
+    std::lock_guard<std::mutex> lock(scheduleMutex);
+    auto cit = std::find_if(begin(scheduleCache), end(scheduleCache), [&key](const std::pair<std::string, std::vector<std::string>>& sc) { return sc.first == key; });
+    if (cit != end(scheduleCache))
+    {
+      scheduleCache.splice(begin(scheduleCache), scheduleCache, cit);
+      for (const auto& operationName : scheduleCache.front().second)
+        results.push_back(workflow.getRenderOperation(operationName));
+      return results;
+    }
+  }
+  results = scheduleOperations(workflow, costCalculator, schedulingBeamWidth);
+
+  std::vector<std::string> operationNames;
+  for (const auto& operation : results)
+    operationNames.push_back(operation->name);
+  std::lock_guard<std::mutex> lock(scheduleMutex);
+  if (scheduleCacheLimit == 0)
+    return results;
+  scheduleCache.push_front({ key, operationNames });
+  while (scheduleCache.size() > scheduleCacheLimit)
+    scheduleCache.pop_back();
+  return results;
+}
+
+void SingleQueueWorkflowCompiler::distributeOperations(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences)
+{
+  // all operations go to the first queue
+  operationSequences.assign(std::max<size_t>(1, workflow.getQueueTraits().size()), std::vector<std::shared_ptr<RenderOperation>>());
+  operationSequences[0] = operationSequence;
+}
+
+MultiQueueWorkflowCompiler::MultiQueueWorkflowCompiler(uint32_t sbw)
+  : SingleQueueWorkflowCompiler(sbw)
+{
+}
+
+void MultiQueueWorkflowCompiler::distributeOperations(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences)
+{
+  const auto& queueTraits = workflow.getQueueTraits();
+  int graphicsQueue = -1, computeQueue = -1;
+  for (uint32_t i = 0; i < queueTraits.size(); ++i)
+  {
+    if (graphicsQueue < 0 && (queueTraits[i].mustHave & VK_QUEUE_GRAPHICS_BIT))
+      graphicsQueue = static_cast<int>(i);
+    if (computeQueue < 0 && (queueTraits[i].mustHave & VK_QUEUE_COMPUTE_BIT) && (queueTraits[i].mustNotHave & VK_QUEUE_GRAPHICS_BIT))
+      computeQueue = static_cast<int>(i);
+  }
+  CHECK_LOG_THROW(graphicsQueue < 0, "MultiQueueWorkflowCompiler : workflow does not define a graphics queue");
+  if (computeQueue < 0)
+    computeQueue = graphicsQueue;
+
+  operationSequences.assign(queueTraits.size(), std::vector<std::shared_ptr<RenderOperation>>());
+  // operationSequence is topologically sorted, so all previous operations are already assigned to their queues
+  std::map<std::string, int> operationQueue;
+  for (auto& operation : operationSequence)
+  {
+    int queue = graphicsQueue;
+    if (operation->operationType == RenderOperation::Compute)
+    {
+      auto previousOperations = workflow.getPreviousOperations(operation->name);
+      if (std::all_of(begin(previousOperations), end(previousOperations), [&operationQueue, computeQueue](std::shared_ptr<RenderOperation> op) { return operationQueue.at(op->name) == computeQueue; }))
+        queue = computeQueue;
+    }
+    operationQueue.insert({ operation->name, queue });
+    operationSequences[queue].push_back(operation);
+  }
+}
+
 void SingleQueueWorkflowCompiler::verifyOperations(const RenderWorkflow& workflow)
 {
   std::ostringstream os;
@@ -847,166 +1072,200 @@ void SingleQueueWorkflowCompiler::calculateAttachmentLayouts(const RenderWorkflo
   }
 }
 
-std::vector<std::string> recursiveLongestPath(const std::vector<std::pair<std::string, std::string>>& resourcePairs, const std::set<std::string>& doneVertices = std::set<std::string>())
+VkDeviceSize pumex::estimateAttachmentMemorySize(const RenderWorkflowResourceType& resourceType, const VkExtent2D& surfaceExtent)
 {
-  std::set<std::string> vertices;
-  if (doneVertices.empty())
-  {
-    for (auto& rp : resourcePairs)
-      vertices.insert(rp.first);
-    for (auto& rp : resourcePairs)
-      vertices.erase(rp.second);
-  }
-  else
-  {
-    for (auto& rp : resourcePairs)
-    {
-      if (doneVertices.find(rp.first) == end(doneVertices))
-        continue;
-      if (doneVertices.find(rp.second) != end(doneVertices))
-        continue;
-      vertices.insert(rp.second);
-    }
-  }
-  if (vertices.empty())
-    return std::vector<std::string>();
+  const auto& attachment = resourceType.attachment;
+  auto format            = static_cast<gli::format>(attachment.format);
+  double texelSize       = gli::is_valid(format) ? static_cast<double>(gli::block_size(format)) : 4.0;
+  double imageArea       = attachment.attachmentSize.imageSize.x * attachment.attachmentSize.imageSize.y;
+  if (attachment.attachmentSize.attachmentSize == AttachmentSize::SurfaceDependent)
+    imageArea *= static_cast<double>(surfaceExtent.width) * static_cast<double>(surfaceExtent.height);
+  return static_cast<VkDeviceSize>(texelSize * imageArea * attachment.attachmentSize.imageSize.z * static_cast<double>(attachment.samples));
+}
 
+// estimation of memory used by user image ( without mip levels )
+VkDeviceSize estimateImageMemorySize(const ImageTraits& imageTraits)
+{
+  auto format      = static_cast<gli::format>(imageTraits.format);
+  double texelSize = gli::is_valid(format) ? static_cast<double>(gli::block_size(format)) : 4.0;
+  return static_cast<VkDeviceSize>(texelSize * imageTraits.extent.width * imageTraits.extent.height * imageTraits.extent.depth * imageTraits.arrayLayers * static_cast<double>(imageTraits.samples));
+}
 
-  std::vector<std::vector<std::string>> results;
-  for (const auto& x : vertices)
-  {
-    auto a = doneVertices;
-    a.insert(x);
-    auto xx = recursiveLongestPath(resourcePairs, a);
-    xx.push_back(x);
-    results.push_back(xx);
-  }
-  uint32_t maxSize = 0;
-  int maxElt = -1;
-  for (uint32_t i = 0; i<results.size(); ++i)
-  {
-    if (results[i].size() > maxSize)
-    {
-      maxSize = results[i].size();
-      maxElt = i;
-    }
-  }
-  return results[maxElt];
+// Images that hold more than one resource or share memory with other images. Contents of such image are discarded when new resource is generated in it
+std::set<std::string> getSharedImages(const RenderWorkflowResults& workflowResults)
+{
+  std::set<std::string> sharedImages;
+  for (auto& ra : workflowResults.resourceAlias)
+    if (ra.first != ra.second)
+      sharedImages.insert(ra.second);
+  for (auto& ma : workflowResults.memoryAlias)
+    sharedImages.insert(ma.first);
+  return sharedImages;
 }
 
-void SingleQueueWorkflowCompiler::findAliasedResources(const RenderWorkflow& workflow, const std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences, std::shared_ptr<RenderWorkflowResults> workflowResults)
+void SingleQueueWorkflowCompiler::findAliasedResources(const RenderWorkflow& workflow, const StandardRenderWorkflowCostCalculator& costCalculator, const std::vector<std::vector<std::shared_ptr<RenderOperation>>>& operationSequences, std::shared_ptr<RenderWorkflowResults> workflowResults)
 {
   workflowResults->resourceAlias.clear();
+  workflowResults->memoryAlias.clear();
 
   std::map<std::string, std::pair<uint32_t,uint32_t>> operationIndex;
   for (uint32_t i = 0; i < operationSequences.size(); ++i)
     for (uint32_t j = 0; j < operationSequences[i].size(); ++j)
       operationIndex.insert({ operationSequences[i][j]->name, {i,j} });
 
-  // collect resources that may be used again
-  // Resource may be used again when :
-  // - all of its inputs are used in the same queue
-  // - it is an attachment or has no associated resource
+  // Lifetime of a resource starts at the operation that generates it and ends at its last consumer ( operation indices come from compiled queue sequence ).
+  // Resource may share its image or memory with other resources when :
+  // - it is not persistent
+  // - it is generated in the workflow and all of its inputs are in the same queue
+  // - it is an attachment, an image or has no associated memory object ( associated images may only share memory, look at getAliasableMemoryImage() )
   // - it is not a swapchain image
-  // aliasingPossible stores queue index in which resource is created and queue index in which resource is consumed ( -1 if there's no generation/consumption )
-  // also it stores operation indices
-  std::map<std::string,std::tuple<int,int,int,int,int>> aliasingPossible;
+  struct ResourceLifetime
+  {
+    std::string name;
+    uint32_t    queue;
+    uint32_t    first;
+    uint32_t    last;
+  };
+  std::vector<ResourceLifetime> lifetimes;
   auto resourceNames = workflow.getResourceNames();
   for (auto& resourceName : resourceNames)
   {
     workflowResults->resourceAlias.insert({ resourceName , resourceName });
     auto resource = workflow.getResource(resourceName);
-    if (resource->resourceType->metaType != RenderWorkflowResourceType::Attachment && workflow.getAssociatedMemoryObject(resourceName) != nullptr)
+    if (resource->resourceType->persistent)
+      continue;
+    if (resource->resourceType->metaType == RenderWorkflowResourceType::Buffer && workflow.getAssociatedMemoryObject(resourceName) != nullptr)
       continue;
     if (resource->resourceType->attachment.attachmentType == atSurface)
       continue;
-    auto inputTransitions = workflow.getResourceIO(resourceName, rttAllInputs);
-    std::set<uint32_t> consumedInQueue;
-    std::set<int> inOpIndices;
-    for (auto& inputTransition : inputTransitions)
+    auto outTransitions = workflow.getResourceIO(resourceName, rttAllOutputs);
+    if (outTransitions.empty())
+      continue;
+    auto outIndex = operationIndex.at(outTransitions[0]->operation->name);
+    ResourceLifetime lifetime{ resourceName, outIndex.first, outIndex.second, outIndex.second };
+    bool sameQueue = true;
+    for (auto& inputTransition : workflow.getResourceIO(resourceName, rttAllInputs))
     {
-      consumedInQueue.insert(operationIndex.at(inputTransition->operation->name).first);
-      inOpIndices.insert(operationIndex.at(inputTransition->operation->name).second);
+      auto inIndex  = operationIndex.at(inputTransition->operation->name);
+      sameQueue     = sameQueue && (inIndex.first == lifetime.queue);
+      lifetime.last = std::max(lifetime.last, inIndex.second);
     }
-    if (consumedInQueue.size() > 1)
-      continue;
-
-    int inQueueIndex = consumedInQueue.empty() ? -1 : *begin(consumedInQueue);
-    int inOpFirst    = inOpIndices.empty() ? -1 : *begin(inOpIndices);
-    int inOpLast     = inOpIndices.empty() ? -1 : *rbegin(inOpIndices);
-
-    auto outTransitions = workflow.getResourceIO(resourceName, rttAllOutputs);
-    int outQueueIndex = outTransitions.empty() ? -1 : operationIndex.at(outTransitions[0]->operation->name).first;
-    int outOpIndex    = outTransitions.empty() ? -1 : operationIndex.at(outTransitions[0]->operation->name).second;
-
-    aliasingPossible.insert( { resourceName,std::make_tuple( outQueueIndex, outOpIndex, inQueueIndex, inOpFirst, inOpLast ) } );
+    if (sameQueue)
+      lifetimes.push_back(lifetime);
   }
+  std::sort(begin(lifetimes), end(lifetimes), [](const ResourceLifetime& lhs, const ResourceLifetime& rhs) { return std::tie(lhs.queue, lhs.first, lhs.last) < std::tie(rhs.queue, rhs.first, rhs.last); });
 
-  // OK, so we have a group of resources where resource reuse is possible. First - we build pairs of resources that may be reused
-  // Remark : algorithm complexity is n^2
-  std::vector<std::pair<std::string, std::string>> resourcePairs;
-  for (auto it0 = begin(aliasingPossible); it0 != end(aliasingPossible); ++it0)
+  // Step 1 : resources of identical type with disjoint lifetimes use the same image. Resources are visited in order of their generation and each one
+  // goes to an image released before ( greedy interval partitioning, so the number of images is minimal ). Image is named after its first resource
+  struct SharedImage
   {
-    auto resource0 = workflow.getResource(it0->first);
-    // cannot overwrite a resource marked as persistent
-    if (resource0->resourceType->persistent)
-      continue;
-    int r0oq, r0op, r0iq, r0ip0, r0ip1;
-    std::tie(r0oq, r0op, r0iq, r0ip0, r0ip1) = it0->second;
-    // let's skip some empty resources ( this shouldnt happen, but... )
-    if (r0oq == -1 && r0iq == -1)
-      continue;
-    // Question : what to do with resources that are generated but are not persistent and are not used later (r0iq==-1) ?
-    // For now we will assume that this resource may be used later in the same queue
-    if (r0iq == -1)
+    std::string name;
+    uint32_t    queue;
+    uint32_t    first;
+    uint32_t    last;
+    bool        attachmentOutputsOnly;
+  };
+  std::vector<SharedImage> images;
+  for (auto& lifetime : lifetimes)
+  {
+    auto resourceType     = workflow.getResource(lifetime.name)->resourceType;
+    bool attachmentOutput = (workflow.getResourceIO(lifetime.name, rttAllOutputs)[0]->transitionType & rttAllAttachmentOutputs) != 0;
+    // resources with associated images always use their own images
+    bool associated       = workflow.getAssociatedMemoryObject(lifetime.name) != nullptr;
+    auto best             = end(images);
+    for (auto it = begin(images); it != end(images) && !associated; ++it)
     {
-      r0iq  = r0oq;
-      r0ip0 = r0ip1 = r0op;
+      if (it->queue != lifetime.queue || it->last >= lifetime.first || workflow.getAssociatedMemoryObject(it->name) != nullptr || !resourceType->isEqual(*(workflow.getResource(it->name)->resourceType)))
+        continue;
+      // prefer image released most recently
+      if (best == end(images) || it->last > best->last)
+        best = it;
     }
-    for (auto it1 = begin(aliasingPossible); it1 != end(aliasingPossible); ++it1)
+    if (best == end(images))
+    {
+      images.push_back({ lifetime.name, lifetime.queue, lifetime.first, lifetime.last, attachmentOutput });
+      continue;
+    }
+    workflowResults->resourceAlias[lifetime.name] = best->name;
+    best->last                  = lifetime.last;
+    best->attachmentOutputsOnly = best->attachmentOutputsOnly && attachmentOutput;
+  }
+
+  // Step 2 : attachment images and associated user images of any format and size with disjoint lifetimes share the same memory ( interval graph coloring ).
+  // Image lifetime is extended to whole render passes, because attachments are loaded and stored at render pass boundaries.
+  // Attachment must be generated as an attachment each time it gets a new resource - render pass discards previous memory contents then.
+  // User image must be fully written by the operation that generates it. Memory requirements of user images are queried with their own traits ( usage flags included )
+  // by MemoryAliasGroup. Only images with the same PerObjectBehaviour may share memory ( attachments are created per surface ).
+  // From all memory slots released before image is generated, the one with the closest estimated size is chosen
+  auto sameRenderPass = [&](uint32_t queue, uint32_t index0, uint32_t index1) -> bool
+  {
+    // look at createCommandSequence() : consecutive graphics operations with the same tag form a render pass
+    const auto& op0 = operationSequences[queue][index0];
+    const auto& op1 = operationSequences[queue][index1];
+    return op0->operationType == RenderOperation::Graphics && op1->operationType == RenderOperation::Graphics && costCalculator.attachmentTag.at(op0->name) == costCalculator.attachmentTag.at(op1->name);
+  };
+  struct MemorySlot
+  {
+    uint32_t                 queue;
+    PerObjectBehaviour       perObjectBehaviour;
+    uint32_t                 last;
+    float                    size;
+    std::vector<std::string> images;
+  };
+  std::vector<MemorySlot> slots;
+  for (auto& image : images)
+  {
+    auto resourceType = workflow.getResource(image.name)->resourceType;
+    // estimation is only used to choose which images share memory
+    float size;
+    PerObjectBehaviour perObjectBehaviour = pbPerSurface;
+    if (resourceType->metaType == RenderWorkflowResourceType::Attachment)
     {
-      // cannot merge resource with itself
-      if (it0 == it1) continue;
-      auto resource1 = workflow.getResource(it1->first);
-      if (!resource0->resourceType->isEqual(*(resource1->resourceType)))
+      if (!image.attachmentOutputsOnly)
         continue;
-      int r1oq, r1op, r1iq, r1ip0, r1ip1;
-      std::tie(r1oq, r1op, r1iq, r1ip0, r1ip1) = it1->second;
-      // if resource r1 is not generated ( r1oq==-1 ) then it is sent from outside the workflow and we should not try to merge r0->r1
-      if (r1oq == -1)
+      size = static_cast<float>(estimateAttachmentMemorySize(*resourceType, VkExtent2D{ 1920, 1080 }));
+    }
+    else
+    {
+      auto memoryImage = getAliasableMemoryImage(workflow, image.name);
+      if (memoryImage == nullptr)
         continue;
-
-      // skip it if last use of r0 is in other queue than creation of r1
-      if (r0iq != r1oq)
+      size               = static_cast<float>(estimateImageMemorySize(memoryImage->getImageTraits()));
+      perObjectBehaviour = memoryImage->getPerObjectBehaviour();
+    }
+    uint32_t first = image.first, last = image.last;
+    while (first > 0 && sameRenderPass(image.queue, first - 1, first))
+      first--;
+    while (last + 1 < operationSequences[image.queue].size() && sameRenderPass(image.queue, last, last + 1))
+      last++;
+
+    auto best = end(slots);
+    for (auto it = begin(slots); it != end(slots); ++it)
+    {
+      if (it->queue != image.queue || it->perObjectBehaviour != perObjectBehaviour || it->last >= first)
         continue;
-      // if last consumption of r0 happens after generation of r1
-      if (r0ip1 >= r1op) continue;
-
-      resourcePairs.push_back({ it0->first , it1->first });
+      if (best == end(slots) || std::abs(it->size - size) < std::abs(best->size - size))
+        best = it;
     }
+    if (best == end(slots))
+      best = slots.insert(end(slots), MemorySlot{ image.queue, perObjectBehaviour, 0, 0.0f, {} });
+    best->last = last;
+    best->size = std::max(best->size, size);
+    best->images.push_back(image.name);
   }
-  // we can find reuse schema having graph from resource pairs that can be reused. This algorithm should minimize the number of output elements
-  while (!resourcePairs.empty())
-  {
-    auto longestPath = recursiveLongestPath(resourcePairs);
 
-    std::vector<std::pair<std::string, std::string>> rp;
-    std::copy_if(begin(resourcePairs), end(resourcePairs), std::back_inserter(rp),
-      [&longestPath](const std::pair<std::string, std::string>& thisPair) { return std::find(begin(longestPath), end(longestPath), thisPair.first) == end(longestPath) && std::find(begin(longestPath), end(longestPath), thisPair.second) == end(longestPath); });
-    resourcePairs = rp;
-
-    if (longestPath.size() > 1)
-    {
-      auto target = longestPath.back();
-      longestPath.pop_back();
-      for (auto& p : longestPath)
-        workflowResults->resourceAlias[p] = target;
-    }
-    else break;
+  uint32_t slotIndex = 0;
+  for (auto& slot : slots)
+  {
+    if (slot.images.size() < 2)
+      continue;
+    for (auto& imageName : slot.images)
+      workflowResults->memoryAlias.insert({ imageName, slotIndex });
+    slotIndex++;
   }
 }
 
-void SingleQueueWorkflowCompiler::createCommandSequence(const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::shared_ptr<RenderCommand>>& commands)
+void SingleQueueWorkflowCompiler::createCommandSequence(const StandardRenderWorkflowCostCalculator& costCalculator, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::vector<std::shared_ptr<RenderCommand>>& commands)
 {
   commands.clear();
 
@@ -1078,12 +1337,20 @@ void SingleQueueWorkflowCompiler::buildFrameBuffersAndRenderPasses(const RenderW
     }
   }
 
+  // images from the same memory slot share memory through MemoryAliasGroup
+  auto sharedImages = getSharedImages(*workflowResults);
+  workflowResults->memoryAliasGroups.clear();
+  for (auto& ma : workflowResults->memoryAlias)
+    while (workflowResults->memoryAliasGroups.size() <= ma.second)
+      workflowResults->memoryAliasGroups.push_back(std::make_shared<MemoryAliasGroup>(workflow.frameBufferAllocator));
+
   // build framebuffers
   for (auto& renderPass : renderPasses)
   {
     std::map<std::string,uint32_t>          definedImages;
     std::vector<FrameBufferImageDefinition> frameBufferDefinitions;
     std::vector<VkImageLayout>              rpInitialLayouts;
+    std::vector<char>                       rpDiscardContents;
     for (auto& sb : renderPass->subPasses)
     {
       auto subPass           = sb.lock();
@@ -1094,7 +1361,7 @@ void SingleQueueWorkflowCompiler::buildFrameBuffersAndRenderPasses(const RenderW
       {
         VkExtent3D imSize{ 1,1,1 };
         auto resourceName   = workflowResults->resourceAlias.at(transition->resource->name);
-        uint32_t resid      = resourceMap.at(resourceName);
+        uint32_t resid      = resourceMap.at(transition->resource->name);
         auto resourceType   = transition->resource->resourceType;
         auto aspectMask     = getAspectMask(resourceType->attachment.attachmentType);
         uint32_t layerCount = static_cast<uint32_t>(resourceType->attachment.attachmentSize.imageSize.z);
@@ -1104,18 +1371,24 @@ void SingleQueueWorkflowCompiler::buildFrameBuffersAndRenderPasses(const RenderW
           ImageTraits imageTraits(resourceType->attachment.imageUsage, resourceType->attachment.format, imSize, 1, layerCount, resourceType->attachment.samples, false, VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_IMAGE_TYPE_2D, VK_SHARING_MODE_EXCLUSIVE);
           SwapChainImageBehaviour scib = (resourceType->attachment.attachmentType == atSurface) ? swForEachImage : swOnce;
           ait = workflowResults->registeredMemoryImages.insert({ resourceName, std::make_shared<MemoryImage>(imageTraits, workflow.frameBufferAllocator, aspectMask, pbPerSurface, scib, false, false) }).first;
+          auto mit = workflowResults->memoryAlias.find(resourceName);
+          if (mit != end(workflowResults->memoryAlias))
+            ait->second->setMemoryAliasGroup(workflowResults->memoryAliasGroups[mit->second]);
         }
+        // shared image starts to hold a new resource, so its previous contents are discarded
+        bool discardContents = (sharedImages.find(resourceName) != end(sharedImages)) && ((transition->transitionType & rttAllOutputs) != 0);
         auto aiv = workflowResults->registeredImageViews.find(resourceName);
         if (aiv == end(workflowResults->registeredImageViews))
         {
           ImageSubresourceRange range(aspectMask, 0, 1, 0, layerCount);
           VkImageViewType imageViewType = (layerCount > 1) ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
           aiv = workflowResults->registeredImageViews.insert({ resourceName, std::make_shared<ImageView>(ait->second, range, imageViewType) }).first;
-          workflowResults->initialImageLayouts.insert({ resourceName, std::make_tuple(opLayouts[resid], resourceType->attachment.attachmentType , aspectMask) });
+          workflowResults->initialImageLayouts.insert({ resourceName, std::make_tuple(discardContents ? VK_IMAGE_LAYOUT_UNDEFINED : opLayouts[resid], resourceType->attachment.attachmentType , aspectMask) });
         }
         if (definedImages.find(resourceName) == end(definedImages))
         {
-          rpInitialLayouts.push_back(opLayouts[resid]);
+          rpInitialLayouts.push_back(discardContents ? VK_IMAGE_LAYOUT_UNDEFINED : opLayouts[resid]);
+          rpDiscardContents.push_back(discardContents);
           definedImages.insert({ resourceName,static_cast<uint32_t>(frameBufferDefinitions.size()) });
           frameBufferDefinitions.push_back(FrameBufferImageDefinition(
             resourceType->attachment.attachmentType,
@@ -1181,7 +1454,7 @@ void SingleQueueWorkflowCompiler::buildFrameBuffersAndRenderPasses(const RenderW
         // if it's an output transition
         if ((transition->transitionType & rttAllOutputs) != 0)
         {
-          if (attachments[attIndex].initialLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+          if (attachments[attIndex].initialLayout == VK_IMAGE_LAYOUT_UNDEFINED && !rpDiscardContents[attIndex])
             attachments[attIndex].initialLayout = transition->layout;
         }
 
@@ -1336,6 +1609,7 @@ void SingleQueueWorkflowCompiler::createPipelineBarriers(const RenderWorkflow& w
     queueIndex++;
   }
 
+  auto sharedImages  = getSharedImages(*workflowResults);
   auto resourceNames = workflow.getResourceNames();
   for (auto& resourceName : resourceNames)
   {
@@ -1347,6 +1621,41 @@ void SingleQueueWorkflowCompiler::createPipelineBarriers(const RenderWorkflow& w
     auto generatingOperationNumber = operationNumber[generatingTransitions[0]->operation->name];
     auto generatingQueueNumber     = queueNumber[generatingTransitions[0]->operation->name];
 
+    // when shared image gets a new resource, all previous work on its memory must be finished ( write-after-read and write-after-write hazards )
+    auto generatingCommand = commandMap[generatingTransitions[0]->operation->name];
+    if (sharedImages.find(workflowResults->resourceAlias.at(resourceName)) != end(sharedImages) && generatingCommand->commandType == RenderCommand::ctRenderSubPass)
+    {
+      auto generatingSubpass = std::dynamic_pointer_cast<RenderSubPass>(generatingCommand);
+      VkPipelineStageFlags dstStageMask = 0, unusedStageMask = 0;
+      VkAccessFlags        dstAccessMask = 0, unusedAccessMask = 0;
+      getPipelineStageMasks(generatingTransitions[0], generatingTransitions[0], dstStageMask, unusedStageMask);
+      getAccessMasks(generatingTransitions[0], generatingTransitions[0], dstAccessMask, unusedAccessMask);
+
+      uint32_t dstSubpassIndex = generatingSubpass->subpassIndex;
+      auto& dependencies       = generatingSubpass->renderPass->dependencies;
+      auto dep = std::find_if(begin(dependencies), end(dependencies), [dstSubpassIndex](const SubpassDependencyDefinition& sd) -> bool { return sd.srcSubpass == VK_SUBPASS_EXTERNAL && sd.dstSubpass == dstSubpassIndex; });
+      if (dep == end(dependencies))
+        dep = dependencies.insert(end(dependencies), SubpassDependencyDefinition(VK_SUBPASS_EXTERNAL, dstSubpassIndex, 0, 0, 0, 0, 0));
+      dep->srcStageMask  |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+      dep->dstStageMask  |= dstStageMask;
+      dep->srcAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+      dep->dstAccessMask |= dstAccessMask;
+    }
+    else if (workflowResults->memoryAlias.find(resourceName) != end(workflowResults->memoryAlias))
+    {
+      // user image generated outside of render pass : previous contents of its memory are discarded by transition from undefined layout
+      auto memoryObject = workflow.getAssociatedMemoryObject(resourceName);
+      if (memoryObject != nullptr)
+      {
+        VkPipelineStageFlags dstStageMask = 0, unusedStageMask = 0;
+        VkAccessFlags        dstAccessMask = 0, unusedAccessMask = 0;
+        getPipelineStageMasks(generatingTransitions[0], generatingTransitions[0], dstStageMask, unusedStageMask);
+        getAccessMasks(generatingTransitions[0], generatingTransitions[0], dstAccessMask, unusedAccessMask);
+        MemoryObjectBarrier barrier(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, dstAccessMask, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, memoryObject, VK_IMAGE_LAYOUT_UNDEFINED, generatingTransitions[0]->layout, generatingTransitions[0]->imageSubresourceRange);
+        generatingCommand->barriersBeforeOp[MemoryObjectBarrierGroup(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dstStageMask, 0)].push_back(barrier);
+      }
+    }
+
     // sort consuming transitions according to operation index, operations from current queue will be first in sorted vector
     auto consumingTransitions = workflow.getResourceIO(resourceName, rttAllInputs);
     // place transitions that are in the same queue first
@@ -1368,9 +1677,22 @@ void SingleQueueWorkflowCompiler::createPipelineBarriers(const RenderWorkflow& w
     });
 
     // for now we will create a barrier/subpass dependency for each transition. It should be later optimized ( some barriers are not necessary )
+    // Resource ownership is transferred to each of the other queues only once, by the first consumer in that queue. Semaphore does not change
+    // image layout, so each following consumer in that queue gets a barrier from the previous consumer when its layout or access differs
+    std::map<int, std::shared_ptr<ResourceTransition>> lastQueueConsumer;
     for (auto& consumingTransition : consumingTransitions)
     {
-      if( ((generatingTransitions[0]->transitionType & rttAllAttachmentOutputs) != 0) && ((consumingTransition->transitionType & rttAllAttachmentInputs) != 0) )
+      auto consumingQueueNumber = queueNumber[consumingTransition->operation->name];
+      if (consumingQueueNumber != generatingQueueNumber)
+      {
+        auto lit = lastQueueConsumer.find(consumingQueueNumber);
+        if (lit == end(lastQueueConsumer))
+          createPipelineBarrier(generatingTransitions[0], commandMap[generatingTransitions[0]->operation->name], consumingTransition, commandMap[consumingTransition->operation->name], generatingQueueNumber, consumingQueueNumber, workflowResults);
+        else
+          createConsumerBarrier(generatingTransitions[0], lit->second, consumingTransition, commandMap[consumingTransition->operation->name], workflowResults);
+        lastQueueConsumer[consumingQueueNumber] = consumingTransition;
+      }
+      else if( ((generatingTransitions[0]->transitionType & rttAllAttachmentOutputs) != 0) && ((consumingTransition->transitionType & rttAllAttachmentInputs) != 0) )
         createSubpassDependency(generatingTransitions[0], commandMap[generatingTransitions[0]->operation->name], consumingTransition, commandMap[consumingTransition->operation->name], queueNumber[generatingTransitions[0]->operation->name], queueNumber[consumingTransition->operation->name], workflowResults);
       else
         createPipelineBarrier(generatingTransitions[0], commandMap[generatingTransitions[0]->operation->name], consumingTransition, commandMap[consumingTransition->operation->name], queueNumber[generatingTransitions[0]->operation->name], queueNumber[consumingTransition->operation->name], workflowResults);
@@ -1431,24 +1753,11 @@ void SingleQueueWorkflowCompiler::createSubpassDependency(std::shared_ptr<Resour
 
 void SingleQueueWorkflowCompiler::createPipelineBarrier(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<RenderCommand> generatingCommand, std::shared_ptr<ResourceTransition> consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, uint32_t generatingQueueIndex, uint32_t consumingQueueIndex, std::shared_ptr<RenderWorkflowResults> workflowResults)
 {
-  auto workflow = generatingTransition->operation->renderWorkflow.lock();
-
   // If there's no associated memory object then there can be no pipeline barrier
   // Some inputs/outputs may be added without memory objects just to enforce proper order of operations
-  auto memoryObject = workflow->getAssociatedMemoryObject(generatingTransition->resource->name);
+  auto memoryObject = getBarrierMemoryObject(generatingTransition, workflowResults);
   if (memoryObject == nullptr)
-  {
-    auto it = workflowResults->registeredMemoryImages.find(workflowResults->resourceAlias.at(generatingTransition->resource->name));
-    if (it == end(workflowResults->registeredMemoryImages))
-      return;
-    memoryObject = it->second;
-  }
-
-  uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  if (generatingQueueIndex != consumingQueueIndex)
-  {
-    // TODO - find family indices for both queues
-  }
+    return;
 
   VkPipelineStageFlags srcStageMask = 0,  dstStageMask = 0;
   VkAccessFlags        srcAccessMask = 0, dstAccessMask = 0;
@@ -1457,16 +1766,13 @@ void SingleQueueWorkflowCompiler::createPipelineBarrier(std::shared_ptr<Resource
 
   VkDependencyFlags dependencyFlags = 0; // FIXME
 
-  MemoryObjectBarrierGroup rbg(srcStageMask, dstStageMask, dependencyFlags);
-  auto rbgit = consumingCommand->barriersBeforeOp.find(rbg);
-  if (rbgit == end(consumingCommand->barriersBeforeOp))
-    rbgit = consumingCommand->barriersBeforeOp.insert({ rbg, std::vector<MemoryObjectBarrier>() }).first;
+  MemoryObjectBarrier barrier;
   switch (generatingTransition->resource->resourceType->metaType)
   {
   case RenderWorkflowResourceType::Buffer:
   {
     auto bufferRange = generatingTransition->bufferSubresourceRange;
-    rbgit->second.push_back(MemoryObjectBarrier(srcAccessMask, dstAccessMask, srcQueueFamilyIndex, dstQueueFamilyIndex, memoryObject, bufferRange));
+    barrier = MemoryObjectBarrier(srcAccessMask, dstAccessMask, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, memoryObject, bufferRange);
     break;
   }
   case RenderWorkflowResourceType::Image:
@@ -1475,10 +1781,220 @@ void SingleQueueWorkflowCompiler::createPipelineBarrier(std::shared_ptr<Resource
     VkImageLayout oldLayout = generatingTransition->layout;
     VkImageLayout newLayout = consumingTransition->layout;
     auto imageRange         = generatingTransition->imageSubresourceRange;
-    rbgit->second.push_back(MemoryObjectBarrier(srcAccessMask, dstAccessMask, srcQueueFamilyIndex, dstQueueFamilyIndex, memoryObject, oldLayout, newLayout, imageRange));
+    barrier = MemoryObjectBarrier(srcAccessMask, dstAccessMask, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, memoryObject, oldLayout, newLayout, imageRange);
     break;
   }
   default:
+    return;
+  }
+
+  if (generatingQueueIndex == consumingQueueIndex)
+  {
+    consumingCommand->barriersBeforeOp[MemoryObjectBarrierGroup(srcStageMask, dstStageMask, dependencyFlags)].push_back(barrier);
+    return;
+  }
+
+  // Barrier between queues is divided into release barrier recorded after generating command and acquire barrier recorded before consuming command.
+  // Queue family indices are resolved when command buffer is built. Barriers cannot be recorded inside a render pass, so release barrier
+  // goes after the last subpass of a render pass and acquire barrier goes before its first subpass ( createSubmissions() splits commands at the same places )
+  auto releaseCommand = generatingCommand;
+  if (generatingCommand->commandType == RenderCommand::ctRenderSubPass)
+    releaseCommand = std::dynamic_pointer_cast<RenderSubPass>(generatingCommand)->renderPass->subPasses.back().lock();
+  auto acquireCommand = consumingCommand;
+  if (consumingCommand->commandType == RenderCommand::ctRenderSubPass)
+    acquireCommand = std::dynamic_pointer_cast<RenderSubPass>(consumingCommand)->renderPass->subPasses.front().lock();
+
+  MemoryObjectBarrier releaseBarrier(barrier);
+  releaseBarrier.dstAccessMask = 0;
+  releaseBarrier.setOwnershipTransfer(MemoryObjectBarrier::otRelease, generatingQueueIndex, consumingQueueIndex);
+  releaseCommand->barriersAfterOp[MemoryObjectBarrierGroup(srcStageMask, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, dependencyFlags)].push_back(releaseBarrier);
+
+  // semaphore wait occurs at dstStageMask, so acquire barrier starts its dependency chain there
+  MemoryObjectBarrier acquireBarrier(barrier);
+  acquireBarrier.srcAccessMask = 0;
+  acquireBarrier.setOwnershipTransfer(MemoryObjectBarrier::otAcquire, generatingQueueIndex, consumingQueueIndex);
+  acquireCommand->barriersBeforeOp[MemoryObjectBarrierGroup(dstStageMask, dstStageMask, dependencyFlags)].push_back(acquireBarrier);
+}
+
+void SingleQueueWorkflowCompiler::createConsumerBarrier(std::shared_ptr<ResourceTransition> generatingTransition, std::shared_ptr<ResourceTransition> previousTransition, std::shared_ptr<ResourceTransition> consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, std::shared_ptr<RenderWorkflowResults> workflowResults)
+{
+  auto memoryObject = getBarrierMemoryObject(generatingTransition, workflowResults);
+  if (memoryObject == nullptr)
+    return;
+
+  // source scope is the stage of previous consumer, so this barrier chains with the barrier recorded before previous consumer
+  VkPipelineStageFlags srcStageMask = 0,  dstStageMask = 0,  unusedStageMask = 0;
+  VkAccessFlags        srcAccessMask = 0, dstAccessMask = 0, unusedAccessMask = 0;
+  getPipelineStageMasks(generatingTransition, previousTransition, unusedStageMask, srcStageMask);
+  getPipelineStageMasks(generatingTransition, consumingTransition, unusedStageMask, dstStageMask);
+  getAccessMasks(generatingTransition, previousTransition, unusedAccessMask, srcAccessMask);
+  getAccessMasks(generatingTransition, consumingTransition, unusedAccessMask, dstAccessMask);
+  if (previousTransition->layout == consumingTransition->layout && srcAccessMask == dstAccessMask)
+    return;
+
+  MemoryObjectBarrier barrier;
+  switch (generatingTransition->resource->resourceType->metaType)
+  {
+  case RenderWorkflowResourceType::Buffer:
+    barrier = MemoryObjectBarrier(srcAccessMask, dstAccessMask, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, memoryObject, generatingTransition->bufferSubresourceRange);
+    break;
+  case RenderWorkflowResourceType::Image:
+  case RenderWorkflowResourceType::Attachment:
+    barrier = MemoryObjectBarrier(srcAccessMask, dstAccessMask, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, memoryObject, previousTransition->layout, consumingTransition->layout, generatingTransition->imageSubresourceRange);
     break;
+  default:
+    return;
+  }
+  consumingCommand->barriersBeforeOp[MemoryObjectBarrierGroup(srcStageMask, dstStageMask, 0)].push_back(barrier);
+}
+
+std::shared_ptr<MemoryObject> SingleQueueWorkflowCompiler::getBarrierMemoryObject(std::shared_ptr<ResourceTransition> transition, std::shared_ptr<RenderWorkflowResults> workflowResults)
+{
+  auto workflow     = transition->operation->renderWorkflow.lock();
+  auto memoryObject = workflow->getAssociatedMemoryObject(transition->resource->name);
+  if (memoryObject != nullptr)
+    return memoryObject;
+  auto it = workflowResults->registeredMemoryImages.find(workflowResults->resourceAlias.at(transition->resource->name));
+  if (it == end(workflowResults->registeredMemoryImages))
+    return nullptr;
+  return it->second;
+}
+
+void SingleQueueWorkflowCompiler::createSubmissions(const RenderWorkflow& workflow, const std::vector<std::shared_ptr<RenderOperation>>& operationSequence, std::shared_ptr<RenderWorkflowResults> workflowResults)
+{
+  const auto& commands = workflowResults->commands;
+
+  std::map<std::string, uint32_t> sequenceIndex;
+  for (uint32_t i = 0; i < operationSequence.size(); ++i)
+    sequenceIndex.insert({ operationSequence[i]->name, i });
+  std::map<std::string, std::pair<uint32_t, uint32_t>> commandIndex;
+  for (uint32_t i = 0; i < commands.size(); ++i)
+    for (uint32_t j = 0; j < commands[i].size(); ++j)
+      commandIndex.insert({ commands[i][j]->operation->name, { i, j } });
+
+  // render pass cannot be divided between submissions, so dependencies of subpasses are moved to the borders of their render passes
+  auto renderPassBegin = [&commands](uint32_t queue, uint32_t index) -> uint32_t
+  {
+    auto subpass = commands[queue][index]->asRenderSubPass();
+    while (subpass != nullptr && index > 0 && commands[queue][index - 1]->asRenderSubPass() != nullptr && commands[queue][index - 1]->asRenderSubPass()->renderPass == subpass->renderPass)
+      index--;
+    return index;
+  };
+  auto renderPassEnd = [&commands](uint32_t queue, uint32_t index) -> uint32_t
+  {
+    auto subpass = commands[queue][index]->asRenderSubPass();
+    while (subpass != nullptr && index + 1 < commands[queue].size() && commands[queue][index + 1]->asRenderSubPass() != nullptr && commands[queue][index + 1]->asRenderSubPass()->renderPass == subpass->renderPass)
+      index++;
+    return index;
+  };
+
+  // find all dependencies between queues. Generating command ends a submission, consuming command starts a new one
+  struct QueueDependency
+  {
+    std::pair<uint32_t, uint32_t> generatingCommand;
+    std::pair<uint32_t, uint32_t> consumingCommand;
+    VkPipelineStageFlags          dstStageMask;
+  };
+  std::vector<QueueDependency>    dependencies;
+  std::vector<std::set<uint32_t>> submissionBegins(commands.size(), std::set<uint32_t>{ 0 });
+  for (auto& resourceName : workflow.getResourceNames())
+  {
+    auto generatingTransitions = workflow.getResourceIO(resourceName, rttAllOutputs);
+    if (generatingTransitions.empty())
+      continue;
+    auto generatingCommand = commandIndex.at(generatingTransitions[0]->operation->name);
+    for (auto& consumingTransition : workflow.getResourceIO(resourceName, rttAllInputs))
+    {
+      auto consumingCommand = commandIndex.at(consumingTransition->operation->name);
+      if (consumingCommand.first == generatingCommand.first)
+        continue;
+      VkPipelineStageFlags srcStageMask = 0, dstStageMask = 0;
+      getPipelineStageMasks(generatingTransitions[0], consumingTransition, srcStageMask, dstStageMask);
+
+      QueueDependency dependency{ { generatingCommand.first, renderPassEnd(generatingCommand.first, generatingCommand.second) }, { consumingCommand.first, renderPassBegin(consumingCommand.first, consumingCommand.second) }, dstStageMask };
+      submissionBegins[dependency.generatingCommand.first].insert(dependency.generatingCommand.second + 1);
+      submissionBegins[dependency.consumingCommand.first].insert(dependency.consumingCommand.second);
+      dependencies.push_back(dependency);
+    }
+  }
+
+  // each queue gets at least one submission, even if it has no commands
+  std::vector<QueueSubmission> submissions;
+  std::vector<std::map<uint32_t, uint32_t>> submissionByCommand(commands.size());
+  for (uint32_t i = 0; i < commands.size(); ++i)
+  {
+    uint32_t commandCount = commands[i].size();
+    submissionBegins[i].erase(submissionBegins[i].lower_bound(std::max(1U, commandCount)), end(submissionBegins[i]));
+    for (auto it = begin(submissionBegins[i]); it != end(submissionBegins[i]); ++it)
+    {
+      auto nit = std::next(it);
+      QueueSubmission submission;
+      submission.queueIndex   = i;
+      submission.firstCommand = *it;
+      submission.commandCount = ((nit == end(submissionBegins[i])) ? commandCount : *nit) - *it;
+      submissionByCommand[i].insert({ *it, submissions.size() });
+      submissions.push_back(submission);
+    }
+  }
+  auto findSubmission = [&submissionByCommand](const std::pair<uint32_t, uint32_t>& command) -> uint32_t
+  {
+    return std::prev(submissionByCommand[command.first].upper_bound(command.second))->second;
+  };
+
+  // submission depends on previous submission from the same queue and on submissions it waits for
+  std::vector<std::set<uint32_t>> waitsFor(submissions.size());
+  for (auto& dependency : dependencies)
+  {
+    uint32_t generatingSubmission = findSubmission(dependency.generatingCommand);
+    uint32_t consumingSubmission  = findSubmission(dependency.consumingCommand);
+    waitsFor[consumingSubmission].insert(generatingSubmission);
+    auto& submission = submissions[consumingSubmission];
+    auto wit = std::find(begin(submission.waitSubmissions), end(submission.waitSubmissions), generatingSubmission);
+    if (wit == end(submission.waitSubmissions))
+    {
+      submission.waitSubmissions.push_back(generatingSubmission);
+      submission.waitStages.push_back(dependency.dstStageMask);
+    }
+    else
+      submission.waitStages[std::distance(begin(submission.waitSubmissions), wit)] |= dependency.dstStageMask;
+  }
+  for (uint32_t i = 1; i < submissions.size(); ++i)
+    if (submissions[i].queueIndex == submissions[i - 1].queueIndex)
+      waitsFor[i].insert(i - 1);
+
+  // Semaphore may be waited on only after its signal operation was submitted, so submissions are sorted topologically.
+  // Among ready submissions the one whose first operation was scheduled earlier goes first
+  auto submissionOrder = [&](uint32_t s) -> uint32_t
+  {
+    if (submissions[s].commandCount == 0)
+      return 0;
+    return sequenceIndex.at(commands[submissions[s].queueIndex][submissions[s].firstCommand]->operation->name) + 1;
+  };
+  std::vector<uint32_t> sortedSubmissions;
+  std::vector<bool>     submitted(submissions.size(), false);
+  while (sortedSubmissions.size() < submissions.size())
+  {
+    uint32_t best = submissions.size();
+    for (uint32_t i = 0; i < submissions.size(); ++i)
+    {
+      if (submitted[i] || std::any_of(begin(waitsFor[i]), end(waitsFor[i]), [&submitted](uint32_t w) { return !submitted[w]; }))
+        continue;
+      if (best == submissions.size() || submissionOrder(i) < submissionOrder(best))
+        best = i;
+    }
+    CHECK_LOG_THROW(best == submissions.size(), "Cannot order queue submissions of a workflow - render pass depends on work from other queue that depends on the same render pass");
+    submitted[best] = true;
+    sortedSubmissions.push_back(best);
+  }
+
+  std::vector<uint32_t> newIndex(submissions.size());
+  for (uint32_t i = 0; i < sortedSubmissions.size(); ++i)
+    newIndex[sortedSubmissions[i]] = i;
+  workflowResults->submissions.clear();
+  for (auto s : sortedSubmissions)
+  {
+    workflowResults->submissions.push_back(submissions[s]);
+    for (auto& w : workflowResults->submissions.back().waitSubmissions)
+      w = newIndex[w];
   }
 }
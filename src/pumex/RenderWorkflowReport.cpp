@@ -0,0 +1,486 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <pumex/RenderWorkflowReport.h>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <pumex/RenderWorkflow.h>
+#include <pumex/RenderPass.h>
+#include <pumex/FrameBuffer.h>
+#include <pumex/MemoryObjectBarrier.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+namespace
+{
+
+std::string jsonString(const std::string& value)
+{
+  std::ostringstream result;
+  result << '"';
+  for (auto c : value)
+  {
+    switch (c)
+    {
+    case '"':  result << "\\\""; break;
+    case '\\': result << "\\\\"; break;
+    case '\n': result << "\\n";  break;
+    case '\t': result << "\\t";  break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+        result << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xF] << "0123456789abcdef"[c & 0xF];
+      else
+        result << c;
+    }
+  }
+  result << '"';
+  return result.str();
+}
+
+// label may contain DOT escape sequences ( e.g. \n ), so only quotes are escaped
+std::string dotString(const std::string& value)
+{
+  std::string result = "\"";
+  for (auto c : value)
+  {
+    if (c == '"')
+      result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+std::string imageLayoutName(VkImageLayout layout)
+{
+  switch (layout)
+  {
+  case VK_IMAGE_LAYOUT_UNDEFINED:                        return "UNDEFINED";
+  case VK_IMAGE_LAYOUT_GENERAL:                          return "GENERAL";
+  case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:         return "COLOR_ATTACHMENT_OPTIMAL";
+  case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT_OPTIMAL";
+  case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:  return "DEPTH_STENCIL_READ_ONLY_OPTIMAL";
+  case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:         return "SHADER_READ_ONLY_OPTIMAL";
+  case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:             return "TRANSFER_SRC_OPTIMAL";
+  case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:             return "TRANSFER_DST_OPTIMAL";
+  case VK_IMAGE_LAYOUT_PREINITIALIZED:                   return "PREINITIALIZED";
+  case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:                  return "PRESENT_SRC_KHR";
+  default:                                               return std::to_string(static_cast<int>(layout));
+  }
+}
+
+std::string loadOpName(VkAttachmentLoadOp loadOp)
+{
+  switch (loadOp)
+  {
+  case VK_ATTACHMENT_LOAD_OP_LOAD:      return "LOAD";
+  case VK_ATTACHMENT_LOAD_OP_CLEAR:     return "CLEAR";
+  case VK_ATTACHMENT_LOAD_OP_DONT_CARE: return "DONT_CARE";
+  default:                              return std::to_string(static_cast<int>(loadOp));
+  }
+}
+
+std::string storeOpName(VkAttachmentStoreOp storeOp)
+{
+  switch (storeOp)
+  {
+  case VK_ATTACHMENT_STORE_OP_STORE:     return "STORE";
+  case VK_ATTACHMENT_STORE_OP_DONT_CARE: return "DONT_CARE";
+  default:                               return std::to_string(static_cast<int>(storeOp));
+  }
+}
+
+std::string ownershipTransferName(MemoryObjectBarrier::OwnershipTransfer transfer)
+{
+  switch (transfer)
+  {
+  case MemoryObjectBarrier::otRelease: return "release";
+  case MemoryObjectBarrier::otAcquire: return "acquire";
+  default:                             return "none";
+  }
+}
+
+uint32_t countBarriers(const std::map<MemoryObjectBarrierGroup, std::vector<MemoryObjectBarrier>>& barriers)
+{
+  uint32_t result = 0;
+  for (auto& group : barriers)
+    result += static_cast<uint32_t>(group.second.size());
+  return result;
+}
+
+void writeAttachmentReferences(std::ostream& stream, const std::vector<VkAttachmentReference>& references)
+{
+  stream << "[";
+  for (uint32_t i = 0; i < references.size(); ++i)
+    stream << (i > 0 ? ", " : " ") << "{ \"attachment\" : " << static_cast<int>(references[i].attachment) << ", \"layout\" : " << jsonString(imageLayoutName(references[i].layout)) << " }";
+  stream << (references.empty() ? "]" : " ]");
+}
+
+}
+
+RenderWorkflowReport::RenderWorkflowReport(RenderWorkflow& w, std::shared_ptr<RenderWorkflowCompiler> compiler, const VkExtent2D& se)
+  : workflow{ w }, surfaceExtent{ se }
+{
+  CHECK_LOG_THROW(compiler == nullptr, "RenderWorkflowReport : compiler not defined");
+  // compilation does not create any Vulkan objects, so compiler may be called directly. Results are not stored in the workflow
+  workflowResults = compiler->compile(workflow);
+
+  for (auto& commandSequence : workflowResults->commands)
+  {
+    for (auto& command : commandSequence)
+    {
+      if (command->commandType != RenderCommand::ctRenderSubPass)
+        continue;
+      auto renderPass = command->asRenderSubPass()->renderPass;
+      if (renderPass != nullptr && std::find(begin(renderPasses), end(renderPasses), renderPass) == end(renderPasses))
+        renderPasses.push_back(renderPass);
+    }
+  }
+
+  for (auto& mo : workflow.getAssociatedMemoryObjects())
+    memoryObjectNames.insert({ mo.second.get(), mo.first });
+  for (auto& mi : workflowResults->registeredMemoryImages)
+    memoryObjectNames.insert({ mi.second.get(), mi.first });
+  for (auto& mb : workflowResults->registeredMemoryBuffers)
+    memoryObjectNames.insert({ mb.second.get(), mb.first });
+}
+
+uint32_t RenderWorkflowReport::getOperationCount() const
+{
+  uint32_t result = 0;
+  for (auto& commandSequence : workflowResults->commands)
+    result += static_cast<uint32_t>(commandSequence.size());
+  return result;
+}
+
+uint32_t RenderWorkflowReport::getRenderPassCount() const
+{
+  return static_cast<uint32_t>(renderPasses.size());
+}
+
+uint32_t RenderWorkflowReport::getPipelineBarrierCount() const
+{
+  uint32_t result = 0;
+  for (auto& commandSequence : workflowResults->commands)
+    for (auto& command : commandSequence)
+      result += countBarriers(command->barriersBeforeOp) + countBarriers(command->barriersAfterOp);
+  return result;
+}
+
+uint32_t RenderWorkflowReport::getSubpassDependencyCount() const
+{
+  uint32_t result = 0;
+  for (auto& renderPass : renderPasses)
+    result += static_cast<uint32_t>(renderPass->dependencies.size());
+  return result;
+}
+
+VkDeviceSize RenderWorkflowReport::getAttachmentMemorySize(bool withAliasing) const
+{
+  VkDeviceSize result = 0;
+  if (!withAliasing)
+  {
+    // each resource has its own image
+    for (auto& resourceName : workflow.getResourceNames())
+    {
+      auto resourceType = workflow.getResource(resourceName)->resourceType;
+      if (resourceType->metaType != RenderWorkflowResourceType::Attachment || resourceType->attachment.attachmentType == atSurface || workflow.getAssociatedMemoryObject(resourceName) != nullptr)
+        continue;
+      result += estimateAttachmentMemorySize(*resourceType, surfaceExtent);
+    }
+    return result;
+  }
+
+  // images created by the compiler. Images from the same memory slot need as much memory as the largest of them
+  std::map<uint32_t, VkDeviceSize> slotSizes;
+  for (auto& mi : workflowResults->registeredMemoryImages)
+  {
+    if (workflow.getAssociatedMemoryObject(mi.first) != nullptr)
+      continue;
+    auto resourceType = workflow.getResource(mi.first)->resourceType;
+    if (resourceType->attachment.attachmentType == atSurface)
+      continue;
+    auto size = estimateAttachmentMemorySize(*resourceType, surfaceExtent);
+    auto mit  = workflowResults->memoryAlias.find(mi.first);
+    if (mit == end(workflowResults->memoryAlias))
+      result += size;
+    else
+      slotSizes[mit->second] = std::max(slotSizes[mit->second], size);
+  }
+  for (auto& slotSize : slotSizes)
+    result += slotSize.second;
+  return result;
+}
+
+int RenderWorkflowReport::getRenderPassIndex(const RenderCommand* command) const
+{
+  if (command->commandType != RenderCommand::ctRenderSubPass)
+    return -1;
+  auto renderPass = static_cast<const RenderSubPass*>(command)->renderPass;
+  auto it = std::find(begin(renderPasses), end(renderPasses), renderPass);
+  if (it == end(renderPasses))
+    return -1;
+  return static_cast<int>(std::distance(begin(renderPasses), it));
+}
+
+std::string RenderWorkflowReport::getResourceName(const MemoryObjectBarrier& barrier) const
+{
+  auto it = memoryObjectNames.find(barrier.memoryObject.get());
+  if (it == end(memoryObjectNames))
+    return std::string();
+  return it->second;
+}
+
+void RenderWorkflowReport::writeJSON(std::ostream& stream) const
+{
+  auto writeBarriers = [&](const std::map<MemoryObjectBarrierGroup, std::vector<MemoryObjectBarrier>>& barriers)
+  {
+    stream << "[";
+    bool first = true;
+    for (auto& group : barriers)
+    {
+      for (auto& barrier : group.second)
+      {
+        stream << (first ? "" : ",") << "\n            { ";
+        stream << "\"resource\" : " << jsonString(getResourceName(barrier));
+        stream << ", \"srcStageMask\" : " << group.first.srcStageMask << ", \"dstStageMask\" : " << group.first.dstStageMask;
+        stream << ", \"srcAccessMask\" : " << barrier.srcAccessMask << ", \"dstAccessMask\" : " << barrier.dstAccessMask;
+        if (barrier.objectType == MemoryObject::moImage)
+          stream << ", \"oldLayout\" : " << jsonString(imageLayoutName(barrier.oldLayout)) << ", \"newLayout\" : " << jsonString(imageLayoutName(barrier.newLayout));
+        stream << ", \"ownershipTransfer\" : " << jsonString(ownershipTransferName(barrier.ownershipTransfer));
+        if (barrier.ownershipTransfer != MemoryObjectBarrier::otNone)
+          stream << ", \"srcQueue\" : " << barrier.srcQueueIndex << ", \"dstQueue\" : " << barrier.dstQueueIndex;
+        stream << " }";
+        first = false;
+      }
+    }
+    stream << (first ? "]" : "\n          ]");
+  };
+
+  stream << "{\n";
+  stream << "  \"workflow\" : " << jsonString(workflow.getName()) << ",\n";
+
+  // operations in the order of execution on each queue
+  stream << "  \"queues\" : [";
+  for (uint32_t q = 0; q < workflowResults->commands.size(); ++q)
+  {
+    stream << (q > 0 ? "," : "") << "\n    {\n";
+    stream << "      \"index\" : " << q << ", \"mustHave\" : " << workflowResults->queueTraits[q].mustHave << ", \"mustNotHave\" : " << workflowResults->queueTraits[q].mustNotHave << ",\n";
+    stream << "      \"commands\" : [";
+    for (uint32_t c = 0; c < workflowResults->commands[q].size(); ++c)
+    {
+      auto& command = workflowResults->commands[q][c];
+      stream << (c > 0 ? "," : "") << "\n        {\n";
+      stream << "          \"operation\" : " << jsonString(command->operation->name);
+      stream << ", \"type\" : " << (command->commandType == RenderCommand::ctRenderSubPass ? "\"subpass\"" : "\"compute\"");
+      stream << ", \"renderPass\" : " << getRenderPassIndex(command.get());
+      stream << ", \"subpass\" : " << (command->commandType == RenderCommand::ctRenderSubPass ? static_cast<int>(command->asRenderSubPass()->subpassIndex) : -1) << ",\n";
+      stream << "          \"barriersBefore\" : ";
+      writeBarriers(command->barriersBeforeOp);
+      stream << ",\n          \"barriersAfter\" : ";
+      writeBarriers(command->barriersAfterOp);
+      stream << "\n        }";
+    }
+    stream << (workflowResults->commands[q].empty() ? "]" : "\n      ]") << "\n    }";
+  }
+  stream << "\n  ],\n";
+
+  stream << "  \"submissions\" : [";
+  for (uint32_t s = 0; s < workflowResults->submissions.size(); ++s)
+  {
+    auto& submission = workflowResults->submissions[s];
+    stream << (s > 0 ? "," : "") << "\n    { \"queue\" : " << submission.queueIndex << ", \"firstCommand\" : " << submission.firstCommand << ", \"commandCount\" : " << submission.commandCount << ", \"waits\" : [";
+    for (uint32_t w = 0; w < submission.waitSubmissions.size(); ++w)
+      stream << (w > 0 ? ", " : " ") << "{ \"submission\" : " << submission.waitSubmissions[w] << ", \"stageMask\" : " << submission.waitStages[w] << " }";
+    stream << (submission.waitSubmissions.empty() ? "] }" : " ] }");
+  }
+  stream << (workflowResults->submissions.empty() ? "],\n" : "\n  ],\n");
+
+  stream << "  \"renderPasses\" : [";
+  for (uint32_t r = 0; r < renderPasses.size(); ++r)
+  {
+    auto& renderPass = renderPasses[r];
+    stream << (r > 0 ? "," : "") << "\n    {\n";
+    stream << "      \"index\" : " << r << ",\n";
+    stream << "      \"attachments\" : [";
+    for (uint32_t a = 0; a < renderPass->attachments.size(); ++a)
+    {
+      auto& attachment = renderPass->attachments[a];
+      stream << (a > 0 ? "," : "") << "\n        { ";
+      stream << "\"image\" : " << jsonString(renderPass->frameBuffer->getImageDefinition(attachment.imageDefinitionIndex).name);
+      stream << ", \"format\" : " << static_cast<int>(attachment.format) << ", \"samples\" : " << static_cast<int>(attachment.samples);
+      stream << ", \"loadOp\" : " << jsonString(loadOpName(attachment.loadOp)) << ", \"storeOp\" : " << jsonString(storeOpName(attachment.storeOp));
+      stream << ", \"stencilLoadOp\" : " << jsonString(loadOpName(attachment.stencilLoadOp)) << ", \"stencilStoreOp\" : " << jsonString(storeOpName(attachment.stencilStoreOp));
+      stream << ", \"initialLayout\" : " << jsonString(imageLayoutName(attachment.initialLayout)) << ", \"finalLayout\" : " << jsonString(imageLayoutName(attachment.finalLayout));
+      stream << " }";
+    }
+    stream << (renderPass->attachments.empty() ? "],\n" : "\n      ],\n");
+    stream << "      \"subpasses\" : [";
+    for (uint32_t s = 0; s < renderPass->subPasses.size(); ++s)
+    {
+      auto subPass = renderPass->subPasses[s].lock();
+      stream << (s > 0 ? "," : "") << "\n        {\n";
+      stream << "          \"operation\" : " << jsonString(subPass->operation->name) << ",\n";
+      stream << "          \"inputAttachments\" : ";
+      writeAttachmentReferences(stream, subPass->definition.inputAttachments);
+      stream << ",\n          \"colorAttachments\" : ";
+      writeAttachmentReferences(stream, subPass->definition.colorAttachments);
+      stream << ",\n          \"resolveAttachments\" : ";
+      writeAttachmentReferences(stream, subPass->definition.resolveAttachments);
+      stream << ",\n          \"depthStencilAttachment\" : ";
+      if (subPass->definition.depthStencilAttachment.attachment == VK_ATTACHMENT_UNUSED)
+        stream << "null";
+      else
+        stream << "{ \"attachment\" : " << subPass->definition.depthStencilAttachment.attachment << ", \"layout\" : " << jsonString(imageLayoutName(subPass->definition.depthStencilAttachment.layout)) << " }";
+      stream << ",\n          \"preserveAttachments\" : [";
+      for (uint32_t p = 0; p < subPass->definition.preserveAttachments.size(); ++p)
+        stream << (p > 0 ? ", " : " ") << subPass->definition.preserveAttachments[p];
+      stream << (subPass->definition.preserveAttachments.empty() ? "]" : " ]") << "\n        }";
+    }
+    stream << (renderPass->subPasses.empty() ? "],\n" : "\n      ],\n");
+    stream << "      \"dependencies\" : [";
+    for (uint32_t d = 0; d < renderPass->dependencies.size(); ++d)
+    {
+      auto& dependency = renderPass->dependencies[d];
+      stream << (d > 0 ? "," : "") << "\n        { ";
+      stream << "\"srcSubpass\" : " << (dependency.srcSubpass == VK_SUBPASS_EXTERNAL ? std::string("\"external\"") : std::to_string(dependency.srcSubpass));
+      stream << ", \"dstSubpass\" : " << (dependency.dstSubpass == VK_SUBPASS_EXTERNAL ? std::string("\"external\"") : std::to_string(dependency.dstSubpass));
+      stream << ", \"srcStageMask\" : " << dependency.srcStageMask << ", \"dstStageMask\" : " << dependency.dstStageMask;
+      stream << ", \"srcAccessMask\" : " << dependency.srcAccessMask << ", \"dstAccessMask\" : " << dependency.dstAccessMask;
+      stream << ", \"dependencyFlags\" : " << dependency.dependencyFlags << " }";
+    }
+    stream << (renderPass->dependencies.empty() ? "]" : "\n      ]") << "\n    }";
+  }
+  stream << (renderPasses.empty() ? "],\n" : "\n  ],\n");
+
+  // resources with images that hold them. Images with the same memory slot share memory
+  stream << "  \"resources\" : [";
+  auto resourceNames = workflow.getResourceNames();
+  std::sort(begin(resourceNames), end(resourceNames));
+  for (uint32_t r = 0; r < resourceNames.size(); ++r)
+  {
+    auto resource = workflow.getResource(resourceNames[r]);
+    stream << (r > 0 ? "," : "") << "\n    { \"name\" : " << jsonString(resource->name) << ", \"type\" : " << jsonString(resource->resourceType->typeName);
+    stream << ", \"associated\" : " << (workflow.getAssociatedMemoryObject(resource->name) != nullptr ? "true" : "false");
+    auto ait = workflowResults->resourceAlias.find(resource->name);
+    if (ait != end(workflowResults->resourceAlias))
+    {
+      auto mit = workflowResults->memoryAlias.find(ait->second);
+      stream << ", \"image\" : " << jsonString(ait->second) << ", \"memorySlot\" : " << (mit != end(workflowResults->memoryAlias) ? static_cast<int>(mit->second) : -1);
+    }
+    stream << " }";
+  }
+  stream << (resourceNames.empty() ? "],\n" : "\n  ],\n");
+
+  stream << "  \"memory\" : { \"surfaceWidth\" : " << surfaceExtent.width << ", \"surfaceHeight\" : " << surfaceExtent.height;
+  stream << ", \"withoutAliasing\" : " << getAttachmentMemorySize(false) << ", \"withAliasing\" : " << getAttachmentMemorySize(true) << " },\n";
+
+  stream << "  \"statistics\" : { \"operations\" : " << getOperationCount() << ", \"renderPasses\" : " << getRenderPassCount();
+  stream << ", \"pipelineBarriers\" : " << getPipelineBarrierCount() << ", \"subpassDependencies\" : " << getSubpassDependencyCount();
+  stream << ", \"submissions\" : " << workflowResults->submissions.size() << ", \"images\" : " << workflowResults->registeredMemoryImages.size();
+  stream << ", \"memoryAliasGroups\" : " << workflowResults->memoryAliasGroups.size() << " }\n";
+  stream << "}\n";
+}
+
+void RenderWorkflowReport::writeDOT(std::ostream& stream) const
+{
+  std::map<std::string, uint32_t> operationQueue;
+
+  stream << "digraph " << dotString(workflow.getName()) << "\n{\n";
+  stream << "  rankdir=LR;\n";
+  stream << "  node [shape=box, style=rounded];\n";
+  // each queue is a cluster. Subpasses of a render pass are grouped in a nested cluster
+  for (uint32_t q = 0; q < workflowResults->commands.size(); ++q)
+  {
+    stream << "  subgraph cluster_queue_" << q << "\n  {\n";
+    stream << "    label=\"queue " << q << "\";\n";
+    int currentRenderPass = -1;
+    for (auto& command : workflowResults->commands[q])
+    {
+      operationQueue[command->operation->name] = q;
+      int renderPassIndex = getRenderPassIndex(command.get());
+      if (renderPassIndex != currentRenderPass)
+      {
+        if (currentRenderPass >= 0)
+          stream << "    }\n";
+        if (renderPassIndex >= 0)
+          stream << "    subgraph cluster_renderpass_" << renderPassIndex << "\n    {\n      label=\"render pass " << renderPassIndex << "\";\n";
+        currentRenderPass = renderPassIndex;
+      }
+      std::ostringstream label;
+      label << command->operation->name;
+      if (command->commandType == RenderCommand::ctRenderSubPass)
+        label << "\\nsubpass " << command->asRenderSubPass()->subpassIndex;
+      else
+        label << "\\ncompute";
+      uint32_t barriersBefore = countBarriers(command->barriersBeforeOp);
+      uint32_t barriersAfter  = countBarriers(command->barriersAfterOp);
+      if (barriersBefore + barriersAfter > 0)
+        label << "\\nbarriers : " << barriersBefore << " before, " << barriersAfter << " after";
+      stream << (renderPassIndex >= 0 ? "      " : "    ") << dotString(command->operation->name) << " [label=" << dotString(label.str());
+      if (command->commandType == RenderCommand::ctComputePass)
+        stream << ", shape=ellipse";
+      stream << "];\n";
+    }
+    if (currentRenderPass >= 0)
+      stream << "    }\n";
+    stream << "  }\n";
+  }
+
+  // edges go from operation generating a resource to each operation consuming it. Edges between queues are dashed
+  auto resourceNames = workflow.getResourceNames();
+  std::sort(begin(resourceNames), end(resourceNames));
+  for (auto& resourceName : resourceNames)
+  {
+    std::string label = resourceName;
+    auto ait = workflowResults->resourceAlias.find(resourceName);
+    if (ait != end(workflowResults->resourceAlias))
+    {
+      if (ait->second != resourceName)
+        label += "\\nimage " + ait->second;
+      auto mit = workflowResults->memoryAlias.find(ait->second);
+      if (mit != end(workflowResults->memoryAlias))
+        label += "\\nmemory slot " + std::to_string(mit->second);
+    }
+    auto generatingTransitions = workflow.getResourceIO(resourceName, rttAllOutputs);
+    auto consumingTransitions  = workflow.getResourceIO(resourceName, rttAllInputs);
+    for (auto& generatingTransition : generatingTransitions)
+    {
+      auto git = operationQueue.find(generatingTransition->operation->name);
+      if (git == end(operationQueue))
+        continue;
+      for (auto& consumingTransition : consumingTransitions)
+      {
+        auto cit = operationQueue.find(consumingTransition->operation->name);
+        if (cit == end(operationQueue))
+          continue;
+        stream << "  " << dotString(generatingTransition->operation->name) << " -> " << dotString(consumingTransition->operation->name) << " [label=" << dotString(label);
+        if (git->second != cit->second)
+          stream << ", style=dashed";
+        stream << "];\n";
+      }
+    }
+  }
+  stream << "}\n";
+}
@@ -0,0 +1,207 @@
+//
+// Copyright(c) 2017-2018 Paweł Księżopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/SkinningPaletteNode.h>
+#include <limits>
+#include <pumex/Asset.h>
+#include <pumex/Descriptor.h>
+#include <pumex/Pipeline.h>
+#include <pumex/DispatchNode.h>
+#include <pumex/UniformBuffer.h>
+#include <pumex/StorageBuffer.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+const uint32_t SkinningPaletteNode::workGroupSize;
+
+namespace
+{
+
+inline glm::vec4 keyValue(const glm::vec3& value) { return glm::vec4(value, 0.0f); }
+inline glm::vec4 keyValue(const glm::quat& value) { return glm::vec4(value.x, value.y, value.z, value.w); }
+
+template<typename T, typename TrackDefinition>
+void appendTrack(const std::vector<TimeLine<T>>& timeLine, float beginTime, float endTime, std::vector<float>& keyTimes, std::vector<glm::vec4>& keyValues, TrackDefinition& track)
+{
+  track.firstKey  = keyTimes.size();
+  track.keyCount  = timeLine.size();
+  track.beginTime = beginTime;
+  track.endTime   = endTime;
+  for (const auto& key : timeLine)
+  {
+    keyTimes.push_back(key.time);
+    keyValues.push_back(keyValue(key.value));
+  }
+}
+
+}
+
+SkinningPaletteNode::SkinningPaletteNode(std::shared_ptr<Viewer> viewer, std::shared_ptr<PipelineCache> pipelineCache, std::shared_ptr<DescriptorPool> descriptorPool, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator, std::shared_ptr<MemoryBuffer> outputBuffer, uint32_t outputStride_, uint32_t outputOffset_)
+  : outputStride{ outputStride_ }, outputOffset{ outputOffset_ }
+{
+  CHECK_LOG_THROW(outputStride <= outputOffset, "SkinningPaletteNode : output stride must be greater than output offset");
+
+  clips            = std::make_shared<std::vector<ClipDefinition>>();
+  bones            = std::make_shared<std::vector<BoneDefinition>>();
+  channels         = std::make_shared<std::vector<ChannelDefinition>>();
+  keyTimes         = std::make_shared<std::vector<float>>();
+  keyValues        = std::make_shared<std::vector<glm::vec4>>();
+  // storage buffers cannot be empty, so there's always at least one instance. Parameters::instanceCount tells how many of them are used
+  instances        = std::make_shared<std::vector<SkinningPaletteInstance>>(1);
+
+  parametersBuffer = std::make_shared<Buffer<Parameters>>(buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pbPerDevice, swForEachImage);
+  clipBuffer       = std::make_shared<Buffer<std::vector<ClipDefinition>>>(clips, buffersAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, pbPerDevice, swOnce);
+  boneBuffer       = std::make_shared<Buffer<std::vector<BoneDefinition>>>(bones, buffersAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, pbPerDevice, swOnce);
+  channelBuffer    = std::make_shared<Buffer<std::vector<ChannelDefinition>>>(channels, buffersAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, pbPerDevice, swOnce);
+  keyTimeBuffer    = std::make_shared<Buffer<std::vector<float>>>(keyTimes, buffersAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, pbPerDevice, swOnce);
+  keyValueBuffer   = std::make_shared<Buffer<std::vector<glm::vec4>>>(keyValues, buffersAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, pbPerDevice, swOnce);
+  instanceBuffer   = std::make_shared<Buffer<std::vector<SkinningPaletteInstance>>>(instances, buffersAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, pbPerDevice, swForEachImage);
+
+  Parameters parameters;
+  parameters.instanceCount = 0;
+  parameters.outputStride  = outputStride;
+  parameters.outputOffset  = outputOffset;
+  parametersBuffer->setData(parameters);
+
+  std::vector<DescriptorSetLayoutBinding> layoutBindings =
+  {
+    { 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 6, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 7, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT }
+  };
+  auto descriptorSetLayout = std::make_shared<DescriptorSetLayout>(layoutBindings);
+  auto pipelineLayout      = std::make_shared<PipelineLayout>();
+  pipelineLayout->descriptorSetLayouts.push_back(descriptorSetLayout);
+  auto pipeline            = std::make_shared<ComputePipeline>(pipelineCache, pipelineLayout);
+  pipeline->shaderStage    = { VK_SHADER_STAGE_COMPUTE_BIT, std::make_shared<ShaderModule>(viewer, "shaders/skinning_palette.comp.spv"), "main" };
+  pipeline->setName("skinningPalettePipeline");
+  addChild(pipeline);
+
+  dispatchNode = std::make_shared<DispatchNode>(0, 1, 1);
+  dispatchNode->setName("skinningPaletteDispatch");
+  pipeline->addChild(dispatchNode);
+
+  auto descriptorSet = std::make_shared<DescriptorSet>(descriptorPool, descriptorSetLayout);
+  descriptorSet->setDescriptor(0, std::make_shared<UniformBuffer>(parametersBuffer));
+  descriptorSet->setDescriptor(1, std::make_shared<StorageBuffer>(clipBuffer));
+  descriptorSet->setDescriptor(2, std::make_shared<StorageBuffer>(boneBuffer));
+  descriptorSet->setDescriptor(3, std::make_shared<StorageBuffer>(channelBuffer));
+  descriptorSet->setDescriptor(4, std::make_shared<StorageBuffer>(keyTimeBuffer));
+  descriptorSet->setDescriptor(5, std::make_shared<StorageBuffer>(keyValueBuffer));
+  descriptorSet->setDescriptor(6, std::make_shared<StorageBuffer>(instanceBuffer));
+  descriptorSet->setDescriptor(7, std::make_shared<StorageBuffer>(outputBuffer));
+  dispatchNode->setDescriptorSet(0, descriptorSet);
+}
+
+void SkinningPaletteNode::validate(const RenderContext& renderContext)
+{
+  CHECK_LOG_THROW(clips->empty(), "SkinningPaletteNode : no clips were added");
+  Group::validate(renderContext);
+}
+
+uint32_t SkinningPaletteNode::addClip(const Skeleton& skeleton, const Animation& animation)
+{
+  return addClip(SkeletonAnimationBinding(skeleton, animation));
+}
+
+uint32_t SkinningPaletteNode::addClip(const SkeletonAnimationBinding& binding)
+{
+  const Skeleton&  skeleton  = binding.getSkeleton();
+  const Animation& animation = binding.getAnimation();
+  CHECK_LOG_THROW(binding.getBoneCount() == 0, "SkinningPaletteNode : skeleton has no bones");
+  CHECK_LOG_THROW(binding.getBoneCount() > outputStride - outputOffset, "SkinningPaletteNode : skeleton has more bones than output stride allows ( " << binding.getBoneCount() << " > " << outputStride - outputOffset << " )");
+
+  uint32_t firstChannel = channels->size();
+  for (uint32_t i = 0; i < animation.channels.size(); ++i)
+  {
+    const Animation::Channel& channel = animation.channels[i];
+    ChannelDefinition channelDefinition;
+    appendTrack(channel.position, channel.positionTimeBegin, channel.positionTimeEnd, *keyTimes, *keyValues, channelDefinition.position);
+    appendTrack(channel.rotation, channel.rotationTimeBegin, channel.rotationTimeEnd, *keyTimes, *keyValues, channelDefinition.rotation);
+    appendTrack(channel.scale,    channel.scaleTimeBegin,    channel.scaleTimeEnd,    *keyTimes, *keyValues, channelDefinition.scale);
+    channelDefinition.before = static_cast<uint32_t>(animation.channelBefore[i]);
+    channelDefinition.after  = static_cast<uint32_t>(animation.channelAfter[i]);
+    channels->push_back(channelDefinition);
+  }
+
+  ClipDefinition clipDefinition;
+  clipDefinition.invGlobalTransform = skeleton.invGlobalTransform;
+  clipDefinition.firstBone          = bones->size();
+  clipDefinition.boneCount          = binding.getBoneCount();
+  for (uint32_t boneIndex = 0; boneIndex < binding.getBoneCount(); ++boneIndex)
+  {
+    uint32_t       channelIndex = binding.getBoneChannel(boneIndex);
+    BoneDefinition boneDefinition;
+    boneDefinition.localTransformation = skeleton.bones[boneIndex].localTransformation;
+    boneDefinition.offsetMatrix        = skeleton.bones[boneIndex].offsetMatrix;
+    boneDefinition.parentIndex         = skeleton.bones[boneIndex].parentIndex;
+    boneDefinition.channel             = (channelIndex == std::numeric_limits<uint32_t>::max()) ? channelIndex : firstChannel + channelIndex;
+    bones->push_back(boneDefinition);
+  }
+  clips->push_back(clipDefinition);
+
+  // storage buffers cannot be empty
+  if (keyTimes->empty())
+  {
+    keyTimes->push_back(0.0f);
+    keyValues->push_back(glm::vec4(0.0f));
+  }
+  if (channels->empty())
+    channels->push_back(ChannelDefinition());
+
+  clipBuffer->invalidateData();
+  boneBuffer->invalidateData();
+  channelBuffer->invalidateData();
+  keyTimeBuffer->invalidateData();
+  keyValueBuffer->invalidateData();
+  return clips->size() - 1;
+}
+
+uint32_t SkinningPaletteNode::getClipCount() const
+{
+  return clips->size();
+}
+
+void SkinningPaletteNode::setInstances(const std::vector<SkinningPaletteInstance>& inst)
+{
+  if (inst.empty())
+    instances->resize(1);
+  else
+    instances->assign(begin(inst), end(inst));
+  instanceBuffer->invalidateData();
+
+  Parameters parameters;
+  parameters.instanceCount = inst.size();
+  parameters.outputStride  = outputStride;
+  parameters.outputOffset  = outputOffset;
+  parametersBuffer->setData(parameters);
+
+  uint32_t groupCount = inst.size() / workGroupSize + ((inst.size() % workGroupSize > 0) ? 1 : 0);
+  if (dispatchNode->getX() != groupCount)
+    dispatchNode->setDispatch(groupCount, 1, 1);
+}
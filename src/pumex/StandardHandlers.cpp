@@ -26,6 +26,8 @@
 #include <glm/gtx/projection.hpp>
 #include <pumex/Viewer.h>
 #include <pumex/Surface.h>
+#include <pumex/Device.h>
+#include <pumex/DeviceMemoryAllocator.h>
 #include <pumex/Descriptor.h>
 #include <pumex/Pipeline.h>
 #include <pumex/TimeStatistics.h>
@@ -45,7 +47,7 @@ TimeStatisticsHandler::TimeStatisticsHandler(std::shared_ptr<Viewer> viewer, std
 {
   showfFPS                   = { false, true, true };
   viewerStatisticsToCollect  = { 0,  TSV_STAT_RENDER, TSV_STAT_UPDATE | TSV_STAT_RENDER | TSV_STAT_RENDER_EVENTS };
-  surfaceStatisticsToCollect = { 0,  0,              TSS_STAT_BASIC | TSS_STAT_BUFFERS | TSS_STAT_EVENTS };
+  surfaceStatisticsToCollect = { 0,  0,              TSS_STAT_BASIC | TSS_STAT_BUFFERS | TSS_STAT_EVENTS | TSS_STAT_ALLOCATORS };
   viewerStatisticsGroups     = { {}, {}, { TSV_GROUP_UPDATE, TSV_GROUP_RENDER, TSV_GROUP_RENDER_EVENTS} };
   surfaceStatisticsGroups    = { {}, {}, { TSS_GROUP_BASIC, TSS_GROUP_EVENTS, TSS_GROUP_SECONDARY_BUFFERS, TSS_GROUP_PRIMARY_BUFFERS, TSS_GROUP_PRIMARY_BUFFERS+1, TSS_GROUP_PRIMARY_BUFFERS+2, TSS_GROUP_PRIMARY_BUFFERS+3 } };
 
@@ -202,6 +204,109 @@ void TimeStatisticsHandler::addChannelData(float minVal, uint32_t vertexSize, fl
   }
 }
 
+void TimeStatisticsHandler::addValueChannelData(float maxVal, uint32_t vertexSize, float h0, float h1, VertexAccumulator& acc, const TimeStatisticsChannel& channel, std::vector<float>& vertices, std::vector<uint32_t>& indices)
+{
+  if (maxVal <= 0.0f)
+    return;
+  std::vector<double> start, value;
+  channel.getLastValues(valueFramesCount, start, value);
+
+  glm::vec4 color = channel.getColor();
+  acc.set(VertexSemantic::Color, color.r, color.g, color.b, color.a);
+
+  // each frame gets a column, the newest frame is on the right side of the window
+  float columnWidth = windowTime / valueFramesCount;
+  for (uint32_t i = 0; i < value.size(); ++i)
+  {
+    uint32_t verticesSoFar = vertices.size() / vertexSize;
+
+    float x0 = i * columnWidth;
+    float x1 = x0 + 0.8f * columnWidth;
+    float hv = h0 + (h1 - h0) * static_cast<float>(value[i]) / maxVal;
+
+    acc.set(VertexSemantic::Position, x0, hv);
+    vertices.insert(end(vertices), cbegin(acc.values), cend(acc.values));
+
+    acc.set(VertexSemantic::Position, x0, h0);
+    vertices.insert(end(vertices), cbegin(acc.values), cend(acc.values));
+
+    acc.set(VertexSemantic::Position, x1, h0);
+    vertices.insert(end(vertices), cbegin(acc.values), cend(acc.values));
+
+    acc.set(VertexSemantic::Position, x1, hv);
+    vertices.insert(end(vertices), cbegin(acc.values), cend(acc.values));
+
+    indices.push_back(verticesSoFar + 0);
+    indices.push_back(verticesSoFar + 1);
+    indices.push_back(verticesSoFar + 2);
+
+    indices.push_back(verticesSoFar + 2);
+    indices.push_back(verticesSoFar + 3);
+    indices.push_back(verticesSoFar + 0);
+  }
+}
+
+void TimeStatisticsHandler::addAllocatorStatistics(std::shared_ptr<DeviceMemoryAllocator> allocator, const std::wstring& name)
+{
+  uint32_t index = static_cast<uint32_t>(allocators.size());
+  allocators.push_back({ allocator, name });
+  surfaceStatisticsGroups[2].push_back(TSS_GROUP_ALLOCATORS + 2 * index + 0);
+  surfaceStatisticsGroups[2].push_back(TSS_GROUP_ALLOCATORS + 2 * index + 1);
+}
+
+void TimeStatisticsHandler::collectAllocatorData(Surface* surface, TimeStatistics* surfaceStatistics, double frameBegin)
+{
+  if (!surfaceStatistics->hasFlags(TSS_STAT_ALLOCATORS))
+    return;
+  VkDevice device                 = surface->device.lock()->device;
+  unsigned long long frameNumber  = surface->viewer.lock()->getFrameNumber();
+  const double MB = 1024.0 * 1024.0;
+  for (uint32_t i = 0; i < allocators.size(); ++i)
+  {
+    uint32_t memoryGroup     = TSS_GROUP_ALLOCATORS + 2 * i + 0;
+    uint32_t allocationGroup = TSS_GROUP_ALLOCATORS + 2 * i + 1;
+    uint32_t channelBase     = TSS_CHANNEL_ALLOCATORS + 10 * i;
+    // channels are registered on first use, because handler gets surface statistics only here
+    if (surfaceStatistics->getGroups().find(memoryGroup) == end(surfaceStatistics->getGroups()))
+    {
+      surfaceStatistics->registerGroup(memoryGroup,     allocators[i].name + L" memory");
+      surfaceStatistics->registerGroup(allocationGroup, allocators[i].name + L" allocations");
+      surfaceStatistics->registerChannel(channelBase + 0, memoryGroup,     L"reserved",              glm::vec4(0.5f, 0.5f, 0.5f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 1, memoryGroup,     L"peak used",             glm::vec4(0.8f, 0.1f, 0.1f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 2, memoryGroup,     L"used",                  glm::vec4(0.8f, 0.8f, 0.1f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 3, memoryGroup,     L"free",                  glm::vec4(0.1f, 0.8f, 0.1f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 4, memoryGroup,     L"largest free block",    glm::vec4(0.1f, 0.1f, 0.8f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 5, allocationGroup, L"allocation count",      glm::vec4(0.8f, 0.8f, 0.1f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 6, allocationGroup, L"free block count",      glm::vec4(0.1f, 0.8f, 0.1f, 0.5f));
+      surfaceStatistics->registerChannel(channelBase + 7, allocationGroup, L"allocations per frame", glm::vec4(0.8f, 0.1f, 0.1f, 0.5f));
+    }
+
+    // many surfaces may share the same device - allocation counter must be closed only once per frame
+    auto lfit = allocators[i].lastFinishedFrame.find(device);
+    if (lfit == end(allocators[i].lastFinishedFrame) || lfit->second != frameNumber)
+    {
+      allocators[i].allocator->finishFrame(device);
+      allocators[i].lastFinishedFrame[device] = frameNumber;
+    }
+    auto stats = allocators[i].allocator->getStatistics(device);
+    surfaceStatistics->setValues(channelBase + 0, frameBegin, static_cast<double>(stats.reservedBytes));
+    surfaceStatistics->setValues(channelBase + 1, frameBegin, static_cast<double>(stats.peakUsedBytes));
+    surfaceStatistics->setValues(channelBase + 2, frameBegin, static_cast<double>(stats.usedBytes));
+    surfaceStatistics->setValues(channelBase + 3, frameBegin, static_cast<double>(stats.freeBytes));
+    surfaceStatistics->setValues(channelBase + 4, frameBegin, static_cast<double>(stats.largestFreeBlock));
+    surfaceStatistics->setValues(channelBase + 5, frameBegin, static_cast<double>(stats.allocationCount));
+    surfaceStatistics->setValues(channelBase + 6, frameBegin, static_cast<double>(stats.freeBlockCount));
+    surfaceStatistics->setValues(channelBase + 7, frameBegin, static_cast<double>(stats.allocationsPerFrame));
+
+    std::wstringstream memoryStream;
+    memoryStream << std::fixed << std::setprecision(1) << L" : " << stats.usedBytes / MB << L" / " << stats.reservedBytes / MB << L" MB in " << stats.blockCount << L" blocks, peak " << stats.peakUsedBytes / MB << L" MB, largest free " << stats.largestFreeBlock / MB << L" MB";
+    allocatorGroupTexts[memoryGroup] = memoryStream.str();
+    std::wstringstream allocationStream;
+    allocationStream << L" : " << stats.allocationCount << L", free blocks " << stats.freeBlockCount << L", per frame " << stats.allocationsPerFrame;
+    allocatorGroupTexts[allocationGroup] = allocationStream.str();
+  }
+}
+
 bool TimeStatisticsHandler::handle(const InputEvent& iEvent, Viewer* viewer)
 {
   bool handled = false;
@@ -262,6 +367,7 @@ void TimeStatisticsHandler::collectData(Surface* surface, TimeStatistics* viewer
   const auto& renderChannel = viewerStatistics->getChannel(TSV_CHANNEL_RENDER);
   renderChannel.getLastValues(framesCount, renderBegin, renderDuration);
   float minTime = renderBegin[0];
+  collectAllocatorData(surface, surfaceStatistics, renderBegin.back());
 
   // We want to have 0.0 time render at 130 pixels and windowTime render at renderWidth pixels
   float renderWidth  = surface->swapChainSize.width;
@@ -303,12 +409,30 @@ void TimeStatisticsHandler::collectData(Surface* surface, TimeStatistics* viewer
   {
     if (std::find(begin(surfaceStatisticsGroups[statisticsCollection]), end(surfaceStatisticsGroups[statisticsCollection]), group.first) == end(surfaceStatisticsGroups[statisticsCollection]))
       continue;
-    textSmall->setText(surface, 200 + group.first, glm::vec2(5, channelHeight -0.2*dHeight), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), group.second);
     auto channelIDs = surfaceStatistics->getGroupChannelIDs(group.first);
-    for (auto channelID : channelIDs)
+    if (group.first >= TSS_GROUP_ALLOCATORS)
     {
-      const auto& channel = surfaceStatistics->getChannel(channelID);
-      addChannelData(minTime, vertexSize, channelHeight, channelHeight - 0.8f*dHeight, acc, channel, vertices, indices);
+      // allocator channels store values instead of durations - they're graphed frame by frame, scaled to the biggest value in a group
+      textSmall->setText(surface, 200 + group.first, glm::vec2(5, channelHeight - 0.2*dHeight), glm::vec4(0.0f, 1.0f, 1.0f, 1.0f), group.second + allocatorGroupTexts[group.first]);
+      double maxValue = 0.0;
+      for (auto channelID : channelIDs)
+      {
+        std::vector<double> start, value;
+        surfaceStatistics->getChannel(channelID).getLastValues(valueFramesCount, start, value);
+        for (auto v : value)
+          maxValue = std::max(maxValue, v);
+      }
+      for (auto channelID : channelIDs)
+        addValueChannelData(static_cast<float>(maxValue), vertexSize, channelHeight, channelHeight - 0.8f*dHeight, acc, surfaceStatistics->getChannel(channelID), vertices, indices);
+    }
+    else
+    {
+      textSmall->setText(surface, 200 + group.first, glm::vec2(5, channelHeight -0.2*dHeight), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), group.second);
+      for (auto channelID : channelIDs)
+      {
+        const auto& channel = surfaceStatistics->getChannel(channelID);
+        addChannelData(minTime, vertexSize, channelHeight, channelHeight - 0.8f*dHeight, acc, channel, vertices, indices);
+      }
     }
     channelHeight += dHeight;
   }
@@ -103,21 +103,18 @@ void Surface::realize()
   VkSemaphoreCreateInfo semaphoreCreateInfo{};
     semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-  // get all queues and create command pools and command buffers for them
+  // get all queues and create command pools for them. Only presentation queue must support presentation
   for (auto& q : workflowResults->queueTraits)
   {
     std::shared_ptr<Queue> queue = deviceSh->getQueue(q, true);
     CHECK_LOG_THROW(queue.get() == nullptr, "Cannot get the queue for this surface");
-    CHECK_LOG_THROW(supportsPresent[queue->familyIndex] == VK_FALSE, "Support not present for(device,surface,familyIndex) : " << queue->familyIndex);
+    CHECK_LOG_THROW(queues.size() == workflowResults->presentationQueueIndex && supportsPresent[queue->familyIndex] == VK_FALSE, "Support not present for(device,surface,familyIndex) : " << queue->familyIndex);
     queues.push_back(queue);
 
     auto commandPool = std::make_shared<CommandPool>(queue->familyIndex);
     commandPool->validate(deviceSh.get());
     commandPools.push_back(commandPool);
 
-    auto commandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_PRIMARY, deviceSh.get(), commandPool, surfaceTraits.imageCount);
-    primaryCommandBuffers.push_back(commandBuffer);
-
     // Create a semaphore used to synchronize command submission
     // Ensures that the image is not presented until all commands have been sumbitted and executed
     VkSemaphore semaphore0;
@@ -131,6 +128,7 @@ void Surface::realize()
   // define basic command buffers required to render a frame
   prepareCommandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_PRIMARY, deviceSh.get(), commandPools[workflowResults->presentationQueueIndex], surfaceTraits.imageCount);
   presentCommandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_PRIMARY, deviceSh.get(), commandPools[workflowResults->presentationQueueIndex], surfaceTraits.imageCount);
+  createPrimarySubmissions();
 
   // create all semaphores required to render a frame
   VK_CHECK_LOG_THROW( vkCreateSemaphore(vkDevice, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore), "Could not create image available semaphore");
@@ -168,6 +166,8 @@ void Surface::cleanup()
     for (auto& fence : waitFences)
       vkDestroyFence(dev, fence, nullptr);
 
+    destroyPrimarySubmissions();
+
     for (auto sem : renderCompleteSemaphores)
       vkDestroySemaphore(dev, sem, nullptr);
     for (auto sem : frameBufferReadySemaphores)
@@ -176,7 +176,6 @@ void Surface::cleanup()
       vkDestroySemaphore(dev, renderFinishedSemaphore, nullptr);
     if (imageAvailableSemaphore != VK_NULL_HANDLE)
       vkDestroySemaphore(dev, imageAvailableSemaphore, nullptr);
-    primaryCommandBuffers.clear();
     presentCommandBuffer = nullptr;
     prepareCommandBuffer = nullptr;
     commandPools.clear();
@@ -277,8 +276,13 @@ bool Surface::checkWorkflow()
       prepareCommandBuffer->invalidate(std::numeric_limits<uint32_t>::max());
     if(presentCommandBuffer.get() != nullptr)
       presentCommandBuffer->invalidate(std::numeric_limits<uint32_t>::max());
-    for (auto& pcb : primaryCommandBuffers)
-      pcb->invalidate(std::numeric_limits<uint32_t>::max());
+    // new workflow results may divide work into different submissions. Semaphores may be still in use, so we have to wait for the device
+    if (!queues.empty())
+    {
+      vkDeviceWaitIdle(deviceSh->device);
+      destroyPrimarySubmissions();
+      createPrimarySubmissions();
+    }
     return true;
   }
   return false;
@@ -326,8 +330,9 @@ void Surface::validateWorkflow()
     frameBuffer->validate(renderContext);
 
   // create/update render passes and compute passes for current surface
-  for (auto& command : workflowResults->commands[workflowResults->presentationQueueIndex])
-    command->validate(renderContext);
+  for (auto& commandSequence : workflowResults->commands)
+    for (auto& command : commandSequence)
+      command->validate(renderContext);
 
   // at the beginning of render we must transform frame buffer images into appropriate image layouts
   prepareCommandBuffer->setActiveIndex(swapChainImageIndex);
@@ -421,8 +426,8 @@ void Surface::validateWorkflow()
 
 void Surface::setCommandBufferIndices()
 {
-  for (uint32_t i = 0; i < primaryCommandBuffers.size(); ++i)
-    primaryCommandBuffers[i]->setActiveIndex(swapChainImageIndex);
+  for (auto& submission : primarySubmissions)
+    submission.commandBuffer->setActiveIndex(swapChainImageIndex);
 
   RenderContext renderContext(this, workflowResults->presentationQueueIndex);
   for (uint32_t i = 0; i < secondaryCommandBufferNodes.size(); ++i)
@@ -452,17 +457,22 @@ void Surface::validatePrimaryDescriptors(uint32_t queueNumber)
 void Surface::buildPrimaryCommandBuffer(uint32_t queueNumber)
 {
   RenderContext renderContext(this, workflowResults->presentationQueueIndex);
-  primaryCommandBuffers[queueNumber]->setActiveIndex(swapChainImageIndex);
-  if (!primaryCommandBuffers[queueNumber]->isValid())
+  for (auto& submission : primarySubmissions)
   {
-    BuildCommandBufferVisitor cbVisitor(renderContext, primaryCommandBuffers[queueNumber].get(), true);
+    if (submission.queueIndex != queueNumber)
+      continue;
+    submission.commandBuffer->setActiveIndex(swapChainImageIndex);
+    if (submission.commandBuffer->isValid())
+      continue;
 
-    primaryCommandBuffers[queueNumber]->cmdBegin();
+    BuildCommandBufferVisitor cbVisitor(renderContext, submission.commandBuffer.get(), true);
 
-    for (auto& command : workflowResults->commands[queueNumber])
-      command->buildCommandBuffer(cbVisitor);
+    submission.commandBuffer->cmdBegin();
 
-    primaryCommandBuffers[queueNumber]->cmdEnd();
+    for (uint32_t i = submission.firstCommand; i < submission.firstCommand + submission.commandCount; ++i)
+      workflowResults->commands[queueNumber][i]->buildCommandBuffer(cbVisitor);
+
+    submission.commandBuffer->cmdEnd();
   }
 }
 
@@ -551,13 +561,14 @@ void Surface::buildSecondaryCommandBuffers()
 
 void Surface::draw()
 {
+  // all host writes to persistently mapped memory made during this frame must be visible to the device
+  device.lock()->flushMappedMemoryRanges();
+
   prepareCommandBuffer->queueSubmit(queues[workflowResults->presentationQueueIndex]->queue, { imageAvailableSemaphore }, { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT }, frameBufferReadySemaphores, VK_NULL_HANDLE );
 
-  for (uint32_t i = 0; i < queues.size(); ++i)
-  {
-    // submit command buffer to each queue with a semaphore signaling ent of work (renderCompleteSemaphores[i])
-    primaryCommandBuffers[i]->queueSubmit(queues[i]->queue, { frameBufferReadySemaphores[i] }, { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT }, { renderCompleteSemaphores[i] }, VK_NULL_HANDLE);
-  }
+  // submit command buffers in workflow order. Last submission on each queue signals end of work (renderCompleteSemaphores[i])
+  for (auto& submission : primarySubmissions)
+    submission.commandBuffer->queueSubmit(queues[submission.queueIndex]->queue, submission.waitSemaphores, submission.waitStages, submission.signalSemaphores, VK_NULL_HANDLE);
 }
 
 void Surface::endFrame()
@@ -581,6 +592,67 @@ void Surface::endFrame()
     VK_CHECK_LOG_THROW(result, "failed vkQueuePresentKHR");
 }
 
+void Surface::createPrimarySubmissions()
+{
+  auto deviceSh     = device.lock();
+  VkDevice vkDevice = deviceSh->device;
+  VkSemaphoreCreateInfo semaphoreCreateInfo{};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  // compilers that do not divide commands into submissions get one submission per queue
+  auto submissions = workflowResults->submissions;
+  if (submissions.empty())
+  {
+    for (uint32_t i = 0; i < queues.size(); ++i)
+    {
+      QueueSubmission submission;
+      submission.queueIndex   = i;
+      submission.commandCount = (i < workflowResults->commands.size()) ? workflowResults->commands[i].size() : 0;
+      submissions.push_back(submission);
+    }
+  }
+
+  primarySubmissions.resize(submissions.size());
+  for (uint32_t i = 0; i < submissions.size(); ++i)
+  {
+    uint32_t queueIndex                 = submissions[i].queueIndex;
+    primarySubmissions[i].queueIndex    = queueIndex;
+    primarySubmissions[i].firstCommand  = submissions[i].firstCommand;
+    primarySubmissions[i].commandCount  = submissions[i].commandCount;
+    primarySubmissions[i].commandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_PRIMARY, deviceSh.get(), commandPools[queueIndex], surfaceTraits.imageCount);
+
+    auto sameQueue = [queueIndex](const QueueSubmission& s) { return s.queueIndex == queueIndex; };
+    // first submission on a queue waits for frame buffers, last submission on a queue signals that the queue finished its work
+    if (std::none_of(begin(submissions), begin(submissions) + i, sameQueue))
+    {
+      primarySubmissions[i].waitSemaphores.push_back(frameBufferReadySemaphores[queueIndex]);
+      primarySubmissions[i].waitStages.push_back(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+    if (std::none_of(begin(submissions) + i + 1, end(submissions), sameQueue))
+      primarySubmissions[i].signalSemaphores.push_back(renderCompleteSemaphores[queueIndex]);
+
+    // each dependency between submissions gets its own semaphore
+    for (uint32_t j = 0; j < submissions[i].waitSubmissions.size(); ++j)
+    {
+      VkSemaphore semaphore;
+      VK_CHECK_LOG_THROW(vkCreateSemaphore(vkDevice, &semaphoreCreateInfo, nullptr, &semaphore), "Could not create submission semaphore");
+      submissionSemaphores.push_back(semaphore);
+      primarySubmissions[i].waitSemaphores.push_back(semaphore);
+      primarySubmissions[i].waitStages.push_back(submissions[i].waitStages[j]);
+      primarySubmissions[submissions[i].waitSubmissions[j]].signalSemaphores.push_back(semaphore);
+    }
+  }
+}
+
+void Surface::destroyPrimarySubmissions()
+{
+  VkDevice vkDevice = device.lock()->device;
+  for (auto sem : submissionSemaphores)
+    vkDestroySemaphore(vkDevice, sem, nullptr);
+  submissionSemaphores.clear();
+  primarySubmissions.clear();
+}
+
 void Surface::resizeSurface(uint32_t newWidth, uint32_t newHeight)
 {
   if (!isRealized())
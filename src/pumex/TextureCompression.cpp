@@ -0,0 +1,474 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/TextureCompression.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <limits>
+#include <tbb/tbb.h>
+#include <pumex/AssetCache.h>
+#include <pumex/Viewer.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+namespace
+{
+
+// increase it when encoder output changes, so that old cache files are not used anymore
+const uint32_t textureCacheVersion = 2;
+
+struct Color565
+{
+  uint16_t value;
+  int      r, g, b;
+};
+
+Color565 makeColor565(int r, int g, int b)
+{
+  Color565 result;
+  result.value = static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+  // colors expanded back to 8 bits - the same way GPU does it
+  int r5 = (result.value >> 11) & 31, g6 = (result.value >> 5) & 63, b5 = result.value & 31;
+  result.r = (r5 << 3) | (r5 >> 2);
+  result.g = (g6 << 2) | (g6 >> 4);
+  result.b = (b5 << 3) | (b5 >> 2);
+  return result;
+}
+
+void writeUint16(uint8_t* target, uint16_t value)
+{
+  target[0] = static_cast<uint8_t>(value & 0xFF);
+  target[1] = static_cast<uint8_t>(value >> 8);
+}
+
+// BC1 color block : two 565 endpoints ( c0 > c1, so that 4 color mode is used ) and 2 bit indices. Endpoints are corners of a color bounding box inset by 1/16 of its size
+void encodeColorBlock(const uint8_t* pixels, uint8_t* target)
+{
+  int minColor[3] = { 255, 255, 255 };
+  int maxColor[3] = { 0, 0, 0 };
+  for (uint32_t i = 0; i < 16; ++i)
+  {
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+      minColor[c] = std::min<int>(minColor[c], pixels[4 * i + c]);
+      maxColor[c] = std::max<int>(maxColor[c], pixels[4 * i + c]);
+    }
+  }
+  for (uint32_t c = 0; c < 3; ++c)
+  {
+    int inset   = (maxColor[c] - minColor[c]) / 16;
+    minColor[c] = std::min(255, minColor[c] + inset);
+    maxColor[c] = std::max(0, maxColor[c] - inset);
+  }
+  Color565 c0 = makeColor565(maxColor[0], maxColor[1], maxColor[2]);
+  Color565 c1 = makeColor565(minColor[0], minColor[1], minColor[2]);
+  if (c0.value < c1.value)
+    std::swap(c0, c1);
+
+  uint32_t indices = 0;
+  if (c0.value != c1.value)
+  {
+    int palette[4][3] =
+    {
+      { c0.r, c0.g, c0.b },
+      { c1.r, c1.g, c1.b },
+      { (2 * c0.r + c1.r) / 3, (2 * c0.g + c1.g) / 3, (2 * c0.b + c1.b) / 3 },
+      { (c0.r + 2 * c1.r) / 3, (c0.g + 2 * c1.g) / 3, (c0.b + 2 * c1.b) / 3 }
+    };
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      uint32_t bestIndex    = 0;
+      int      bestDistance = std::numeric_limits<int>::max();
+      for (uint32_t j = 0; j < 4; ++j)
+      {
+        int dr = palette[j][0] - pixels[4 * i + 0], dg = palette[j][1] - pixels[4 * i + 1], db = palette[j][2] - pixels[4 * i + 2];
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance)
+        {
+          bestDistance = distance;
+          bestIndex    = j;
+        }
+      }
+      indices |= bestIndex << (2 * i);
+    }
+  }
+  writeUint16(target, c0.value);
+  writeUint16(target + 2, c1.value);
+  for (uint32_t i = 0; i < 4; ++i)
+    target[4 + i] = static_cast<uint8_t>((indices >> (8 * i)) & 0xFF);
+}
+
+// BC3 alpha block : two endpoints ( a0 > a1, so that 8 interpolated values are used ) and 3 bit indices
+void encodeAlphaBlock(const uint8_t* pixels, uint8_t* target)
+{
+  int minAlpha = 255, maxAlpha = 0;
+  for (uint32_t i = 0; i < 16; ++i)
+  {
+    minAlpha = std::min<int>(minAlpha, pixels[4 * i + 3]);
+    maxAlpha = std::max<int>(maxAlpha, pixels[4 * i + 3]);
+  }
+  target[0] = static_cast<uint8_t>(maxAlpha);
+  target[1] = static_cast<uint8_t>(minAlpha);
+
+  uint64_t indices = 0;
+  if (maxAlpha != minAlpha)
+  {
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+      // position on a ramp from a0 ( 0 ) to a1 ( 7 ). Ramp ends are stored under indices 0 and 1, interpolated values under indices 2..7
+      int position = ((maxAlpha - pixels[4 * i + 3]) * 7 + (maxAlpha - minAlpha) / 2) / (maxAlpha - minAlpha);
+      uint64_t index = (position == 0) ? 0 : (position == 7) ? 1 : position + 1;
+      indices |= index << (3 * i);
+    }
+  }
+  for (uint32_t i = 0; i < 6; ++i)
+    target[2 + i] = static_cast<uint8_t>((indices >> (8 * i)) & 0xFF);
+}
+
+// BC7 mode 6 block : one subset, RGBA endpoints with 7 bits per channel and unique p-bit per endpoint, 4 bit indices
+const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+class BlockBitWriter
+{
+public:
+  explicit BlockBitWriter(uint8_t* t)
+    : target{ t }, position{ 0 }
+  {
+    std::memset(target, 0, 16);
+  }
+  void write(uint32_t value, uint32_t bitCount)
+  {
+    for (uint32_t i = 0; i < bitCount; ++i, ++position)
+      target[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+  }
+protected:
+  uint8_t* target;
+  uint32_t position;
+};
+
+// endpoint is quantized to 7 bits per channel, p-bit that gives smaller error is chosen
+void quantizeEndpointBC7(const int* endpoint, int* quantized, int& pBit)
+{
+  int bestError = std::numeric_limits<int>::max();
+  for (int p = 0; p < 2; ++p)
+  {
+    int error = 0;
+    int values[4];
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+      values[c] = std::min(127, std::max(0, (endpoint[c] - p + 1) / 2));
+      int reconstructed = (values[c] << 1) | p;
+      error += (reconstructed - endpoint[c]) * (reconstructed - endpoint[c]);
+    }
+    if (error < bestError)
+    {
+      bestError = error;
+      pBit      = p;
+      std::copy(values, values + 4, quantized);
+    }
+  }
+}
+
+void encodeBlockBC7(const uint8_t* pixels, uint8_t* target)
+{
+  int minColor[4] = { 255, 255, 255, 255 };
+  int maxColor[4] = { 0, 0, 0, 0 };
+  int mean[4]     = { 0, 0, 0, 0 };
+  for (uint32_t i = 0; i < 16; ++i)
+  {
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+      minColor[c] = std::min<int>(minColor[c], pixels[4 * i + c]);
+      maxColor[c] = std::max<int>(maxColor[c], pixels[4 * i + c]);
+      mean[c]    += pixels[4 * i + c];
+    }
+  }
+  // bounding box diagonal is chosen using the sign of covariance between each channel and the channel with the largest range
+  uint32_t mainChannel = 0;
+  for (uint32_t c = 1; c < 4; ++c)
+    if (maxColor[c] - minColor[c] > maxColor[mainChannel] - minColor[mainChannel])
+      mainChannel = c;
+  int endpoints[2][4];
+  for (uint32_t c = 0; c < 4; ++c)
+  {
+    int covariance = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+      covariance += (16 * pixels[4 * i + c] - mean[c]) * (16 * pixels[4 * i + mainChannel] - mean[mainChannel]) / 256;
+    int inset = (maxColor[c] - minColor[c]) / 32;
+    endpoints[0][c] = (covariance < 0) ? maxColor[c] - inset : minColor[c] + inset;
+    endpoints[1][c] = (covariance < 0) ? minColor[c] + inset : maxColor[c] - inset;
+  }
+
+  int quantized[2][4], pBits[2], palette[2][4];
+  for (uint32_t e = 0; e < 2; ++e)
+  {
+    quantizeEndpointBC7(endpoints[e], quantized[e], pBits[e]);
+    for (uint32_t c = 0; c < 4; ++c)
+      palette[e][c] = (quantized[e][c] << 1) | pBits[e];
+  }
+
+  uint32_t indices[16];
+  for (uint32_t i = 0; i < 16; ++i)
+  {
+    int bestError = std::numeric_limits<int>::max();
+    for (uint32_t j = 0; j < 16; ++j)
+    {
+      int error = 0;
+      for (uint32_t c = 0; c < 4; ++c)
+      {
+        int value = (palette[0][c] * (64 - bc7Weights[j]) + palette[1][c] * bc7Weights[j] + 32) >> 6;
+        error += (value - pixels[4 * i + c]) * (value - pixels[4 * i + c]);
+      }
+      if (error < bestError)
+      {
+        bestError  = error;
+        indices[i] = j;
+      }
+    }
+  }
+  // highest bit of the first index is not stored - it must be zero, so endpoints are swapped when necessary
+  if (indices[0] >= 8)
+  {
+    for (uint32_t c = 0; c < 4; ++c)
+      std::swap(quantized[0][c], quantized[1][c]);
+    std::swap(pBits[0], pBits[1]);
+    for (uint32_t i = 0; i < 16; ++i)
+      indices[i] = 15 - indices[i];
+  }
+
+  BlockBitWriter writer(target);
+  writer.write(1 << 6, 7); // mode 6
+  for (uint32_t c = 0; c < 4; ++c)
+  {
+    writer.write(quantized[0][c], 7);
+    writer.write(quantized[1][c], 7);
+  }
+  writer.write(pBits[0], 1);
+  writer.write(pBits[1], 1);
+  writer.write(indices[0], 3);
+  for (uint32_t i = 1; i < 16; ++i)
+    writer.write(indices[i], 4);
+}
+
+// converts all levels of a texture to RGBA8. Missing mip levels are created using a box filter
+std::shared_ptr<gli::texture> prepareRGBATexture(const gli::texture& texture, bool srgb, uint32_t channels, bool generateMipmaps)
+{
+  auto extent     = texture.extent(0);
+  size_t levels   = texture.levels();
+  if (generateMipmaps && levels == 1)
+    levels = static_cast<size_t>(getMipLevelCount({ uint32_t(extent.x), uint32_t(extent.y), 1 }));
+  auto result = std::make_shared<gli::texture>(texture.target(), srgb ? gli::FORMAT_RGBA8_SRGB_PACK8 : gli::FORMAT_RGBA8_UNORM_PACK8, extent, texture.layers(), texture.faces(), levels);
+
+  for (size_t layer = 0; layer < result->layers(); ++layer)
+  {
+    for (size_t face = 0; face < result->faces(); ++face)
+    {
+      for (size_t level = 0; level < result->levels(); ++level)
+      {
+        auto     levelExtent = result->extent(level);
+        uint8_t* target      = static_cast<uint8_t*>(result->data(layer, face, level));
+        if (level < texture.levels())
+        {
+          const uint8_t* source = static_cast<const uint8_t*>(texture.data(layer, face, level));
+          size_t pixelCount     = size_t(levelExtent.x) * size_t(levelExtent.y);
+          for (size_t i = 0; i < pixelCount; ++i)
+          {
+            std::memcpy(target + 4 * i, source + channels * i, channels);
+            if (channels == 3)
+              target[4 * i + 3] = 255;
+          }
+          continue;
+        }
+        auto           sourceExtent = result->extent(level - 1);
+        const uint8_t* source       = static_cast<const uint8_t*>(result->data(layer, face, level - 1));
+        for (int y = 0; y < levelExtent.y; ++y)
+        {
+          int y0 = std::min(2 * y, sourceExtent.y - 1), y1 = std::min(2 * y + 1, sourceExtent.y - 1);
+          for (int x = 0; x < levelExtent.x; ++x)
+          {
+            int x0 = std::min(2 * x, sourceExtent.x - 1), x1 = std::min(2 * x + 1, sourceExtent.x - 1);
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+              uint32_t sum = source[4 * (y0 * sourceExtent.x + x0) + c] + source[4 * (y0 * sourceExtent.x + x1) + c] + source[4 * (y1 * sourceExtent.x + x0) + c] + source[4 * (y1 * sourceExtent.x + x1) + c];
+              target[4 * (y * levelExtent.x + x) + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+}
+
+namespace pumex
+{
+
+std::shared_ptr<gli::texture> compressTexture(std::shared_ptr<gli::texture> texture, TextureCompressionFormat compressionFormat, bool generateMipmaps)
+{
+  CHECK_LOG_THROW(texture.get() == nullptr, "compressTexture() : texture not defined");
+  uint32_t channels;
+  bool     srgb;
+  switch (texture->format())
+  {
+  case gli::FORMAT_RGBA8_UNORM_PACK8: channels = 4; srgb = false; break;
+  case gli::FORMAT_RGBA8_SRGB_PACK8:  channels = 4; srgb = true;  break;
+  case gli::FORMAT_RGB8_UNORM_PACK8:  channels = 3; srgb = false; break;
+  case gli::FORMAT_RGB8_SRGB_PACK8:   channels = 3; srgb = true;  break;
+  default:
+    return texture;
+  }
+  // 3D textures are not compressed
+  if (texture->empty() || texture->extent(0).z > 1)
+    return texture;
+
+  auto rgbaTexture = prepareRGBATexture(*texture, srgb, channels, generateMipmaps);
+
+  if (compressionFormat == tcAuto)
+  {
+    bool opaque = true;
+    if (channels == 4)
+    {
+      const uint8_t* pixels = static_cast<const uint8_t*>(rgbaTexture->data());
+      for (size_t i = 3; i < rgbaTexture->size() && opaque; i += 4)
+        opaque = (pixels[i] == 255);
+    }
+    compressionFormat = opaque ? tcBC1 : tcBC3;
+  }
+  gli::format format;
+  switch (compressionFormat)
+  {
+  case tcBC1: format = srgb ? gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8  : gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8;  break;
+  case tcBC3: format = srgb ? gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16 : gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16; break;
+  default:    format = srgb ? gli::FORMAT_RGBA_BP_SRGB_BLOCK16   : gli::FORMAT_RGBA_BP_UNORM_BLOCK16;   break;
+  }
+  uint32_t blockSize = (compressionFormat == tcBC1) ? 8 : 16;
+
+  auto result = std::make_shared<gli::texture>(rgbaTexture->target(), format, rgbaTexture->extent(0), rgbaTexture->layers(), rgbaTexture->faces(), rgbaTexture->levels(), texture->swizzles());
+  for (size_t layer = 0; layer < result->layers(); ++layer)
+  {
+    for (size_t face = 0; face < result->faces(); ++face)
+    {
+      for (size_t level = 0; level < result->levels(); ++level)
+      {
+        auto           extent  = rgbaTexture->extent(level);
+        const uint8_t* source  = static_cast<const uint8_t*>(rgbaTexture->data(layer, face, level));
+        uint8_t*       target  = static_cast<uint8_t*>(result->data(layer, face, level));
+        int            blocksX = (extent.x + 3) / 4;
+        int            blocksY = (extent.y + 3) / 4;
+        tbb::parallel_for(tbb::blocked_range<int>(0, blocksY), [&](const tbb::blocked_range<int>& r)
+        {
+          uint8_t pixels[64];
+          for (int by = r.begin(); by != r.end(); ++by)
+          {
+            for (int bx = 0; bx < blocksX; ++bx)
+            {
+              // pixels outside of the texture are clamped to its edge
+              for (int py = 0; py < 4; ++py)
+              {
+                int y = std::min(4 * by + py, extent.y - 1);
+                for (int px = 0; px < 4; ++px)
+                {
+                  int x = std::min(4 * bx + px, extent.x - 1);
+                  std::memcpy(pixels + 4 * (4 * py + px), source + 4 * (y * extent.x + x), 4);
+                }
+              }
+              uint8_t* block = target + blockSize * (by * blocksX + bx);
+              switch (compressionFormat)
+              {
+              case tcBC1:
+                encodeColorBlock(pixels, block);
+                break;
+              case tcBC3:
+                encodeAlphaBlock(pixels, block);
+                encodeColorBlock(pixels, block + 8);
+                break;
+              default:
+                encodeBlockBC7(pixels, block);
+                break;
+              }
+            }
+          }
+        });
+      }
+    }
+  }
+  return result;
+}
+
+}
+
+TextureLoaderCompressed::TextureLoaderCompressed(std::shared_ptr<TextureLoader> l, const std::string& cd, TextureCompressionFormat f, bool gm)
+  : loader{ l }, cacheDirectory{ cd }, format{ f }, generateMipmaps{ gm }
+{
+  CHECK_LOG_THROW(loader.get() == nullptr, "TextureLoaderCompressed : loader not defined");
+  if (cacheDirectory.empty())
+    cacheDirectory = (filesystem::temp_directory_path() / filesystem::path("pumex_cache")).string();
+}
+
+std::shared_ptr<gli::texture> TextureLoaderCompressed::load(const std::string& fileName)
+{
+  filesystem::path sourcePath(fileName);
+  if (!filesystem::exists(sourcePath))
+    return loader->load(fileName);
+
+  // everything that affects the compressed texture
+  std::ostringstream sourceKey;
+  sourceKey << textureCacheVersion << "|" << fileName << "|" << filesystem::last_write_time(sourcePath).time_since_epoch().count() << "|" << filesystem::file_size(sourcePath) << "|" << format << "|" << generateMipmaps;
+
+  std::ostringstream cacheFileName;
+  cacheFileName << sourcePath.stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0') << static_cast<uint64_t>(std::hash<std::string>()(sourceKey.str())) << ".pumexasset";
+  filesystem::path cachePath = filesystem::path(cacheDirectory) / filesystem::path(cacheFileName.str());
+
+  try
+  {
+    auto texture = loadTextureFile(cachePath.string(), sourceKey.str());
+    if (texture.get() != nullptr)
+      return texture;
+  }
+  catch (const std::exception& e)
+  {
+    LOG_WARNING << "Cannot read cached texture " << cachePath.string() << " : " << e.what() << std::endl;
+  }
+
+  auto texture = loader->load(fileName);
+  if (texture.get() == nullptr || texture->empty())
+    return texture;
+  auto compressed = compressTexture(texture, format, generateMipmaps);
+  if (compressed == texture)
+    return texture;
+  try
+  {
+    filesystem::create_directories(filesystem::path(cacheDirectory));
+    saveTextureFile(*compressed, cachePath.string(), sourceKey.str());
+  }
+  catch (const std::exception& e)
+  {
+    LOG_WARNING << "Cannot write cached texture " << cachePath.string() << " : " << e.what() << std::endl;
+  }
+  return compressed;
+}
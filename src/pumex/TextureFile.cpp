@@ -0,0 +1,297 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/TextureFile.h>
+#include <algorithm>
+#include <cstring>
+#include <gli/load.hpp>
+#include <gli/gl.hpp>
+#include <gli/dx.hpp>
+#include <pumex/utils/MappedFile.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+namespace
+{
+
+const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const uint32_t      ktxEndianness     = 0x04030201;
+
+struct KTXHeader
+{
+  uint32_t endianness;
+  uint32_t glType;
+  uint32_t glTypeSize;
+  uint32_t glFormat;
+  uint32_t glInternalFormat;
+  uint32_t glBaseInternalFormat;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t numberOfArrayElements;
+  uint32_t numberOfFaces;
+  uint32_t numberOfMipmapLevels;
+  uint32_t bytesOfKeyValueData;
+};
+
+const uint32_t ddsMagic                   = 0x20534444; // "DDS "
+const uint32_t ddsFlagMipMapCount         = 0x20000;
+const uint32_t ddsFlagDepth               = 0x800000;
+const uint32_t ddsPixelFormatFourCC       = 0x4;
+const uint32_t ddsCaps2Cubemap            = 0x200;
+const uint32_t ddsCaps2Volume             = 0x200000;
+const uint32_t ddsResourceMiscTextureCube = 0x4;
+const uint32_t ddsResourceDimension1D     = 2;
+const uint32_t ddsResourceDimension3D     = 4;
+
+struct DDSPixelFormat
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t bitMask[4];
+};
+
+struct DDSHeader
+{
+  uint32_t       size;
+  uint32_t       flags;
+  uint32_t       height;
+  uint32_t       width;
+  uint32_t       pitchOrLinearSize;
+  uint32_t       depth;
+  uint32_t       mipMapCount;
+  uint32_t       reserved1[11];
+  DDSPixelFormat pixelFormat;
+  uint32_t       caps;
+  uint32_t       caps2;
+  uint32_t       caps3;
+  uint32_t       caps4;
+  uint32_t       reserved2;
+};
+
+struct DDSHeader10
+{
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+template<typename T>
+bool readStruct(const MappedFile& file, size_t offset, T& value)
+{
+  if (offset > file.size() || sizeof(T) > file.size() - offset)
+    return false;
+  std::memcpy(&value, file.data() + offset, sizeof(T));
+  return true;
+}
+
+}
+
+TextureFile::TextureFile(const std::string& fn)
+  : fileName{ fn }, file{ new MappedFile(fn) }
+{
+  if (file->data() == nullptr)
+    return;
+  if (!parseKTX())
+    parseDDS();
+}
+
+TextureFile::~TextureFile()
+{
+}
+
+gli::extent3d TextureFile::getExtent(size_t level) const
+{
+  return gli::extent3d(std::max(1, extent.x >> level), std::max(1, extent.y >> level), std::max(1, extent.z >> level));
+}
+
+const char* TextureFile::data(size_t layer, size_t face, size_t level) const
+{
+  CHECK_LOG_THROW(!direct, "Texture file cannot be read directly : " << fileName);
+  CHECK_LOG_THROW(layer >= layers || face >= faces || level >= levels, "Texture file data out of bounds : " << fileName);
+  return file->data() + offsets[(layer * faces + face) * levels + level];
+}
+
+size_t TextureFile::size(size_t level) const
+{
+  auto levelExtent = getExtent(level);
+  auto blockExtent = gli::block_extent(format);
+  size_t blockCount = static_cast<size_t>((levelExtent.x + blockExtent.x - 1) / blockExtent.x) * static_cast<size_t>((levelExtent.y + blockExtent.y - 1) / blockExtent.y) * static_cast<size_t>((levelExtent.z + blockExtent.z - 1) / blockExtent.z);
+  return blockCount * gli::block_size(format);
+}
+
+size_t TextureFile::size() const
+{
+  size_t result = 0;
+  for (size_t level = 0; level < levels; ++level)
+    result += size(level);
+  return result * layers * faces;
+}
+
+std::shared_ptr<gli::texture> TextureFile::createTexture() const
+{
+  if (file->data() == nullptr)
+    return std::make_shared<gli::texture>();
+  return std::make_shared<gli::texture>(gli::load(file->data(), file->size()));
+}
+
+// returns false when file is not a KTX file. Otherwise direct flag informs whether texture may be copied from the mapping as it is
+bool TextureFile::parseKTX()
+{
+  KTXHeader header;
+  if (file->size() < sizeof(ktxIdentifier) || std::memcmp(file->data(), ktxIdentifier, sizeof(ktxIdentifier)) != 0 || !readStruct(*file, sizeof(ktxIdentifier), header))
+    return false;
+  if (header.endianness != ktxEndianness)
+    return true;
+
+  gli::gl GL(gli::gl::PROFILE_KTX);
+  format = GL.find(static_cast<gli::gl::internal_format>(header.glInternalFormat), static_cast<gli::gl::external_format>(header.glFormat), static_cast<gli::gl::type_format>(header.glType));
+  extent = gli::extent3d(std::max(1u, header.pixelWidth), std::max(1u, header.pixelHeight), std::max(1u, header.pixelDepth));
+  layers = std::max(1u, header.numberOfArrayElements);
+  faces  = std::max(1u, header.numberOfFaces);
+  levels = std::max(1u, header.numberOfMipmapLevels);
+  setTarget(header.numberOfArrayElements > 0, (header.pixelDepth > 0) ? 3 : ((header.pixelHeight > 0) ? 2 : 1));
+  if (format == gli::FORMAT_UNDEFINED)
+    return true;
+
+  // rows of uncompressed textures are aligned to 4 bytes in KTX files. Such rows cannot be copied to Vulkan image without conversion
+  for (size_t level = 0; level < levels; ++level)
+  {
+    auto blockExtent = gli::block_extent(format);
+    if ((static_cast<size_t>((getExtent(level).x + blockExtent.x - 1) / blockExtent.x) * gli::block_size(format)) % 4 != 0)
+      return true;
+  }
+
+  // mip levels are stored one after another. Each level contains all layers and faces ( cube padding and mip padding are zero, because all sizes are multiples of 4 )
+  offsets.resize(layers * faces * levels);
+  size_t position     = sizeof(ktxIdentifier) + sizeof(KTXHeader) + header.bytesOfKeyValueData;
+  bool   nonArrayCube = (header.numberOfArrayElements == 0 && faces == 6);
+  for (size_t level = 0; level < levels; ++level)
+  {
+    uint32_t imageSize;
+    if (!readStruct(*file, position, imageSize))
+      return true;
+    position += sizeof(uint32_t);
+    size_t levelSize = size(level);
+    // non array cubemaps store the size of a single face
+    if (imageSize != (nonArrayCube ? levelSize : levelSize * layers * faces))
+      return true;
+    for (size_t layer = 0; layer < layers; ++layer)
+    {
+      for (size_t face = 0; face < faces; ++face)
+      {
+        offsets[(layer * faces + face) * levels + level] = position;
+        position += levelSize;
+      }
+    }
+  }
+  direct = (position <= file->size());
+  return true;
+}
+
+// returns false when file is not a DDS file. Otherwise direct flag informs whether texture may be copied from the mapping as it is
+bool TextureFile::parseDDS()
+{
+  uint32_t  magic;
+  DDSHeader header;
+  if (!readStruct(*file, 0, magic) || magic != ddsMagic || !readStruct(*file, sizeof(uint32_t), header))
+    return false;
+  size_t position = sizeof(uint32_t) + sizeof(DDSHeader);
+
+  bool volume = (header.flags & ddsFlagDepth) && (header.caps2 & ddsCaps2Volume);
+  extent = gli::extent3d(std::max(1u, header.width), std::max(1u, header.height), volume ? std::max(1u, header.depth) : 1u);
+  levels = (header.flags & ddsFlagMipMapCount) ? std::max(1u, header.mipMapCount) : 1;
+  faces  = (header.caps2 & ddsCaps2Cubemap) ? 6 : 1;
+
+  gli::dx  DX;
+  bool     isArray    = false;
+  uint32_t dimensions = volume ? 3 : 2;
+  if ((header.pixelFormat.flags & ddsPixelFormatFourCC) && header.pixelFormat.fourCC == static_cast<uint32_t>(gli::dx::D3DFMT_DX10))
+  {
+    DDSHeader10 header10;
+    if (!readStruct(*file, position, header10))
+      return true;
+    position += sizeof(DDSHeader10);
+    format  = DX.find(gli::dx::D3DFMT_DX10, gli::dx::dxgiFormat(static_cast<gli::dx::dxgi_format_dds>(header10.dxgiFormat)));
+    layers  = std::max(1u, header10.arraySize);
+    isArray = (header10.arraySize > 1);
+    if (header10.miscFlag & ddsResourceMiscTextureCube)
+      faces = 6;
+    if (header10.resourceDimension == ddsResourceDimension1D)
+      dimensions = 1;
+    else if (header10.resourceDimension == ddsResourceDimension3D)
+      dimensions = 3;
+  }
+  // pixel formats described by masks need swizzling, so gli must load them
+  else if ((header.pixelFormat.flags & ddsPixelFormatFourCC) && header.pixelFormat.fourCC != static_cast<uint32_t>(gli::dx::D3DFMT_GLI1))
+    format = DX.find(static_cast<gli::dx::d3dfmt>(header.pixelFormat.fourCC));
+  setTarget(isArray, dimensions);
+  if (format == gli::FORMAT_UNDEFINED)
+    return true;
+
+  // each layer and face stores all its mip levels
+  offsets.resize(layers * faces * levels);
+  for (size_t layer = 0; layer < layers; ++layer)
+  {
+    for (size_t face = 0; face < faces; ++face)
+    {
+      for (size_t level = 0; level < levels; ++level)
+      {
+        offsets[(layer * faces + face) * levels + level] = position;
+        position += size(level);
+      }
+    }
+  }
+  direct = (position <= file->size());
+  return true;
+}
+
+void TextureFile::setTarget(bool isArray, uint32_t dimensions)
+{
+  if (faces == 6)
+    target = isArray ? gli::TARGET_CUBE_ARRAY : gli::TARGET_CUBE;
+  else if (dimensions == 1)
+    target = isArray ? gli::TARGET_1D_ARRAY : gli::TARGET_1D;
+  else if (dimensions == 3)
+    target = gli::TARGET_3D;
+  else
+    target = isArray ? gli::TARGET_2D_ARRAY : gli::TARGET_2D;
+}
+
+namespace pumex
+{
+
+ImageTraits getImageTraitsFromTextureFile(const TextureFile& textureFile, VkImageUsageFlags usage)
+{
+  auto t = textureFile.getExtent();
+  // cube faces are stored as separate array layers
+  VkImageCreateFlags flags = (textureFile.getFaces() == 6) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+  return ImageTraits(usage, vulkanFormatFromGliFormat(textureFile.getFormat()), { uint32_t(t.x), uint32_t(t.y), uint32_t(t.z) },
+    static_cast<uint32_t>(textureFile.getLevels()), static_cast<uint32_t>(textureFile.getLayers() * textureFile.getFaces()), VK_SAMPLE_COUNT_1_BIT, false, VK_IMAGE_LAYOUT_UNDEFINED, flags, vulkanImageTypeFromTextureExtents(t), VK_SHARING_MODE_EXCLUSIVE);
+}
+
+}
@@ -22,10 +22,15 @@
 
 #include <pumex/TextureLoaderGli.h>
 #include <gli/load.hpp>
+#include <pumex/utils/MappedFile.h>
 
 using namespace pumex;
 
 std::shared_ptr<gli::texture> TextureLoaderGli::load(const std::string& fileName)
 {
-  return std::make_shared<gli::texture>( gli::load(fileName) );
+  // gli::load(fileName) reads whole file to memory before it creates a texture. Mapped file is read directly into texture storage instead
+  MappedFile file(fileName);
+  if (file.data() == nullptr)
+    return std::make_shared<gli::texture>();
+  return std::make_shared<gli::texture>( gli::load(file.data(), file.size()) );
 }
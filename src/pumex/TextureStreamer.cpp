@@ -0,0 +1,208 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#include <pumex/TextureStreamer.h>
+#include <algorithm>
+#include <pumex/MemoryImage.h>
+#include <pumex/TextureFile.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+namespace
+{
+
+// streamed image may get its data from gli::texture or from memory mapped texture file
+uint32_t getLevelCount(const MemoryImage& memoryImage)
+{
+  auto texture = memoryImage.getTexture();
+  return (texture != nullptr) ? static_cast<uint32_t>(texture->levels()) : static_cast<uint32_t>(memoryImage.getTextureFile()->getLevels());
+}
+
+// size of all layers and faces of a mip level
+VkDeviceSize getLevelSize(const MemoryImage& memoryImage, uint32_t level)
+{
+  auto texture = memoryImage.getTexture();
+  if (texture != nullptr)
+    return texture->size(level) * texture->layers() * texture->faces();
+  auto textureFile = memoryImage.getTextureFile();
+  return textureFile->size(level) * textureFile->getLayers() * textureFile->getFaces();
+}
+
+uint32_t getLevelDimension(const MemoryImage& memoryImage, uint32_t level)
+{
+  auto texture = memoryImage.getTexture();
+  auto extent  = (texture != nullptr) ? texture->extent(level) : memoryImage.getTextureFile()->getExtent(level);
+  return static_cast<uint32_t>(std::max(extent.x, extent.y));
+}
+
+}
+
+TextureStreamer::StreamedImage::StreamedImage(std::shared_ptr<MemoryImage> mi, uint32_t tl)
+  : memoryImage{ mi }, tailLevel{ tl }, residentLevel{ tl }, targetLevel{ tl }
+{
+  uint32_t levelCount = getLevelCount(*mi);
+  levelSizes.resize(levelCount + 1, 0);
+  for (int32_t level = static_cast<int32_t>(levelCount) - 1; level >= 0; --level)
+    levelSizes[level] = levelSizes[level + 1] + getLevelSize(*mi, level);
+}
+
+TextureStreamer::TextureStreamer(VkDeviceSize mb, VkDeviceSize ub, uint32_t mts)
+  : memoryBudget{ mb }, uploadBudget{ ub }, mipTailSize{ mts }
+{
+}
+
+void TextureStreamer::addImage(std::shared_ptr<MemoryImage> memoryImage)
+{
+  CHECK_LOG_THROW(memoryImage->getTexture() == nullptr && memoryImage->getTextureFile() == nullptr, "TextureStreamer::addImage() : only images created from gli::texture or TextureFile may be streamed");
+  std::lock_guard<std::mutex> lock(mutex);
+  if (findImage(memoryImage.get()) != end(images))
+    return;
+  // mip tail starts at the first level that is not bigger than mipTailSize
+  uint32_t levelCount = getLevelCount(*memoryImage);
+  uint32_t tailLevel  = 0;
+  while (tailLevel < levelCount - 1 && getLevelDimension(*memoryImage, tailLevel) > mipTailSize)
+    tailLevel++;
+  images.push_back(StreamedImage(memoryImage, tailLevel));
+  memoryImage->setResidentMipLevel(tailLevel);
+}
+
+void TextureStreamer::removeImage(std::shared_ptr<MemoryImage> memoryImage)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = findImage(memoryImage.get());
+  if (it != end(images))
+    images.erase(it);
+}
+
+void TextureStreamer::requestMipLevel(std::shared_ptr<MemoryImage> memoryImage, uint32_t mipLevel, float priority)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = findImage(memoryImage.get());
+  CHECK_LOG_THROW(it == end(images), "TextureStreamer::requestMipLevel() : image was not added to streamer");
+  if (it->requested)
+  {
+    it->requestedLevel = std::min(it->requestedLevel, mipLevel);
+    it->priority       = std::max(it->priority, priority);
+  }
+  else
+  {
+    it->requested      = true;
+    it->requestedLevel = mipLevel;
+    it->priority       = priority;
+  }
+}
+
+void TextureStreamer::update()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  images.erase(std::remove_if(begin(images), end(images), [](const StreamedImage& si) { return si.memoryImage.expired(); }), end(images));
+
+  // textures that were not requested since last update need only their mip tails
+  VkDeviceSize residentSize = 0;
+  std::vector<StreamedImage*> order;
+  for (auto& si : images)
+  {
+    si.targetLevel = si.requested ? std::min(si.requestedLevel, si.tailLevel) : si.tailLevel;
+    if (!si.requested)
+      si.priority = -1.0f;
+    residentSize += si.levelSizes[si.residentLevel];
+    order.push_back(&si);
+  }
+  // least important textures first
+  std::stable_sort(begin(order), end(order), [](const StreamedImage* lhs, const StreamedImage* rhs) { return lhs->priority < rhs->priority; });
+
+  // evictableSize is the size of mip levels that are resident, but not needed
+  VkDeviceSize evictableSize = 0;
+  for (auto& si : images)
+    if (si.residentLevel < si.targetLevel)
+      evictableSize += si.levelSizes[si.residentLevel] - si.levelSizes[si.targetLevel];
+
+  auto setResidentLevel = [&residentSize](StreamedImage& si, uint32_t level)
+  {
+    residentSize = residentSize - si.levelSizes[si.residentLevel] + si.levelSizes[level];
+    si.residentLevel = level;
+    si.memoryImage.lock()->setResidentMipLevel(level);
+  };
+  // evict mip levels that are not needed, starting from least important textures, until requiredSize fits in memoryBudget
+  auto evict = [&](VkDeviceSize requiredSize)
+  {
+    for (auto it = begin(order); it != end(order) && residentSize + requiredSize > memoryBudget; ++it)
+    {
+      if ((*it)->residentLevel < (*it)->targetLevel)
+      {
+        evictableSize -= (*it)->levelSizes[(*it)->residentLevel] - (*it)->levelSizes[(*it)->targetLevel];
+        setResidentLevel(**it, (*it)->targetLevel);
+      }
+    }
+  };
+  evict(0);
+
+  // load one more mip level of the textures that need it, starting from most important ones.
+  // Image is recreated when new mip level is added, but levels resident before are copied on GPU, so only the new level is sent.
+  // At least one texture is updated, even if its level is bigger than uploadBudget
+  VkDeviceSize uploadedSize = 0;
+  for (auto it = order.rbegin(); it != order.rend(); ++it)
+  {
+    StreamedImage& si = **it;
+    if (si.targetLevel >= si.residentLevel)
+      continue;
+    uint32_t newLevel         = si.residentLevel - 1;
+    VkDeviceSize requiredSize = si.levelSizes[newLevel] - si.levelSizes[si.residentLevel];
+    if (uploadedSize > 0 && uploadedSize + requiredSize > uploadBudget)
+      break;
+    // don't evict anything when new level will not fit anyway
+    if (residentSize - evictableSize + requiredSize > memoryBudget)
+      continue;
+    evict(requiredSize);
+    setResidentLevel(si, newLevel);
+    uploadedSize += requiredSize;
+  }
+
+  for (auto& si : images)
+    si.requested = false;
+}
+
+void TextureStreamer::setMemoryBudget(VkDeviceSize budget)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  memoryBudget = budget;
+}
+
+void TextureStreamer::setUploadBudget(VkDeviceSize budget)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  uploadBudget = budget;
+}
+
+VkDeviceSize TextureStreamer::getResidentSize() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  VkDeviceSize result = 0;
+  for (const auto& si : images)
+    result += si.levelSizes[si.residentLevel];
+  return result;
+}
+
+std::vector<TextureStreamer::StreamedImage>::iterator TextureStreamer::findImage(MemoryImage* memoryImage)
+{
+  return std::find_if(begin(images), end(images), [memoryImage](const StreamedImage& si) { return si.memoryImage.lock().get() == memoryImage; });
+}
@@ -168,6 +168,89 @@ void StagingBuffer::unmapMemory()
   vkUnmapMemory(device, memory);
 }
 
+StagingRing::StagingRing(Device* d, VkDeviceSize s)
+  : device{ d->device }
+{
+  memorySize = createBuffer(d, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, s, &buffer, &memory);
+  CHECK_LOG_THROW(memorySize == 0, "Cannot create staging ring");
+  VK_CHECK_LOG_THROW(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, (void**)&mappedPointer), "Cannot map staging ring memory");
+  statistics.capacity = memorySize;
+}
+
+StagingRing::~StagingRing()
+{
+  vkUnmapMemory(device, memory);
+  destroyBuffer(device, buffer, memory);
+}
+
+bool StagingRing::acquire(VkDeviceSize size, VkDeviceSize alignment, StagingRegion& region)
+{
+  alignment = std::max<VkDeviceSize>(1, alignment);
+  size      = std::max<VkDeviceSize>(1, size);
+  if (allocations.empty())
+    head = tail = 0;
+
+  // used space lies between tail and head. Allocation that does not fit at the end of a ring starts at its beginning
+  // and the space skipped at the end is added to that allocation, so it will be recycled along with it
+  VkDeviceSize begin = head;
+  VkDeviceSize start = ((head + alignment - 1) / alignment) * alignment;
+  bool fits;
+  if (allocations.empty() || head > tail)
+  {
+    fits = (start + size <= memorySize);
+    if (!fits && size <= (allocations.empty() ? memorySize : tail))
+    {
+      start = 0;
+      fits  = true;
+    }
+  }
+  else
+    fits = (head < tail) && (start + size <= tail);
+  if (!fits)
+  {
+    statistics.stallCount++;
+    return false;
+  }
+
+  allocations.push_back({ begin, start + size, false });
+  head = start + size;
+  tail = allocations.front().begin;
+
+  region.buffer         = buffer;
+  region.offset         = start;
+  region.size           = size;
+  region.mappedPointer  = mappedPointer + start;
+  region.allocationID   = firstAllocationID + allocations.size() - 1;
+  region.fallbackBuffer = nullptr;
+
+  statistics.allocationCount++;
+  statistics.usedBytes     = (head > tail) ? (head - tail) : (memorySize - tail + head);
+  statistics.peakUsedBytes = std::max(statistics.peakUsedBytes, statistics.usedBytes);
+  return true;
+}
+
+void StagingRing::release(const StagingRegion& region)
+{
+  CHECK_LOG_THROW(region.allocationID < firstAllocationID || region.allocationID >= firstAllocationID + allocations.size(), "Cannot release staging region that was not acquired from this ring");
+  allocations[region.allocationID - firstAllocationID].released = true;
+  // recycle all released regions at the tail of the ring
+  while (!allocations.empty() && allocations.front().released)
+  {
+    allocations.pop_front();
+    firstAllocationID++;
+  }
+  if (allocations.empty())
+    head = tail = 0;
+  else
+    tail = allocations.front().begin;
+  statistics.usedBytes = allocations.empty() ? 0 : ((head > tail) ? (head - tail) : (memorySize - tail + head));
+}
+
+StagingRingStatistics StagingRing::getStatistics() const
+{
+  return statistics;
+}
+
 
 
 
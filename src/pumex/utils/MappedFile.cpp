@@ -0,0 +1,80 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#include <pumex/utils/MappedFile.h>
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+using namespace pumex;
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+#if defined(_WIN32)
+  HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (fileHandle == INVALID_HANDLE_VALUE)
+    return;
+  file = fileHandle;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    return;
+  mapping = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+    return;
+  mapped = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mapped != nullptr)
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+  file = open(fileName.c_str(), O_RDONLY);
+  if (file < 0)
+    return;
+  struct stat fileStat;
+  if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    return;
+  void* ptr = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+  if (ptr == MAP_FAILED)
+    return;
+  mapped     = static_cast<const char*>(ptr);
+  mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+  if (mapped != nullptr)
+    UnmapViewOfFile(mapped);
+  if (mapping != nullptr)
+    CloseHandle(mapping);
+  if (file != nullptr)
+    CloseHandle(file);
+#else
+  if (mapped != nullptr)
+    munmap(const_cast<char*>(mapped), mappedSize);
+  if (file >= 0)
+    close(file);
+#endif
+}